@@ -0,0 +1,191 @@
+#include <chrono>
+
+#include "daisydata.h"
+#include "asc500_acquisition.h"
+
+
+namespace asc500
+{
+
+std::atomic<SpscRing *> Acquisition::s_rings[ASC500_DATA_CHANNELS];
+std::atomic<int> Acquisition::s_busy[ASC500_DATA_CHANNELS];
+
+
+/** \brief Wait strategy for an empty ring: spin, then yield, then sleep.
+ *
+ * \param idle unsigned& Number of consecutive empty polls, updated.
+ * \return void
+ *
+ */
+static void backoff(unsigned &idle)
+{
+    if(idle >= 128)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    else if(idle >= 64)
+        std::this_thread::yield();
+    idle++;
+}
+
+
+Acquisition::Acquisition(const size_t ringWords)
+    : _ringWords(ringWords)
+{
+}
+
+
+Acquisition::~Acquisition()
+{
+    for(int32_t channel = 0; channel < ASC500_DATA_CHANNELS; channel++)
+        detach(channel);
+}
+
+
+bool Acquisition::validChannel(const int32_t channel)
+{
+    return channel >= 0 && channel < ASC500_DATA_CHANNELS;
+}
+
+
+/** \brief Data callback registered for all attached channels.
+ *
+ * Runs in the event loop thread; the only work is the copy into the ring.
+ *
+ */
+void Acquisition::dataCallback(Int32 channel, Int32 length, Int32 index,
+                               const Int32 *data, const DYB_Meta *meta)
+{
+    if(!validChannel(channel))
+        return;
+
+    s_busy[channel].fetch_add(1);
+    SpscRing *ring = s_rings[channel].load();
+    if(ring)
+        ring->push(channel, index, length, data, meta);
+    s_busy[channel].fetch_sub(1, std::memory_order_release);
+}
+
+
+DYB_Rc Acquisition::attach(const int32_t channel)
+{
+    if(!validChannel(channel) || _channels[channel].ring)
+        return DYB_OutOfRange;
+
+    std::unique_ptr<SpscRing> ring(new SpscRing(_ringWords));
+    SpscRing *expected = nullptr;
+    if(!s_rings[channel].compare_exchange_strong(expected, ring.get()))
+        return DYB_OutOfRange; /* Owned by another instance */
+
+    /* Callbacks are only served for unbuffered channels */
+    DYB_Rc rc = DYB_configureDataBuffering(channel, 0);
+    if(rc == DYB_Ok)
+        rc = DYB_setDataCallback(channel, dataCallback);
+
+    if(rc != DYB_Ok)
+    {
+        s_rings[channel].store(nullptr);
+        return rc;
+    }
+
+    _channels[channel].ring = std::move(ring);
+    _losses.reset(channel);
+    return DYB_Ok;
+}
+
+
+DYB_Rc Acquisition::detach(const int32_t channel)
+{
+    if(!validChannel(channel) || !_channels[channel].ring)
+        return DYB_OutOfRange;
+
+    DYB_Rc rc = DYB_setDataCallback(channel, NULL);
+    stopWorker(channel);
+    s_rings[channel].store(nullptr);
+
+    /* A callback may still be running in the event loop thread */
+    while(s_busy[channel].load())
+        std::this_thread::yield();
+    _channels[channel].ring.reset();
+    return rc;
+}
+
+
+size_t Acquisition::poll(const int32_t channel, const PacketHandler &handler, const size_t maxPackets)
+{
+    if(!validChannel(channel) || !_channels[channel].ring)
+        return 0;
+
+    SpscRing &ring = *_channels[channel].ring;
+    DataPacket packet;
+    size_t count = 0;
+
+    while((maxPackets == 0 || count < maxPackets) && ring.front(packet))
+    {
+        _losses.feed(channel, packet.index, packet.length, &packet.meta);
+        handler(packet);
+        ring.pop();
+        count++;
+    }
+    return count;
+}
+
+
+void Acquisition::workerLoop(const int32_t channel, PacketHandler handler)
+{
+    Channel &ch = _channels[channel];
+    unsigned idle = 0;
+
+    while(true)
+    {
+        if(poll(channel, handler) > 0)
+            idle = 0;
+        else if(ch.running.load(std::memory_order_acquire))
+            backoff(idle);
+        else
+            break;
+    }
+}
+
+
+DYB_Rc Acquisition::startWorker(const int32_t channel, PacketHandler handler)
+{
+    if(!validChannel(channel) || !_channels[channel].ring || _channels[channel].worker.joinable())
+        return DYB_OutOfRange;
+
+    _channels[channel].running.store(true);
+    _channels[channel].worker = std::thread(&Acquisition::workerLoop, this, channel, std::move(handler));
+    return DYB_Ok;
+}
+
+
+void Acquisition::stopWorker(const int32_t channel)
+{
+    if(!validChannel(channel) || !_channels[channel].worker.joinable())
+        return;
+
+    _channels[channel].running.store(false);
+    _channels[channel].worker.join();
+}
+
+
+uint64_t Acquisition::droppedPackets(const int32_t channel) const
+{
+    if(!validChannel(channel) || !_channels[channel].ring)
+        return 0;
+    return _channels[channel].ring->dropped();
+}
+
+
+DYB_Rc Acquisition::lossStats(const int32_t channel, ContinuityStats &stats) const
+{
+    return _losses.stats(channel, stats);
+}
+
+
+size_t Acquisition::pending(const int32_t channel) const
+{
+    if(!validChannel(channel) || !_channels[channel].ring)
+        return 0;
+    return _channels[channel].ring->used();
+}
+
+} /* namespace asc500 */
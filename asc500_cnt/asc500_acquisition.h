@@ -0,0 +1,146 @@
+/** \file asc500_acquisition.h
+ * \brief Callback based data acquisition decoupled from the event loop.
+ *
+ * A data callback of daisybase runs in the context of the event loop thread;
+ * if it is not processed fast enough, data may be lost. The acquisition layer
+ * registers a thin callback for each attached channel that only copies the
+ * packet into a per channel SpscRing. Worker threads (or the application via
+ * poll()) drain the rings at their own pace.
+ *
+ * To use the data channels they must be enabled by using ID_DATA_EN.
+ */
+
+#ifndef __ASC500_ACQUISITION_H
+#define __ASC500_ACQUISITION_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "daisybase.h"
+#include "asc500.h"
+#include "asc500_continuity.h"
+#include "asc500_spscring.h"
+
+
+namespace asc500
+{
+
+class Acquisition
+{
+public:
+    typedef std::function<void(const DataPacket &)> PacketHandler;
+
+    /** \brief Create an acquisition layer.
+     *
+     * \param ringWords const size_t Ring capacity per channel in 32 bit words.
+     *
+     */
+    explicit Acquisition(const size_t ringWords = 1 << 20);
+    ~Acquisition();
+
+    Acquisition(const Acquisition &) = delete;
+    Acquisition &operator=(const Acquisition &) = delete;
+
+    /** \brief Disable buffering for the channel and register the ring callback.
+     *
+     * \param channel const int32_t Data channel (0..ASC500_DATA_CHANNELS-1).
+     * \return DYB_Rc DYB_OutOfRange if the channel is invalid or already attached.
+     *
+     */
+    DYB_Rc attach(const int32_t channel);
+
+    /** \brief Unregister the callback and stop the worker of the channel.
+     *
+     * \param channel const int32_t Data channel.
+     * \return DYB_Rc Checks for success or failure.
+     *
+     */
+    DYB_Rc detach(const int32_t channel);
+
+    /** \brief Drain a channel on the calling thread.
+     *
+     * Must not be mixed with a running worker on the same channel.
+     *
+     * \param channel const int32_t Data channel.
+     * \param handler const PacketHandler& Called for every packet.
+     * \param maxPackets const size_t Stop after this many packets (0 = all available).
+     * \return size_t Number of packets handled.
+     *
+     */
+    size_t poll(const int32_t channel, const PacketHandler &handler, const size_t maxPackets = 0);
+
+    /** \brief Start a worker thread that drains the channel.
+     *
+     * \param channel const int32_t Data channel, must be attached.
+     * \param handler PacketHandler Called in the worker context for every packet.
+     * \return DYB_Rc DYB_OutOfRange if the channel is not attached or has a worker.
+     *
+     */
+    DYB_Rc startWorker(const int32_t channel, PacketHandler handler);
+
+    /** \brief Stop the worker of a channel after it has drained the ring.
+     *
+     * \param channel const int32_t Data channel.
+     * \return void
+     *
+     */
+    void stopWorker(const int32_t channel);
+
+    /** \brief Packets dropped on the channel because the ring was full.
+     *
+     * \param channel const int32_t Data channel.
+     * \return uint64_t Dropped packets since attach().
+     *
+     */
+    uint64_t droppedPackets(const int32_t channel) const;
+
+    /** \brief Sample loss statistics derived from the packet indices.
+     *
+     * Covers both packets dropped by a full ring and data lost before
+     * they reached the client.
+     *
+     * \param channel const int32_t Data channel.
+     * \param stats ContinuityStats& Output: statistics.
+     * \return DYB_Rc DYB_OutOfRange for an invalid channel.
+     *
+     */
+    DYB_Rc lossStats(const int32_t channel, ContinuityStats &stats) const;
+
+    /** \brief Ring fill level of the channel.
+     *
+     * \param channel const int32_t Data channel.
+     * \return size_t Occupied words.
+     *
+     */
+    size_t pending(const int32_t channel) const;
+
+private:
+    struct Channel
+    {
+        std::unique_ptr<SpscRing> ring;
+        std::thread worker;
+        std::atomic<bool> running;
+
+        Channel() : running(false) {}
+    };
+
+    static void dataCallback(Int32 channel, Int32 length, Int32 index,
+                             const Int32 *data, const DYB_Meta *meta);
+    static bool validChannel(const int32_t channel);
+    void workerLoop(const int32_t channel, PacketHandler handler);
+
+    /* Rings reachable from the static callback, one owner per channel */
+    static std::atomic<SpscRing *> s_rings[ASC500_DATA_CHANNELS];
+    static std::atomic<int> s_busy[ASC500_DATA_CHANNELS];
+
+    size_t _ringWords;
+    Channel _channels[ASC500_DATA_CHANNELS];
+    LossMonitor _losses;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <limits>
+
+#include "asc500_assembler.h"
+#include "asc500_convert.h"
+#include "asc500_coords.h"
+
+
+namespace asc500
+{
+
+FrameAssembler::FrameAssembler()
+    : _grids(2), _columns(0), _rows(0), _frame(-1), _frameStart(0), _next(0), _linesDone(0)
+{
+    _forward[0] = _forward[1] = true;
+}
+
+
+const Flt32 *FrameAssembler::forwardPlane() const
+{
+    return _forward[0] ? plane(0) : _forward[1] ? plane(1) : NULL;
+}
+
+
+const Flt32 *FrameAssembler::backwardPlane() const
+{
+    return !_forward[0] ? plane(0) : !_forward[1] ? plane(1) : NULL;
+}
+
+
+DYB_Rc FrameAssembler::configure(const DYB_Meta *meta)
+{
+    std::shared_ptr<const CoordGrid> grid = _grids.get(meta);
+    if(!grid)
+        return DYB_OutOfRange;
+
+    if(grid != _grid)
+    {
+        /* New geometry: the current frame can't be continued */
+        _grid = grid;
+        _columns = grid->pointsX();
+        _rows = grid->pointsY();
+        _forward[0] = grid->lineForward()[0] != 0;
+        _forward[1] = grid->lineForward()[_columns] != 0;
+        for(std::vector<Flt32> &plane : _planes)
+            plane.assign(static_cast<size_t>(_columns) * _rows, std::numeric_limits<Flt32>::quiet_NaN());
+        _line.resize(2 * static_cast<size_t>(_columns));
+        _frame = -1;
+        _next = 0;
+    }
+
+    /* Value scaling is not part of the geometry and may change any time */
+    _meta = *meta;
+    return DYB_Ok;
+}
+
+
+void FrameAssembler::startFrame(const int64_t start)
+{
+    _frame++;
+    _frameStart = start;
+    _linesDone = 0;
+    for(std::vector<Flt32> &plane : _planes)
+        std::fill(plane.begin(), plane.end(), std::numeric_limits<Flt32>::quiet_NaN());
+}
+
+
+DYB_Rc FrameAssembler::push(const int32_t index, const int32_t length, const int32_t *data, const DYB_Meta *meta)
+{
+    if(length <= 0)
+        return DYB_Ok;
+
+    const DYB_Rc rc = configure(meta);
+    if(rc != DYB_Ok)
+        return rc;
+
+    const int32_t *column = _grid->lineColumns();
+    const int64_t lineSize = 2 * static_cast<int64_t>(_columns),
+                  frameSize = lineSize * _rows,
+                  end = static_cast<int64_t>(index) + length;
+    int64_t position = index;
+
+    /* Every frame begins with a packet of index 0; an index going back also means a new frame */
+    if(_frame < 0 || (index == 0 && _next > 0) || index < _next)
+        startFrame(index - index % frameSize);
+
+    while(position < end)
+    {
+        /* Continuous indices across frames, should the server deliver them */
+        if(position - _frameStart >= frameSize)
+            startFrame(position - (position - _frameStart) % frameSize);
+
+        const int64_t inFrame = position - _frameStart;
+        const int32_t line = static_cast<int32_t>(inFrame / lineSize),
+                      first = static_cast<int32_t>(inFrame % lineSize),
+                      count = static_cast<int32_t>(end - position < lineSize - first ? end - position
+                                                                                    : lineSize - first),
+                      last = first + count;
+
+        /* Row 0 is the top line */
+        const int32_t row = _rows - 1 - scanLine(line, _rows, _frame % 2 != 0);
+        Flt32 *pass0 = _planes[0].data() + static_cast<size_t>(row) * _columns,
+              *pass1 = _planes[1].data() + static_cast<size_t>(row) * _columns;
+
+        convValues2Phys(&_meta, data + (position - index), count, _line.data() + first);
+        for(int32_t q = first; q < std::min(last, _columns); q++)
+            pass0[column[q]] = _line[q];
+        for(int32_t q = std::max(first, _columns); q < last; q++)
+            pass1[column[q]] = _line[q];
+
+        position += count;
+        _next = position;
+        if(last == lineSize)
+        {
+            _linesDone++;
+            if(_lineHandler)
+                _lineHandler(*this, row);
+            if(line == _rows - 1 && _frameHandler)
+                _frameHandler(*this);
+        }
+    }
+    return DYB_Ok;
+}
+
+} /* namespace asc500 */
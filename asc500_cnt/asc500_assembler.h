@@ -0,0 +1,148 @@
+/** \file asc500_assembler.h
+ * \brief Incremental de-interleaving of scan data into image planes.
+ *
+ * A data line of a scan holds 2 * _pointsX values: the first pass across the
+ * line followed by the second one, in the directions given by the DYB_Order
+ * (FfScan, FbScan, BbScan, BfScan). Successive frames alternate between
+ * bottom-to-top and top-to-bottom.
+ *
+ * FrameAssembler takes the packets as they arrive (e.g. from an Acquisition
+ * worker), converts the values of each line with the batch kernels of
+ * asc500_convert.h and writes them to their place in one of two planes, one
+ * per pass. The planes are in display
+ * orientation: row 0 is the top line, column 0 the left column, independent
+ * of scan direction and frame parity. Column positions come from the
+ * CoordGrid of the geometry, so there is no second pass over the data.
+ *
+ * The line handler is called when both passes of a line have arrived, the
+ * frame handler when the last line of a frame has arrived. Both run in the
+ * context of push() and may read the planes; the planes are reset to NaN
+ * when the next frame begins.
+ */
+
+#ifndef __ASC500_ASSEMBLER_H
+#define __ASC500_ASSEMBLER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500_gridcache.h"
+#include "asc500_spscring.h"
+
+
+namespace asc500
+{
+
+class FrameAssembler
+{
+public:
+    typedef std::function<void(const FrameAssembler &assembler, const int32_t row)> LineHandler;
+    typedef std::function<void(const FrameAssembler &assembler)> FrameHandler;
+
+    FrameAssembler();
+
+    FrameAssembler(const FrameAssembler &) = delete;
+    FrameAssembler &operator=(const FrameAssembler &) = delete;
+
+    /** \brief Set the handler for completed lines.
+     *
+     * \param handler LineHandler Called with the display row of the line.
+     * \return void
+     *
+     */
+    void onLine(LineHandler handler) { _lineHandler = handler; }
+
+    /** \brief Set the handler for completed frames.
+     *
+     * \param handler FrameHandler Called after the last line of a frame.
+     * \return void
+     *
+     */
+    void onFrame(FrameHandler handler) { _frameHandler = handler; }
+
+    /** \brief Scatter a packet into the planes.
+     *
+     * A packet with index 0 or an index below the end of the previous packet
+     * starts a new frame, as does a new geometry. The first frame pushed is
+     * taken as the first frame of the scan (bottom to top); the Y direction
+     * alternates with every frame started.
+     *
+     * \param index const int32_t Index of the first item.
+     * \param length const int32_t Number of items.
+     * \param data const int32_t* Raw data.
+     * \param meta const DYB_Meta* Meta data belonging to the packet.
+     * \return DYB_Rc DYB_OutOfRange if the data are not a scan.
+     *
+     */
+    DYB_Rc push(const int32_t index, const int32_t length, const int32_t *data, const DYB_Meta *meta);
+
+    /** \brief Scatter a packet of the acquisition layer into the planes.
+     *
+     * \param packet const DataPacket& The packet.
+     * \return DYB_Rc See above.
+     *
+     */
+    DYB_Rc push(const DataPacket &packet) { return push(packet.index, packet.length, packet.data, &packet.meta); }
+
+    /** \brief Image of a pass in display orientation.
+     *
+     * \param pass const int32_t 0 = first pass of the lines, 1 = second pass.
+     * \return const Flt32* rows() * columns() values, NaN where not yet scanned.
+     *
+     */
+    const Flt32 *plane(const int32_t pass) const { return _planes[pass].data(); }
+
+    /** \brief Scan direction of a pass.
+     *
+     * \param pass const int32_t 0 or 1.
+     * \return bool True if the pass runs forward (left to right).
+     *
+     */
+    bool isForward(const int32_t pass) const { return _forward[pass]; }
+
+    /** \brief Image of the forward scan.
+     *
+     * \return const Flt32* First forward pass; NULL for BbScan.
+     *
+     */
+    const Flt32 *forwardPlane() const;
+
+    /** \brief Image of the backward scan.
+     *
+     * \return const Flt32* First backward pass; NULL for FfScan.
+     *
+     */
+    const Flt32 *backwardPlane() const;
+
+    int32_t columns() const { return _columns; }     /**< Values per row                   */
+    int32_t rows() const { return _rows; }           /**< Rows of a plane                  */
+    int64_t frame() const { return _frame; }         /**< Frames started since the scan start */
+    int32_t linesDone() const { return _linesDone; } /**< Lines completed in the frame     */
+    const DYB_Meta &meta() const { return _meta; }   /**< Meta data of the current frame   */
+
+private:
+    DYB_Rc configure(const DYB_Meta *meta);
+    void startFrame(const int64_t start);
+
+    CoordGridCache _grids;
+    std::shared_ptr<const CoordGrid> _grid;
+    DYB_Meta _meta;
+    std::vector<Flt32> _planes[2];
+    bool _forward[2];
+    int32_t _columns;
+    int32_t _rows;
+    int64_t _frame;
+    int64_t _frameStart;       /* Index of the first item of the frame */
+    int64_t _next;             /* Index after the last item received   */
+    int32_t _linesDone;
+    std::vector<Flt32> _line;  /* Converted values of a line, in scan order */
+    LineHandler _lineHandler;
+    FrameHandler _frameHandler;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "asc500_batch.h"
+#include "asc500_events.h"
+
+
+namespace asc500
+{
+
+static uint64_t keyOf(const DYB_Address address, const int32_t index)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(address)) << 32) | static_cast<uint32_t>(index);
+}
+
+
+AckState::Result AckState::onEvent(const int32_t value)
+{
+    /* The requested value, or the same differing value once more after the
+     * read back (the server has limited it) */
+    if(value == _requested || (_fenced && _candidate && value == _value))
+        return Accept;
+
+    /* A limited value or a notification caused by another request */
+    const bool first = !_candidate;
+    _candidate = true;
+    _value = value;
+    return first && !_fenced ? ReadBack : Ignore;
+}
+
+
+DYB_Rc setParameterBatch(ParamEntry *entries, const size_t count, const int32_t timeout)
+{
+    std::mutex lock;
+    std::condition_variable done;
+    std::unordered_map<uint64_t, std::vector<size_t> > pending;  /* Sent, not acknowledged */
+    std::vector<AckState> states;
+    std::vector<size_t> readBack;                                /* Entries to fence */
+    size_t open = 0;
+    bool fence = false;
+    DYB_Rc rc = DYB_Ok;
+
+    if(count == 0)
+        return DYB_Ok;
+
+    states.reserve(count);
+    for(size_t k = 0; k < count; k++)
+    {
+        entries[k].acknowledged = false;
+        states.push_back(AckState(entries[k].value));
+    }
+
+    const int32_t token = EventHub::subscribe([&](const DYB_Address address, const int32_t index, const int32_t value)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = pending.find(keyOf(address, index));
+        if(found == pending.end())
+            return;
+
+        std::vector<size_t> &waiting = found->second;
+        for(size_t w = 0; w < waiting.size(); )
+        {
+            const size_t k = waiting[w];
+            const AckState::Result result = states[k].onEvent(value);
+            if(result == AckState::Accept)
+            {
+                entries[k].returned = value;
+                entries[k].acknowledged = true;
+                waiting.erase(waiting.begin() + w);
+                open--;
+                continue;
+            }
+            if(result == AckState::ReadBack)
+            {
+                readBack.push_back(k);
+                fence = true;
+            }
+            w++;
+        }
+        if(waiting.empty())
+            pending.erase(found);
+        if(open == 0 || fence)
+            done.notify_one();
+    });
+
+    for(size_t k = 0; k < count; k++)
+    {
+        {
+            /* Registered before sending, the answer may come at once */
+            std::lock_guard<std::mutex> guard(lock);
+            pending[keyOf(entries[k].address, entries[k].index)].push_back(k);
+            open++;
+        }
+        const DYB_Rc sent = DYB_setParameterAsync(entries[k].address, entries[k].index, entries[k].value);
+        if(sent != DYB_Ok)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            std::vector<size_t> &waiting = pending[keyOf(entries[k].address, entries[k].index)];
+            waiting.erase(std::find(waiting.begin(), waiting.end(), k));
+            open--;
+            if(rc == DYB_Ok)
+                rc = sent;
+        }
+    }
+
+    {
+        const std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        std::unique_lock<std::mutex> guard(lock);
+        while(open > 0)
+        {
+            if(fence)
+            {
+                /* Read back the entries with a differing value; the answer
+                 * comes after the set has been processed */
+                std::vector<size_t> fenced;
+                fenced.swap(readBack);
+                for(const size_t k : fenced)
+                    states[k].fence();
+                fence = false;
+                guard.unlock();
+                for(const size_t k : fenced)
+                    DYB_getParameterAsync(entries[k].address, entries[k].index);
+                guard.lock();
+                continue;
+            }
+            if(done.wait_until(guard, deadline) == std::cv_status::timeout && !fence && open > 0)
+            {
+                if(rc == DYB_Ok)
+                    rc = DYB_Timeout;
+                break;
+            }
+        }
+    }
+
+    EventHub::unsubscribe(token);
+    return rc;
+}
+
+
+size_t countLimited(const ParamEntry *entries, const size_t count)
+{
+    size_t limited = 0;
+    for(size_t k = 0; k < count; k++)
+    {
+        if(!entries[k].acknowledged || entries[k].returned != entries[k].value)
+            limited++;
+    }
+    return limited;
+}
+
+} /* namespace asc500 */
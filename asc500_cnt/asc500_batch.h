@@ -0,0 +1,119 @@
+/** \file asc500_batch.h
+ * \brief Setting many parameters with a single wait.
+ *
+ * DYB_setParameterSync costs a round trip per parameter. setParameterBatch
+ * sends all values with DYB_setParameterAsync back to back and then waits
+ * once until the server has acknowledged every (address, index) of the
+ * batch by an event. The acknowledged value, which may have been limited
+ * by the server, is returned per entry.
+ *
+ * Acknowledgements are observed through the EventHub; see asc500_events.h.
+ * An entry is only acknowledged by an event that arrives after it has been
+ * registered for sending and that carries the requested value. An event
+ * with a different value may be a notification caused by another entry of
+ * the batch, so it isn't trusted: the entry is read back by
+ * DYB_getParameterAsync, and the value is accepted once an event after the
+ * read back confirms it (the server has limited it). This costs one more
+ * round trip for limited entries only. An event with the requested value
+ * caused by another entry is still taken as the acknowledgement, as the
+ * parameter already has the requested value then. AckState implements this
+ * rule for one request; the coroutine client (asc500_coro.h) uses it too.
+ */
+
+#ifndef __ASC500_BATCH_H
+#define __ASC500_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "daisybase.h"
+
+
+namespace asc500
+{
+
+/** \brief One parameter of a batch.
+ */
+struct ParamEntry
+{
+    DYB_Address address;       /**< Parameter address                          */
+    int32_t index;             /**< Subaddress, 0 if not applicable            */
+    int32_t value;             /**< Value to set                               */
+    int32_t returned;          /**< Output: value acknowledged by the server   */
+    bool acknowledged;         /**< Output: acknowledgement has arrived        */
+};
+
+
+/** \brief Acknowledgement state of one set request.
+ *
+ * Fed with the events of the parameter that arrive after the request has
+ * been registered. The first event with a differing value asks for a read
+ * back; the caller calls fence() just before sending it, and the differing
+ * value is accepted once an event after the fence confirms it.
+ */
+class AckState
+{
+public:
+    enum Result
+    {
+        Accept,                /**< The event acknowledges the request         */
+        ReadBack,              /**< Read the parameter back, then fence()      */
+        Ignore                 /**< Not an acknowledgement (yet)               */
+    };
+
+    /** \brief Start waiting for a requested value.
+     *
+     * \param requested const int32_t Value that has been set.
+     *
+     */
+    explicit AckState(const int32_t requested = 0)
+        : _requested(requested), _value(0), _candidate(false), _fenced(false) {}
+
+    /** \brief Classify an event of the parameter.
+     *
+     * \param value const int32_t Value carried by the event.
+     * \return Result Accept if value is the acknowledged value.
+     *
+     */
+    Result onEvent(const int32_t value);
+
+    /** \brief Mark the read back as sent; only later events confirm the candidate.
+     *
+     * \return void
+     *
+     */
+    void fence() { _fenced = true; }
+
+private:
+    int32_t _requested;
+    int32_t _value;            /* Value of the last differing event           */
+    bool _candidate;           /* An event with a different value has arrived */
+    bool _fenced;              /* Read back requested after the candidate     */
+};
+
+
+/** \brief Set parameters and wait for all acknowledgements at once.
+ *
+ * Must not be called in the context of a data or event callback.
+ *
+ * \param entries ParamEntry* Parameters, sent in this order.
+ * \param count const size_t Number of entries.
+ * \param timeout const int32_t Maximum wait for the acknowledgements [ms].
+ * \return DYB_Rc First error of DYB_setParameterAsync, DYB_Timeout if not
+ *         every entry has been acknowledged in time.
+ *
+ */
+DYB_Rc setParameterBatch(ParamEntry *entries, const size_t count, const int32_t timeout = 1000);
+
+/** \brief Number of entries whose acknowledged value differs from the request.
+ *
+ * \param entries const ParamEntry* Entries after setParameterBatch().
+ * \param count const size_t Number of entries.
+ * \return size_t Entries that have been limited or rejected.
+ *
+ */
+size_t countLimited(const ParamEntry *entries, const size_t count);
+
+} /* namespace asc500 */
+
+#endif
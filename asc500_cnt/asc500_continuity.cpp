@@ -0,0 +1,168 @@
+#include <cstring>
+
+#include "asc500_continuity.h"
+
+
+namespace asc500
+{
+
+/** \brief Number of data in a complete frame if the data stem from a scan.
+ *
+ * Every line is scanned forward and backward, so a frame holds two
+ * values per pixel.
+ *
+ * \param meta const DYB_Meta* Meta data set.
+ * \return int64_t Frame size [items]; 0 if the data order is not a scan.
+ *
+ */
+static int64_t scanFrameSize(const DYB_Meta *meta)
+{
+    if(!meta)
+        return 0;
+
+    switch(meta->_order)
+    {
+    case DYB_FfScan:
+    case DYB_FbScan:
+    case DYB_BbScan:
+    case DYB_BfScan:
+        return 2 * static_cast<int64_t>(meta->_pointsX) * meta->_pointsY;
+    default:
+        return 0;
+    }
+}
+
+
+ContinuityTracker::ContinuityTracker()
+{
+    reset();
+}
+
+
+void ContinuityTracker::reset()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+
+    _started = false;
+    _expected = 0;
+    _frameSize = 0;
+    memset(&_stats, 0, sizeof(_stats));
+    _start = _windowStart = Clock::now();
+    _windowDrops = 0;
+}
+
+
+/** \brief Drop rate of the last complete window as seen at a time.
+ *
+ * \param now const Clock::time_point Current time.
+ * \return double Drops per second.
+ *
+ */
+double ContinuityTracker::windowRate(const Clock::time_point now) const
+{
+    const double elapsed = std::chrono::duration<double>(now - _windowStart).count();
+
+    if(elapsed < 1.0)
+        return _stats.dropsPerSec;
+    /* An idle period longer than one window means no drops lately */
+    return elapsed < 2.0 ? _windowDrops / elapsed : 0.0;
+}
+
+
+void ContinuityTracker::rollWindow(const Clock::time_point now)
+{
+    if(now - _windowStart >= std::chrono::seconds(1))
+    {
+        _stats.dropsPerSec = windowRate(now);
+        _windowDrops = 0;
+        _windowStart = now;
+    }
+}
+
+
+void ContinuityTracker::countDrop(const uint64_t lost, const Clock::time_point now)
+{
+    _stats.drops++;
+    _stats.lostSamples += lost;
+    if(lost > _stats.longestGap)
+        _stats.longestGap = lost;
+    rollWindow(now);
+    _windowDrops++;
+}
+
+
+int64_t ContinuityTracker::feed(const int32_t index, const int32_t length, const DYB_Meta *meta)
+{
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> guard(_lock);
+    int64_t lost = 0;
+
+    if(_started)
+    {
+        if(index > _expected)
+        {
+            lost = index - _expected;
+        }
+        else if(index < _expected)
+        {
+            _stats.resets++;
+            /* A scan frame restarted early: the rest of the frame is missing */
+            if(index == 0 && _frameSize > 0 && _expected < _frameSize)
+                lost = _frameSize - _expected;
+        }
+        if(lost > 0)
+            countDrop(static_cast<uint64_t>(lost), now);
+        else
+            rollWindow(now);
+    }
+
+    _started = true;
+    _frameSize = scanFrameSize(meta);
+    _expected = static_cast<int64_t>(index) + (length > 0 ? length : 0);
+    _stats.packets++;
+    _stats.samples += length > 0 ? length : 0;
+    return lost;
+}
+
+
+ContinuityStats ContinuityTracker::stats() const
+{
+    const Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> guard(_lock);
+    ContinuityStats stats = _stats;
+
+    /* The rates are evaluated at the time of reading, so they decay when
+     * the packets stop */
+    const double total = std::chrono::duration<double>(now - _start).count();
+    stats.dropsPerSec = windowRate(now);
+    stats.avgDropsPerSec = total > 0.0 ? stats.drops / total : 0.0;
+    return stats;
+}
+
+
+int64_t LossMonitor::feed(const int32_t channel, const int32_t index, const int32_t length,
+                          const DYB_Meta *meta)
+{
+    if(channel < 0 || channel >= ASC500_DATA_CHANNELS)
+        return -1;
+    return _trackers[channel].feed(index, length, meta);
+}
+
+
+DYB_Rc LossMonitor::stats(const int32_t channel, ContinuityStats &stats) const
+{
+    if(channel < 0 || channel >= ASC500_DATA_CHANNELS)
+        return DYB_OutOfRange;
+    stats = _trackers[channel].stats();
+    return DYB_Ok;
+}
+
+
+void LossMonitor::reset(const int32_t channel)
+{
+    for(int32_t ch = 0; ch < ASC500_DATA_CHANNELS; ch++)
+        if(channel < 0 || channel == ch)
+            _trackers[ch].reset();
+}
+
+} /* namespace asc500 */
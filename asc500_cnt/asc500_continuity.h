@@ -0,0 +1,140 @@
+/** \file asc500_continuity.h
+ * \brief Sample loss accounting based on the data index stream.
+ *
+ * The index delivered with every data packet (DYB_DataCallback) or buffer
+ * (DYB_getDataBuffer) counts the data since the begin of the measurement,
+ * including data lost due to performance problems of the control PC.
+ * A ContinuityTracker compares each index with the one expected from the
+ * previous packet and classifies the difference:
+ *
+ * - equal: continuous data,
+ * - larger: a gap, i.e. samples have been lost,
+ * - smaller: a legitimate reset. Scans start every frame with index 0;
+ *   timer triggered channels reset the index from time to time to avoid
+ *   overflow. If a scan frame is restarted before it was complete, the
+ *   missing rest of the frame is accounted as lost.
+ *
+ * Partial buffers (DYB_getDataBuffer with fullOnly=0) return the same frame
+ * repeatedly; only the newly arrived part must be fed.
+ */
+
+#ifndef __ASC500_CONTINUITY_H
+#define __ASC500_CONTINUITY_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "daisybase.h"
+#include "asc500.h"
+
+
+namespace asc500
+{
+
+/** \brief Snapshot of the loss statistics of one channel.
+ */
+struct ContinuityStats
+{
+    uint64_t packets;        /**< Packets seen                                 */
+    uint64_t samples;        /**< Samples received                             */
+    uint64_t drops;          /**< Number of gaps (drop events)                 */
+    uint64_t lostSamples;    /**< Cumulative number of lost samples            */
+    uint64_t longestGap;     /**< Largest single gap [samples]                 */
+    uint64_t resets;         /**< Legitimate index resets (frames, overflow)   */
+    double dropsPerSec;      /**< Drop events in the last complete second      */
+    double avgDropsPerSec;   /**< Drop events per second since the start       */
+};
+
+
+class ContinuityTracker
+{
+public:
+    ContinuityTracker();
+
+    /** \brief Account for a packet or buffer.
+     *
+     * \param index const int32_t Index of the first item.
+     * \param length const int32_t Number of items.
+     * \param meta const DYB_Meta* Meta data, used to find the frame size of scans.
+     * \return int64_t Number of samples lost before this packet (0 if continuous).
+     *
+     */
+    int64_t feed(const int32_t index, const int32_t length, const DYB_Meta *meta);
+
+    /** \brief Current statistics.
+     *
+     * The drop rates are those at the time of the call, also if no packet
+     * has arrived for a while.
+     *
+     * \return ContinuityStats Consistent snapshot.
+     *
+     */
+    ContinuityStats stats() const;
+
+    /** \brief Forget all history, e.g. after reconfiguring the channel.
+     *
+     * \return void
+     *
+     */
+    void reset();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void countDrop(const uint64_t lost, const Clock::time_point now);
+    double windowRate(const Clock::time_point now) const;
+    void rollWindow(const Clock::time_point now);
+
+    mutable std::mutex _lock;
+    bool _started;
+    int64_t _expected;
+    int64_t _frameSize;
+    ContinuityStats _stats;
+    Clock::time_point _start;
+    Clock::time_point _windowStart;
+    uint64_t _windowDrops;
+};
+
+
+/** \brief Continuity trackers for all data channels of the controller.
+ */
+class LossMonitor
+{
+public:
+    /** \brief Account for a packet or buffer of a channel.
+     *
+     * \param channel const int32_t Data channel.
+     * \param index const int32_t Index of the first item.
+     * \param length const int32_t Number of items.
+     * \param meta const DYB_Meta* Meta data of the packet.
+     * \return int64_t Samples lost before this packet, -1 for an invalid channel.
+     *
+     */
+    int64_t feed(const int32_t channel, const int32_t index, const int32_t length,
+                 const DYB_Meta *meta);
+
+    /** \brief Statistics of one channel.
+     *
+     * \param channel const int32_t Data channel.
+     * \param stats ContinuityStats& Output: statistics.
+     * \return DYB_Rc DYB_OutOfRange for an invalid channel.
+     *
+     */
+    DYB_Rc stats(const int32_t channel, ContinuityStats &stats) const;
+
+    /** \brief Reset the statistics of one channel (-1 for all).
+     *
+     * \param channel const int32_t Data channel or -1.
+     * \return void
+     *
+     */
+    void reset(const int32_t channel = -1);
+
+private:
+    ContinuityTracker _trackers[ASC500_DATA_CHANNELS];
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,305 @@
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include "asc500_convert.h"
+#include "asc500_simd.h"
+
+
+namespace asc500
+{
+
+double scaleOf(const DYB_Meta *meta)
+{
+    return meta->_stepValNum != 0.0f ? static_cast<double>(meta->_stepVal) / meta->_stepValNum
+                                     : static_cast<double>(meta->_stepVal);
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Single precision kernels, phys may alias data (same element size)
+ * ------------------------------------------------------------------------- */
+
+static void toFloatScalar(const int32_t *data, const int32_t count, const Flt32 scale,
+                          const Flt32 offset, Flt32 *phys, ValueStats *stats)
+{
+    Flt32 lo = FLT_MAX,
+          hi = -FLT_MAX;
+    double sum = 0.0;
+
+    for(int32_t j = 0; j < count; j++)
+    {
+        const Flt32 scaled = static_cast<Flt32>(data[j]) * scale,
+                    value = scaled + offset;
+        if(phys)
+            phys[j] = value;
+        if(stats)
+        {
+            lo = value < lo ? value : lo;
+            hi = value > hi ? value : hi;
+            sum += value;
+        }
+    }
+    if(stats)
+    {
+        stats->min = lo;
+        stats->max = hi;
+        stats->mean = sum;
+    }
+}
+
+
+#ifdef ASC500_SSE2
+static void toFloatSse2(const int32_t *data, const int32_t count, const Flt32 scale,
+                        const Flt32 offset, Flt32 *phys, ValueStats *stats)
+{
+    const __m128 vScale = _mm_set1_ps(scale),
+                 vOffset = _mm_set1_ps(offset);
+    __m128 lo = _mm_set1_ps(FLT_MAX),
+           hi = _mm_set1_ps(-FLT_MAX);
+    __m128d sum0 = _mm_setzero_pd(),
+            sum1 = _mm_setzero_pd();
+    int32_t j = 0;
+
+    for(; j + 4 <= count; j += 4)
+    {
+        const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + j));
+        const __m128 value = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(raw), vScale), vOffset);
+        if(phys)
+            _mm_storeu_ps(phys + j, value);
+        if(stats)
+        {
+            lo = _mm_min_ps(lo, value);
+            hi = _mm_max_ps(hi, value);
+            sum0 = _mm_add_pd(sum0, _mm_cvtps_pd(value));
+            sum1 = _mm_add_pd(sum1, _mm_cvtps_pd(_mm_movehl_ps(value, value)));
+        }
+    }
+
+    ValueStats tail;
+    toFloatScalar(data + j, count - j, scale, offset, phys ? phys + j : NULL, stats ? &tail : NULL);
+    if(stats)
+    {
+        Flt32 l[4], h[4];
+        double s[2];
+        _mm_storeu_ps(l, lo);
+        _mm_storeu_ps(h, hi);
+        _mm_storeu_pd(s, _mm_add_pd(sum0, sum1));
+        stats->min = tail.min;
+        stats->max = tail.max;
+        for(int k = 0; k < 4; k++)
+        {
+            stats->min = l[k] < stats->min ? l[k] : stats->min;
+            stats->max = h[k] > stats->max ? h[k] : stats->max;
+        }
+        stats->mean = s[0] + s[1] + tail.mean;
+    }
+}
+#endif
+
+
+#ifdef ASC500_AVX2
+ASC500_TARGET_AVX2
+static void toFloatAvx2(const int32_t *data, const int32_t count, const Flt32 scale,
+                        const Flt32 offset, Flt32 *phys, ValueStats *stats)
+{
+    const __m256 vScale = _mm256_set1_ps(scale),
+                 vOffset = _mm256_set1_ps(offset);
+    __m256 lo = _mm256_set1_ps(FLT_MAX),
+           hi = _mm256_set1_ps(-FLT_MAX);
+    __m256d sum0 = _mm256_setzero_pd(),
+            sum1 = _mm256_setzero_pd();
+    int32_t j = 0;
+
+    for(; j + 8 <= count; j += 8)
+    {
+        const __m256i raw = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + j));
+        const __m256 value = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(raw), vScale), vOffset);
+        if(phys)
+            _mm256_storeu_ps(phys + j, value);
+        if(stats)
+        {
+            lo = _mm256_min_ps(lo, value);
+            hi = _mm256_max_ps(hi, value);
+            sum0 = _mm256_add_pd(sum0, _mm256_cvtps_pd(_mm256_castps256_ps128(value)));
+            sum1 = _mm256_add_pd(sum1, _mm256_cvtps_pd(_mm256_extractf128_ps(value, 1)));
+        }
+    }
+
+    ValueStats tail;
+    toFloatScalar(data + j, count - j, scale, offset, phys ? phys + j : NULL, stats ? &tail : NULL);
+    if(stats)
+    {
+        Flt32 l[8], h[8];
+        double s[4];
+        _mm256_storeu_ps(l, lo);
+        _mm256_storeu_ps(h, hi);
+        _mm256_storeu_pd(s, _mm256_add_pd(sum0, sum1));
+        stats->min = tail.min;
+        stats->max = tail.max;
+        for(int k = 0; k < 8; k++)
+        {
+            stats->min = l[k] < stats->min ? l[k] : stats->min;
+            stats->max = h[k] > stats->max ? h[k] : stats->max;
+        }
+        stats->mean = s[0] + s[1] + s[2] + s[3] + tail.mean;
+    }
+}
+#endif
+
+
+static void toFloat(const int32_t *data, const int32_t count, const Flt32 scale,
+                    const Flt32 offset, Flt32 *phys, ValueStats *stats)
+{
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+        return toFloatAvx2(data, count, scale, offset, phys, stats);
+#endif
+#ifdef ASC500_SSE2
+    toFloatSse2(data, count, scale, offset, phys, stats);
+#else
+    toFloatScalar(data, count, scale, offset, phys, stats);
+#endif
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Double precision kernels
+ * ------------------------------------------------------------------------- */
+
+static void toDoubleScalar(const int32_t *data, const int32_t count, const double scale,
+                           const double offset, double *phys)
+{
+    for(int32_t j = 0; j < count; j++)
+    {
+        const double scaled = static_cast<double>(data[j]) * scale;
+        phys[j] = scaled + offset;
+    }
+}
+
+
+#ifdef ASC500_SSE2
+static void toDoubleSse2(const int32_t *data, const int32_t count, const double scale,
+                         const double offset, double *phys)
+{
+    const __m128d vScale = _mm_set1_pd(scale),
+                  vOffset = _mm_set1_pd(offset);
+    int32_t j = 0;
+
+    for(; j + 4 <= count; j += 4)
+    {
+        const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + j));
+        const __m128d a = _mm_cvtepi32_pd(raw),
+                      b = _mm_cvtepi32_pd(_mm_shuffle_epi32(raw, _MM_SHUFFLE(1, 0, 3, 2)));
+        _mm_storeu_pd(phys + j, _mm_add_pd(_mm_mul_pd(a, vScale), vOffset));
+        _mm_storeu_pd(phys + j + 2, _mm_add_pd(_mm_mul_pd(b, vScale), vOffset));
+    }
+    toDoubleScalar(data + j, count - j, scale, offset, phys + j);
+}
+#endif
+
+
+#ifdef ASC500_AVX2
+ASC500_TARGET_AVX2
+static void toDoubleAvx2(const int32_t *data, const int32_t count, const double scale,
+                         const double offset, double *phys)
+{
+    const __m256d vScale = _mm256_set1_pd(scale),
+                  vOffset = _mm256_set1_pd(offset);
+    int32_t j = 0;
+
+    for(; j + 4 <= count; j += 4)
+    {
+        const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + j));
+        _mm256_storeu_pd(phys + j, _mm256_add_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(raw), vScale), vOffset));
+    }
+    toDoubleScalar(data + j, count - j, scale, offset, phys + j);
+}
+#endif
+
+
+/* ---------------------------------------------------------------------------
+ *  Public functions
+ * ------------------------------------------------------------------------- */
+
+void convValues2Phys(const DYB_Meta *meta, const int32_t *data, const int32_t count, Flt32 *phys)
+{
+    if(!meta || count <= 0)
+        return;
+    toFloat(data, count, static_cast<Flt32>(scaleOf(meta)), meta->_offsetVal, phys, NULL);
+}
+
+
+void convValues2Phys(const DYB_Meta *meta, const int32_t *data, const int32_t count, double *phys)
+{
+    if(!meta || count <= 0)
+        return;
+
+    const double scale = scaleOf(meta),
+                 offset = meta->_offsetVal;
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+        return toDoubleAvx2(data, count, scale, offset, phys);
+#endif
+#ifdef ASC500_SSE2
+    toDoubleSse2(data, count, scale, offset, phys);
+#else
+    toDoubleScalar(data, count, scale, offset, phys);
+#endif
+}
+
+
+Flt32 *convValues2PhysInPlace(const DYB_Meta *meta, int32_t *data, const int32_t count)
+{
+    Flt32 *phys = reinterpret_cast<Flt32 *>(data);
+    convValues2Phys(meta, data, count, phys);
+    return phys;
+}
+
+
+void convValues2PhysStats(const DYB_Meta *meta, const int32_t *data, const int32_t count,
+                          Flt32 *phys, ValueStats &stats)
+{
+    stats.min = stats.max = 0.0f;
+    stats.mean = 0.0;
+    stats.count = count > 0 ? count : 0;
+    if(!meta || count <= 0)
+        return;
+
+    toFloat(data, count, static_cast<Flt32>(scaleOf(meta)), meta->_offsetVal, phys, &stats);
+    stats.mean /= count;
+}
+
+
+int32_t checkValue2Phys(const DYB_Meta *meta, const int32_t *data, const int32_t count,
+                        const double tolerance)
+{
+    if(!meta || !data || count < 0)
+        return -1;
+
+    std::vector<Flt32> phys(count);
+    const double scale = scaleOf(meta);
+    int32_t mismatches = 0;
+
+    convValues2Phys(meta, data, count, phys.data());
+    for(int32_t i = 0; i < count; i++)
+    {
+        const double expected = DYB_convValue2Phys(meta, data[i]),
+                     magnitude = fabs(data[i] * scale) + fabs(meta->_offsetVal);
+        if(!(fabs(phys[i] - expected) <= tolerance * magnitude))
+            mismatches++;
+    }
+    return mismatches;
+}
+
+
+double sampleRateOf(const DYB_Meta *meta)
+{
+    /* The low byte of the unit is the decimal exponent in steps of 10^3 */
+    const int32_t unit = meta ? static_cast<int32_t>(meta->_unitXY) : 0;
+    if((unit >> 8) != (DYB_UnitS >> 8) || !(meta->_stepX > 0.0f))
+        return 0.0;
+    return 1.0 / (meta->_stepX * pow(1000.0, (unit & 0xFF) - 0x80));
+}
+
+} /* namespace asc500 */
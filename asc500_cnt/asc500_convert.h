@@ -0,0 +1,121 @@
+/** \file asc500_convert.h
+ * \brief Batch conversion of raw data values to physical values.
+ *
+ * DYB_convValue2Phys converts one value per call. The functions here convert
+ * whole arrays with SSE2 / AVX2 kernels (scalar fallback elsewhere):
+ *
+ *     phys = value * scale + _offsetVal,   scale = _stepVal / _stepValNum
+ *
+ * where the scale is computed once per call in the precision of the output.
+ * A fused variant also returns minimum, maximum and mean of the converted
+ * data in the same pass. checkValue2Phys() compares against the conversion
+ * function of the library.
+ */
+
+#ifndef __ASC500_CONVERT_H
+#define __ASC500_CONVERT_H
+
+#include <cstdint>
+
+#include "metadata.h"
+
+
+namespace asc500
+{
+
+/** \brief Summary of a converted array.
+ */
+struct ValueStats
+{
+    Flt32 min;             /**< Smallest physical value                       */
+    Flt32 max;             /**< Largest physical value                        */
+    double mean;           /**< Mean of the physical values                   */
+    int32_t count;         /**< Number of values                              */
+};
+
+
+/** \brief Scale of the data values, i.e. physical units per LSB.
+ *
+ * \param meta const DYB_Meta* Meta data set.
+ * \return double Scale; an invalid numerator of 0 is treated as 1.
+ *
+ */
+double scaleOf(const DYB_Meta *meta);
+
+/** \brief Convert raw values to single precision physical values.
+ *
+ * \param meta const DYB_Meta* Meta data belonging to the data.
+ * \param data const int32_t* Raw values.
+ * \param count const int32_t Number of values.
+ * \param phys Flt32* Output: physical values, may not overlap data
+ *             (see convValues2PhysInPlace).
+ * \return void
+ *
+ */
+void convValues2Phys(const DYB_Meta *meta, const int32_t *data, const int32_t count, Flt32 *phys);
+
+/** \brief Convert raw values to double precision physical values.
+ *
+ * \param meta const DYB_Meta* Meta data belonging to the data.
+ * \param data const int32_t* Raw values.
+ * \param count const int32_t Number of values.
+ * \param phys double* Output: physical values.
+ * \return void
+ *
+ */
+void convValues2Phys(const DYB_Meta *meta, const int32_t *data, const int32_t count, double *phys);
+
+/** \brief Convert raw values to single precision in place.
+ *
+ * \param meta const DYB_Meta* Meta data belonging to the data.
+ * \param data int32_t* Raw values; overwritten with Flt32 values.
+ * \param count const int32_t Number of values.
+ * \return Flt32* The same memory, now holding the physical values.
+ *
+ */
+Flt32 *convValues2PhysInPlace(const DYB_Meta *meta, int32_t *data, const int32_t count);
+
+/** \brief Convert raw values and compute their statistics in one pass.
+ *
+ * \param meta const DYB_Meta* Meta data belonging to the data.
+ * \param data const int32_t* Raw values.
+ * \param count const int32_t Number of values.
+ * \param phys Flt32* Output: physical values; may be equal to data
+ *             (in place) or NULL (statistics only).
+ * \param stats ValueStats& Output: minimum, maximum and mean.
+ * \return void
+ *
+ */
+void convValues2PhysStats(const DYB_Meta *meta, const int32_t *data, const int32_t count,
+                          Flt32 *phys, ValueStats &stats);
+
+
+/** \brief Compare the single precision conversion with the library function.
+ *
+ * Calls DYB_convValue2Phys for every value, so it is meant for validation
+ * on the target, not for the acquisition path. The library may round
+ * differently, so a value matches if it differs by at most tolerance
+ * relative to |value * scale| + |_offsetVal|.
+ *
+ * \param meta const DYB_Meta* Meta data belonging to the data.
+ * \param data const int32_t* Raw values.
+ * \param count const int32_t Number of values.
+ * \param tolerance const double Relative tolerance.
+ * \return int32_t Number of values whose results differ, -1 on error.
+ *
+ */
+int32_t checkValue2Phys(const DYB_Meta *meta, const int32_t *data, const int32_t count,
+                        const double tolerance = 1e-6);
+
+
+/** \brief Sample rate of time triggered data.
+ *
+ * \param meta const DYB_Meta* Meta data belonging to the data.
+ * \return double Samples per second from _stepX; 0 if _unitXY isn't a time.
+ *
+ */
+double sampleRateOf(const DYB_Meta *meta);
+
+} /* namespace asc500 */
+
+#endif
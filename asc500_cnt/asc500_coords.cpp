@@ -0,0 +1,500 @@
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "asc500_coords.h"
+#include "asc500_simd.h"
+
+
+namespace asc500
+{
+
+/* A stretch of indices along one scan line */
+struct Run
+{
+    int32_t offset;      /* Position in the output arrays                     */
+    int32_t length;      /* Number of indices                                 */
+    int32_t column;      /* Column of the first index                         */
+    int32_t step;        /* +1 forward, -1 backward                           */
+    int32_t line;        /* Line (constant within the run)                    */
+};
+
+
+static bool isScan(const DYB_Order order)
+{
+    return order == DYB_FfScan || order == DYB_FbScan ||
+           order == DYB_BbScan || order == DYB_BfScan;
+}
+
+
+int32_t scanLine(const int64_t dataLine, const int32_t pointsY, const bool oddFrame)
+{
+    const int64_t l = dataLine % pointsY;
+    const bool odd = oddFrame != ((dataLine / pointsY) % 2 != 0);
+    return static_cast<int32_t>(odd ? pointsY - 1 - l : l);
+}
+
+
+/** \brief Check the meta data and split an index range into scan line runs.
+ *
+ * \param meta const DYB_Meta* Meta data set of a scan.
+ * \param first const int32_t First data index, counted from the start of the frame.
+ * \param count const int32_t Number of indices.
+ * \param oddFrame const bool If the frame runs top to bottom.
+ * \param runs std::vector<Run>& Output: runs covering the range.
+ * \return DYB_MRc Success code.
+ *
+ */
+static DYB_MRc scanRuns(const DYB_Meta *meta, const int32_t first, const int32_t count,
+                        const bool oddFrame, std::vector<Run> &runs)
+{
+    runs.clear();
+    if(!meta || first < 0 || count < 0)
+        return DYB_MetaInvalid;
+    if(!isScan(meta->_order))
+        return DYB_MetaNotApp;
+    if(meta->_pointsX <= 0 || meta->_pointsY <= 0)
+        return DYB_MetaInvalid;
+
+    const int64_t pointsX = meta->_pointsX,
+                  lineSize = 2 * pointsX;
+    const bool firstForward = meta->_order == DYB_FfScan || meta->_order == DYB_FbScan,
+               secondForward = meta->_order == DYB_FfScan || meta->_order == DYB_BfScan;
+    int64_t index = first,
+            end = static_cast<int64_t>(first) + count;
+
+    while(index < end)
+    {
+        const int64_t inLine = index % lineSize,
+                      k = inLine % pointsX;
+        const bool forward = inLine < pointsX ? firstForward : secondForward;
+        Run run;
+
+        run.offset = static_cast<int32_t>(index - first);
+        run.length = static_cast<int32_t>(end - index < pointsX - k ? end - index : pointsX - k);
+        run.column = static_cast<int32_t>(forward ? k : pointsX - 1 - k);
+        run.step = forward ? 1 : -1;
+        run.line = scanLine(index / lineSize, meta->_pointsY, oddFrame);
+        runs.push_back(run);
+        index += run.length;
+    }
+    return DYB_MetaOk;
+}
+
+
+/* Scan geometry in the form used by the kernels */
+struct Geometry
+{
+    Flt32 stepX, stepY, originX, originY, cosR, sinR;
+    bool rotated;
+};
+
+
+static Geometry geometryOf(const DYB_Meta *meta)
+{
+    Geometry g;
+    g.stepX = meta->_stepX;
+    g.stepY = meta->_stepY;
+    g.originX = meta->_originX;
+    g.originY = meta->_originY;
+    g.cosR = std::cos(meta->_rotation);
+    g.sinR = std::sin(meta->_rotation);
+    g.rotated = meta->_rotation != 0.0f;
+    return g;
+}
+
+
+/** \brief Scalar position of one pixel, the reference for all kernels.
+ *
+ */
+static inline void pixel2Phys(const Geometry &g, const int32_t column, const int32_t line,
+                              Flt32 &x, Flt32 &y)
+{
+    const Flt32 u = static_cast<Flt32>(column) * g.stepX,
+                v = static_cast<Flt32>(line) * g.stepY;
+    if(g.rotated)
+    {
+        const Flt32 ux = u * g.cosR,
+                    vx = v * g.sinR,
+                    uy = u * g.sinR,
+                    vy = v * g.cosR;
+        x = g.originX + (ux - vx);
+        y = g.originY + (uy + vy);
+    }
+    else
+    {
+        x = g.originX + u;
+        y = g.originY + v;
+    }
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Kernels: fill one run
+ * ------------------------------------------------------------------------- */
+
+#ifndef ASC500_SSE2
+static void pixelRunScalar(const Run &run, int32_t *columns, int32_t *lines)
+{
+    for(int32_t j = 0; j < run.length; j++)
+    {
+        columns[j] = run.column + run.step * j;
+        lines[j] = run.line;
+    }
+}
+
+
+static void physRunScalar(const Geometry &g, const Run &run, Flt32 *x, Flt32 *y)
+{
+    for(int32_t j = 0; j < run.length; j++)
+        pixel2Phys(g, run.column + run.step * j, run.line, x[j], y[j]);
+}
+#endif
+
+
+#ifdef ASC500_SSE2
+static void pixelRunSse2(const Run &run, int32_t *columns, int32_t *lines)
+{
+    const __m128i step = _mm_set1_epi32(4 * run.step),
+                  line = _mm_set1_epi32(run.line);
+    __m128i col = _mm_add_epi32(_mm_set1_epi32(run.column),
+                                _mm_setr_epi32(0, run.step, 2 * run.step, 3 * run.step));
+    int32_t j = 0;
+
+    for(; j + 4 <= run.length; j += 4)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(columns + j), col);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lines + j), line);
+        col = _mm_add_epi32(col, step);
+    }
+    for(; j < run.length; j++)
+    {
+        columns[j] = run.column + run.step * j;
+        lines[j] = run.line;
+    }
+}
+
+
+static void physRunSse2(const Geometry &g, const Run &run, Flt32 *x, Flt32 *y)
+{
+    const __m128i step = _mm_set1_epi32(4 * run.step);
+    const __m128 stepX = _mm_set1_ps(g.stepX),
+                 originX = _mm_set1_ps(g.originX),
+                 originY = _mm_set1_ps(g.originY),
+                 cosR = _mm_set1_ps(g.cosR),
+                 sinR = _mm_set1_ps(g.sinR),
+                 v = _mm_set1_ps(static_cast<Flt32>(run.line) * g.stepY);
+    __m128i col = _mm_add_epi32(_mm_set1_epi32(run.column),
+                                _mm_setr_epi32(0, run.step, 2 * run.step, 3 * run.step));
+    int32_t j = 0;
+
+    if(g.rotated)
+    {
+        const __m128 vx = _mm_mul_ps(v, sinR),
+                     vy = _mm_mul_ps(v, cosR);
+        for(; j + 4 <= run.length; j += 4)
+        {
+            const __m128 u = _mm_mul_ps(_mm_cvtepi32_ps(col), stepX);
+            _mm_storeu_ps(x + j, _mm_add_ps(originX, _mm_sub_ps(_mm_mul_ps(u, cosR), vx)));
+            _mm_storeu_ps(y + j, _mm_add_ps(originY, _mm_add_ps(_mm_mul_ps(u, sinR), vy)));
+            col = _mm_add_epi32(col, step);
+        }
+    }
+    else
+    {
+        const __m128 yv = _mm_add_ps(originY, v);
+        for(; j + 4 <= run.length; j += 4)
+        {
+            _mm_storeu_ps(x + j, _mm_add_ps(originX, _mm_mul_ps(_mm_cvtepi32_ps(col), stepX)));
+            _mm_storeu_ps(y + j, yv);
+            col = _mm_add_epi32(col, step);
+        }
+    }
+    for(; j < run.length; j++)
+        pixel2Phys(g, run.column + run.step * j, run.line, x[j], y[j]);
+}
+#endif
+
+
+#ifdef ASC500_AVX2
+ASC500_TARGET_AVX2
+static void pixelRunAvx2(const Run &run, int32_t *columns, int32_t *lines)
+{
+    const __m256i step = _mm256_set1_epi32(8 * run.step),
+                  line = _mm256_set1_epi32(run.line);
+    __m256i col = _mm256_add_epi32(_mm256_set1_epi32(run.column),
+                                   _mm256_mullo_epi32(_mm256_set1_epi32(run.step),
+                                                      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    int32_t j = 0;
+
+    for(; j + 8 <= run.length; j += 8)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(columns + j), col);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lines + j), line);
+        col = _mm256_add_epi32(col, step);
+    }
+    for(; j < run.length; j++)
+    {
+        columns[j] = run.column + run.step * j;
+        lines[j] = run.line;
+    }
+}
+
+
+ASC500_TARGET_AVX2
+static void physRunAvx2(const Geometry &g, const Run &run, Flt32 *x, Flt32 *y)
+{
+    const __m256i step = _mm256_set1_epi32(8 * run.step);
+    const __m256 stepX = _mm256_set1_ps(g.stepX),
+                 originX = _mm256_set1_ps(g.originX),
+                 originY = _mm256_set1_ps(g.originY),
+                 cosR = _mm256_set1_ps(g.cosR),
+                 sinR = _mm256_set1_ps(g.sinR),
+                 v = _mm256_set1_ps(static_cast<Flt32>(run.line) * g.stepY);
+    __m256i col = _mm256_add_epi32(_mm256_set1_epi32(run.column),
+                                   _mm256_mullo_epi32(_mm256_set1_epi32(run.step),
+                                                      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    int32_t j = 0;
+
+    if(g.rotated)
+    {
+        const __m256 vx = _mm256_mul_ps(v, sinR),
+                     vy = _mm256_mul_ps(v, cosR);
+        for(; j + 8 <= run.length; j += 8)
+        {
+            const __m256 u = _mm256_mul_ps(_mm256_cvtepi32_ps(col), stepX);
+            _mm256_storeu_ps(x + j, _mm256_add_ps(originX, _mm256_sub_ps(_mm256_mul_ps(u, cosR), vx)));
+            _mm256_storeu_ps(y + j, _mm256_add_ps(originY, _mm256_add_ps(_mm256_mul_ps(u, sinR), vy)));
+            col = _mm256_add_epi32(col, step);
+        }
+    }
+    else
+    {
+        const __m256 yv = _mm256_add_ps(originY, v);
+        for(; j + 8 <= run.length; j += 8)
+        {
+            _mm256_storeu_ps(x + j, _mm256_add_ps(originX, _mm256_mul_ps(_mm256_cvtepi32_ps(col), stepX)));
+            _mm256_storeu_ps(y + j, yv);
+            col = _mm256_add_epi32(col, step);
+        }
+    }
+    for(; j < run.length; j++)
+        pixel2Phys(g, run.column + run.step * j, run.line, x[j], y[j]);
+}
+#endif
+
+
+static void pixelRun(const Run &run, int32_t *columns, int32_t *lines)
+{
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+        return pixelRunAvx2(run, columns, lines);
+#endif
+#ifdef ASC500_SSE2
+    pixelRunSse2(run, columns, lines);
+#else
+    pixelRunScalar(run, columns, lines);
+#endif
+}
+
+
+static void physRun(const Geometry &g, const Run &run, Flt32 *x, Flt32 *y)
+{
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+        return physRunAvx2(g, run, x, y);
+#endif
+#ifdef ASC500_SSE2
+    physRunSse2(g, run, x, y);
+#else
+    physRunScalar(g, run, x, y);
+#endif
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Public functions
+ * ------------------------------------------------------------------------- */
+
+DYB_MRc convIndex2PixelBulk(const DYB_Meta *meta, const int32_t first, const int32_t count,
+                            int32_t *columns, int32_t *lines, int32_t *forward,
+                            const bool oddFrame)
+{
+    std::vector<Run> runs;
+    const DYB_MRc rc = scanRuns(meta, first, count, oddFrame, runs);
+
+    if(rc != DYB_MetaOk)
+        return rc;
+
+    for(const Run &run : runs)
+    {
+        pixelRun(run, columns + run.offset, lines + run.offset);
+        if(forward)
+        {
+            int32_t *f = forward + run.offset;
+            for(int32_t j = 0; j < run.length; j++)
+                f[j] = run.step > 0;
+        }
+    }
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc convIndex2Phys2Bulk(const DYB_Meta *meta, const int32_t first, const int32_t count,
+                            Flt32 *x, Flt32 *y, const bool oddFrame)
+{
+    std::vector<Run> runs;
+    const DYB_MRc rc = scanRuns(meta, first, count, oddFrame, runs);
+
+    if(rc != DYB_MetaOk)
+        return rc;
+
+    const Geometry g = geometryOf(meta);
+    for(const Run &run : runs)
+        physRun(g, run, x + run.offset, y + run.offset);
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc convIndex2Phys1Bulk(const DYB_Meta *meta, const int32_t first, const int32_t count,
+                            Flt32 *x)
+{
+    if(!meta || first < 0 || count < 0)
+        return DYB_MetaInvalid;
+    if(isScan(meta->_order) || meta->_order > DYB_Cyclic)
+        return DYB_MetaNotApp;
+    if(meta->_order == DYB_Cyclic && meta->_pointsX <= 0)
+        return DYB_MetaInvalid;
+
+    /* A 1D sequence is a rotation free run along a single line */
+    Geometry g = geometryOf(meta);
+    g.rotated = false;
+    g.originY = 0.0f;
+    g.stepY = 0.0f;
+
+    std::vector<Flt32> dummy(count < 4096 ? count : 4096);
+    int64_t index = first;
+    const int64_t end = static_cast<int64_t>(first) + count;
+
+    while(index < end)
+    {
+        Run run;
+        int64_t length = end - index;
+
+        if(meta->_order == DYB_Cyclic)
+        {
+            const int64_t k = index % meta->_pointsX;
+            length = length < meta->_pointsX - k ? length : meta->_pointsX - k;
+            run.column = static_cast<int32_t>(k);
+        }
+        else
+        {
+            run.column = static_cast<int32_t>(index);
+        }
+        if(length > static_cast<int64_t>(dummy.size()))
+            length = dummy.size();
+
+        run.offset = static_cast<int32_t>(index - first);
+        run.length = static_cast<int32_t>(length);
+        run.step = 1;
+        run.line = 0;
+        physRun(g, run, x + run.offset, dummy.data());
+        index += length;
+    }
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc convIndex2PixelScalar(const DYB_Meta *meta, const int32_t index,
+                              int32_t *column, int32_t *line, int32_t *forward,
+                              const bool oddFrame)
+{
+    std::vector<Run> runs;
+    const DYB_MRc rc = scanRuns(meta, index, 1, oddFrame, runs);
+
+    if(rc != DYB_MetaOk)
+        return rc;
+
+    *column = runs[0].column;
+    *line = runs[0].line;
+    if(forward)
+        *forward = runs[0].step > 0;
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc convIndex2Phys2Scalar(const DYB_Meta *meta, const int32_t index, Flt32 *x, Flt32 *y,
+                              const bool oddFrame)
+{
+    int32_t column = 0,
+            line = 0;
+    const DYB_MRc rc = convIndex2PixelScalar(meta, index, &column, &line, NULL, oddFrame);
+
+    if(rc != DYB_MetaOk)
+        return rc;
+
+    pixel2Phys(geometryOf(meta), column, line, *x, *y);
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc convIndex2Phys1Scalar(const DYB_Meta *meta, const int32_t index, Flt32 *x)
+{
+    if(!meta || index < 0)
+        return DYB_MetaInvalid;
+    if(isScan(meta->_order) || meta->_order > DYB_Cyclic)
+        return DYB_MetaNotApp;
+    if(meta->_order == DYB_Cyclic && meta->_pointsX <= 0)
+        return DYB_MetaInvalid;
+
+    const int32_t k = meta->_order == DYB_Cyclic ? index % meta->_pointsX : index;
+    *x = meta->_originX + static_cast<Flt32>(k) * meta->_stepX;
+    return DYB_MetaOk;
+}
+
+
+int32_t checkIndex2Phys(const DYB_Meta *meta, const int32_t first, const int32_t count)
+{
+    if(!meta || count < 0)
+        return -1;
+
+    std::vector<Flt32> x(count), y(count);
+    int32_t mismatches = 0;
+
+    if(isScan(meta->_order))
+    {
+        std::vector<int32_t> columns(count), lines(count);
+        if(convIndex2PixelBulk(meta, first, count, columns.data(), lines.data()) != DYB_MetaOk ||
+           convIndex2Phys2Bulk(meta, first, count, x.data(), y.data()) != DYB_MetaOk)
+            return -1;
+
+        for(int32_t i = 0; i < count; i++)
+        {
+            Int32 column = 0,
+                  line = 0;
+            Flt32 px = 0.0f,
+                  py = 0.0f;
+            DYB_convIndex2Pixel(meta, first + i, &column, &line);
+            DYB_convIndex2Phys2(meta, first + i, &px, &py);
+            if(column != columns[i] || line != lines[i] ||
+               memcmp(&px, &x[i], sizeof(Flt32)) || memcmp(&py, &y[i], sizeof(Flt32)))
+                mismatches++;
+        }
+    }
+    else
+    {
+        if(convIndex2Phys1Bulk(meta, first, count, x.data()) != DYB_MetaOk)
+            return -1;
+
+        for(int32_t i = 0; i < count; i++)
+        {
+            Flt32 px = 0.0f;
+            DYB_convIndex2Phys1(meta, first + i, &px);
+            if(memcmp(&px, &x[i], sizeof(Flt32)))
+                mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+} /* namespace asc500 */
@@ -0,0 +1,125 @@
+/** \file asc500_coords.h
+ * \brief Bulk conversion of data indices to pixel and physical positions.
+ *
+ * The functions of metadata.h convert one index per call. The functions
+ * here convert a whole index range into contiguous arrays. They split the
+ * range into runs along a scan line, where the column is an arithmetic
+ * sequence and the line is constant, and fill every run with SIMD kernels.
+ *
+ * Mapping for the scan orders (DYB_FfScan .. DYB_BfScan): a frame consists of
+ * _pointsY lines of 2 * _pointsX data; the first half of a line is scanned
+ * in the first, the second half in the second direction of the order
+ * (e.g. forward then backward for DYB_FbScan). The first frame runs bottom
+ * to top, the Y direction of subsequent frames alternates. As every frame
+ * starts over at index 0, the index doesn't tell the frame; callers pass
+ * the parity of the frame (counted from the start of the scan). A range
+ * that extends beyond the frame continues in the following frames, with
+ * the Y direction alternating each time (see scanLine()). Physical
+ * positions are
+ *
+ *     u = column * _stepX,  v = line * _stepY
+ *     x = _originX + (u * cos(_rotation) - v * sin(_rotation))
+ *     y = _originY + (u * sin(_rotation) + v * cos(_rotation))
+ *
+ * evaluated in single precision. DYB_Linear and DYB_Triggered map to
+ * _originX + index * _stepX, DYB_Cyclic wraps the index at _pointsX.
+ *
+ * The *Scalar functions are the reference implementation; the bulk
+ * functions produce bit identical results. checkIndex2Phys() compares
+ * against the conversion functions of the library.
+ */
+
+#ifndef __ASC500_COORDS_H
+#define __ASC500_COORDS_H
+
+#include <cstdint>
+
+#include "metadata.h"
+
+
+namespace asc500
+{
+
+/** \brief Pixel line of a data line, the Y direction rule of all scan conversions.
+ *
+ * \param dataLine const int64_t Data line counted from the start of the frame
+ *                 (0 = first scanned); beyond _pointsY it runs into the following frames.
+ * \param pointsY const int32_t Lines per frame.
+ * \param oddFrame const bool If the frame runs top to bottom (2nd, 4th, ... frame).
+ * \return int32_t Pixel line, 0 = bottom.
+ *
+ */
+int32_t scanLine(const int64_t dataLine, const int32_t pointsY, const bool oddFrame);
+
+/** \brief Pixel positions and scan directions of an index range.
+ *
+ * \param meta const DYB_Meta* Meta data set of a scan.
+ * \param first const int32_t First data index, counted from the start of the frame.
+ * \param count const int32_t Number of indices.
+ * \param columns int32_t* Output: column numbers (count items).
+ * \param lines int32_t* Output: line numbers (count items).
+ * \param forward int32_t* Output: forward flags (count items), may be NULL.
+ * \param oddFrame const bool If the frame runs top to bottom (2nd, 4th, ... frame).
+ * \return DYB_MRc DYB_MetaNotApp if the data don't stem from a scan.
+ *
+ */
+DYB_MRc convIndex2PixelBulk(const DYB_Meta *meta, const int32_t first, const int32_t count,
+                            int32_t *columns, int32_t *lines, int32_t *forward = NULL,
+                            const bool oddFrame = false);
+
+/** \brief Physical positions of an index range for one variable.
+ *
+ * \param meta const DYB_Meta* Meta data set (DYB_Linear, DYB_Triggered, DYB_Cyclic).
+ * \param first const int32_t First data index.
+ * \param count const int32_t Number of indices.
+ * \param x Flt32* Output: independent variable (count items).
+ * \return DYB_MRc DYB_MetaNotApp for scans.
+ *
+ */
+DYB_MRc convIndex2Phys1Bulk(const DYB_Meta *meta, const int32_t first, const int32_t count,
+                            Flt32 *x);
+
+/** \brief Physical positions of an index range for two variables.
+ *
+ * \param meta const DYB_Meta* Meta data set of a scan.
+ * \param first const int32_t First data index, counted from the start of the frame.
+ * \param count const int32_t Number of indices.
+ * \param x Flt32* Output: horizontal positions (count items).
+ * \param y Flt32* Output: vertical positions (count items).
+ * \param oddFrame const bool If the frame runs top to bottom.
+ * \return DYB_MRc DYB_MetaNotApp if the data don't stem from a scan.
+ *
+ */
+DYB_MRc convIndex2Phys2Bulk(const DYB_Meta *meta, const int32_t first, const int32_t count,
+                            Flt32 *x, Flt32 *y, const bool oddFrame = false);
+
+/** \brief Reference conversion of one index to a pixel position. */
+DYB_MRc convIndex2PixelScalar(const DYB_Meta *meta, const int32_t index,
+                              int32_t *column, int32_t *line, int32_t *forward = NULL,
+                              const bool oddFrame = false);
+
+/** \brief Reference conversion of one index for one variable. */
+DYB_MRc convIndex2Phys1Scalar(const DYB_Meta *meta, const int32_t index, Flt32 *x);
+
+/** \brief Reference conversion of one index for two variables. */
+DYB_MRc convIndex2Phys2Scalar(const DYB_Meta *meta, const int32_t index, Flt32 *x, Flt32 *y,
+                              const bool oddFrame = false);
+
+/** \brief Compare the bulk conversion with the library functions.
+ *
+ * Calls DYB_convIndex2Pixel and DYB_convIndex2Phys1/2 for every index, so it
+ * is meant for validation on the target, not for the acquisition path.
+ * Scans are compared for the first frame, as the library functions don't
+ * know the frame either.
+ *
+ * \param meta const DYB_Meta* Meta data set.
+ * \param first const int32_t First data index.
+ * \param count const int32_t Number of indices.
+ * \return int32_t Number of indices whose results differ, -1 on error.
+ *
+ */
+int32_t checkIndex2Phys(const DYB_Meta *meta, const int32_t first, const int32_t count);
+
+} /* namespace asc500 */
+
+#endif
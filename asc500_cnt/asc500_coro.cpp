@@ -0,0 +1,295 @@
+#include "asc500_coro.h"
+
+#ifdef ASC500_COROUTINES
+
+#include <algorithm>
+
+#include "daisydata.h"
+#include "asc500_events.h"
+
+
+namespace asc500
+{
+
+/* ----------------------------------------------------------------------
+ *  Scheduler
+ * ---------------------------------------------------------------------- */
+
+void Scheduler::post(std::coroutine_handle<> handle)
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _ready.push_back(handle);
+    }
+    _wakeup.notify_one();
+}
+
+
+void Scheduler::at(const TimePoint deadline, std::function<void()> action)
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _timers.insert(std::make_pair(deadline, std::move(action)));
+    }
+    _wakeup.notify_one();
+}
+
+
+void Scheduler::spawn(Task<void> task)
+{
+    std::coroutine_handle<> handle = task.handle();
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _tasks.push_back(std::move(task));
+    }
+    post(handle);
+}
+
+
+size_t Scheduler::active() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _tasks.size();
+}
+
+
+bool Scheduler::run(const int32_t timeout)
+{
+    const TimePoint end = timeout < 0 ? TimePoint::max() :
+                          std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    std::vector<std::coroutine_handle<> > ready;
+    std::vector<std::function<void()> > due;
+    std::unique_lock<std::mutex> lock(_lock);
+
+    for(;;)
+    {
+        /* Completed tasks are destroyed here, never inside their own resumption */
+        _tasks.erase(std::remove_if(_tasks.begin(), _tasks.end(),
+                                    [](const Task<void> &task) { return task.done(); }), _tasks.end());
+        if(_tasks.empty())
+            return true;
+
+        const TimePoint now = std::chrono::steady_clock::now();
+        while(!_timers.empty() && _timers.begin()->first <= now)
+        {
+            due.push_back(std::move(_timers.begin()->second));
+            _timers.erase(_timers.begin());
+        }
+        ready.swap(_ready);
+
+        if(ready.empty() && due.empty())
+        {
+            if(now >= end)
+                return false;
+            const TimePoint wake = _timers.empty() ? end : std::min(end, _timers.begin()->first);
+            if(wake == TimePoint::max())
+                _wakeup.wait(lock);
+            else
+                _wakeup.wait_until(lock, wake);
+            continue;
+        }
+
+        /* Timers may post further handles; those run in the next round */
+        lock.unlock();
+        for(std::function<void()> &action : due)
+            action();
+        for(std::coroutine_handle<> handle : ready)
+            handle.resume();
+        due.clear();
+        ready.clear();
+        lock.lock();
+    }
+}
+
+
+/* ----------------------------------------------------------------------
+ *  AsyncClient
+ * ---------------------------------------------------------------------- */
+
+AsyncClient::AsyncClient(Scheduler &scheduler, FramePool &pool, EventQueue &events)
+    : _scheduler(scheduler), _pool(pool), _events(events), _nextId(1), _token(0), _running(true)
+{
+    _token = EventHub::subscribe([this](const DYB_Address address, const int32_t index, const int32_t value)
+    {
+        onEvent(address, index, value);
+    });
+    _frames = std::thread(&AsyncClient::frameLoop, this);
+}
+
+
+AsyncClient::~AsyncClient()
+{
+    _running = false;
+    if(_frames.joinable())
+        _frames.join();
+    EventHub::unsubscribe(_token);
+}
+
+
+AsyncClient::Pending AsyncClient::request(const Pending::Kind kind, const DYB_Address address,
+                                          const int32_t index, const int32_t value, const bool set,
+                                          const int32_t timeout)
+{
+    Pending pending;
+    pending.kind = kind;
+    pending.address = address;
+    pending.index = index;
+    pending.value = value;
+    pending.set = set;
+    pending.ack = AckState(value);
+    pending.timeout = timeout;
+    pending.param.rc = DYB_Ok;
+    pending.param.value = 0;
+    pending.frame.rc = DYB_Ok;
+    pending.frame.buffer = NULL;
+    return pending;
+}
+
+
+bool AsyncClient::tryNow(Pending &pending)
+{
+    if(pending.kind == Pending::Delay)
+        return pending.timeout <= 0;
+    if(pending.kind != Pending::Frame)
+        return false;
+
+    /* A frame the pump has fetched already is taken without suspending */
+    pending.frame.buffer = _events.takeFrame(pending.address);
+    return pending.frame.buffer != NULL;
+}
+
+
+bool AsyncClient::start(Pending &pending)
+{
+    uint64_t id = 0;
+    {
+        /* Registered before sending, the answer may come at once */
+        std::lock_guard<std::mutex> lock(_lock);
+        id = _nextId++;
+        _pending[id] = &pending;
+    }
+
+    if(pending.kind == Pending::Parameter)
+    {
+        const DYB_Rc rc = pending.set ? DYB_setParameterAsync(pending.address, pending.index, pending.value) :
+                                        DYB_getParameterAsync(pending.address, pending.index);
+        if(rc != DYB_Ok)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            if(_pending.erase(id) == 0)
+                return true;            /* Completed meanwhile, already posted */
+            pending.param.rc = rc;
+            return false;
+        }
+    }
+
+    _scheduler.at(std::chrono::steady_clock::now() + std::chrono::milliseconds(pending.timeout),
+                  [this, id] { expire(id); });
+    return true;
+}
+
+
+void AsyncClient::expire(const uint64_t id)
+{
+    Pending *pending = NULL;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        std::map<uint64_t, Pending *>::iterator found = _pending.find(id);
+        if(found == _pending.end())
+            return;
+        pending = found->second;
+        _pending.erase(found);
+    }
+
+    pending->param.rc = DYB_Timeout;
+    pending->frame.rc = DYB_Timeout;
+    _scheduler.post(pending->handle);
+}
+
+
+void AsyncClient::readBack(const uint64_t id)
+{
+    DYB_Address address = 0;
+    int32_t index = 0;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        std::map<uint64_t, Pending *>::iterator found = _pending.find(id);
+        if(found == _pending.end())
+            return;
+        /* Only events after this point confirm the candidate */
+        found->second->ack.fence();
+        address = found->second->address;
+        index = found->second->index;
+    }
+    DYB_getParameterAsync(address, index);
+}
+
+
+void AsyncClient::onEvent(const DYB_Address address, const int32_t index, const int32_t value)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    std::map<uint64_t, Pending *>::iterator it = _pending.begin();
+    while(it != _pending.end())
+    {
+        Pending *pending = it->second;
+        if(pending->kind != Pending::Parameter || pending->address != address || pending->index != index)
+        {
+            ++it;
+            continue;
+        }
+
+        /* A get takes any value, a set what its acknowledgement state accepts */
+        const AckState::Result result = pending->set ? pending->ack.onEvent(value) : AckState::Accept;
+        pending->param.value = value;
+        if(result == AckState::Accept)
+        {
+            _scheduler.post(pending->handle);
+            it = _pending.erase(it);
+            continue;
+        }
+
+        if(result == AckState::ReadBack)
+        {
+            const uint64_t id = it->first;
+            _scheduler.at(std::chrono::steady_clock::now(), [this, id] { readBack(id); });
+        }
+        ++it;
+    }
+}
+
+
+void AsyncClient::frameLoop()
+{
+    const int32_t dataMask = (DYB_EVT_DATA_00 << ASC500_DATA_CHANNELS) - DYB_EVT_DATA_00;
+    uint64_t seq = _events.sequence();
+    QueuedEvent event;
+
+    while(_running)
+    {
+        /* Short timeout to notice the destruction and frames queued before their request */
+        if(_events.waitSince(seq, dataMask, 100, &event))
+            seq = event.seq;
+
+        /* Oldest request of a channel first; a frame not requested stays in the queue */
+        std::lock_guard<std::mutex> lock(_lock);
+        std::map<uint64_t, Pending *>::iterator it = _pending.begin();
+        while(it != _pending.end())
+        {
+            FrameBuffer *buffer = it->second->kind == Pending::Frame ? _events.takeFrame(it->second->address) : NULL;
+            if(buffer)
+            {
+                it->second->frame.buffer = buffer;
+                _scheduler.post(it->second->handle);
+                it = _pending.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+}
+
+} /* namespace asc500 */
+
+#endif /* ASC500_COROUTINES */
@@ -0,0 +1,420 @@
+/** \file asc500_coro.h
+ * \brief Coroutine interface for parameter and data operations (C++20).
+ *
+ * The *Sync functions of daisybase block the calling thread for a round
+ * trip. With the awaitables of AsyncClient, a coroutine suspends instead
+ * and one thread keeps any number of operations in flight:
+ *
+ *     asc500::Task<void> step(asc500::AsyncClient &asc)
+ *     {
+ *         asc500::ParamResult status = co_await asc.get(ID_SCAN_STATUS);
+ *         co_await asc.set(ID_OUTPUT_ACTIVATE, 0, 1);
+ *         asc500::FrameResult frame = co_await asc.nextFrame(0);
+ *         ...
+ *         asc.release(frame.buffer);
+ *     }
+ *
+ *     scheduler.spawn(step(asc));
+ *     scheduler.run();
+ *
+ * Requests are sent with the *Async functions; the answers arrive as events
+ * through the EventHub and full data buffers are taken from an EventQueue
+ * whose pump has been started for the channels of interest (see
+ * asc500_eventqueue.h). Coroutines are always resumed by Scheduler::run()
+ * on the thread that calls it, never in the callback context, so they may
+ * use any daisybase function.
+ *
+ * Only available if the compiler supports coroutines (__cpp_impl_coroutine);
+ * the rest of the library stays C++14. asc500_cnt.cbp builds with C++14,
+ * where this module is empty; the target test_coro of tests/asc500_tests.cbp
+ * builds and checks it with C++20.
+ */
+
+#ifndef __ASC500_CORO_H
+#define __ASC500_CORO_H
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define ASC500_COROUTINES 1
+#endif
+#endif
+
+#ifdef ASC500_COROUTINES
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500_batch.h"
+#include "asc500_eventqueue.h"
+#include "asc500_framepool.h"
+
+
+namespace asc500
+{
+
+/* ----------------------------------------------------------------------
+ *  Task
+ * ---------------------------------------------------------------------- */
+
+template <typename T> class Task;
+
+namespace detail
+{
+
+/* Resumes the awaiting coroutine when a task completes */
+struct FinalAwaiter
+{
+    bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+    {
+        std::coroutine_handle<> continuation = handle.promise().continuation;
+        return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+
+struct PromiseBase
+{
+    std::coroutine_handle<> continuation;
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() const noexcept { std::terminate(); }
+};
+
+
+template <typename T>
+struct Promise : PromiseBase
+{
+    T value;
+
+    Task<T> get_return_object();
+    void return_value(T result) { value = std::move(result); }
+    T result() { return std::move(value); }
+};
+
+
+template <>
+struct Promise<void> : PromiseBase
+{
+    Task<void> get_return_object();
+    void return_void() const noexcept {}
+    void result() const noexcept {}
+};
+
+} /* namespace detail */
+
+
+/** \brief Lazily started coroutine; runs when awaited or spawned.
+ */
+template <typename T = void>
+class Task
+{
+public:
+    typedef detail::Promise<T> promise_type;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+    Task(Task &&other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+    ~Task() { if(_handle) _handle.destroy(); }
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if(this != &other)
+        {
+            if(_handle)
+                _handle.destroy();
+            _handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    bool done() const { return !_handle || _handle.done(); }
+    std::coroutine_handle<promise_type> handle() const { return _handle; }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        _handle.promise().continuation = awaiting;
+        return _handle;
+    }
+
+    T await_resume() { return _handle.promise().result(); }
+
+private:
+    std::coroutine_handle<promise_type> _handle;
+};
+
+
+namespace detail
+{
+
+template <typename T>
+Task<T> Promise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<Promise<T> >::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<Promise<void> >::from_promise(*this));
+}
+
+} /* namespace detail */
+
+
+/* ----------------------------------------------------------------------
+ *  Scheduler
+ * ---------------------------------------------------------------------- */
+
+class Scheduler
+{
+public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    Scheduler() {}
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    /** \brief Queue a coroutine for resumption by run(); thread safe.
+     *
+     * \param handle std::coroutine_handle<> Suspended coroutine.
+     * \return void
+     *
+     */
+    void post(std::coroutine_handle<> handle);
+
+    /** \brief Call a function from run() at a given time; thread safe.
+     *
+     * \param deadline const TimePoint When to call.
+     * \param action std::function<void()> Function to call.
+     * \return void
+     *
+     */
+    void at(const TimePoint deadline, std::function<void()> action);
+
+    /** \brief Start a task; it is owned by the scheduler until it completes.
+     *
+     * \param task Task<void> The task.
+     * \return void
+     *
+     */
+    void spawn(Task<void> task);
+
+    /** \brief Resume coroutines and fire timers until all spawned tasks are done.
+     *
+     * \param timeout const int32_t Maximum run time [ms], -1 for unlimited.
+     * \return bool True if all tasks are done.
+     *
+     */
+    bool run(const int32_t timeout = -1);
+
+    /** \brief Number of spawned tasks that are not done.
+     *
+     * \return size_t Tasks.
+     *
+     */
+    size_t active() const;
+
+private:
+    mutable std::mutex _lock;
+    std::condition_variable _wakeup;
+    std::vector<std::coroutine_handle<> > _ready;
+    std::multimap<TimePoint, std::function<void()> > _timers;
+    std::vector<Task<void> > _tasks;
+};
+
+
+/* ----------------------------------------------------------------------
+ *  AsyncClient
+ * ---------------------------------------------------------------------- */
+
+/** \brief Result of a parameter operation.
+ */
+struct ParamResult
+{
+    DYB_Rc rc;                 /**< DYB_Ok, DYB_Timeout or error of the request */
+    int32_t value;             /**< Value reported by the server                */
+};
+
+
+/** \brief Result of nextFrame().
+ */
+struct FrameResult
+{
+    DYB_Rc rc;                 /**< DYB_Ok, DYB_Timeout or error of DYB_getDataBuffer */
+    FrameBuffer *buffer;       /**< The frame; to be released with AsyncClient::release() */
+};
+
+
+class AsyncClient
+{
+private:
+    struct Pending
+    {
+        enum Kind { Parameter, Frame, Delay };
+
+        Kind kind;
+        DYB_Address address;       /* Parameter or data channel  */
+        int32_t index;
+        int32_t value;             /* Value to set               */
+        bool set;                  /* Set or get a parameter     */
+        AckState ack;              /* Set: acknowledgement state */
+        int32_t timeout;           /* [ms]                       */
+        ParamResult param;
+        FrameResult frame;
+        std::coroutine_handle<> handle;
+    };
+
+public:
+    /** \brief Awaitable of all operations; the result depends on the operation.
+     *
+     * Lives in the frame of the awaiting coroutine while it is suspended.
+     */
+    template <typename Result>
+    class Operation
+    {
+    public:
+        Operation(AsyncClient &client, const Pending &pending) : _client(client), _pending(pending) {}
+
+        bool await_ready() { return _client.tryNow(_pending); }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            _pending.handle = handle;
+            return _client.start(_pending);
+        }
+
+        Result await_resume() const { return result(static_cast<const Result *>(NULL)); }
+
+    private:
+        ParamResult result(const ParamResult *) const { return _pending.param; }
+        FrameResult result(const FrameResult *) const { return _pending.frame; }
+        void result(const void *) const {}
+
+        AsyncClient &_client;
+        Pending _pending;
+    };
+
+    /** \brief Create a client.
+     *
+     * \param scheduler Scheduler& Scheduler that resumes the coroutines.
+     * \param pool FramePool& Pool the pump of events fetches the frames from.
+     * \param events EventQueue& Queue whose pump fetches the full buffers.
+     *
+     */
+    AsyncClient(Scheduler &scheduler, FramePool &pool, EventQueue &events);
+    ~AsyncClient();
+
+    AsyncClient(const AsyncClient &) = delete;
+    AsyncClient &operator=(const AsyncClient &) = delete;
+
+    /** \brief Read a parameter (DYB_getParameterAsync).
+     *
+     * \param address const DYB_Address Parameter address.
+     * \param index const int32_t Subaddress.
+     * \param timeout const int32_t Wait for the answer [ms].
+     * \return Operation<ParamResult> Awaitable.
+     *
+     */
+    Operation<ParamResult> get(const DYB_Address address, const int32_t index = 0, const int32_t timeout = 1000)
+    {
+        return Operation<ParamResult>(*this, request(Pending::Parameter, address, index, 0, false, timeout));
+    }
+
+    /** \brief Set a parameter (DYB_setParameterAsync) and wait for the acknowledgement.
+     *
+     * Acknowledged by an event with the requested value. An event with
+     * another value may be caused by a different request, so the parameter
+     * is read back and the value is accepted if an event after the read back
+     * confirms it (the server has limited it), as in setParameterBatch().
+     *
+     * \param address const DYB_Address Parameter address.
+     * \param index const int32_t Subaddress.
+     * \param value const int32_t Value to set.
+     * \param timeout const int32_t Wait for the acknowledgement [ms].
+     * \return Operation<ParamResult> Awaitable; value as acknowledged (may be limited).
+     *
+     */
+    Operation<ParamResult> set(const DYB_Address address, const int32_t index, const int32_t value,
+                               const int32_t timeout = 1000)
+    {
+        return Operation<ParamResult>(*this, request(Pending::Parameter, address, index, value, true, timeout));
+    }
+
+    /** \brief Wait for the next full buffer of a buffered data channel.
+     *
+     * \param channel const int32_t Data channel; its pump must be running.
+     * \param timeout const int32_t Wait for the frame [ms].
+     * \return Operation<FrameResult> Awaitable.
+     *
+     */
+    Operation<FrameResult> nextFrame(const int32_t channel, const int32_t timeout = 5000)
+    {
+        return Operation<FrameResult>(*this, request(Pending::Frame, channel, 0, 0, false, timeout));
+    }
+
+    /** \brief Suspend for a time without blocking the thread.
+     *
+     * \param milliseconds const int32_t Delay [ms].
+     * \return Operation<void> Awaitable.
+     *
+     */
+    Operation<void> sleep(const int32_t milliseconds)
+    {
+        return Operation<void>(*this, request(Pending::Delay, -1, 0, 0, false, milliseconds));
+    }
+
+    /** \brief Return a frame of nextFrame() to the pool.
+     *
+     * \param buffer FrameBuffer* The frame, may be NULL.
+     * \return void
+     *
+     */
+    void release(FrameBuffer *buffer) { _pool.release(buffer); }
+
+private:
+    static Pending request(const Pending::Kind kind, const DYB_Address address, const int32_t index,
+                           const int32_t value, const bool set, const int32_t timeout);
+    bool tryNow(Pending &pending);
+    bool start(Pending &pending);
+    void expire(const uint64_t id);
+    void readBack(const uint64_t id);
+    void onEvent(const DYB_Address address, const int32_t index, const int32_t value);
+    void frameLoop();
+
+    Scheduler &_scheduler;
+    FramePool &_pool;
+    EventQueue &_events;
+    std::mutex _lock;
+    std::map<uint64_t, Pending *> _pending;    /* Suspended operations by id, oldest first */
+    uint64_t _nextId;
+    int32_t _token;
+    std::thread _frames;
+    std::atomic<bool> _running;
+};
+
+} /* namespace asc500 */
+
+#endif /* ASC500_COROUTINES */
+
+#endif
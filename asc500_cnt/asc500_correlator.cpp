@@ -0,0 +1,188 @@
+#include <algorithm>
+
+#include "asc500_correlator.h"
+
+
+namespace asc500
+{
+
+/* Sample time unit of DYB_configureChannel [s] */
+static const double SampleTimeUnit = 2.5e-6;
+
+
+MultiTauCorrelator::MultiTauCorrelator(const int32_t sampleTime, const int32_t levels,
+                                       const int32_t channels)
+    : _channels(channels < 4 ? 4 : channels > 256 ? 256 : channels & ~1),
+      _sampleTime(sampleTime > 0 ? sampleTime : 0), _samples(0), _nextIndex(-1),
+      _interval(0), _published(0)
+{
+    _levels.resize(levels < 1 ? 1 : levels > 40 ? 40 : levels);
+    for(Level &level : _levels)
+    {
+        level.shift.resize(2 * _channels);
+        level.product.resize(_channels);
+        level.direct.resize(_channels);
+        level.delayed.resize(_channels);
+        level.count.resize(_channels);
+    }
+    reset();
+}
+
+
+void MultiTauCorrelator::onCurve(CurveHandler handler, const int64_t interval)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _handler = handler;
+    _interval = interval > 0 ? interval : 1;
+    _published = _samples;
+}
+
+
+void MultiTauCorrelator::setSampleTime(const int32_t sampleTime)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _sampleTime = sampleTime > 0 ? sampleTime : 0;
+}
+
+
+void MultiTauCorrelator::reset()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    for(Level &level : _levels)
+    {
+        std::fill(level.product.begin(), level.product.end(), 0.0);
+        std::fill(level.direct.begin(), level.direct.end(), 0.0);
+        std::fill(level.delayed.begin(), level.delayed.end(), 0.0);
+        std::fill(level.count.begin(), level.count.end(), 0);
+    }
+    empty();
+    _samples = 0;
+    _published = 0;
+    _nextIndex = -1;
+}
+
+
+void MultiTauCorrelator::empty()
+{
+    for(Level &level : _levels)
+    {
+        std::fill(level.shift.begin(), level.shift.end(), 0.0);
+        level.pos = 0;
+        level.filled = 0;
+        level.pending = 0.0;
+        level.pendingCount = 0;
+    }
+}
+
+
+DYB_Rc MultiTauCorrelator::push(const int32_t *counts, const int32_t length)
+{
+    CurveHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        for(int32_t i = 0; i < length; i++)
+            add(counts[i] > 0 ? counts[i] : 0);
+
+        if(_handler && _samples - _published >= _interval)
+        {
+            _published = _samples;
+            collect(_curve);
+            handler = _handler;
+        }
+    }
+
+    /* Outside of the lock, the handler may call curve() */
+    if(handler)
+        handler(_curve);
+    return DYB_Ok;
+}
+
+
+DYB_Rc MultiTauCorrelator::push(const DataPacket &packet)
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if(_nextIndex >= 0 && packet.index != _nextIndex)
+            empty();
+        _nextIndex = static_cast<int64_t>(packet.index) + packet.length;
+    }
+    return push(packet.data, packet.length);
+}
+
+
+void MultiTauCorrelator::add(const double value)
+{
+    _samples++;
+
+    /* Cascade: every level hands the sum of two values to the next one */
+    double carry = value;
+    for(int32_t l = 0; l < static_cast<int32_t>(_levels.size()); l++)
+    {
+        correlate(l, carry);
+
+        Level &level = _levels[l];
+        level.pending += carry;
+        if(++level.pendingCount < 2)
+            break;
+        carry = level.pending;
+        level.pending = 0.0;
+        level.pendingCount = 0;
+    }
+}
+
+
+void MultiTauCorrelator::correlate(const int32_t l, const double value)
+{
+    Level &level = _levels[l];
+
+    /* Newest value at pos, mirrored so that the window pos .. pos + channels - 1 is contiguous */
+    level.pos = level.pos > 0 ? level.pos - 1 : _channels - 1;
+    level.shift[level.pos] = value;
+    level.shift[level.pos + _channels] = value;
+    level.filled++;
+
+    /* Level 0 covers all lags, the others only the upper half of their register */
+    const int32_t first = l == 0 ? 0 : _channels / 2,
+                  last = level.filled < _channels ? static_cast<int32_t>(level.filled) : _channels;
+    const double *delayed = level.shift.data() + level.pos;
+    for(int32_t j = first; j < last; j++)
+    {
+        level.product[j] += value * delayed[j];
+        level.direct[j] += value;
+        level.delayed[j] += delayed[j];
+        level.count[j]++;
+    }
+}
+
+
+void MultiTauCorrelator::collect(std::vector<CorrelationPoint> &curve) const
+{
+    curve.clear();
+    for(int32_t l = 0; l < static_cast<int32_t>(_levels.size()); l++)
+    {
+        const Level &level = _levels[l];
+        for(int32_t j = l == 0 ? 0 : _channels / 2; j < _channels; j++)
+        {
+            if(level.count[j] == 0)
+                continue;
+
+            CorrelationPoint point;
+            point.lag = static_cast<int64_t>(j) << l;
+            point.tau = point.lag * _sampleTime * SampleTimeUnit;
+            const double norm = level.direct[j] * level.delayed[j];
+            point.g2 = norm > 0.0 ? level.product[j] * level.count[j] / norm : 0.0;
+            point.products = level.count[j];
+            curve.push_back(point);
+        }
+    }
+}
+
+
+int64_t MultiTauCorrelator::curve(std::vector<CorrelationPoint> &curve) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    collect(curve);
+    return _samples;
+}
+
+} /* namespace asc500 */
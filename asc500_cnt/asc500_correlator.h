@@ -0,0 +1,154 @@
+/** \file asc500_correlator.h
+ * \brief Real time multi-tau autocorrelation of counter data.
+ *
+ * MultiTauCorrelator computes the intensity autocorrelation g2(tau) of a
+ * CHANADC_COUNTER stream with cascaded shift registers (Schaetzel): level 0
+ * correlates the samples over lags 0 .. channels - 1; every further level
+ * receives the sums of two successive values of the level below and
+ * correlates them over the lags channels / 2 .. channels - 1 in its
+ * coarser time unit. Lags are therefore spaced logarithmically up to
+ * channels * 2^(levels - 1) samples, and a sample costs about 2 * channels
+ * multiply-adds independent of the number of levels, i.e. O(log tau_max)
+ * for a given lag resolution.
+ *
+ * Every channel keeps the sum of products, the number of products and the
+ * sums of the direct and delayed values taking part, so the curve uses the
+ * symmetric normalization
+ *
+ *     g2 = products * sum(x[t] x[t - tau]) / (sum(x[t]) * sum(x[t - tau]))
+ *
+ * which isn't biased by drifts of the mean count rate between the levels.
+ * curve() may be called from any thread; optionally the curve is published
+ * to a handler after a given number of samples.
+ */
+
+#ifndef __ASC500_CORRELATOR_H
+#define __ASC500_CORRELATOR_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500_spscring.h"
+
+
+namespace asc500
+{
+
+/** One lag of the correlation curve */
+struct CorrelationPoint
+{
+    int64_t lag;               /**< Lag [samples]                              */
+    double tau;                /**< Lag [s]; 0 if the sample time is unknown   */
+    double g2;                 /**< Normalized correlation; 0 without data     */
+    int64_t products;          /**< Number of products accumulated             */
+};
+
+
+class MultiTauCorrelator
+{
+public:
+    typedef std::function<void(const std::vector<CorrelationPoint> &curve)> CurveHandler;
+
+    /** \brief Create a correlator.
+     *
+     * \param sampleTime const int32_t Sample time of the channel [2.5 us] as passed
+     *                                 to DYB_configureChannel; 0 = unknown.
+     * \param levels const int32_t Number of levels (1 .. 40).
+     * \param channels const int32_t Lags per level, even (4 .. 256).
+     *
+     */
+    explicit MultiTauCorrelator(const int32_t sampleTime = 0, const int32_t levels = 24,
+                                const int32_t channels = 16);
+
+    MultiTauCorrelator(const MultiTauCorrelator &) = delete;
+    MultiTauCorrelator &operator=(const MultiTauCorrelator &) = delete;
+
+    /** \brief Publish the curve from push() every interval samples.
+     *
+     * \param handler CurveHandler Called with the current curve; empty = none.
+     * \param interval const int64_t Samples between two publications.
+     * \return void
+     *
+     */
+    void onCurve(CurveHandler handler, const int64_t interval);
+
+    /** \brief Set the sample time used for tau.
+     *
+     * \param sampleTime const int32_t Sample time [2.5 us].
+     * \return void
+     *
+     */
+    void setSampleTime(const int32_t sampleTime);
+
+    /** \brief Append counts.
+     *
+     * \param counts const int32_t* Counts per sample, negative values count as 0.
+     * \param length const int32_t Number of samples.
+     * \return DYB_Rc DYB_Ok
+     *
+     */
+    DYB_Rc push(const int32_t *counts, const int32_t length);
+
+    /** \brief Append a packet of the acquisition layer.
+     *
+     * A gap in the data index empties the registers, so no product spans it.
+     *
+     * \param packet const DataPacket& The packet.
+     * \return DYB_Rc DYB_Ok
+     *
+     */
+    DYB_Rc push(const DataPacket &packet);
+
+    /** \brief Discard the accumulated correlation.
+     *
+     * \return void
+     *
+     */
+    void reset();
+
+    /** \brief Current curve.
+     *
+     * \param curve std::vector<CorrelationPoint>& Output: all lags with products, ascending.
+     * \return int64_t Number of samples processed.
+     *
+     */
+    int64_t curve(std::vector<CorrelationPoint> &curve) const;
+
+private:
+    struct Level
+    {
+        std::vector<double> shift;     /* 2 * channels, mirrored: shift[pos + j] is j values old */
+        int32_t pos;
+        int64_t filled;                /* Values entered since the registers were emptied */
+        double pending;                /* Sum handed to the next level */
+        int32_t pendingCount;
+        std::vector<double> product;
+        std::vector<double> direct;
+        std::vector<double> delayed;
+        std::vector<int64_t> count;
+    };
+
+    void add(const double value);
+    void correlate(const int32_t level, const double value);
+    void empty();
+    void collect(std::vector<CorrelationPoint> &curve) const;
+
+    mutable std::mutex _lock;
+    int32_t _channels;
+    int32_t _sampleTime;
+    std::vector<Level> _levels;
+    int64_t _samples;
+    int64_t _nextIndex;
+
+    CurveHandler _handler;
+    int64_t _interval;
+    int64_t _published;
+    std::vector<CorrelationPoint> _curve;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cmath>
+
+#include "asc500.h"
+#include "asc500_counterstats.h"
+#include "asc500_events.h"
+
+
+namespace asc500
+{
+
+/* Exposure time unit of ID_CNT_EXP_TIME [s] */
+static const double ExposureUnit = 2.5e-6;
+
+/* Histogram: exact below 2 * Subbins, Subbins bins per octave up to 2^31 */
+static const int32_t SubbinBits = 3;
+static const int32_t HistogramBins = CounterStatistics::Subbins * (31 - SubbinBits + 1);
+
+static_assert(CounterStatistics::Subbins == 1 << SubbinBits, "Subbins must be 2^SubbinBits");
+
+
+static int32_t highestBit(uint64_t value)
+{
+    int32_t bit = 0;
+    for(int32_t step = 32; step > 0; step /= 2)
+    {
+        if(value >> step)
+        {
+            value >>= step;
+            bit += step;
+        }
+    }
+    return bit;
+}
+
+
+static int32_t binOf(const int64_t count)
+{
+    if(count < 2 * CounterStatistics::Subbins)
+        return static_cast<int32_t>(count);
+    const int32_t shift = highestBit(static_cast<uint64_t>(count)) - SubbinBits;
+    return CounterStatistics::Subbins * shift + static_cast<int32_t>(count >> shift);
+}
+
+
+CounterStatistics::CounterStatistics(const int32_t exposure, const int32_t octaves)
+    : _token(0), _exposure(exposure > 0 ? exposure : 0),
+      _octaves(octaves < 1 ? 1 : octaves > 20 ? 20 : octaves)
+{
+    _phase.resize(static_cast<size_t>(1) << (_octaves + 1));
+    _mask = _phase.size() - 1;
+    _bins.resize(HistogramBins);
+    _allanSum.resize(_octaves);
+    _allanTerms.resize(_octaves);
+    clear();
+
+    if(_exposure == 0)
+    {
+        _token = EventHub::subscribe([this](const DYB_Address, const int32_t index, const int32_t value)
+        {
+            if(index == 0)
+                exposureChanged(value);
+        }, ID_CNT_EXP_TIME);
+
+        /* Current value; later changes arrive autonomously */
+        DYB_getParameterAsync(ID_CNT_EXP_TIME, 0);
+    }
+}
+
+
+CounterStatistics::~CounterStatistics()
+{
+    if(_token != 0)
+        EventHub::unsubscribe(_token);
+}
+
+
+void CounterStatistics::setExposureTime(const int32_t exposure)
+{
+    if(_token != 0)
+    {
+        EventHub::unsubscribe(_token);
+        _token = 0;
+    }
+    exposureChanged(exposure > 0 ? exposure : 0);
+}
+
+
+void CounterStatistics::exposureChanged(const int32_t exposure)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    if(exposure != _exposure)
+    {
+        _exposure = exposure;
+        clear();
+    }
+}
+
+
+void CounterStatistics::reset()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    clear();
+}
+
+
+void CounterStatistics::clear()
+{
+    _nextIndex = -1;
+    _samples = 0;
+    _mean = 0.0;
+    _m2 = 0.0;
+    std::fill(_bins.begin(), _bins.end(), 0);
+    std::fill(_allanSum.begin(), _allanSum.end(), 0.0);
+    std::fill(_allanTerms.begin(), _allanTerms.end(), 0);
+    _run = 0;
+    _total = 0;
+    _phase[0] = 0;
+}
+
+
+DYB_Rc CounterStatistics::push(const int32_t *counts, const int32_t length)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    for(int32_t i = 0; i < length; i++)
+        add(counts[i] > 0 ? counts[i] : 0);
+    return DYB_Ok;
+}
+
+
+DYB_Rc CounterStatistics::push(const DataPacket &packet)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    if(_nextIndex >= 0 && packet.index != _nextIndex)
+    {
+        /* New run of the phase; the sums so far stay valid */
+        _run = 0;
+        _total = 0;
+        _phase[0] = 0;
+    }
+    _nextIndex = static_cast<int64_t>(packet.index) + packet.length;
+
+    for(int32_t i = 0; i < packet.length; i++)
+        add(packet.data[i] > 0 ? packet.data[i] : 0);
+    return DYB_Ok;
+}
+
+
+void CounterStatistics::add(const int64_t count)
+{
+    /* Welford */
+    _samples++;
+    const double delta = count - _mean;
+    _mean += delta / _samples;
+    _m2 += delta * (count - _mean);
+
+    _bins[binOf(count)]++;
+
+    /* Overlapping Allan variance from the cumulated counts x:
+     * term(m) = x[n] - 2 x[n - m] + x[n - 2m] = m * difference of the means */
+    _total += count;
+    _run++;
+    _phase[_run & _mask] = _total;
+    for(int32_t k = 0; k < _octaves; k++)
+    {
+        const int64_t m = static_cast<int64_t>(1) << k;
+        if(_run < 2 * m)
+            break;
+        const double term = static_cast<double>(_total - 2 * _phase[(_run - m) & _mask] + _phase[(_run - 2 * m) & _mask]);
+        _allanSum[k] += term * term;
+        _allanTerms[k]++;
+    }
+}
+
+
+CounterSummary CounterStatistics::summary() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    CounterSummary result;
+    result.samples = _samples;
+    result.mean = _mean;
+    result.variance = _samples > 1 ? _m2 / (_samples - 1) : 0.0;
+    result.fano = _mean > 0.0 ? result.variance / _mean : 0.0;
+    result.rate = _exposure > 0 ? _mean / (_exposure * ExposureUnit) : 0.0;
+    result.exposure = _exposure;
+    return result;
+}
+
+
+void CounterStatistics::histogram(std::vector<HistogramBin> &bins) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    bins.clear();
+    for(int32_t b = 0; b < HistogramBins; b++)
+    {
+        if(_bins[b] == 0)
+            continue;
+
+        HistogramBin bin;
+        if(b < 2 * Subbins)
+        {
+            bin.lower = b;
+            bin.upper = b + 1;
+        }
+        else
+        {
+            const int32_t shift = b / Subbins - 1;
+            bin.lower = static_cast<int64_t>(b - Subbins * shift) << shift;
+            bin.upper = bin.lower + (static_cast<int64_t>(1) << shift);
+        }
+        bin.samples = _bins[b];
+        bins.push_back(bin);
+    }
+}
+
+
+void CounterStatistics::allan(std::vector<AllanPoint> &points) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    points.clear();
+    const double exposure = _exposure * ExposureUnit;
+    for(int32_t k = 0; k < _octaves && _allanTerms[k] > 0; k++)
+    {
+        AllanPoint point;
+        point.m = 1 << k;
+        point.tau = point.m * exposure;
+        point.deviation = sqrt(_allanSum[k] / (2.0 * _allanTerms[k])) / point.m;
+        if(exposure > 0.0)
+            point.deviation /= exposure;
+        point.terms = _allanTerms[k];
+        points.push_back(point);
+    }
+}
+
+} /* namespace asc500 */
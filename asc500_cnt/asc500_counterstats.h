@@ -0,0 +1,169 @@
+/** \file asc500_counterstats.h
+ * \brief Online statistics of photon counter data.
+ *
+ * CounterStatistics consumes the samples of a CHANADC_COUNTER channel as
+ * they arrive. Every sample is taken as the number of counts in one
+ * exposure time (ID_CNT_EXP_TIME, 2.5 us units), which the object follows
+ * through the EventHub unless it is set explicitly. It keeps:
+ *
+ * - mean, variance (Welford), Fano factor and count rate, O(1) per sample;
+ * - a log-binned histogram: counts below 2 * Subbins are binned exactly,
+ *   every octave above is split into Subbins bins of equal width;
+ * - the overlapping Allan deviation of the count rate for tau = 2^k
+ *   exposure times, k = 0 .. octaves - 1. The counts are summed up exactly
+ *   (int64) in a history ring of 2^(octaves + 1) entries, so each sample
+ *   adds one term per octave, computed from three ring entries.
+ *
+ * A gap in the data index only leaves out the Allan terms that would span
+ * it. A change of the exposure time resets everything, as the counts aren't
+ * comparable anymore.
+ *
+ * All queries copy under a lock and may be called from any thread while
+ * the acquisition keeps pushing data.
+ */
+
+#ifndef __ASC500_COUNTERSTATS_H
+#define __ASC500_COUNTERSTATS_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500_spscring.h"
+
+
+namespace asc500
+{
+
+/** Moments of the counts per exposure */
+struct CounterSummary
+{
+    int64_t samples;           /**< Samples taken into account                 */
+    double mean;               /**< Mean counts per exposure                   */
+    double variance;           /**< Sample variance of the counts              */
+    double fano;               /**< Variance / mean; 1 for Poisson statistics  */
+    double rate;               /**< Count rate [cps]; 0 if exposure unknown    */
+    int32_t exposure;          /**< Exposure time [2.5 us]                     */
+};
+
+
+/** Bin of the count histogram: counts in [lower, upper) */
+struct HistogramBin
+{
+    int64_t lower;             /**< Smallest count of the bin                  */
+    int64_t upper;             /**< Smallest count of the next bin             */
+    int64_t samples;           /**< Samples in the bin                         */
+};
+
+
+/** Overlapping Allan deviation at one averaging time */
+struct AllanPoint
+{
+    int32_t m;                 /**< Averaging factor, tau = m * exposure       */
+    double tau;                /**< Averaging time [s]; 0 if exposure unknown  */
+    double deviation;          /**< Allan deviation [cps]; counts / exposure
+                                    if the exposure is unknown                 */
+    int64_t terms;             /**< Number of overlapping differences          */
+};
+
+
+class CounterStatistics
+{
+public:
+    static const int32_t Subbins = 8;                /**< Histogram bins per octave        */
+
+    /** \brief Create the statistics.
+     *
+     * \param exposure const int32_t Exposure time [2.5 us]; 0 = follow ID_CNT_EXP_TIME.
+     * \param octaves const int32_t Number of Allan tau values (1 .. 20).
+     *
+     */
+    explicit CounterStatistics(const int32_t exposure = 0, const int32_t octaves = 16);
+    ~CounterStatistics();
+
+    CounterStatistics(const CounterStatistics &) = delete;
+    CounterStatistics &operator=(const CounterStatistics &) = delete;
+
+    /** \brief Set the exposure time and stop following ID_CNT_EXP_TIME.
+     *
+     * \param exposure const int32_t Exposure time [2.5 us].
+     * \return void
+     *
+     */
+    void setExposureTime(const int32_t exposure);
+
+    /** \brief Append counts.
+     *
+     * \param counts const int32_t* Counts per exposure, negative values count as 0.
+     * \param length const int32_t Number of samples.
+     * \return DYB_Rc DYB_Ok
+     *
+     */
+    DYB_Rc push(const int32_t *counts, const int32_t length);
+
+    /** \brief Append a packet of the acquisition layer.
+     *
+     * \param packet const DataPacket& The packet; a gap in the index interrupts the Allan sums.
+     * \return DYB_Rc DYB_Ok
+     *
+     */
+    DYB_Rc push(const DataPacket &packet);
+
+    /** \brief Discard all statistics.
+     *
+     * \return void
+     *
+     */
+    void reset();
+
+    /** \brief Current moments.
+     *
+     * \return CounterSummary The moments.
+     *
+     */
+    CounterSummary summary() const;
+
+    /** \brief Copy the non-empty histogram bins.
+     *
+     * \param bins std::vector<HistogramBin>& Output: the bins in ascending order.
+     * \return void
+     *
+     */
+    void histogram(std::vector<HistogramBin> &bins) const;
+
+    /** \brief Overlapping Allan deviation of the octaves with terms.
+     *
+     * \param points std::vector<AllanPoint>& Output: by ascending tau.
+     * \return void
+     *
+     */
+    void allan(std::vector<AllanPoint> &points) const;
+
+private:
+    void clear();
+    void add(int64_t count);
+    void exposureChanged(const int32_t exposure);
+
+    mutable std::mutex _lock;
+    int32_t _token;            /* EventHub subscription, 0 if fixed           */
+    int32_t _exposure;
+    int32_t _octaves;
+    int64_t _nextIndex;
+
+    int64_t _samples;
+    double _mean;
+    double _m2;
+    std::vector<int64_t> _bins;
+
+    std::vector<int64_t> _phase;       /* Ring of cumulated counts         */
+    uint64_t _mask;
+    int64_t _run;                      /* Contiguous samples in the ring   */
+    int64_t _total;                    /* Cumulated counts of the run      */
+    std::vector<double> _allanSum;
+    std::vector<int64_t> _allanTerms;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,219 @@
+#include <chrono>
+#include <cstring>
+
+#include "daisydata.h"
+#include "asc500.h"
+#include "asc500_events.h"
+#include "asc500_eventqueue.h"
+
+
+namespace asc500
+{
+
+static int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+EventQueue::EventQueue(const size_t capacity)
+    : _ring(capacity > 0 ? capacity : 1), _seq(0), _token(0), _pumping(false), _pool(NULL)
+{
+    memset(_last, 0, sizeof(_last));
+    memset(_full, 0, sizeof(_full));
+
+    _token = EventHub::subscribe([this](const DYB_Address address, const int32_t index, const int32_t value)
+    {
+        int32_t type = DYB_EVT_CUSTOM;
+        if(address == ID_SPEC_PATHMANSTAT && value != 0)
+            type |= DYB_EVT_HANDSHK;
+        post(type, address, index, value);
+    });
+}
+
+
+EventQueue::~EventQueue()
+{
+    stopPump();
+    EventHub::unsubscribe(_token);
+}
+
+
+uint64_t EventQueue::sequence() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _seq;
+}
+
+
+uint64_t EventQueue::post(const int32_t type, const DYB_Address address,
+                          const int32_t index, const int32_t value)
+{
+    uint64_t seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        QueuedEvent &event = _ring[_seq % _ring.size()];
+        event.seq = seq = ++_seq;
+        event.timeNs = nowNs();
+        event.type = type;
+        event.address = address;
+        event.index = index;
+        event.value = value;
+
+        /* Kept after the ring has overwritten the event, for late waiters */
+        for(int32_t bit = 0; bit < 32; bit++)
+        {
+            if((static_cast<uint32_t>(type) >> bit) & 1)
+                _last[bit] = event;
+        }
+        if(type & DYB_EVT_CUSTOM)
+            _lastCustom[address] = event;
+    }
+    _arrived.notify_all();
+    return seq;
+}
+
+
+int32_t EventQueue::matches(const QueuedEvent &event, const int32_t mask, const DYB_Address customId) const
+{
+    int32_t hit = event.type & mask;
+    if((hit & DYB_EVT_CUSTOM) && customId != -1 && event.address != customId)
+        hit &= ~DYB_EVT_CUSTOM;
+    return hit;
+}
+
+
+bool EventQueue::find(const uint64_t seq, const int32_t mask, const DYB_Address customId,
+                      QueuedEvent &event) const
+{
+    const uint64_t oldest = _seq >= _ring.size() ? _seq - _ring.size() + 1 : 1;
+
+    for(uint64_t s = (seq + 1 > oldest ? seq + 1 : oldest); s <= _seq; s++)
+    {
+        const QueuedEvent &candidate = _ring[(s - 1) % _ring.size()];
+        if(matches(candidate, mask, customId))
+        {
+            event = candidate;
+            return true;
+        }
+    }
+    if(seq + 1 >= oldest)
+        return false;
+
+    /* The first match may have been overwritten: take the latest known one */
+    bool found = false;
+    for(int32_t bit = 0; bit < 32; bit++)
+    {
+        const QueuedEvent &candidate = _last[bit];
+        if(((static_cast<uint32_t>(mask) >> bit) & 1) && candidate.seq > seq && (!found || candidate.seq < event.seq) &&
+           matches(candidate, mask, customId))
+        {
+            event = candidate;
+            found = true;
+        }
+    }
+    if(!found && (mask & DYB_EVT_CUSTOM) && customId != -1)
+    {
+        std::unordered_map<DYB_Address, QueuedEvent>::const_iterator last = _lastCustom.find(customId);
+        if(last != _lastCustom.end() && last->second.seq > seq)
+        {
+            event = last->second;
+            found = true;
+        }
+    }
+    return found;
+}
+
+
+int32_t EventQueue::waitSince(const uint64_t seq, const int32_t mask, const int32_t timeout,
+                              QueuedEvent *event, const DYB_Address customId)
+{
+    QueuedEvent found;
+    std::unique_lock<std::mutex> lock(_lock);
+
+    if(!_arrived.wait_for(lock, std::chrono::milliseconds(timeout),
+                          [&] { return find(seq, mask, customId, found); }))
+        return 0;
+
+    if(event)
+        *event = found;
+    return matches(found, mask, customId);
+}
+
+
+DYB_Rc EventQueue::pumpData(FramePool &pool, const int32_t dataMask)
+{
+    if(_pumping.exchange(true))
+        return DYB_WrongContext;
+
+    _pool = &pool;
+    _pump = std::thread(&EventQueue::pumpLoop, this, dataMask);
+    return DYB_Ok;
+}
+
+
+FrameBuffer *EventQueue::takeFrame(const int32_t channel)
+{
+    if(channel < 0 || channel >= ASC500_DATA_CHANNELS)
+        return NULL;
+
+    std::lock_guard<std::mutex> lock(_lock);
+    FrameBuffer *buffer = _full[channel];
+    _full[channel] = NULL;
+    return buffer;
+}
+
+
+void EventQueue::stopPump()
+{
+    _pumping = false;
+    if(_pump.joinable())
+        _pump.join();
+
+    std::lock_guard<std::mutex> lock(_lock);
+    for(int32_t channel = 0; channel < ASC500_DATA_CHANNELS; channel++)
+    {
+        if(_full[channel])
+            _pool->release(_full[channel]);
+        _full[channel] = NULL;
+    }
+}
+
+
+void EventQueue::pumpLoop(const int32_t dataMask)
+{
+    while(_pumping)
+    {
+        /* Only a wakeup, the event may have come before the wait; short timeout to notice stopPump() */
+        DYB_waitForEvent(100, dataMask, 0);
+
+        for(int32_t channel = 0; channel < ASC500_DATA_CHANNELS; channel++)
+        {
+            if(!(dataMask & (DYB_EVT_DATA_00 << channel)))
+                continue;
+
+            /* Drain the channel, whatever woke us up */
+            for(;;)
+            {
+                FrameBuffer *buffer = _pool->acquire(channel);
+                if(!buffer || FramePool::fill(buffer, 1) != DYB_Ok)
+                {
+                    _pool->release(buffer);
+                    break;
+                }
+
+                FrameBuffer *stale = NULL;
+                {
+                    std::lock_guard<std::mutex> lock(_lock);
+                    stale = _full[channel];
+                    _full[channel] = buffer;
+                }
+                _pool->release(stale);
+                post(DYB_EVT_DATA_00 << channel, channel);
+            }
+        }
+    }
+}
+
+} /* namespace asc500 */
@@ -0,0 +1,159 @@
+/** \file asc500_eventqueue.h
+ * \brief Sequence numbered events without lost wakeups.
+ *
+ * DYB_waitForEvent only sees events that occur while it is waiting; an
+ * event that arrives between triggering an action and beginning to wait is
+ * lost. EventQueue records every event with a monotonic sequence number and
+ * a timestamp. The caller reads sequence() before triggering the action and
+ * then calls waitSince(), which returns at once if a matching event has
+ * already arrived in between:
+ *
+ *     const uint64_t seq = queue.sequence();
+ *     DYB_setParameterAsync(ID_OUTPUT_ACTIVATE, 0, 0);
+ *     queue.waitSince(seq, DYB_EVT_CUSTOM, 1000, NULL, ID_OUTPUT_STATUS);
+ *
+ * The event types are those of DYB_waitForEvent (daisydata.h):
+ * - DYB_EVT_CUSTOM for every parameter event, observed through the EventHub;
+ * - DYB_EVT_HANDSHK in addition for a path mode handshake request
+ *   (ID_SPEC_PATHMANSTAT != 0);
+ * - DYB_EVT_DATA_xx for full buffers of buffered data channels, collected by
+ *   the pump thread (pumpData()), or posted by the application, e.g. from a
+ *   data callback (post()).
+ *
+ * DYB_waitForEvent serves the pump only as a wakeup: after every wait, with
+ * or without event, it fetches the full buffers of its channels itself and
+ * keeps them until the application takes them (takeFrame()). A buffer that
+ * becomes full while the pump is not waiting is found by the next check, so
+ * no buffer event is lost. The application must not read these channels
+ * with DYB_getDataBuffer while the pump is running.
+ *
+ * The queue subscribes to the EventHub and must be created after DYB_init.
+ */
+
+#ifndef __ASC500_EVENTQUEUE_H
+#define __ASC500_EVENTQUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500.h"
+#include "asc500_framepool.h"
+
+
+namespace asc500
+{
+
+/** \brief An event recorded by the EventQueue.
+ */
+struct QueuedEvent
+{
+    uint64_t seq;              /**< Sequence number, starting with 1           */
+    int64_t timeNs;            /**< Arrival, steady clock [ns]                 */
+    int32_t type;              /**< Bitfield of DYB_EVT_..                     */
+    DYB_Address address;       /**< Parameter address, channel for data events */
+    int32_t index;             /**< Subaddress                                 */
+    int32_t value;             /**< Parameter value                            */
+};
+
+
+class EventQueue
+{
+public:
+    /** \brief Create the queue and subscribe to parameter events.
+     *
+     * \param capacity const size_t Number of events kept for waitSince().
+     *
+     */
+    explicit EventQueue(const size_t capacity = 1024);
+    ~EventQueue();
+
+    EventQueue(const EventQueue &) = delete;
+    EventQueue &operator=(const EventQueue &) = delete;
+
+    /** \brief Sequence number of the latest event.
+     *
+     * \return uint64_t Sequence, 0 if no event has arrived yet.
+     *
+     */
+    uint64_t sequence() const;
+
+    /** \brief Wait for the first matching event after a given sequence number.
+     *
+     * Returns at once if such an event has already been recorded. If it has
+     * been overwritten meanwhile, the latest event of the type is returned.
+     * Must not be called in the context of a callback.
+     *
+     * \param seq const uint64_t Events up to this sequence are ignored.
+     * \param mask const int32_t Bitfield of DYB_EVT_.. to wait for.
+     * \param timeout const int32_t Wait timeout [ms].
+     * \param event QueuedEvent* Output: the event, may be NULL.
+     * \param customId const DYB_Address Parameter for DYB_EVT_CUSTOM, -1 for any.
+     * \return int32_t Type of the event; 0 on timeout.
+     *
+     */
+    int32_t waitSince(const uint64_t seq, const int32_t mask, const int32_t timeout,
+                      QueuedEvent *event = NULL, const DYB_Address customId = -1);
+
+    /** \brief Record an event.
+     *
+     * \param type const int32_t Bitfield of DYB_EVT_..
+     * \param address const DYB_Address Parameter address or data channel.
+     * \param index const int32_t Subaddress.
+     * \param value const int32_t Value.
+     * \return uint64_t Sequence number of the event.
+     *
+     */
+    uint64_t post(const int32_t type, const DYB_Address address = -1,
+                  const int32_t index = 0, const int32_t value = 0);
+
+    /** \brief Start a thread that fetches full buffers of data channels.
+     *
+     * Every buffer fetched is recorded as a DYB_EVT_DATA_xx event and kept
+     * for takeFrame(). A buffer that is not taken before the next one is
+     * full is returned to the pool, i.e. the frame number jumps.
+     *
+     * \param pool FramePool& Pool providing the buffers; must outlive the pump.
+     * \param dataMask const int32_t Bitfield of DYB_EVT_DATA_xx.
+     * \return DYB_Rc DYB_WrongContext if the pump is already running.
+     *
+     */
+    DYB_Rc pumpData(FramePool &pool, const int32_t dataMask);
+
+    /** \brief Take the latest full buffer fetched by the pump.
+     *
+     * \param channel const int32_t Data channel.
+     * \return FrameBuffer* The buffer, to be released to the pool; NULL if none is waiting.
+     *
+     */
+    FrameBuffer *takeFrame(const int32_t channel);
+
+    /** \brief Stop the pump thread; buffers not taken are returned to the pool. */
+    void stopPump();
+
+private:
+    int32_t matches(const QueuedEvent &event, const int32_t mask, const DYB_Address customId) const;
+    bool find(const uint64_t seq, const int32_t mask, const DYB_Address customId, QueuedEvent &event) const;
+    void pumpLoop(const int32_t dataMask);
+
+    mutable std::mutex _lock;
+    std::condition_variable _arrived;
+    std::vector<QueuedEvent> _ring;                          /* Latest events, _seq % size */
+    QueuedEvent _last[32];                                   /* Latest event per type bit  */
+    std::unordered_map<DYB_Address, QueuedEvent> _lastCustom; /* Latest event per address  */
+    uint64_t _seq;
+    int32_t _token;
+    std::thread _pump;
+    std::atomic<bool> _pumping;
+    FramePool *_pool;
+    FrameBuffer *_full[ASC500_DATA_CHANNELS];                /* Fetched, not yet taken     */
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,87 @@
+#include <thread>
+
+#include "asc500_events.h"
+
+
+namespace asc500
+{
+
+std::mutex EventHub::s_lock;
+std::shared_ptr<const EventHub::Subscribers> EventHub::s_subscribers = std::make_shared<const EventHub::Subscribers>();
+std::atomic<int32_t> EventHub::s_busy(0);
+std::atomic<uint64_t> EventHub::s_events(0);
+int32_t EventHub::s_nextToken = 1;
+bool EventHub::s_installed = false;
+
+/* Set while the current thread runs handlers */
+static thread_local bool t_dispatching = false;
+
+
+void EventHub::dispatch(DYB_Address address, Int32 index, Int32 value)
+{
+    s_busy.fetch_add(1, std::memory_order_seq_cst);
+    t_dispatching = true;
+
+    const std::shared_ptr<const Subscribers> subscribers = std::atomic_load(&s_subscribers);
+    for(const Subscriber &subscriber : *subscribers)
+    {
+        if(subscriber.address == -1 || subscriber.address == address)
+            subscriber.handler(address, index, value);
+    }
+
+    s_events.fetch_add(1, std::memory_order_relaxed);
+    t_dispatching = false;
+    s_busy.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+
+DYB_Rc EventHub::install()
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_installed = true;
+    return DYB_setEventCallback(-1, &EventHub::dispatch);
+}
+
+
+int32_t EventHub::subscribe(EventHandler handler, const DYB_Address address)
+{
+    bool install = false;
+    int32_t token = 0;
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        Subscriber subscriber;
+        subscriber.token = token = s_nextToken++;
+        subscriber.address = address;
+        subscriber.handler = handler;
+
+        /* Copy on write: dispatch works on a snapshot without locking */
+        std::shared_ptr<Subscribers> next = std::make_shared<Subscribers>(*s_subscribers);
+        next->push_back(subscriber);
+        std::atomic_store(&s_subscribers, std::shared_ptr<const Subscribers>(next));
+        install = !s_installed;
+    }
+    if(install)
+        EventHub::install();
+    return token;
+}
+
+
+void EventHub::unsubscribe(const int32_t token)
+{
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        std::shared_ptr<Subscribers> next = std::make_shared<Subscribers>();
+        for(const Subscriber &subscriber : *s_subscribers)
+        {
+            if(subscriber.token != token)
+                next->push_back(subscriber);
+        }
+        std::atomic_store(&s_subscribers, std::shared_ptr<const Subscribers>(next));
+    }
+
+    /* A dispatch that took the old snapshot may still be running */
+    while(!t_dispatching && s_busy.load(std::memory_order_seq_cst) != 0)
+        std::this_thread::yield();
+}
+
+} /* namespace asc500 */
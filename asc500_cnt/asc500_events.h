@@ -0,0 +1,97 @@
+/** \file asc500_events.h
+ * \brief Distribution of parameter events to several consumers.
+ *
+ * daisybase accepts one event callback per address, a plain function without
+ * context; the catchall callback (address -1) only receives the events of
+ * addresses without a callback of their own. EventHub registers the catchall
+ * once and forwards every event to all subscribed handlers, so shadow caches,
+ * waiters and state machines can observe the same event stream.
+ *
+ * For this to work, event callbacks must not be registered for individual
+ * addresses with DYB_setEventCallback; subscribe here instead.
+ *
+ * Handlers run in the context of the event loop thread and must be fast;
+ * they must not call the *Sync functions of daisybase.
+ */
+
+#ifndef __ASC500_EVENTS_H
+#define __ASC500_EVENTS_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "daisybase.h"
+
+
+namespace asc500
+{
+
+class EventHub
+{
+public:
+    typedef std::function<void(const DYB_Address address, const int32_t index, const int32_t value)> EventHandler;
+
+    /** \brief Subscribe to events; registers the catchall callback if necessary.
+     *
+     * \param handler EventHandler Called for every matching event.
+     * \param address const DYB_Address Parameter observed, -1 for all.
+     * \return int32_t Token for unsubscribe().
+     *
+     */
+    static int32_t subscribe(EventHandler handler, const DYB_Address address = -1);
+
+    /** \brief Remove a subscription.
+     *
+     * When called outside of a handler, the handler is guaranteed not to
+     * run anymore after return.
+     *
+     * \param token const int32_t Token from subscribe().
+     * \return void
+     *
+     */
+    static void unsubscribe(const int32_t token);
+
+    /** \brief Register the catchall callback; done implicitly by subscribe().
+     *
+     * Must be repeated if another catchall callback has been registered
+     * meanwhile.
+     *
+     * \return DYB_Rc Result of DYB_setEventCallback.
+     *
+     */
+    static DYB_Rc install();
+
+    /** \brief Number of events dispatched since start.
+     *
+     * \return uint64_t Events.
+     *
+     */
+    static uint64_t events() { return s_events.load(std::memory_order_relaxed); }
+
+private:
+    struct Subscriber
+    {
+        int32_t token;
+        DYB_Address address;
+        EventHandler handler;
+    };
+
+    typedef std::vector<Subscriber> Subscribers;
+
+    static void dispatch(DYB_Address address, Int32 index, Int32 value);
+
+    static std::mutex s_lock;
+    static std::shared_ptr<const Subscribers> s_subscribers;
+    static std::atomic<int32_t> s_busy;
+    static std::atomic<uint64_t> s_events;
+    static int32_t s_nextToken;
+    static bool s_installed;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,195 @@
+#include <cstring>
+
+#include "daisydata.h"
+#include "asc500_exporter.h"
+
+
+namespace asc500
+{
+
+Exporter::Exporter(const size_t depth, const Policy policy)
+    : _depth(depth > 0 ? depth : 1), _policy(policy), _stopping(false), _writing(false),
+      _sumWriteUs(0.0), _sumLatencyUs(0.0), _lastError(DYB_Ok)
+{
+    memset(&_metrics, 0, sizeof(_metrics));
+    _thread = std::thread(&Exporter::run, this);
+}
+
+
+Exporter::~Exporter()
+{
+    stop();
+}
+
+
+void Exporter::spill(Job &job)
+{
+    job.copy.assign(job.buffer->data, job.buffer->data + job.dataSize);
+    job.pool->release(job.buffer);
+    job.pool = NULL;
+    job.buffer = NULL;
+}
+
+
+DYB_Rc Exporter::submit(FramePool &pool, FrameBuffer *buffer, const std::string &fileName,
+                        const std::string &comment, const bool binary, const bool forward)
+{
+    if(!buffer || buffer->dataSize <= 0)
+    {
+        pool.release(buffer);
+        return DYB_OutOfRange;
+    }
+
+    Job job;
+    job.pool = &pool;
+    job.buffer = buffer;
+    job.index = buffer->index;
+    job.dataSize = buffer->dataSize;
+    job.meta = buffer->meta;
+    job.fileName = fileName;
+    job.comment = comment;
+    job.binary = binary;
+    job.forward = forward;
+
+    std::unique_lock<std::mutex> lock(_lock);
+    if(_stopping)
+    {
+        lock.unlock();
+        pool.release(buffer);
+        return DYB_WrongContext;
+    }
+
+    if(_queue.size() >= _depth)
+    {
+        switch(_policy)
+        {
+        case Block:
+        {
+            const Clock::time_point start = Clock::now();
+            _notFull.wait(lock, [this] { return _queue.size() < _depth || _stopping; });
+            _metrics.blockedUs += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+            if(_stopping)
+            {
+                lock.unlock();
+                pool.release(buffer);
+                return DYB_WrongContext;
+            }
+            break;
+        }
+        case DropOldest:
+        {
+            Job &oldest = _queue.front();
+            if(oldest.pool)
+                oldest.pool->release(oldest.buffer);
+            _queue.pop_front();
+            _metrics.dropped++;
+            break;
+        }
+        case Spill:
+            /* Only the new buffer is copied, queued ones are already owned */
+            spill(job);
+            _metrics.spilled++;
+            break;
+        }
+    }
+
+    job.submitted = Clock::now();
+    _queue.push_back(std::move(job));
+    _metrics.submitted++;
+    if(_queue.size() > _metrics.maxDepth)
+        _metrics.maxDepth = _queue.size();
+    lock.unlock();
+    _notEmpty.notify_one();
+    return DYB_Ok;
+}
+
+
+void Exporter::run()
+{
+    std::unique_lock<std::mutex> lock(_lock);
+
+    while(true)
+    {
+        _notEmpty.wait(lock, [this] { return !_queue.empty() || _stopping; });
+        if(_queue.empty())
+            break;
+
+        Job job = std::move(_queue.front());
+        _queue.pop_front();
+        _writing = true;
+        lock.unlock();
+        _notFull.notify_one();
+
+        const int32_t *data = job.buffer ? job.buffer->data : job.copy.data();
+        const Clock::time_point start = Clock::now();
+        const DYB_Rc rc = DYB_writeBuffer(job.fileName.c_str(), job.comment.c_str(),
+                                          job.binary, job.forward, job.index, job.dataSize,
+                                          data, &job.meta);
+        const Clock::time_point end = Clock::now();
+        if(job.pool)
+            job.pool->release(job.buffer);
+
+        const double writeUs = std::chrono::duration<double, std::micro>(end - start).count(),
+                     latencyUs = std::chrono::duration<double, std::micro>(end - job.submitted).count();
+
+        lock.lock();
+        _writing = false;
+        if(rc == DYB_Ok)
+        {
+            _metrics.written++;
+        }
+        else
+        {
+            _metrics.failed++;
+            _lastError = rc;
+        }
+        _metrics.lastWriteUs = writeUs;
+        if(writeUs > _metrics.maxWriteUs)
+            _metrics.maxWriteUs = writeUs;
+        _sumWriteUs += writeUs;
+        _sumLatencyUs += latencyUs;
+        _notFull.notify_all();
+    }
+}
+
+
+void Exporter::flush()
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    _notFull.wait(lock, [this] { return _queue.empty() && !_writing; });
+}
+
+
+void Exporter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _stopping = true;
+    }
+    _notEmpty.notify_all();
+    _notFull.notify_all();
+    if(_thread.joinable())
+        _thread.join();
+}
+
+
+ExportMetrics Exporter::metrics() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    ExportMetrics metrics = _metrics;
+    const uint64_t done = _metrics.written + _metrics.failed;
+
+    metrics.depth = _queue.size();
+    metrics.avgWriteUs = done ? _sumWriteUs / done : 0.0;
+    metrics.avgLatencyUs = done ? _sumLatencyUs / done : 0.0;
+    return metrics;
+}
+
+
+DYB_Rc Exporter::lastError() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _lastError;
+}
+
+} /* namespace asc500 */
@@ -0,0 +1,167 @@
+/** \file asc500_exporter.h
+ * \brief Asynchronous export of frame buffers to files.
+ *
+ * DYB_writeBuffer blocks the calling thread until the file is on disk; on
+ * the acquisition thread every disk stall delays the next DYB_getDataBuffer,
+ * and a frame that is not retrieved in time is lost (the frame number jumps).
+ * The Exporter takes over a filled FrameBuffer together with its meta data,
+ * queues it and writes the bcrf / asc / csv file on its own thread. The
+ * buffer goes back to its FramePool once written.
+ *
+ * The queue is bounded (two entries, i.e. double buffering, by default).
+ * When it is full, the policy decides:
+ *  - Block:      submit() waits until the writer has made room,
+ *  - DropOldest: the oldest queued buffer is discarded,
+ *  - Spill:      the data are copied to the heap and the pool buffer is
+ *                returned at once; the queue grows without bound.
+ */
+
+#ifndef __ASC500_EXPORTER_H
+#define __ASC500_EXPORTER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500_framepool.h"
+
+
+namespace asc500
+{
+
+/** \brief Counters of an Exporter.
+ */
+struct ExportMetrics
+{
+    size_t depth;              /**< Buffers currently queued                   */
+    size_t maxDepth;           /**< Largest queue depth seen                   */
+    uint64_t submitted;        /**< Buffers accepted by submit()               */
+    uint64_t written;          /**< Files written successfully                 */
+    uint64_t failed;           /**< Files DYB_writeBuffer failed on            */
+    uint64_t dropped;          /**< Buffers discarded (DropOldest)             */
+    uint64_t spilled;          /**< Buffers copied to the heap (Spill)         */
+    uint64_t blockedUs;        /**< Time submit() waited for room (Block) [us] */
+    double lastWriteUs;        /**< Duration of the last write [us]            */
+    double maxWriteUs;         /**< Longest write [us]                         */
+    double avgWriteUs;         /**< Average write duration [us]                */
+    double avgLatencyUs;       /**< Average time from submit to written [us]   */
+};
+
+
+class Exporter
+{
+public:
+    enum Policy
+    {
+        Block,                 /**< Wait for room                              */
+        DropOldest,            /**< Discard the oldest queued buffer           */
+        Spill                  /**< Copy to the heap, never wait or drop       */
+    };
+
+    /** \brief Create an exporter and start its writer thread.
+     *
+     * \param depth const size_t Queue capacity in buffers.
+     * \param policy const Policy Behaviour if the queue is full.
+     *
+     */
+    explicit Exporter(const size_t depth = 2, const Policy policy = Block);
+
+    /** \brief Write all queued buffers, then stop the thread. */
+    ~Exporter();
+
+    Exporter(const Exporter &) = delete;
+    Exporter &operator=(const Exporter &) = delete;
+
+    /** \brief Hand a filled buffer over for writing.
+     *
+     * Ownership of the buffer passes to the exporter in any case; it is
+     * released to pool after writing or dropping. Parameters are those of
+     * DYB_writeBuffer.
+     *
+     * \param pool FramePool& Pool the buffer belongs to.
+     * \param buffer FrameBuffer* Buffer filled by FramePool::fill().
+     * \param fileName const std::string& File name without extension.
+     * \param comment const std::string& Description for the file header.
+     * \param binary const bool If the desired format is binary.
+     * \param forward const bool If the forward scan is to be written.
+     * \return DYB_Rc DYB_OutOfRange if buffer is NULL or empty,
+     *         DYB_WrongContext if the exporter is stopped.
+     *
+     */
+    DYB_Rc submit(FramePool &pool, FrameBuffer *buffer, const std::string &fileName,
+                  const std::string &comment, const bool binary, const bool forward);
+
+    /** \brief Wait until every submitted buffer has been written.
+     *
+     * \return void
+     *
+     */
+    void flush();
+
+    /** \brief Write the queued buffers and stop the writer thread.
+     *
+     * \return void
+     *
+     */
+    void stop();
+
+    /** \brief Snapshot of the counters.
+     *
+     * \return ExportMetrics Current values.
+     *
+     */
+    ExportMetrics metrics() const;
+
+    /** \brief Result of the last failed write.
+     *
+     * \return DYB_Rc DYB_Ok if no write has failed.
+     *
+     */
+    DYB_Rc lastError() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Job
+    {
+        FramePool *pool;             /* Owner of buffer, NULL if spilled      */
+        FrameBuffer *buffer;
+        std::vector<int32_t> copy;   /* Data of a spilled buffer              */
+        int32_t index;
+        int32_t dataSize;
+        DYB_Meta meta;
+        std::string fileName;
+        std::string comment;
+        bool binary;
+        bool forward;
+        Clock::time_point submitted;
+    };
+
+    void run();
+    static void spill(Job &job);
+
+    size_t _depth;
+    Policy _policy;
+    bool _stopping;
+    bool _writing;
+    std::deque<Job> _queue;
+    ExportMetrics _metrics;
+    double _sumWriteUs;
+    double _sumLatencyUs;
+    DYB_Rc _lastError;
+
+    mutable std::mutex _lock;
+    std::condition_variable _notEmpty;
+    std::condition_variable _notFull;
+    std::thread _thread;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,413 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "asc500_filereader.h"
+
+
+namespace asc500
+{
+
+/* ---------------------------------------------------------------------------
+ *  MappedFile
+ * ------------------------------------------------------------------------- */
+
+MappedFile::MappedFile()
+    : _data(NULL), _size(0), _file(NULL), _mapping(NULL)
+{
+}
+
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+DYB_Rc MappedFile::open(const std::string &fileName)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+    if(file == INVALID_HANDLE_VALUE)
+        return DYB_OpenError;
+    if(!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return DYB_OpenError;
+    }
+    _file = file;
+    _size = size.QuadPart;
+    if(_size > 0)
+    {
+        _mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        const void *view = _mapping ? MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if(!view)
+        {
+            close();
+            return DYB_OpenError;
+        }
+        _data = static_cast<const char *>(view);
+    }
+#else
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd < 0)
+        return DYB_OpenError;
+    if(fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return DYB_OpenError;
+    }
+    _size = st.st_size;
+    if(_size > 0)
+    {
+        void *view = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(view == MAP_FAILED)
+        {
+            ::close(fd);
+            _size = 0;
+            return DYB_OpenError;
+        }
+        _data = static_cast<const char *>(view);
+    }
+    /* The mapping stays valid without the descriptor */
+    ::close(fd);
+#endif
+    return DYB_Ok;
+}
+
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if(_data)
+        UnmapViewOfFile(_data);
+    if(_mapping)
+        CloseHandle(_mapping);
+    if(_file)
+        CloseHandle(_file);
+#else
+    if(_data)
+        munmap(const_cast<char *>(_data), _size);
+#endif
+    _data = NULL;
+    _size = 0;
+    _file = NULL;
+    _mapping = NULL;
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  BcrfFile
+ * ------------------------------------------------------------------------- */
+
+static std::string trim(const char *begin, const char *end)
+{
+    while(begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r'))
+        begin++;
+    while(end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        end--;
+    return std::string(begin, end);
+}
+
+
+BcrfFile::BcrfFile()
+    : _dataStart(0), _columns(0), _lines(0), _planes(0), _float(true)
+{
+}
+
+
+DYB_Rc BcrfFile::open(const std::string &fileName)
+{
+    close();
+    const DYB_Rc rc = _map.open(fileName);
+    if(rc != DYB_Ok)
+        return rc;
+
+    /* "key = value" lines; the header is padded to its size */
+    const char *p = _map.data(),
+               *end = p + (_map.size() < 2048 ? _map.size() : 2048);
+    while(p < end && *p != '\0')
+    {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        if(!eol)
+            eol = end;
+        const char *eq = static_cast<const char *>(memchr(p, '=', eol - p));
+        if(eq && *p != '%')
+            _header[trim(p, eq)] = trim(eq + 1, eol);
+        p = eol + 1;
+    }
+
+    const std::string format = value("fileformat");
+    _float = format == "bcrf";
+    _columns = static_cast<int32_t>(number("xpixels"));
+    _lines = static_cast<int32_t>(number("ypixels"));
+    _dataStart = static_cast<uint64_t>(number("headersize", 2048));
+    if((format != "bcrf" && format != "bcrstm") || _columns <= 0 || _lines <= 0 ||
+       _dataStart > _map.size())
+    {
+        close();
+        return DYB_Error;
+    }
+
+    const uint64_t planeBytes = static_cast<uint64_t>(_columns) * _lines * (_float ? sizeof(Flt32) : sizeof(int16_t));
+    _planes = static_cast<int32_t>((_map.size() - _dataStart) / planeBytes);
+    return DYB_Ok;
+}
+
+
+void BcrfFile::close()
+{
+    _map.close();
+    _header.clear();
+    _columns = _lines = _planes = 0;
+}
+
+
+std::string BcrfFile::value(const std::string &key, const std::string &fallback) const
+{
+    auto found = _header.find(key);
+    return found != _header.end() ? found->second : fallback;
+}
+
+
+double BcrfFile::number(const std::string &key, const double fallback) const
+{
+    auto found = _header.find(key);
+    return found != _header.end() ? atof(found->second.c_str()) : fallback;
+}
+
+
+PlaneView<Flt32> BcrfFile::floatPlane(const int32_t plane) const
+{
+    PlaneView<Flt32> view = { NULL, _columns, _lines };
+    if(_float && plane >= 0 && plane < _planes)
+        view.data = reinterpret_cast<const Flt32 *>(_map.data() + _dataStart) +
+                    static_cast<size_t>(plane) * _columns * _lines;
+    return view;
+}
+
+
+PlaneView<int16_t> BcrfFile::shortPlane(const int32_t plane) const
+{
+    PlaneView<int16_t> view = { NULL, _columns, _lines };
+    if(!_float && plane >= 0 && plane < _planes)
+        view.data = reinterpret_cast<const int16_t *>(_map.data() + _dataStart) +
+                    static_cast<size_t>(plane) * _columns * _lines;
+    return view;
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  TextFile
+ * ------------------------------------------------------------------------- */
+
+static const char IndexMagic[4] = { 'A', '5', 'I', 'X' };
+
+/* Sidecar layout: header, then count offsets */
+struct IndexHeader
+{
+    char magic[4];
+    int32_t fields;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t count;
+};
+
+
+static bool isSeparator(const char c)
+{
+    return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r';
+}
+
+
+/* Split a line into fields, calling visit(begin, end) for each */
+template <typename Visit>
+static int32_t splitFields(const char *p, const char *end, Visit visit)
+{
+    int32_t fields = 0;
+    while(p < end)
+    {
+        while(p < end && isSeparator(*p))
+            p++;
+        const char *start = p;
+        while(p < end && !isSeparator(*p))
+            p++;
+        if(p > start)
+        {
+            visit(start, p);
+            fields++;
+        }
+    }
+    return fields;
+}
+
+
+TextFile::TextFile()
+    : _fields(0), _loaded(false)
+{
+}
+
+
+DYB_Rc TextFile::open(const std::string &fileName, const bool useSidecar)
+{
+    close();
+    const DYB_Rc rc = _map.open(fileName);
+    if(rc != DYB_Ok)
+        return rc;
+
+    struct stat st;
+    const int64_t mtime = stat(fileName.c_str(), &st) == 0 ? static_cast<int64_t>(st.st_mtime) : 0;
+
+    if(useSidecar && loadSidecar(fileName, mtime))
+    {
+        _loaded = true;
+        return DYB_Ok;
+    }
+
+    build();
+    if(useSidecar)
+        saveSidecar(fileName, mtime);
+    return DYB_Ok;
+}
+
+
+void TextFile::close()
+{
+    _map.close();
+    _offsets.clear();
+    _fields = 0;
+    _loaded = false;
+}
+
+
+void TextFile::build()
+{
+    const char *begin = _map.data(),
+               *end = begin + _map.size(),
+               *p = begin;
+
+    while(p < end)
+    {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+        if(!eol)
+            eol = end;
+
+        const char *q = p;
+        while(q < eol && isSeparator(*q))
+            q++;
+        if(q < eol && *q != '#')
+        {
+            if(_offsets.empty())
+                _fields = splitFields(p, eol, [](const char *, const char *) {});
+            _offsets.push_back(p - begin);
+        }
+        p = eol + 1;
+    }
+}
+
+
+bool TextFile::loadSidecar(const std::string &fileName, const int64_t mtime)
+{
+    FILE *file = fopen((fileName + ".idx").c_str(), "rb");
+    IndexHeader header;
+    bool ok = false;
+
+    if(!file)
+        return false;
+    if(fread(&header, sizeof(header), 1, file) == 1 &&
+       memcmp(header.magic, IndexMagic, sizeof(IndexMagic)) == 0 &&
+       header.sourceSize == _map.size() && header.sourceTime == mtime &&
+       header.count <= _map.size())
+    {
+        _offsets.resize(header.count);
+        ok = fread(_offsets.data(), sizeof(uint64_t), header.count, file) == header.count;
+        for(size_t k = 0; ok && k < _offsets.size(); k++)
+            ok = _offsets[k] < _map.size();
+        _fields = header.fields;
+    }
+    fclose(file);
+    if(!ok)
+        _offsets.clear();
+    return ok;
+}
+
+
+void TextFile::saveSidecar(const std::string &fileName, const int64_t mtime) const
+{
+    /* The index is a cache; failing to write it is not an error */
+    FILE *file = fopen((fileName + ".idx").c_str(), "wb");
+    if(!file)
+        return;
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IndexMagic, sizeof(IndexMagic));
+    header.fields = _fields;
+    header.sourceSize = _map.size();
+    header.sourceTime = mtime;
+    header.count = _offsets.size();
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(_offsets.data(), sizeof(uint64_t), _offsets.size(), file);
+    fclose(file);
+}
+
+
+const char *TextFile::dataLine(const int64_t line, size_t *length) const
+{
+    if(line < 0 || line >= dataLines())
+        return NULL;
+
+    const char *begin = _map.data() + _offsets[line],
+               *end = _map.data() + _map.size(),
+               *eol = static_cast<const char *>(memchr(begin, '\n', end - begin));
+    if(!eol)
+        eol = end;
+    if(eol > begin && eol[-1] == '\r')
+        eol--;
+    *length = eol - begin;
+    return begin;
+}
+
+
+DYB_Rc TextFile::readValues(const int64_t first, const int64_t last, std::vector<double> &values) const
+{
+    values.clear();
+    if(_fields <= 0 || first < 0 || last < first || last > dataLines() * _fields)
+        return DYB_OutOfRange;
+
+    std::string field;
+    for(int64_t line = first / _fields; line * _fields < last; line++)
+    {
+        size_t length = 0;
+        const char *text = dataLine(line, &length);
+        int64_t v = line * _fields;
+
+        splitFields(text, text + length, [&](const char *begin, const char *end)
+        {
+            if(v >= first && v < last)
+            {
+                /* The mapping is not null terminated */
+                field.assign(begin, end);
+                values.push_back(strtod(field.c_str(), NULL));
+            }
+            v++;
+        });
+    }
+    return values.size() == static_cast<size_t>(last - first) ? DYB_Ok : DYB_Error;
+}
+
+} /* namespace asc500 */
@@ -0,0 +1,201 @@
+/** \file asc500_filereader.h
+ * \brief Random access to the files written by DYB_writeBuffer.
+ *
+ * MappedFile maps a file read only into memory.
+ *
+ * BcrfFile parses the ASCII header of a bcrf file once and exposes the
+ * image planes as typed views directly on the mapping, without copying.
+ * The data type follows the fileformat key: Flt32 for "bcrf", int16_t for
+ * "bcrstm". A file may hold several planes of _pointsX * _pointsY values one
+ * after the other (e.g. forward and backward).
+ *
+ * TextFile indexes the data lines of an asc or csv file: lines starting with
+ * '#' and empty lines are skipped, the others are numbered. The line offsets
+ * are stored in a sidecar file (<name>.idx) that is reused as long as size
+ * and modification time of the file are unchanged, so data line N or value
+ * range [a, b) is reached without parsing the lines before.
+ */
+
+#ifndef __ASC500_FILEREADER_H
+#define __ASC500_FILEREADER_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "daisybase.h"
+
+
+namespace asc500
+{
+
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /** \brief Map a file read only.
+     *
+     * \param fileName const std::string& File name.
+     * \return DYB_Rc DYB_OpenError if it can't be opened or mapped.
+     *
+     */
+    DYB_Rc open(const std::string &fileName);
+
+    /** \brief Unmap the file. */
+    void close();
+
+    const char *data() const { return _data; }   /**< Start of the mapping, NULL if closed */
+    uint64_t size() const { return _size; }      /**< Size of the file [bytes]            */
+
+private:
+    const char *_data;
+    uint64_t _size;
+    void *_file;               /* File handle (Windows)                       */
+    void *_mapping;            /* Mapping handle (Windows)                    */
+};
+
+
+/** \brief Zero copy view of an image plane.
+ */
+template <typename T>
+struct PlaneView
+{
+    const T *data;             /**< lines * columns values, row 0 first        */
+    int32_t columns;           /**< Values per row                             */
+    int32_t lines;             /**< Number of rows                             */
+
+    const T *row(const int32_t line) const { return data + static_cast<size_t>(line) * columns; }
+    T at(const int32_t column, const int32_t line) const { return row(line)[column]; }
+};
+
+
+class BcrfFile
+{
+public:
+    BcrfFile();
+
+    /** \brief Map a bcrf file and parse its header.
+     *
+     * \param fileName const std::string& File name.
+     * \return DYB_Rc DYB_OpenError if not readable, DYB_Error if the
+     *         header is not recognized.
+     *
+     */
+    DYB_Rc open(const std::string &fileName);
+
+    /** \brief Unmap the file. */
+    void close();
+
+    /** \brief A header value.
+     *
+     * \param key const std::string& Key, e.g. "xlength".
+     * \param fallback const std::string& Returned if the key is missing.
+     * \return std::string Value.
+     *
+     */
+    std::string value(const std::string &key, const std::string &fallback = "") const;
+
+    /** \brief A numeric header value.
+     *
+     * \param key const std::string& Key.
+     * \param fallback const double Returned if the key is missing.
+     * \return double Value.
+     *
+     */
+    double number(const std::string &key, const double fallback = 0.0) const;
+
+    int32_t columns() const { return _columns; }    /**< xpixels                    */
+    int32_t lines() const { return _lines; }        /**< ypixels                    */
+    int32_t planes() const { return _planes; }      /**< Complete planes in the file */
+    bool isFloat() const { return _float; }         /**< Flt32 (bcrf) or int16_t    */
+
+    /** \brief Plane of a bcrf file.
+     *
+     * \param plane const int32_t Plane number (0 = first).
+     * \return PlaneView<Flt32> View; data is NULL if not available.
+     *
+     */
+    PlaneView<Flt32> floatPlane(const int32_t plane = 0) const;
+
+    /** \brief Plane of a bcrstm file.
+     *
+     * \param plane const int32_t Plane number (0 = first).
+     * \return PlaneView<int16_t> View; data is NULL if not available.
+     *
+     */
+    PlaneView<int16_t> shortPlane(const int32_t plane = 0) const;
+
+private:
+    MappedFile _map;
+    std::map<std::string, std::string> _header;
+    uint64_t _dataStart;
+    int32_t _columns;
+    int32_t _lines;
+    int32_t _planes;
+    bool _float;
+};
+
+
+class TextFile
+{
+public:
+    TextFile();
+
+    /** \brief Map an asc or csv file and load or build its line index.
+     *
+     * \param fileName const std::string& File name.
+     * \param useSidecar const bool Read / write the index file <fileName>.idx.
+     * \return DYB_Rc DYB_OpenError if the file is not readable.
+     *
+     */
+    DYB_Rc open(const std::string &fileName, const bool useSidecar = true);
+
+    /** \brief Unmap the file. */
+    void close();
+
+    int64_t dataLines() const { return static_cast<int64_t>(_offsets.size()); } /**< Number of data lines */
+    int32_t fieldsPerLine() const { return _fields; }  /**< Values in the first data line */
+    bool indexLoaded() const { return _loaded; }       /**< Index came from the sidecar   */
+
+    /** \brief Text of a data line, without line end.
+     *
+     * \param line const int64_t Data line number.
+     * \param length size_t* Output: length of the text.
+     * \return const char* Text in the mapping, NULL if out of range.
+     *
+     */
+    const char *dataLine(const int64_t line, size_t *length) const;
+
+    /** \brief Parse the values [first, last) in row major order.
+     *
+     * Value v is field v % fieldsPerLine() of data line v / fieldsPerLine().
+     * Fields are separated by blanks, tabs, ',' or ';'.
+     *
+     * \param first const int64_t First value.
+     * \param last const int64_t Value after the last one.
+     * \param values std::vector<double>& Output: the values.
+     * \return DYB_Rc DYB_OutOfRange if the range exceeds the file.
+     *
+     */
+    DYB_Rc readValues(const int64_t first, const int64_t last, std::vector<double> &values) const;
+
+private:
+    void build();
+    bool loadSidecar(const std::string &fileName, const int64_t mtime);
+    void saveSidecar(const std::string &fileName, const int64_t mtime) const;
+
+    MappedFile _map;
+    std::vector<uint64_t> _offsets;   /* Start of every data line              */
+    int32_t _fields;
+    bool _loaded;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,137 @@
+#include <cstring>
+
+#include "daisydata.h"
+#include "asc500_framepool.h"
+
+
+namespace asc500
+{
+
+static const size_t CacheLine = 64;
+
+
+FramePool::FramePool(const size_t maxFreePerChannel)
+    : _maxFree(maxFreePerChannel), _allocations(0)
+{
+}
+
+
+FramePool::~FramePool()
+{
+    for(Channel &ch : _channels)
+        for(Slot *slot : ch.free)
+            delete slot;
+}
+
+
+/** \brief The slot that owns a buffer handed out by the pool.
+ *
+ * \param buffer FrameBuffer* Buffer from acquire().
+ * \return FramePool::Slot* Owning slot.
+ *
+ */
+FramePool::Slot *FramePool::slotOf(FrameBuffer *buffer)
+{
+    return reinterpret_cast<Slot *>(buffer);
+}
+
+
+FramePool::Slot *FramePool::allocate(const int32_t channel, const int32_t frameSize)
+{
+    Slot *slot = new Slot;
+    const size_t bytes = static_cast<size_t>(frameSize) * sizeof(int32_t);
+
+    slot->storage = new char[bytes + CacheLine];
+    uintptr_t address = reinterpret_cast<uintptr_t>(slot->storage);
+    address = (address + CacheLine - 1) & ~static_cast<uintptr_t>(CacheLine - 1);
+
+    /* Touch the pages now instead of in the acquisition loop */
+    memset(reinterpret_cast<void *>(address), 0, bytes);
+
+    memset(&slot->buffer, 0, sizeof(slot->buffer));
+    slot->buffer.channel = channel;
+    slot->buffer.capacity = frameSize;
+    slot->buffer.data = reinterpret_cast<int32_t *>(address);
+    _allocations++;
+    return slot;
+}
+
+
+FrameBuffer *FramePool::acquire(const int32_t channel, const int32_t frameSize)
+{
+    if(channel < 0 || channel >= ASC500_DATA_CHANNELS)
+        return NULL;
+
+    const int32_t size = frameSize > 0 ? frameSize : DYB_getFrameSize(channel);
+    if(size <= 0)
+        return NULL;
+
+    std::lock_guard<std::mutex> guard(_lock);
+    Channel &ch = _channels[channel];
+
+    if(ch.frameSize != size)
+    {
+        for(Slot *slot : ch.free)
+            delete slot;
+        ch.free.clear();
+        ch.frameSize = size;
+    }
+
+    Slot *slot;
+    if(ch.free.empty())
+    {
+        slot = allocate(channel, size);
+    }
+    else
+    {
+        slot = ch.free.back();
+        ch.free.pop_back();
+    }
+
+    slot->buffer.frameNo = 0;
+    slot->buffer.index = 0;
+    slot->buffer.dataSize = size;
+    return &slot->buffer;
+}
+
+
+void FramePool::release(FrameBuffer *buffer)
+{
+    if(!buffer)
+        return;
+
+    Slot *slot = slotOf(buffer);
+    std::lock_guard<std::mutex> guard(_lock);
+    Channel &ch = _channels[buffer->channel];
+
+    /* Buffers of an outdated frame size are not recycled */
+    if(buffer->capacity != ch.frameSize || ch.free.size() >= _maxFree)
+        delete slot;
+    else
+        ch.free.push_back(slot);
+}
+
+
+DYB_Rc FramePool::fill(FrameBuffer *buffer, const Bln32 fullOnly)
+{
+    if(!buffer)
+        return DYB_OutOfRange;
+
+    buffer->dataSize = buffer->capacity;
+    return DYB_getDataBuffer(buffer->channel,
+                             fullOnly,
+                             &buffer->frameNo,
+                             &buffer->index,
+                             &buffer->dataSize,
+                             buffer->data,
+                             &buffer->meta);
+}
+
+
+uint64_t FramePool::allocations() const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _allocations;
+}
+
+} /* namespace asc500 */
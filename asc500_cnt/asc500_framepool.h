@@ -0,0 +1,148 @@
+/** \file asc500_framepool.h
+ * \brief Pool of reusable frame buffers for DYB_getDataBuffer polling.
+ *
+ * Polling loops need one buffer of at least DYB_getFrameSize items per call.
+ * The pool keeps the buffers of every channel and hands them out again after
+ * they have been released, so a polling loop doesn't allocate on the heap
+ * (and doesn't fault in fresh pages) as long as the frame size is unchanged.
+ * Buffers are aligned to a cache line and pre-touched on allocation.
+ */
+
+#ifndef __ASC500_FRAMEPOOL_H
+#define __ASC500_FRAMEPOOL_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500.h"
+
+
+namespace asc500
+{
+
+/** \brief A frame buffer together with the outputs of DYB_getDataBuffer.
+ */
+struct FrameBuffer
+{
+    int32_t channel;       /**< Channel the buffer belongs to                 */
+    int32_t capacity;      /**< Size of data [32 bit items]                   */
+    int32_t frameNo;       /**< Output: number of the frame                   */
+    int32_t index;         /**< Output: index of the first element            */
+    int32_t dataSize;      /**< Output: number of valid data in the buffer    */
+    int32_t *data;         /**< Cache line aligned data array                 */
+    DYB_Meta meta;         /**< Output: meta data belonging to the buffer     */
+};
+
+
+class FramePool
+{
+public:
+    /** \brief Create a pool.
+     *
+     * \param maxFreePerChannel const size_t Released buffers kept per channel.
+     *
+     */
+    explicit FramePool(const size_t maxFreePerChannel = 4);
+    ~FramePool();
+
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+    /** \brief Get a buffer for the channel.
+     *
+     * If the frame size differs from the one of the previous call, the
+     * cached buffers of the channel are discarded.
+     *
+     * \param channel const int32_t Data channel.
+     * \param frameSize const int32_t Required size; 0 queries DYB_getFrameSize.
+     * \return FrameBuffer* Buffer or NULL if the size is unknown (channel not active).
+     *
+     */
+    FrameBuffer *acquire(const int32_t channel, const int32_t frameSize = 0);
+
+    /** \brief Return a buffer to the pool.
+     *
+     * \param buffer FrameBuffer* Buffer from acquire(), may be NULL.
+     * \return void
+     *
+     */
+    void release(FrameBuffer *buffer);
+
+    /** \brief Fill a buffer by DYB_getDataBuffer.
+     *
+     * \param buffer FrameBuffer* Buffer from acquire().
+     * \param fullOnly const Bln32 If only completely filled buffers are requested.
+     * \return DYB_Rc Result of DYB_getDataBuffer.
+     *
+     */
+    static DYB_Rc fill(FrameBuffer *buffer, const Bln32 fullOnly);
+
+    /** \brief Number of buffer allocations since construction.
+     *
+     * \return uint64_t Allocations; stays constant in a steady polling loop.
+     *
+     */
+    uint64_t allocations() const;
+
+private:
+    /* Standard layout with the buffer first, so a slot can be found from its buffer */
+    struct Slot
+    {
+        FrameBuffer buffer;
+        char *storage;
+
+        Slot() : storage(NULL) {}
+        ~Slot() { delete[] storage; }
+    };
+
+    struct Channel
+    {
+        int32_t frameSize;
+        std::vector<Slot *> free;
+
+        Channel() : frameSize(0) {}
+    };
+
+    Slot *allocate(const int32_t channel, const int32_t frameSize);
+    static Slot *slotOf(FrameBuffer *buffer);
+
+    mutable std::mutex _lock;
+    size_t _maxFree;
+    uint64_t _allocations;
+    Channel _channels[ASC500_DATA_CHANNELS];
+};
+
+
+/** \brief Scoped buffer that is returned to its pool on destruction.
+ */
+class PooledFrame
+{
+public:
+    PooledFrame(FramePool &pool, const int32_t channel, const int32_t frameSize = 0)
+        : _pool(pool), _buffer(pool.acquire(channel, frameSize)) {}
+    ~PooledFrame() { _pool.release(_buffer); }
+
+    PooledFrame(const PooledFrame &) = delete;
+    PooledFrame &operator=(const PooledFrame &) = delete;
+
+    FrameBuffer *get() const { return _buffer; }
+    FrameBuffer *operator->() const { return _buffer; }
+    explicit operator bool() const { return _buffer != NULL; }
+
+    /** \brief Give up ownership, e.g. to hand the buffer to another thread.
+     *
+     * \return FrameBuffer* The buffer; the receiver must release it to the pool.
+     *
+     */
+    FrameBuffer *detach() { FrameBuffer *buffer = _buffer; _buffer = NULL; return buffer; }
+
+private:
+    FramePool &_pool;
+    FrameBuffer *_buffer;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#include "daisydata.h"
+#include "asc500_convert.h"
+#include "asc500_coords.h"
+#include "asc500_framewriter.h"
+
+
+namespace asc500
+{
+
+static const long BcrfHeaderSize = 2048;   /* Fixed size of a bcrf header     */
+static const int AscFieldWidth = 16;       /* "%15.6e" plus separator         */
+
+
+FrameWriter::FrameWriter(const std::string &fileName, const std::string &comment,
+                         const bool binary, const bool forward)
+    : _fileName(fileName), _comment(comment), _binary(binary), _forward(forward),
+      _file(NULL), _frameNo(-1), _frames(0), _complete(false), _oddFrame(false), _half(0),
+      _nextLine(0), _dataStart(0), _rowBytes(0), _bytes(0)
+{
+    memset(&_meta, 0, sizeof(_meta));
+}
+
+
+FrameWriter::~FrameWriter()
+{
+    finish();
+}
+
+
+bool FrameWriter::sameGeometry(const DYB_Meta *meta) const
+{
+    return memcmp(&_meta, meta, sizeof(_meta)) == 0;
+}
+
+
+DYB_Rc FrameWriter::update(const FrameBuffer &buffer)
+{
+    return update(buffer.frameNo, buffer.index, buffer.dataSize, buffer.data, &buffer.meta);
+}
+
+
+DYB_Rc FrameWriter::update(const int32_t frameNo, const int32_t index, const int32_t dataSize,
+                           const int32_t *data, const DYB_Meta *meta)
+{
+    if(!meta || !data || index < 0 || dataSize < 0)
+        return DYB_OutOfRange;
+    if(dataSize == 0)
+        return DYB_Ok;
+
+    const DYB_Order order = meta->_order;
+    if(order != DYB_FfScan && order != DYB_FbScan && order != DYB_BbScan && order != DYB_BfScan)
+        return writeOther(frameNo, index, dataSize, data, meta);
+
+    if(!_file || frameNo != _frameNo || !sameGeometry(meta))
+    {
+        /* Trailing buffers of a frame that is already on disk */
+        if(_complete && frameNo == _frameNo && sameGeometry(meta))
+            return DYB_Ok;
+
+        /* Count the frames, including those that were never handed in */
+        if(_frameNo < 0 || !sameGeometry(meta))
+            _frames = 0;
+        else
+            _frames += frameNo > _frameNo ? frameNo - _frameNo : 1;
+
+        DYB_Rc rc = finish();
+        if(rc != DYB_Ok)
+            return rc;
+        rc = open(frameNo, meta);
+        if(rc != DYB_Ok)
+            return rc;
+        _oddFrame = _frames % 2 != 0;
+    }
+
+    const int64_t lineSize = 2 * static_cast<int64_t>(_meta._pointsX),
+                  frameSize = lineSize * _meta._pointsY,
+                  start = index % frameSize,
+                  end = start + dataSize < frameSize ? start + dataSize : frameSize;
+
+    /* Lines before the buffer start are lost; they keep their NaN */
+    int64_t line = (start + lineSize - 1) / lineSize;
+    if(line < _nextLine)
+        line = _nextLine;
+
+    for(; (line + 1) * lineSize <= end; line++)
+    {
+        const DYB_Rc rc = writeLine(static_cast<int32_t>(line), data + (line * lineSize - start));
+        if(rc != DYB_Ok)
+            return rc;
+    }
+    if(line > _nextLine)
+        _nextLine = static_cast<int32_t>(line);
+
+    if(_nextLine == _meta._pointsY)
+    {
+        _complete = true;
+        return finish();
+    }
+    return DYB_Ok;
+}
+
+
+/** \brief Write data that are not a scan as a whole by DYB_writeBuffer.
+ *
+ * \param frameNo const int32_t Number of the frame, part of the file name.
+ * \param index const int32_t Index of the first element in data.
+ * \param dataSize const int32_t Number of valid data.
+ * \param data const int32_t* The data.
+ * \param meta const DYB_Meta* Meta data belonging to the data.
+ * \return DYB_Rc Result of DYB_writeBuffer.
+ *
+ */
+DYB_Rc FrameWriter::writeOther(const int32_t frameNo, const int32_t index, const int32_t dataSize,
+                               const int32_t *data, const DYB_Meta *meta)
+{
+    DYB_Rc rc = finish();
+    if(rc != DYB_Ok)
+        return rc;
+
+    const std::string name = _fileName + "_" + std::to_string(frameNo);
+    rc = DYB_writeBuffer(name.c_str(), _comment.c_str(), _binary, _forward,
+                         index, dataSize, data, meta);
+    if(rc == DYB_Ok)
+        _current = name + ".csv";
+    return rc;
+}
+
+
+DYB_Rc FrameWriter::open(const int32_t frameNo, const DYB_Meta *meta)
+{
+    const DYB_Order order = meta->_order;
+    if(meta->_pointsX <= 0 || meta->_pointsY <= 0)
+        return DYB_OutOfRange;
+
+    const bool firstForward = order == DYB_FfScan || order == DYB_FbScan,
+               secondForward = order == DYB_FfScan || order == DYB_BfScan;
+    if(firstForward == _forward)
+        _half = 0;
+    else if(secondForward == _forward)
+        _half = 1;
+    else
+        return DYB_OutOfRange;
+
+    _meta = *meta;
+    _frameNo = frameNo;
+    _complete = false;
+    _nextLine = 0;
+    _rowBytes = static_cast<long>(_meta._pointsX) * (_binary ? sizeof(Flt32) : AscFieldWidth);
+    _phys.resize(_meta._pointsX);
+    _row.resize(_rowBytes);
+
+    _current = _fileName + "_" + std::to_string(frameNo) + (_binary ? ".bcrf" : ".asc");
+    _file = fopen(_current.c_str(), "wb");
+    if(!_file)
+        return DYB_OpenError;
+
+    DYB_Rc rc = writeHeader();
+    if(rc != DYB_Ok)
+        return rc;
+
+    /* Unscanned lines read as NaN; this is the only write of the full frame */
+    _dataStart = ftell(_file);
+    std::fill(_phys.begin(), _phys.end(), std::numeric_limits<Flt32>::quiet_NaN());
+    for(int32_t l = 0; l < _meta._pointsY && rc == DYB_Ok; l++)
+        rc = writeLine(-1 - l, NULL);
+    return rc;
+}
+
+
+DYB_Rc FrameWriter::writeHeader()
+{
+    char unitXY[16] = "?",
+         unitVal[16] = "?";
+    std::ostringstream out;
+
+    DYB_convPhys2Print(1.0f, _meta._unitXY, unitXY);
+    DYB_convPhys2Print(1.0f, _meta._unitVal, unitVal);
+    const char *direction = _forward ? "forward" : "backward";
+
+    if(_binary)
+    {
+        out << "fileformat = bcrf\nheadersize = " << BcrfHeaderSize
+            << "\nxpixels = " << _meta._pointsX << "\nypixels = " << _meta._pointsY
+            << "\nxlength = " << _meta._pointsX * _meta._stepX
+            << "\nylength = " << _meta._pointsY * _meta._stepY
+            << "\nxunit = " << unitXY << "\nyunit = " << unitXY << "\nzunit = " << unitVal
+            << "\nxoffset = " << _meta._originX << "\nyoffset = " << _meta._originY
+            << "\nbit2nm = 1\nintelmode = 1\n"
+            << "% " << _comment << "\n% frame = " << _frameNo << "\n% direction = " << direction
+            << "\n% rotation = " << _meta._rotation << " rad\n";
+    }
+    else
+    {
+        out << "# " << _comment << "\n# frame: " << _frameNo << "\n# direction: " << direction
+            << "\n# x-pixels: " << _meta._pointsX << "\n# y-pixels: " << _meta._pointsY
+            << "\n# x-length: " << _meta._pointsX * _meta._stepX << " " << unitXY
+            << "\n# y-length: " << _meta._pointsY * _meta._stepY << " " << unitXY
+            << "\n# x-offset: " << _meta._originX << " " << unitXY
+            << "\n# y-offset: " << _meta._originY << " " << unitXY
+            << "\n# rotation: " << _meta._rotation << " rad\n# value unit: " << unitVal << "\n";
+    }
+
+    std::string header = out.str();
+    if(_binary)
+    {
+        /* The data must start at the fixed offset: a longer header is not cut */
+        if(header.size() > static_cast<size_t>(BcrfHeaderSize))
+            return DYB_OutOfRange;
+        header.resize(BcrfHeaderSize, ' ');
+    }
+
+    if(fwrite(header.data(), 1, header.size(), _file) != header.size())
+        return DYB_Error;
+    _bytes += header.size();
+    return DYB_Ok;
+}
+
+
+/** \brief Write one row of the image.
+ *
+ * \param dataLine const int32_t Data line (0 = first scanned); a negative
+ *                 value -1 - r writes the current _phys to row r.
+ * \param data const int32_t* Raw data of the line (2 * _pointsX items).
+ * \return DYB_Rc DYB_Error if writing failed.
+ *
+ */
+DYB_Rc FrameWriter::writeLine(const int32_t dataLine, const int32_t *data)
+{
+    const int32_t pointsX = _meta._pointsX;
+    int32_t row = -1 - dataLine;
+
+    if(dataLine >= 0)
+    {
+        row = scanLine(dataLine, _meta._pointsY, _oddFrame);
+        convValues2Phys(&_meta, data + _half * pointsX, pointsX, _phys.data());
+        if(!_forward)
+            std::reverse(_phys.begin(), _phys.end());
+    }
+
+    if(_binary)
+    {
+        memcpy(_row.data(), _phys.data(), _rowBytes);
+    }
+    else
+    {
+        char field[32];
+        for(int32_t k = 0; k < pointsX; k++)
+        {
+            /* Fixed width, so that every row has a known file offset */
+            snprintf(field, sizeof(field), "%15.6e", _phys[k]);
+            char *dst = _row.data() + k * AscFieldWidth;
+            memset(dst, ' ', AscFieldWidth);
+            memcpy(dst, field, std::min<size_t>(strlen(field), AscFieldWidth - 1));
+            dst[AscFieldWidth - 1] = k + 1 < pointsX ? ' ' : '\n';
+        }
+    }
+
+    if(fseek(_file, _dataStart + row * _rowBytes, SEEK_SET) != 0 ||
+       fwrite(_row.data(), 1, _rowBytes, _file) != static_cast<size_t>(_rowBytes))
+        return DYB_Error;
+    _bytes += _rowBytes;
+    return DYB_Ok;
+}
+
+
+DYB_Rc FrameWriter::finish()
+{
+    if(!_file)
+        return DYB_Ok;
+
+    const bool ok = fclose(_file) == 0;
+    _file = NULL;
+    return ok ? DYB_Ok : DYB_Error;
+}
+
+} /* namespace asc500 */
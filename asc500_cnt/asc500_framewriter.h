@@ -0,0 +1,145 @@
+/** \file asc500_framewriter.h
+ * \brief Streaming writer for partially acquired scan frames.
+ *
+ * DYB_writeBuffer writes a complete file per call, so checkpointing a slow
+ * scan from DYB_getDataBuffer(fullOnly = 0) rewrites the whole partial frame
+ * each time. FrameWriter opens one file per frame instead, writes the header
+ * once and then only the scan lines that have been completed since the last
+ * update. Lines are written to their final position in the image; lines
+ * not yet scanned hold NaN. The Y direction alternates between frames; as
+ * the data index starts over at 0 in every frame, the writer counts the
+ * frames itself (by their frame numbers) and takes the first frame written
+ * with a geometry as the first frame of the scan.
+ *
+ * Formats:
+ *  - bcrf: 2048 byte ASCII header (key = value), then _pointsY rows of
+ *    _pointsX little endian Flt32 physical values, row 0 first.
+ *  - asc:  '#' header lines, then _pointsY text rows of fixed width fields.
+ *
+ * Only scans (DYB_FfScan .. DYB_BfScan) are written line by line; other
+ * data orders are passed to DYB_writeBuffer, which rewrites a csv file
+ * per frame number with every update.
+ */
+
+#ifndef __ASC500_FRAMEWRITER_H
+#define __ASC500_FRAMEWRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500_framepool.h"
+
+
+namespace asc500
+{
+
+class FrameWriter
+{
+public:
+    /** \brief Create a writer; files are opened on the first update.
+     *
+     * \param fileName const std::string& Base name of the files, without extension.
+     *                 The frame number is appended (e.g. "scan_3.bcrf").
+     * \param comment const std::string& Data or channel description for the header.
+     * \param binary const bool Write bcrf (true) or asc (false).
+     * \param forward const bool Write the forward (true) or backward scan.
+     *
+     */
+    FrameWriter(const std::string &fileName, const std::string &comment,
+                const bool binary, const bool forward);
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter &) = delete;
+    FrameWriter &operator=(const FrameWriter &) = delete;
+
+    /** \brief Append the newly completed lines of a partial frame.
+     *
+     * A buffer of a different frame number or geometry finishes the current
+     * file and opens a new one. The file is finished when its last line has
+     * been written.
+     *
+     * \param buffer const FrameBuffer& Buffer as filled by FramePool::fill().
+     * \return DYB_Rc DYB_OutOfRange if the direction is not scanned or the
+     *         bcrf header (comment included) exceeds 2048 bytes,
+     *         DYB_OpenError / DYB_Error on file errors.
+     *
+     */
+    DYB_Rc update(const FrameBuffer &buffer);
+
+    /** \brief Append the newly completed lines of a partial frame.
+     *
+     * \param frameNo const int32_t Number of the frame.
+     * \param index const int32_t Index of the first element in data.
+     * \param dataSize const int32_t Number of valid data.
+     * \param data const int32_t* The data.
+     * \param meta const DYB_Meta* Meta data belonging to the data.
+     * \return DYB_Rc See above.
+     *
+     */
+    DYB_Rc update(const int32_t frameNo, const int32_t index, const int32_t dataSize,
+                  const int32_t *data, const DYB_Meta *meta);
+
+    /** \brief Flush and close the current file, complete or not.
+     *
+     * \return DYB_Rc DYB_Error if flushing failed.
+     *
+     */
+    DYB_Rc finish();
+
+    /** \brief A file is open.
+     *
+     * \return bool True while a frame is being written.
+     *
+     */
+    bool isOpen() const { return _file != NULL; }
+
+    /** \brief Name of the current or last file.
+     *
+     * \return const std::string& File name with extension.
+     *
+     */
+    const std::string &currentFile() const { return _current; }
+
+    /** \brief Bytes written to files so far (headers included).
+     *
+     * \return uint64_t Bytes.
+     *
+     */
+    uint64_t bytesWritten() const { return _bytes; }
+
+private:
+    DYB_Rc open(const int32_t frameNo, const DYB_Meta *meta);
+    DYB_Rc writeOther(const int32_t frameNo, const int32_t index, const int32_t dataSize,
+                      const int32_t *data, const DYB_Meta *meta);
+    DYB_Rc writeHeader();
+    DYB_Rc writeLine(const int32_t dataLine, const int32_t *data);
+    bool sameGeometry(const DYB_Meta *meta) const;
+
+    std::string _fileName;
+    std::string _comment;
+    bool _binary;
+    bool _forward;
+
+    FILE *_file;
+    std::string _current;
+    int32_t _frameNo;
+    int64_t _frames;         /* Frames since the first of the geometry      */
+    DYB_Meta _meta;
+    bool _complete;          /* Last line of the frame has been written     */
+    bool _oddFrame;          /* Frame runs top to bottom                    */
+    int32_t _half;           /* Half of a data line holding the direction   */
+    int32_t _nextLine;       /* First data line not yet written             */
+    long _dataStart;         /* File offset of row 0                        */
+    long _rowBytes;          /* Size of a row in the file                   */
+    uint64_t _bytes;
+
+    std::vector<Flt32> _phys;
+    std::vector<char> _row;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,240 @@
+#include <cstring>
+
+#include "asc500_coords.h"
+#include "asc500_gridcache.h"
+
+
+namespace asc500
+{
+
+CoordGrid::CoordGrid(const DYB_Meta *meta)
+    : _pointsX(0), _pointsY(0)
+{
+    int32_t column = 0,
+            line = 0;
+
+    /* Rejects everything convIndex2PixelBulk rejects */
+    if(convIndex2PixelScalar(meta, 0, &column, &line) != DYB_MetaOk)
+        return;
+
+    _pointsX = meta->_pointsX;
+    _pointsY = meta->_pointsY;
+
+    const int32_t lineSize = 2 * _pointsX;
+    std::vector<int32_t> lines(lineSize);
+    std::vector<Flt32> x(lineSize), y(lineSize);
+
+    /* The first frame runs bottom to top, so data line l is pixel line l */
+    _column.resize(lineSize);
+    _forward.resize(lineSize);
+    convIndex2PixelBulk(meta, 0, lineSize, _column.data(), lines.data(), _forward.data());
+
+    _x.resize(static_cast<size_t>(_pointsX) * _pointsY);
+    _y.resize(_x.size());
+    for(int32_t l = 0; l < _pointsY; l++)
+    {
+        const int32_t first = l * lineSize;
+        Flt32 *rowX = _x.data() + static_cast<size_t>(l) * _pointsX,
+              *rowY = _y.data() + static_cast<size_t>(l) * _pointsX;
+
+        convIndex2Phys2Bulk(meta, first, lineSize, x.data(), y.data());
+        for(int32_t p = 0; p < _pointsX; p++)
+        {
+            rowX[_column[p]] = x[p];
+            rowY[_column[p]] = y[p];
+        }
+    }
+}
+
+
+template <typename Segment>
+void CoordGrid::walk(const int32_t first, const int32_t count, const bool oddFrame,
+                     Segment segment) const
+{
+    const int64_t lineSize = 2 * static_cast<int64_t>(_pointsX);
+    int64_t l = first / lineSize;
+    int32_t p = static_cast<int32_t>(first % lineSize),
+            offset = 0;
+
+    while(offset < count)
+    {
+        const int32_t length = static_cast<int32_t>(count - offset < lineSize - p ? count - offset
+                                                                                  : lineSize - p);
+        segment(offset, p, length, scanLine(l, _pointsY, oddFrame));
+        offset += length;
+        p = 0;
+        l++;
+    }
+}
+
+
+void CoordGrid::index2Pixel(const int32_t first, const int32_t count,
+                            int32_t *columns, int32_t *lines, int32_t *forward,
+                            const bool oddFrame) const
+{
+    walk(first, count, oddFrame, [&](const int32_t offset, const int32_t p, const int32_t length, const int32_t line)
+    {
+        memcpy(columns + offset, _column.data() + p, length * sizeof(int32_t));
+        if(forward)
+            memcpy(forward + offset, _forward.data() + p, length * sizeof(int32_t));
+        int32_t *dst = lines + offset;
+        for(int32_t j = 0; j < length; j++)
+            dst[j] = line;
+    });
+}
+
+
+void CoordGrid::index2Phys2(const int32_t first, const int32_t count, Flt32 *x, Flt32 *y,
+                            const bool oddFrame) const
+{
+    walk(first, count, oddFrame, [&](const int32_t offset, const int32_t p, const int32_t length, const int32_t line)
+    {
+        const Flt32 *rowX = _x.data() + static_cast<size_t>(line) * _pointsX,
+                    *rowY = _y.data() + static_cast<size_t>(line) * _pointsX;
+        const int32_t *column = _column.data() + p;
+        for(int32_t j = 0; j < length; j++)
+        {
+            x[offset + j] = rowX[column[j]];
+            y[offset + j] = rowY[column[j]];
+        }
+    });
+}
+
+
+size_t CoordGrid::bytes() const
+{
+    return (_column.size() + _forward.size()) * sizeof(int32_t) +
+           (_x.size() + _y.size()) * sizeof(Flt32);
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Cache
+ * ------------------------------------------------------------------------- */
+
+bool CoordGridCache::Key::operator==(const Key &other) const
+{
+    return memcmp(field, other.field, sizeof(field)) == 0;
+}
+
+
+size_t CoordGridCache::KeyHash::operator()(const Key &key) const
+{
+    /* FNV-1a over the field bit patterns */
+    uint64_t hash = 14695981039346656037ULL;
+    for(const uint32_t f : key.field)
+    {
+        hash ^= f;
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+
+CoordGridCache::Key CoordGridCache::keyOf(const DYB_Meta *meta)
+{
+    Key key;
+    const int32_t order = meta->_order,
+                  unit = meta->_unitXY;
+
+    memcpy(&key.field[0], &order, 4);
+    memcpy(&key.field[1], &meta->_pointsX, 4);
+    memcpy(&key.field[2], &meta->_pointsY, 4);
+    memcpy(&key.field[3], &meta->_stepX, 4);
+    memcpy(&key.field[4], &meta->_stepY, 4);
+    memcpy(&key.field[5], &meta->_originX, 4);
+    memcpy(&key.field[6], &meta->_originY, 4);
+    memcpy(&key.field[7], &meta->_rotation, 4);
+    memcpy(&key.field[8], &unit, 4);
+    return key;
+}
+
+
+CoordGridCache::CoordGridCache(const size_t capacity)
+    : _capacity(capacity > 0 ? capacity : 1), _hits(0), _misses(0)
+{
+}
+
+
+std::shared_ptr<const CoordGrid> CoordGridCache::get(const DYB_Meta *meta)
+{
+    if(!meta)
+        return std::shared_ptr<const CoordGrid>();
+
+    const Key key = keyOf(meta);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _index.find(key);
+        if(found != _index.end())
+        {
+            _lru.splice(_lru.begin(), _lru, found->second);
+            _hits++;
+            return found->second->second;
+        }
+        _misses++;
+    }
+
+    /* Build outside the lock, a grid can take a while */
+    std::shared_ptr<const CoordGrid> grid = std::make_shared<CoordGrid>(meta);
+    if(!grid->valid())
+        return std::shared_ptr<const CoordGrid>();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _index.find(key);
+    if(found != _index.end())
+    {
+        /* Another thread was faster */
+        _lru.splice(_lru.begin(), _lru, found->second);
+        return found->second->second;
+    }
+
+    _lru.push_front(Entry(key, grid));
+    _index[key] = _lru.begin();
+    while(_lru.size() > _capacity)
+    {
+        _index.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+    return grid;
+}
+
+
+DYB_MRc CoordGridCache::index2Pixel(const DYB_Meta *meta, const int32_t first, const int32_t count,
+                                    int32_t *columns, int32_t *lines, int32_t *forward,
+                                    const bool oddFrame)
+{
+    if(!meta || first < 0 || count < 0)
+        return DYB_MetaInvalid;
+
+    std::shared_ptr<const CoordGrid> grid = get(meta);
+    if(!grid)
+        return convIndex2PixelBulk(meta, first, count, columns, lines, forward, oddFrame);
+
+    grid->index2Pixel(first, count, columns, lines, forward, oddFrame);
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc CoordGridCache::index2Phys2(const DYB_Meta *meta, const int32_t first, const int32_t count,
+                                    Flt32 *x, Flt32 *y, const bool oddFrame)
+{
+    if(!meta || first < 0 || count < 0)
+        return DYB_MetaInvalid;
+
+    std::shared_ptr<const CoordGrid> grid = get(meta);
+    if(!grid)
+        return convIndex2Phys2Bulk(meta, first, count, x, y, oddFrame);
+
+    grid->index2Phys2(first, count, x, y, oddFrame);
+    return DYB_MetaOk;
+}
+
+
+void CoordGridCache::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _index.clear();
+    _lru.clear();
+}
+
+} /* namespace asc500 */
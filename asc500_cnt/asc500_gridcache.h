@@ -0,0 +1,194 @@
+/** \file asc500_gridcache.h
+ * \brief Cache of precomputed coordinate grids.
+ *
+ * The scan geometry in DYB_Meta only changes when important parameters are
+ * changed, so the pixel and physical coordinates of a frame are the same
+ * for every frame of a scan (apart from the alternating Y direction, which
+ * the callers pass as frame parity, as the data index starts over at 0 in
+ * every frame).
+ * A CoordGrid holds them as lookup tables:
+ *
+ *  - column and direction of every position within a data line (2 * _pointsX),
+ *  - x and y of every pixel (_pointsX * _pointsY).
+ *
+ * Converting an index range then is a table walk without trigonometry.
+ * CoordGridCache keeps the grids of the recently used geometries, keyed by
+ * the geometry fields of DYB_Meta (_order .. _unitXY), and evicts the least
+ * recently used one. Only scans (DYB_FfScan .. DYB_BfScan) are cached.
+ */
+
+#ifndef __ASC500_GRIDCACHE_H
+#define __ASC500_GRIDCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "metadata.h"
+
+
+namespace asc500
+{
+
+class CoordGrid
+{
+public:
+    /** \brief Build the tables of a scan geometry.
+     *
+     * Check valid() afterwards; a grid is invalid if the meta data
+     * don't describe a scan.
+     *
+     * \param meta const DYB_Meta* Meta data set of a scan.
+     *
+     */
+    explicit CoordGrid(const DYB_Meta *meta);
+
+    /** \brief Tables have been built.
+     *
+     * \return bool False if the meta data are not applicable.
+     *
+     */
+    bool valid() const { return !_x.empty(); }
+
+    /** \brief Pixel positions and scan directions of an index range.
+     *
+     * \param first const int32_t First data index, counted from the start of the frame.
+     * \param count const int32_t Number of indices.
+     * \param columns int32_t* Output: column numbers (count items).
+     * \param lines int32_t* Output: line numbers (count items).
+     * \param forward int32_t* Output: forward flags (count items), may be NULL.
+     * \param oddFrame const bool If the frame runs top to bottom (2nd, 4th, ... frame).
+     * \return void
+     *
+     */
+    void index2Pixel(const int32_t first, const int32_t count,
+                     int32_t *columns, int32_t *lines, int32_t *forward = NULL,
+                     const bool oddFrame = false) const;
+
+    /** \brief Physical positions of an index range.
+     *
+     * \param first const int32_t First data index, counted from the start of the frame.
+     * \param count const int32_t Number of indices.
+     * \param x Flt32* Output: horizontal positions (count items).
+     * \param y Flt32* Output: vertical positions (count items).
+     * \param oddFrame const bool If the frame runs top to bottom.
+     * \return void
+     *
+     */
+    void index2Phys2(const int32_t first, const int32_t count, Flt32 *x, Flt32 *y,
+                     const bool oddFrame = false) const;
+
+    int32_t pointsX() const { return _pointsX; }                   /**< Columns                        */
+    int32_t pointsY() const { return _pointsY; }                   /**< Lines                          */
+    const int32_t *lineColumns() const { return _column.data(); }  /**< Column per position in a line  */
+    const int32_t *lineForward() const { return _forward.data(); } /**< Forward per position in a line */
+
+    /** \brief Memory occupied by the tables.
+     *
+     * \return size_t Size [bytes].
+     *
+     */
+    size_t bytes() const;
+
+private:
+    template <typename Segment>
+    void walk(const int32_t first, const int32_t count, const bool oddFrame, Segment segment) const;
+
+    int32_t _pointsX;
+    int32_t _pointsY;
+    std::vector<int32_t> _column;  /* Column per position in a data line      */
+    std::vector<int32_t> _forward; /* Direction per position in a data line   */
+    std::vector<Flt32> _x;         /* x per pixel, row major                  */
+    std::vector<Flt32> _y;         /* y per pixel, row major                  */
+};
+
+
+class CoordGridCache
+{
+public:
+    /** \brief Create a cache.
+     *
+     * \param capacity const size_t Number of grids kept.
+     *
+     */
+    explicit CoordGridCache(const size_t capacity = 4);
+
+    /** \brief Grid of a geometry; built on a miss.
+     *
+     * The grid stays valid as long as the pointer is held, even if it is
+     * evicted meanwhile.
+     *
+     * \param meta const DYB_Meta* Meta data set.
+     * \return std::shared_ptr<const CoordGrid> The grid, empty if not a scan.
+     *
+     */
+    std::shared_ptr<const CoordGrid> get(const DYB_Meta *meta);
+
+    /** \brief Pixel positions of an index range via the cache.
+     *
+     * \param meta const DYB_Meta* Meta data set of a scan.
+     * \param first const int32_t First data index, counted from the start of the frame.
+     * \param count const int32_t Number of indices.
+     * \param columns int32_t* Output: column numbers (count items).
+     * \param lines int32_t* Output: line numbers (count items).
+     * \param forward int32_t* Output: forward flags (count items), may be NULL.
+     * \param oddFrame const bool If the frame runs top to bottom.
+     * \return DYB_MRc Same codes as convIndex2PixelBulk.
+     *
+     */
+    DYB_MRc index2Pixel(const DYB_Meta *meta, const int32_t first, const int32_t count,
+                        int32_t *columns, int32_t *lines, int32_t *forward = NULL,
+                        const bool oddFrame = false);
+
+    /** \brief Physical positions of an index range via the cache.
+     *
+     * \param meta const DYB_Meta* Meta data set of a scan.
+     * \param first const int32_t First data index, counted from the start of the frame.
+     * \param count const int32_t Number of indices.
+     * \param x Flt32* Output: horizontal positions (count items).
+     * \param y Flt32* Output: vertical positions (count items).
+     * \param oddFrame const bool If the frame runs top to bottom.
+     * \return DYB_MRc Same codes as convIndex2Phys2Bulk.
+     *
+     */
+    DYB_MRc index2Phys2(const DYB_Meta *meta, const int32_t first, const int32_t count,
+                        Flt32 *x, Flt32 *y, const bool oddFrame = false);
+
+    /** \brief Drop all grids. */
+    void clear();
+
+    uint64_t hits() const { return _hits; }       /**< Lookups served from the cache */
+    uint64_t misses() const { return _misses; }   /**< Lookups that built a grid     */
+
+private:
+    /* Geometry fields of DYB_Meta as bit patterns */
+    struct Key
+    {
+        uint32_t field[9];
+        bool operator==(const Key &other) const;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const;
+    };
+
+    typedef std::pair<Key, std::shared_ptr<const CoordGrid> > Entry;
+
+    static Key keyOf(const DYB_Meta *meta);
+
+    size_t _capacity;
+    std::atomic<uint64_t> _hits;
+    std::atomic<uint64_t> _misses;
+    std::list<Entry> _lru;         /* Most recently used first                */
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> _index;
+    std::mutex _mutex;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,459 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "asc500_leveling.h"
+#include "asc500_simd.h"
+
+
+namespace asc500
+{
+
+/* Normalized coordinate -1 .. 1 across a row keeps the fits well conditioned */
+static double step(const int32_t count)
+{
+    return count > 1 ? 2.0 / (count - 1) : 0.0;
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Moment kernels: s[k] = sum u^k (k = 0 .. 6), s[7 + k] = sum u^k z
+ *  (k = 0 .. 3) over the valid values, u = -1 + i * du
+ * ------------------------------------------------------------------------- */
+
+static const int MomentCount = 11;
+
+static void momentsScalar(const Flt32 *z, const int32_t first, const int32_t last,
+                          const double du, double *s)
+{
+    for(int32_t i = first; i < last; i++)
+    {
+        if(z[i] != z[i])
+            continue;
+        const double u = -1.0 + static_cast<double>(i) * du,
+                     v = z[i];
+        double p = 1.0;
+        for(int k = 0; k < 7; k++)
+        {
+            s[k] += p;
+            if(k < 4)
+                s[7 + k] += p * v;
+            p = p * u;
+        }
+    }
+}
+
+
+#ifdef ASC500_SSE2
+static void momentsSse2(const Flt32 *z, const int32_t count, const double du, double *s)
+{
+    const __m128d one = _mm_set1_pd(1.0),
+                  minusOne = _mm_set1_pd(-1.0),
+                  vdu = _mm_set1_pd(du);
+    __m128d acc[MomentCount];
+    for(int k = 0; k < MomentCount; k++)
+        acc[k] = _mm_setzero_pd();
+
+    int32_t i = 0;
+    for(; i + 2 <= count; i += 2)
+    {
+        const __m128d v = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(z + i)))),
+                      valid = _mm_cmpord_pd(v, v),
+                      vz = _mm_and_pd(valid, v),
+                      u = _mm_add_pd(minusOne, _mm_mul_pd(_mm_set_pd(i + 1, i), vdu));
+        __m128d p = _mm_and_pd(valid, one);
+        for(int k = 0; k < 7; k++)
+        {
+            acc[k] = _mm_add_pd(acc[k], p);
+            if(k < 4)
+                acc[7 + k] = _mm_add_pd(acc[7 + k], _mm_mul_pd(p, vz));
+            p = _mm_mul_pd(p, u);
+        }
+    }
+
+    for(int k = 0; k < MomentCount; k++)
+    {
+        double lanes[2];
+        _mm_storeu_pd(lanes, acc[k]);
+        s[k] += lanes[0] + lanes[1];
+    }
+    momentsScalar(z, i, count, du, s);
+}
+#endif
+
+
+#ifdef ASC500_AVX2
+ASC500_TARGET_AVX2
+static void momentsAvx2(const Flt32 *z, const int32_t count, const double du, double *s)
+{
+    const __m256d one = _mm256_set1_pd(1.0),
+                  minusOne = _mm256_set1_pd(-1.0),
+                  vdu = _mm256_set1_pd(du),
+                  lane = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+    __m256d acc[MomentCount];
+    for(int k = 0; k < MomentCount; k++)
+        acc[k] = _mm256_setzero_pd();
+
+    int32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        const __m256d v = _mm256_cvtps_pd(_mm_loadu_ps(z + i)),
+                      valid = _mm256_cmp_pd(v, v, _CMP_ORD_Q),
+                      vz = _mm256_and_pd(valid, v),
+                      u = _mm256_add_pd(minusOne, _mm256_mul_pd(_mm256_add_pd(_mm256_set1_pd(i), lane), vdu));
+        __m256d p = _mm256_and_pd(valid, one);
+        for(int k = 0; k < 7; k++)
+        {
+            acc[k] = _mm256_add_pd(acc[k], p);
+            if(k < 4)
+                acc[7 + k] = _mm256_add_pd(acc[7 + k], _mm256_mul_pd(p, vz));
+            p = _mm256_mul_pd(p, u);
+        }
+    }
+
+    for(int k = 0; k < MomentCount; k++)
+    {
+        double lanes[4];
+        _mm256_storeu_pd(lanes, acc[k]);
+        s[k] += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+    momentsScalar(z, i, count, du, s);
+}
+#endif
+
+
+static void moments(const Flt32 *z, const int32_t count, const double du, double *s)
+{
+    memset(s, 0, MomentCount * sizeof(double));
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+        return momentsAvx2(z, count, du, s);
+#endif
+#ifdef ASC500_SSE2
+    momentsSse2(z, count, du, s);
+#else
+    momentsScalar(z, 0, count, du, s);
+#endif
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Subtraction kernels: out[i] = z[i] - (c0 + c1 u + c2 u^2 + c3 u^3),
+ *  u = -1 + i * du, evaluated in single precision
+ * ------------------------------------------------------------------------- */
+
+static void subtractScalar(const Flt32 *z, const int32_t first, const int32_t last,
+                           const Flt32 du, const Flt32 *c, Flt32 *out)
+{
+    for(int32_t i = first; i < last; i++)
+    {
+        const Flt32 u = -1.0f + static_cast<Flt32>(i) * du;
+        Flt32 p = c[3];
+        p = p * u + c[2];
+        p = p * u + c[1];
+        p = p * u + c[0];
+        out[i] = z[i] - p;
+    }
+}
+
+
+#ifdef ASC500_SSE2
+static void subtractSse2(const Flt32 *z, const int32_t count, const Flt32 du, const Flt32 *c, Flt32 *out)
+{
+    const __m128 minusOne = _mm_set1_ps(-1.0f),
+                 vdu = _mm_set1_ps(du),
+                 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f),
+                 c0 = _mm_set1_ps(c[0]), c1 = _mm_set1_ps(c[1]),
+                 c2 = _mm_set1_ps(c[2]), c3 = _mm_set1_ps(c[3]);
+
+    int32_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        const __m128 u = _mm_add_ps(minusOne, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<Flt32>(i)), lane), vdu));
+        __m128 p = c3;
+        p = _mm_add_ps(_mm_mul_ps(p, u), c2);
+        p = _mm_add_ps(_mm_mul_ps(p, u), c1);
+        p = _mm_add_ps(_mm_mul_ps(p, u), c0);
+        _mm_storeu_ps(out + i, _mm_sub_ps(_mm_loadu_ps(z + i), p));
+    }
+    subtractScalar(z, i, count, du, c, out);
+}
+#endif
+
+
+#ifdef ASC500_AVX2
+ASC500_TARGET_AVX2
+static void subtractAvx2(const Flt32 *z, const int32_t count, const Flt32 du, const Flt32 *c, Flt32 *out)
+{
+    const __m256 minusOne = _mm256_set1_ps(-1.0f),
+                 vdu = _mm256_set1_ps(du),
+                 lane = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f),
+                 c0 = _mm256_set1_ps(c[0]), c1 = _mm256_set1_ps(c[1]),
+                 c2 = _mm256_set1_ps(c[2]), c3 = _mm256_set1_ps(c[3]);
+
+    int32_t i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        const __m256 u = _mm256_add_ps(minusOne, _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(static_cast<Flt32>(i)), lane), vdu));
+        __m256 p = c3;
+        p = _mm256_add_ps(_mm256_mul_ps(p, u), c2);
+        p = _mm256_add_ps(_mm256_mul_ps(p, u), c1);
+        p = _mm256_add_ps(_mm256_mul_ps(p, u), c0);
+        _mm256_storeu_ps(out + i, _mm256_sub_ps(_mm256_loadu_ps(z + i), p));
+    }
+    subtractScalar(z, i, count, du, c, out);
+}
+#endif
+
+
+static void subtract(const Flt32 *z, const int32_t count, const Flt32 du, const Flt32 *c, Flt32 *out)
+{
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+        return subtractAvx2(z, count, du, c, out);
+#endif
+#ifdef ASC500_SSE2
+    subtractSse2(z, count, du, c, out);
+#else
+    subtractScalar(z, 0, count, du, c, out);
+#endif
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Small dense least squares systems
+ * ------------------------------------------------------------------------- */
+
+/* Solve m * x = r for the unknowns selected in use[] (n x n, row major);
+ * the other unknowns are 0. False if the selected system is singular. */
+static bool solve(const double *m, const double *r, const int n, const bool *use, double *x)
+{
+    double a[4][5];
+    int index[4], size = 0;
+    for(int j = 0; j < n; j++)
+    {
+        x[j] = 0.0;
+        if(use[j])
+            index[size++] = j;
+    }
+    for(int j = 0; j < size; j++)
+    {
+        for(int k = 0; k < size; k++)
+            a[j][k] = m[index[j] * n + index[k]];
+        a[j][size] = r[index[j]];
+    }
+
+    double scale = 0.0;
+    for(int j = 0; j < size; j++)
+        scale = std::max(scale, fabs(a[j][j]));
+
+    for(int col = 0; col < size; col++)
+    {
+        int pivot = col;
+        for(int j = col + 1; j < size; j++)
+            if(fabs(a[j][col]) > fabs(a[pivot][col]))
+                pivot = j;
+        if(fabs(a[pivot][col]) <= 1e-12 * scale)
+            return false;
+        for(int k = 0; k <= size; k++)
+            std::swap(a[col][k], a[pivot][k]);
+        for(int j = col + 1; j < size; j++)
+        {
+            const double f = a[j][col] / a[col][col];
+            for(int k = col; k <= size; k++)
+                a[j][k] -= f * a[col][k];
+        }
+    }
+    for(int j = size - 1; j >= 0; j--)
+    {
+        double v = a[j][size];
+        for(int k = j + 1; k < size; k++)
+            v -= a[j][k] * x[index[k]];
+        x[index[j]] = v / a[j][j];
+    }
+    return true;
+}
+
+
+/* Polynomial of the given order from the moments; lower orders if the
+ * row has too few valid values */
+static void fitPolynomial(const double *s, int32_t order, double *c)
+{
+    double m[16], r[4];
+    for(; order >= 0; order--)
+    {
+        const int n = order + 1;
+        const bool use[4] = { true, true, true, true };
+        for(int j = 0; j < n; j++)
+        {
+            for(int k = 0; k < n; k++)
+                m[j * n + k] = s[j + k];
+            r[j] = s[7 + j];
+        }
+        if(s[0] > order && solve(m, r, n, use, c))
+        {
+            for(int j = n; j < 4; j++)
+                c[j] = 0.0;
+            return;
+        }
+    }
+    c[0] = c[1] = c[2] = c[3] = 0.0;
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Leveler
+ * ------------------------------------------------------------------------- */
+
+FrameLeveler::FrameLeveler(const Mode mode, const int32_t order)
+    : _mode(mode), _order(order < 1 ? 1 : order > 3 ? 3 : order), _columns(0), _rows(0), _linesDone(0)
+{
+    memset(_sums, 0, sizeof(_sums));
+}
+
+
+DYB_Rc FrameLeveler::startFrame(const int32_t columns, const int32_t rows)
+{
+    if(columns <= 0 || rows <= 0)
+        return DYB_OutOfRange;
+
+    const size_t size = static_cast<size_t>(columns) * rows;
+    _columns = columns;
+    _rows = rows;
+    _linesDone = 0;
+    _raw.assign(size, std::numeric_limits<Flt32>::quiet_NaN());
+    _leveled.assign(size, std::numeric_limits<Flt32>::quiet_NaN());
+    _rowSums.assign(rows, RowSums());
+    _landed.assign(rows, 0);
+    memset(_sums, 0, sizeof(_sums));
+    return DYB_Ok;
+}
+
+
+DYB_Rc FrameLeveler::addRow(const Flt32 *data, const int32_t columns, const int32_t rows, const int32_t row)
+{
+    if(columns != _columns || rows != _rows || complete())
+    {
+        const DYB_Rc rc = startFrame(columns, rows);
+        if(rc != DYB_Ok)
+            return rc;
+    }
+    if(row < 0 || row >= _rows)
+        return DYB_OutOfRange;
+
+    Flt32 *raw = _raw.data() + static_cast<size_t>(row) * _columns;
+    memcpy(raw, data, _columns * sizeof(Flt32));
+
+    double s[MomentCount];
+    moments(raw, _columns, step(_columns), s);
+
+    /* Replace the contribution of the row to the plane sums: O(1) */
+    const double v = -1.0 + row * step(_rows);
+    RowSums &old = _rowSums[row];
+    const RowSums now = { s[0], s[1], s[2], s[7], s[8] };
+    const double delta[9] = { now.n - old.n, now.u - old.u, now.uu - old.uu,
+                              v * (now.n - old.n), v * v * (now.n - old.n), v * (now.u - old.u),
+                              now.z - old.z, now.uz - old.uz, v * (now.z - old.z) };
+    for(int k = 0; k < 9; k++)
+        _sums[k] += delta[k];
+    old = now;
+    if(!_landed[row])
+    {
+        _landed[row] = 1;
+        _linesDone++;
+    }
+
+    double coeffs[4] = { 0.0, 0.0, 0.0, 0.0 };
+    switch(_mode)
+    {
+    case Offset:
+        coeffs[0] = s[0] > 0.0 ? s[7] / s[0] : 0.0;
+        break;
+    case Median:
+    {
+        _scratch.clear();
+        for(int32_t i = 0; i < _columns; i++)
+            if(raw[i] == raw[i])
+                _scratch.push_back(raw[i]);
+        if(!_scratch.empty())
+        {
+            const size_t half = _scratch.size() / 2;
+            std::nth_element(_scratch.begin(), _scratch.begin() + half, _scratch.end());
+            coeffs[0] = _scratch[half];
+            if(_scratch.size() % 2 == 0)
+                coeffs[0] = 0.5 * (coeffs[0] + *std::max_element(_scratch.begin(), _scratch.begin() + half));
+        }
+        break;
+    }
+    case Polynomial:
+        fitPolynomial(s, _order, coeffs);
+        break;
+    case Plane:
+    {
+        double p[3];
+        if(planeCoeffs(p) && complete())
+        {
+            /* Final plane: level the whole frame once more */
+            for(int32_t r = 0; r < _rows; r++)
+            {
+                const double fr[4] = { p[0] + p[2] * (-1.0 + r * step(_rows)), p[1], 0.0, 0.0 };
+                levelRow(r, fr);
+            }
+            return DYB_Ok;
+        }
+        coeffs[0] = p[0] + p[2] * v;
+        coeffs[1] = p[1];
+        break;
+    }
+    default:
+        break;
+    }
+    levelRow(row, coeffs);
+    return DYB_Ok;
+}
+
+
+void FrameLeveler::levelRow(const int32_t row, const double *coeffs)
+{
+    const size_t offset = static_cast<size_t>(row) * _columns;
+    const Flt32 c[4] = { static_cast<Flt32>(coeffs[0]), static_cast<Flt32>(coeffs[1]),
+                         static_cast<Flt32>(coeffs[2]), static_cast<Flt32>(coeffs[3]) };
+    subtract(_raw.data() + offset, _columns, static_cast<Flt32>(step(_columns)), c, _leveled.data() + offset);
+}
+
+
+bool FrameLeveler::planeCoeffs(double *coeffs) const
+{
+    /* z = a + b u + c v; unknowns without support (one row, one column) are dropped */
+    const double m[9] = { _sums[0], _sums[1], _sums[3],
+                          _sums[1], _sums[2], _sums[5],
+                          _sums[3], _sums[5], _sums[4] };
+    const double r[3] = { _sums[6], _sums[7], _sums[8] };
+    static const bool subsets[4][3] = { { true, true, true }, { true, true, false },
+                                        { true, false, true }, { true, false, false } };
+    for(int j = 0; j < 4; j++)
+        if(_sums[0] > 0.5 && solve(m, r, 3, subsets[j], coeffs))
+            return true;
+    coeffs[0] = coeffs[1] = coeffs[2] = 0.0;
+    return false;
+}
+
+
+PlaneFit FrameLeveler::plane() const
+{
+    double p[3];
+    planeCoeffs(p);
+
+    /* Back from normalized to pixel coordinates */
+    const double du = step(_columns),
+                 dv = step(_rows);
+    PlaneFit fit;
+    fit.offset = p[0] - p[1] - p[2];
+    fit.slopeX = p[1] * du;
+    fit.slopeY = p[2] * dv;
+    fit.points = static_cast<int64_t>(_sums[0] + 0.5);
+    return fit;
+}
+
+} /* namespace asc500 */
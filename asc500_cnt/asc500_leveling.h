@@ -0,0 +1,142 @@
+/** \file asc500_leveling.h
+ * \brief Streaming line and plane leveling of topography frames.
+ *
+ * Raw topography (e.g. CHANADC_ZOUT) is dominated by tilt and by offsets
+ * between the lines; the hardware slope compensation (ID_REG_SLOPE_X/Y)
+ * reduces but doesn't remove them. FrameLeveler takes the rows of a frame
+ * as they are completed (typically from the line handler of FrameAssembler)
+ * and keeps a leveled copy of the frame:
+ *
+ * - Offset, Median: the mean or median of the row is subtracted.
+ * - Polynomial: a least squares polynomial in x (order 1 .. 3) is subtracted.
+ * - Plane: the least squares plane of the frame is subtracted.
+ *
+ * The line modes only depend on the row itself, so a leveled row is final
+ * as soon as it has landed. The plane fit is kept in running sums that are
+ * updated in O(1) per row, so plane() is available at any time; in Plane
+ * mode the rows are leveled with the current estimate as they land and the
+ * whole frame once more with the final plane when the last row lands,
+ * before addRow() returns.
+ *
+ * NaN (not scanned) values are ignored by the fits and stay NaN. The
+ * reductions use SSE2 / AVX2 kernels (see asc500_simd.h); sums are
+ * accumulated in double.
+ */
+
+#ifndef __ASC500_LEVELING_H
+#define __ASC500_LEVELING_H
+
+#include <cstdint>
+#include <vector>
+
+#include "daisybase.h"
+
+
+namespace asc500
+{
+
+/** Least squares plane z = offset + slopeX * column + slopeY * row */
+struct PlaneFit
+{
+    double offset;             /**< Value at column 0, row 0                   */
+    double slopeX;             /**< Change per column                          */
+    double slopeY;             /**< Change per row                             */
+    int64_t points;            /**< Valid values contributing to the fit       */
+};
+
+
+class FrameLeveler
+{
+public:
+    enum Mode
+    {
+        None,                  /**< Copy the rows unchanged                    */
+        Offset,                /**< Subtract the mean of every row             */
+        Median,                /**< Subtract the median of every row           */
+        Polynomial,            /**< Subtract a polynomial fit of every row     */
+        Plane                  /**< Subtract the plane fit of the frame        */
+    };
+
+    /** \brief Create a leveler.
+     *
+     * \param mode const Mode Leveling method.
+     * \param order const int32_t Order of the polynomial (1 .. 3) in Polynomial mode.
+     *
+     */
+    explicit FrameLeveler(const Mode mode = Median, const int32_t order = 1);
+
+    FrameLeveler(const FrameLeveler &) = delete;
+    FrameLeveler &operator=(const FrameLeveler &) = delete;
+
+    /** \brief Start a new frame; all rows become NaN and the plane fit is cleared.
+     *
+     * \param columns const int32_t Width of the frame.
+     * \param rows const int32_t Height of the frame.
+     * \return DYB_Rc DYB_OutOfRange for an empty size.
+     *
+     */
+    DYB_Rc startFrame(const int32_t columns, const int32_t rows);
+
+    /** \brief Level a completed row.
+     *
+     * A new frame is started automatically if the size changes or if the
+     * previous frame is complete. A row that arrives a second time replaces
+     * its previous contribution to the plane fit.
+     *
+     * \param data const Flt32* The columns values of the row.
+     * \param columns const int32_t Width of the frame.
+     * \param rows const int32_t Height of the frame.
+     * \param row const int32_t Row number, 0 = top.
+     * \return DYB_Rc DYB_OutOfRange if the row is outside of the frame.
+     *
+     */
+    DYB_Rc addRow(const Flt32 *data, const int32_t columns, const int32_t rows, const int32_t row);
+
+    /** \brief Leveled frame.
+     *
+     * \return const Flt32* rows() * columns() values, NaN where not yet scanned.
+     *
+     */
+    const Flt32 *frame() const { return _leveled.data(); }
+
+    /** \brief Current plane fit of the raw rows that have landed.
+     *
+     * With a single row the slope in y is 0, without valid values the fit is all 0.
+     *
+     * \return PlaneFit The plane in pixel coordinates.
+     *
+     */
+    PlaneFit plane() const;
+
+    Mode mode() const { return _mode; }                 /**< Leveling method                  */
+    int32_t columns() const { return _columns; }        /**< Values per row                   */
+    int32_t rows() const { return _rows; }              /**< Rows of the frame                */
+    int32_t linesDone() const { return _linesDone; }    /**< Distinct rows landed             */
+    bool complete() const { return _rows > 0 && _linesDone == _rows; } /**< All rows landed   */
+
+private:
+    /* Contribution of a row to the plane sums, in normalized coordinates */
+    struct RowSums
+    {
+        double n, u, uu, z, uz;
+    };
+
+    void levelRow(const int32_t row, const double *coeffs);
+    bool planeCoeffs(double *coeffs) const;
+
+    Mode _mode;
+    int32_t _order;
+    int32_t _columns;
+    int32_t _rows;
+    int32_t _linesDone;
+    std::vector<Flt32> _raw;
+    std::vector<Flt32> _leveled;
+    std::vector<RowSums> _rowSums;
+    std::vector<char> _landed;
+    std::vector<Flt32> _scratch;
+    double _sums[9];           /* n u uu v vv uv z uz vz */
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,377 @@
+#include <cmath>
+
+#include "asc500_convert.h"
+#include "asc500_lockin.h"
+#include "asc500_simd.h"
+
+
+namespace asc500
+{
+
+static const double Pi = 3.14159265358979323846;
+static const double PhaseScale = 4294967296.0;   /* 2^32: one turn of the NCO */
+static const int32_t BlockSize = 256;            /* Samples between two NCO resyncs */
+
+
+/* ---------------------------------------------------------------------------
+ *  Demodulation kernels: lanes first .. last - 1 over count samples.
+ *  c / s: oscillator, rc / rs: rotation per sample, alpha / x / y: stages
+ *  rows of lanes values each
+ * ------------------------------------------------------------------------- */
+
+struct Lanes
+{
+    int32_t lanes;             /* Row length of the stage arrays              */
+    int32_t stages;
+    double *c;
+    double *s;
+    const double *rc;
+    const double *rs;
+    const double *alpha;
+    double *x;
+    double *y;
+};
+
+
+static void demodScalar(const Flt32 *in, const int32_t count, const Lanes &l,
+                        const int32_t first, const int32_t last)
+{
+    for(int32_t lane = first; lane < last; lane++)
+    {
+        double c = l.c[lane], s = l.s[lane];
+        const double rc = l.rc[lane], rs = l.rs[lane];
+        for(int32_t i = 0; i < count; i++)
+        {
+            const double v = in[i];
+            double px = v * c,
+                   py = 0.0 - v * s;
+            for(int32_t k = 0; k < l.stages; k++)
+            {
+                const int32_t at = k * l.lanes + lane;
+                l.x[at] = l.x[at] + l.alpha[at] * (px - l.x[at]);
+                l.y[at] = l.y[at] + l.alpha[at] * (py - l.y[at]);
+                px = l.x[at];
+                py = l.y[at];
+            }
+            const double nc = c * rc - s * rs;
+            s = s * rc + c * rs;
+            c = nc;
+        }
+        l.c[lane] = c;
+        l.s[lane] = s;
+    }
+}
+
+
+#ifdef ASC500_SSE2
+static void demodSse2(const Flt32 *in, const int32_t count, const Lanes &l,
+                      const int32_t first, const int32_t last)
+{
+    const __m128d zero = _mm_setzero_pd();
+    int32_t lane = first;
+    for(; lane + 2 <= last; lane += 2)
+    {
+        __m128d c = _mm_loadu_pd(l.c + lane), s = _mm_loadu_pd(l.s + lane);
+        const __m128d rc = _mm_loadu_pd(l.rc + lane), rs = _mm_loadu_pd(l.rs + lane);
+        for(int32_t i = 0; i < count; i++)
+        {
+            const __m128d v = _mm_set1_pd(in[i]);
+            __m128d px = _mm_mul_pd(v, c),
+                    py = _mm_sub_pd(zero, _mm_mul_pd(v, s));
+            for(int32_t k = 0; k < l.stages; k++)
+            {
+                const int32_t at = k * l.lanes + lane;
+                const __m128d a = _mm_loadu_pd(l.alpha + at),
+                              x = _mm_loadu_pd(l.x + at),
+                              y = _mm_loadu_pd(l.y + at);
+                px = _mm_add_pd(x, _mm_mul_pd(a, _mm_sub_pd(px, x)));
+                py = _mm_add_pd(y, _mm_mul_pd(a, _mm_sub_pd(py, y)));
+                _mm_storeu_pd(l.x + at, px);
+                _mm_storeu_pd(l.y + at, py);
+            }
+            const __m128d nc = _mm_sub_pd(_mm_mul_pd(c, rc), _mm_mul_pd(s, rs));
+            s = _mm_add_pd(_mm_mul_pd(s, rc), _mm_mul_pd(c, rs));
+            c = nc;
+        }
+        _mm_storeu_pd(l.c + lane, c);
+        _mm_storeu_pd(l.s + lane, s);
+    }
+    demodScalar(in, count, l, lane, last);
+}
+#endif
+
+
+#ifdef ASC500_AVX2
+ASC500_TARGET_AVX2
+static void demodAvx2(const Flt32 *in, const int32_t count, const Lanes &l,
+                      const int32_t first, const int32_t last)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    int32_t lane = first;
+    for(; lane + 4 <= last; lane += 4)
+    {
+        __m256d c = _mm256_loadu_pd(l.c + lane), s = _mm256_loadu_pd(l.s + lane);
+        const __m256d rc = _mm256_loadu_pd(l.rc + lane), rs = _mm256_loadu_pd(l.rs + lane);
+        for(int32_t i = 0; i < count; i++)
+        {
+            const __m256d v = _mm256_set1_pd(in[i]);
+            __m256d px = _mm256_mul_pd(v, c),
+                    py = _mm256_sub_pd(zero, _mm256_mul_pd(v, s));
+            for(int32_t k = 0; k < l.stages; k++)
+            {
+                const int32_t at = k * l.lanes + lane;
+                const __m256d a = _mm256_loadu_pd(l.alpha + at),
+                              x = _mm256_loadu_pd(l.x + at),
+                              y = _mm256_loadu_pd(l.y + at);
+                px = _mm256_add_pd(x, _mm256_mul_pd(a, _mm256_sub_pd(px, x)));
+                py = _mm256_add_pd(y, _mm256_mul_pd(a, _mm256_sub_pd(py, y)));
+                _mm256_storeu_pd(l.x + at, px);
+                _mm256_storeu_pd(l.y + at, py);
+            }
+            const __m256d nc = _mm256_sub_pd(_mm256_mul_pd(c, rc), _mm256_mul_pd(s, rs));
+            s = _mm256_add_pd(_mm256_mul_pd(s, rc), _mm256_mul_pd(c, rs));
+            c = nc;
+        }
+        _mm256_storeu_pd(l.c + lane, c);
+        _mm256_storeu_pd(l.s + lane, s);
+    }
+    demodSse2(in, count, l, lane, last);
+}
+#endif
+
+
+static void demod(const Flt32 *in, const int32_t count, const Lanes &l)
+{
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+        return demodAvx2(in, count, l, 0, l.lanes);
+#endif
+#ifdef ASC500_SSE2
+    demodSse2(in, count, l, 0, l.lanes);
+#else
+    demodScalar(in, count, l, 0, l.lanes);
+#endif
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Lock-in
+ * ------------------------------------------------------------------------- */
+
+LockIn::LockIn(const double sampleRate, const int32_t decimation)
+    : _userRate(sampleRate > 0.0 ? sampleRate : 0.0), _rate(_userRate),
+      _decimation(decimation > 0 ? decimation : 1), _phase(0), _index(0), _lanes(0), _stages(0)
+{
+}
+
+
+int32_t LockIn::addReference(const double frequency, const double timeConstant,
+                             const int32_t order, const double phase)
+{
+    if(!(frequency >= 0.0) || !(timeConstant > 0.0) || order < 1 || order > MaxOrder)
+        return -1;
+    if(_rate > 0.0 && !(frequency < _rate / 2.0))
+        return -1;
+
+    _frequency.push_back(frequency);
+    _timeConstant.push_back(timeConstant);
+    _order.push_back(order);
+    _ncoPhase.push_back(static_cast<uint32_t>(static_cast<int64_t>(floor(phase / 360.0 * PhaseScale + 0.5))));
+    _pending.push_back(std::vector<LockInSample>());
+    configure();
+    return references() - 1;
+}
+
+
+void LockIn::clearReferences()
+{
+    _frequency.clear();
+    _timeConstant.clear();
+    _order.clear();
+    _ncoPhase.clear();
+    _pending.clear();
+    configure();
+}
+
+
+void LockIn::setSampleRate(const double rate)
+{
+    _userRate = rate > 0.0 ? rate : 0.0;
+    _rate = _userRate;
+    configure();
+}
+
+
+void LockIn::configure()
+{
+    const int32_t count = references();
+    _lanes = (count + 3) / 4 * 4;
+    _stages = 1;
+    for(int32_t r = 0; r < count; r++)
+        if(_order[r] > _stages)
+            _stages = _order[r];
+
+    _cos.assign(_lanes, 0.0);
+    _sin.assign(_lanes, 0.0);
+    _rotCos.assign(_lanes, 1.0);
+    _rotSin.assign(_lanes, 0.0);
+    _alpha.assign(static_cast<size_t>(_stages) * _lanes, 1.0);
+    _x.assign(static_cast<size_t>(_stages) * _lanes, 0.0);
+    _y.assign(static_cast<size_t>(_stages) * _lanes, 0.0);
+    _ncoStep.assign(count, 0);
+    _phase = 0;
+
+    if(_rate > 0.0)
+    {
+        for(int32_t r = 0; r < count; r++)
+        {
+            /* The rotation uses the quantized step, so it agrees with the phase accumulator */
+            const double turns = fmod(_frequency[r] / _rate, 1.0);
+            _ncoStep[r] = static_cast<uint32_t>(static_cast<int64_t>(floor(turns * PhaseScale + 0.5)));
+            const double angle = 2.0 * Pi * _ncoStep[r] / PhaseScale;
+            _rotCos[r] = cos(angle);
+            _rotSin[r] = sin(angle);
+
+            const double alpha = 1.0 - exp(-1.0 / (_rate * _timeConstant[r]));
+            for(int32_t k = 0; k < _order[r]; k++)
+                _alpha[static_cast<size_t>(k) * _lanes + r] = alpha;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_lock);
+    LockInSample none;
+    none.index = -1;
+    none.x = none.y = none.r = none.theta = 0.0;
+    _latest.assign(count, none);
+}
+
+
+DYB_Rc LockIn::push(const Flt32 *samples, const int32_t count)
+{
+    if(!(_rate > 0.0))
+        return DYB_WrongContext;
+
+    for(int32_t done = 0; done < count; )
+    {
+        int32_t n = count - done;
+        if(n > _decimation - _phase)
+            n = _decimation - _phase;
+        if(n > BlockSize)
+            n = BlockSize;
+
+        block(samples + done, n);
+        done += n;
+        _phase += n;
+        _index += n;
+        if(_phase == _decimation)
+        {
+            emit();
+            _phase = 0;
+        }
+    }
+
+    for(int32_t r = 0; r < references(); r++)
+    {
+        if(_pending[r].empty())
+            continue;
+        if(_handler)
+            _handler(r, _pending[r].data(), static_cast<int32_t>(_pending[r].size()));
+        _pending[r].clear();
+    }
+    return DYB_Ok;
+}
+
+
+DYB_Rc LockIn::push(const DataPacket &packet)
+{
+    if(_userRate == 0.0)
+    {
+        const double rate = sampleRateOf(&packet.meta);
+        if(rate != _rate)
+        {
+            _rate = rate;
+            configure();
+        }
+    }
+    if(!(_rate > 0.0))
+        return DYB_WrongContext;
+
+    /* Keep the references coherent with the time across gaps */
+    if(packet.index > _index)
+    {
+        const uint64_t gap = static_cast<uint64_t>(packet.index - _index);
+        for(int32_t r = 0; r < references(); r++)
+            _ncoPhase[r] += static_cast<uint32_t>(gap * _ncoStep[r]);
+    }
+    _index = packet.index;
+
+    Flt32 chunk[BlockSize];
+    for(int32_t done = 0; done < packet.length; )
+    {
+        const int32_t n = packet.length - done < BlockSize ? packet.length - done : BlockSize;
+        convValues2Phys(&packet.meta, packet.data + done, n, chunk);
+        const DYB_Rc rc = push(chunk, n);
+        if(rc != DYB_Ok)
+            return rc;
+        done += n;
+    }
+    return DYB_Ok;
+}
+
+
+void LockIn::block(const Flt32 *samples, const int32_t count)
+{
+    /* Exact oscillator phase at the start of every block, the rotation
+     * within the block doesn't accumulate errors over time */
+    const int32_t refs = references();
+    for(int32_t r = 0; r < refs; r++)
+    {
+        const double angle = 2.0 * Pi * _ncoPhase[r] / PhaseScale;
+        _cos[r] = cos(angle);
+        _sin[r] = sin(angle);
+        _ncoPhase[r] += static_cast<uint32_t>(static_cast<uint64_t>(count) * _ncoStep[r]);
+    }
+
+    Lanes lanes;
+    lanes.lanes = _lanes;
+    lanes.stages = _stages;
+    lanes.c = _cos.data();
+    lanes.s = _sin.data();
+    lanes.rc = _rotCos.data();
+    lanes.rs = _rotSin.data();
+    lanes.alpha = _alpha.data();
+    lanes.x = _x.data();
+    lanes.y = _y.data();
+    demod(samples, count, lanes);
+}
+
+
+void LockIn::emit()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    for(int32_t r = 0; r < references(); r++)
+    {
+        /* Output of the last stage of the reference; 2x for the amplitude */
+        const size_t at = static_cast<size_t>(_order[r] - 1) * _lanes + r;
+        LockInSample sample;
+        sample.index = _index - 1;
+        sample.x = 2.0 * _x[at];
+        sample.y = 2.0 * _y[at];
+        sample.r = sqrt(sample.x * sample.x + sample.y * sample.y);
+        sample.theta = atan2(sample.y, sample.x) * 180.0 / Pi;
+        _pending[r].push_back(sample);
+        _latest[r] = sample;
+    }
+}
+
+
+bool LockIn::latest(const int32_t reference, LockInSample &sample) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    if(reference < 0 || reference >= static_cast<int32_t>(_latest.size()) || _latest[reference].index < 0)
+        return false;
+    sample = _latest[reference];
+    return true;
+}
+
+} /* namespace asc500 */
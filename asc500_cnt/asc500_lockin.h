@@ -0,0 +1,173 @@
+/** \file asc500_lockin.h
+ * \brief Multi-reference software lock-in for ADC data channels.
+ *
+ * The LF lock-in of the controller (ID_AFM_M_FREQ, CHANADC_AFMMAMPL /
+ * CHANADC_AFMMPHASE) exists once. LockIn demodulates the samples of a timer
+ * triggered data channel (e.g. CHANADC_ADC_MIN .. CHANADC_ADC_MAX) at any
+ * number of reference frequencies in one pass over the data:
+ *
+ * - every reference has a numerically controlled oscillator: a 32 bit phase
+ *   accumulator that gives the exact phase at the start of each block, and
+ *   a complex rotation from there within the block;
+ * - the sample is mixed with cos and -sin of the reference and the products
+ *   are filtered by a cascade of 1 .. 8 first order low-pass stages
+ *   (6 dB / octave each);
+ * - every decimation samples, X, Y, R and theta of each reference are
+ *   emitted to the output handler and kept as the latest value.
+ *
+ * The references are processed side by side in the vector lanes (double
+ * precision, SSE2: 2, AVX2: 4 references per instruction), so the cost per
+ * sample is about order + 2 vector operations per 4 references. The
+ * results don't depend on the kernel used.
+ *
+ * For a signal A cos(2 pi f t + phi), X = A cos(phi), Y = A sin(phi), R = A
+ * and theta = phi, relative to the phase of the reference.
+ *
+ * References and handlers are set up by the thread that pushes the data;
+ * latest() may be called from any thread.
+ */
+
+#ifndef __ASC500_LOCKIN_H
+#define __ASC500_LOCKIN_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500_spscring.h"
+
+
+namespace asc500
+{
+
+/** Demodulated output of one reference */
+struct LockInSample
+{
+    int64_t index;             /**< Data index of the last input sample        */
+    double x;                  /**< In-phase component                         */
+    double y;                  /**< Quadrature component                       */
+    double r;                  /**< Amplitude                                  */
+    double theta;              /**< Phase [deg], -180 .. 180                   */
+};
+
+
+class LockIn
+{
+public:
+    typedef std::function<void(const int32_t reference, const LockInSample *samples,
+                               const int32_t count)> OutputHandler;
+
+    static const int32_t MaxOrder = 8;               /**< Maximum low-pass stages          */
+
+    /** \brief Create a lock-in without references.
+     *
+     * \param sampleRate const double Samples per second; 0 = take it from the meta
+     *                                data of the packets.
+     * \param decimation const int32_t Input samples per output sample.
+     *
+     */
+    explicit LockIn(const double sampleRate = 0.0, const int32_t decimation = 100);
+
+    LockIn(const LockIn &) = delete;
+    LockIn &operator=(const LockIn &) = delete;
+
+    /** \brief Add a reference.
+     *
+     * \param frequency const double Reference frequency [Hz], below half the sample rate.
+     * \param timeConstant const double Time constant of each low-pass stage [s].
+     * \param order const int32_t Number of low-pass stages (1 .. MaxOrder).
+     * \param phase const double Phase of the reference [deg].
+     * \return int32_t Number of the reference; -1 for invalid parameters.
+     *
+     */
+    int32_t addReference(const double frequency, const double timeConstant,
+                         const int32_t order = 4, const double phase = 0.0);
+
+    /** \brief Remove all references.
+     *
+     * \return void
+     *
+     */
+    void clearReferences();
+
+    /** \brief Set the handler for the decimated output.
+     *
+     * \param handler OutputHandler Called from push() once per reference with new samples.
+     * \return void
+     *
+     */
+    void onOutput(OutputHandler handler) { _handler = handler; }
+
+    /** \brief Set the sample rate; restarts the filters.
+     *
+     * \param rate const double Samples per second; 0 = take it from the meta data.
+     * \return void
+     *
+     */
+    void setSampleRate(const double rate);
+
+    /** \brief Demodulate physical samples.
+     *
+     * \param samples const Flt32* Samples.
+     * \param count const int32_t Number of samples.
+     * \return DYB_Rc DYB_WrongContext if the sample rate is unknown.
+     *
+     */
+    DYB_Rc push(const Flt32 *samples, const int32_t count);
+
+    /** \brief Demodulate a packet of the acquisition layer.
+     *
+     * \param packet const DataPacket& The packet; the data are converted to physical values.
+     * \return DYB_Rc See above.
+     *
+     */
+    DYB_Rc push(const DataPacket &packet);
+
+    /** \brief Latest output of a reference.
+     *
+     * \param reference const int32_t Number of the reference.
+     * \param sample LockInSample& Output: the latest sample.
+     * \return bool False if there is no output yet.
+     *
+     */
+    bool latest(const int32_t reference, LockInSample &sample) const;
+
+    int32_t references() const { return static_cast<int32_t>(_frequency.size()); } /**< References */
+    double sampleRate() const { return _rate; }      /**< Samples per second, 0 = unknown  */
+
+private:
+    void configure();
+    void block(const Flt32 *samples, const int32_t count);
+    void emit();
+
+    double _userRate;
+    double _rate;
+    int32_t _decimation;
+    int32_t _phase;            /* Samples since the last output               */
+    int64_t _index;            /* Data index of the next sample               */
+    OutputHandler _handler;
+
+    /* Per reference */
+    std::vector<double> _frequency;
+    std::vector<double> _timeConstant;
+    std::vector<int32_t> _order;
+    std::vector<uint32_t> _ncoPhase;
+    std::vector<uint32_t> _ncoStep;
+    std::vector<std::vector<LockInSample> > _pending;
+
+    /* Lane arrays, padded to a multiple of 4 references; the filter
+     * arrays have _stages rows of _lanes values */
+    int32_t _lanes;
+    int32_t _stages;
+    std::vector<double> _cos, _sin, _rotCos, _rotSin;
+    std::vector<double> _alpha, _x, _y;
+
+    mutable std::mutex _lock;
+    std::vector<LockInSample> _latest;
+};
+
+} /* namespace asc500 */
+
+#endif
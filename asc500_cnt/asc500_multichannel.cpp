@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <cstring>
+
+#include "daisydata.h"
+#include "asc500_multichannel.h"
+
+
+namespace asc500
+{
+
+MultiChannelAcquisition::MultiChannelAcquisition(BlockHandler handler, const AlignMode mode)
+    : _handler(handler), _mode(mode), _eventMask(0), _discarded(0), _epochTimeout(1000),
+      _newestEpoch(0)
+{
+    for(int &slot : _slotOf)
+        slot = -1;
+}
+
+
+DYB_Rc MultiChannelAcquisition::addChannel(const int32_t channel)
+{
+    if(channel < 0 || channel >= ASC500_DATA_CHANNELS || _slotOf[channel] >= 0)
+        return DYB_OutOfRange;
+
+    Stage stage;
+    stage.channel = channel;
+    stage.epoch = 0;
+    stage.started = false;
+
+    _slotOf[channel] = static_cast<int>(_stages.size());
+    _stages.push_back(stage);
+    _eventMask |= DYB_EVT_DATA_00 << channel;
+    _ids.push_back(channel);
+    return DYB_Ok;
+}
+
+
+void MultiChannelAcquisition::setEpochTimeout(const int32_t timeout)
+{
+    _epochTimeout = std::chrono::milliseconds(timeout > 0 ? timeout : 0);
+}
+
+
+void MultiChannelAcquisition::discard(Segment &segment)
+{
+    _discarded += segment.data.size() - segment.read;
+    segment.data.clear();
+    segment.read = 0;
+    segment.start = segment.next;
+}
+
+
+DYB_Rc MultiChannelAcquisition::feed(const int32_t channel, const int32_t index, const int32_t length,
+                                     const int32_t *data, const DYB_Meta *meta)
+{
+    if(channel < 0 || channel >= ASC500_DATA_CHANNELS || _slotOf[channel] < 0)
+        return DYB_OutOfRange;
+    if(length <= 0)
+        return DYB_Ok;
+
+    Stage &stage = _stages[_slotOf[channel]];
+    bool open = !stage.started || stage.segments.empty();
+
+    if(!open && index < stage.segments.back().next)
+    {
+        /* New frame or overflow reset: a new epoch begins, the old one stays
+         * staged until the other channels have delivered it as well */
+        stage.epoch++;
+        open = true;
+        if(stage.epoch > _newestEpoch)
+        {
+            _newestEpoch = stage.epoch;
+            _newestSince = Clock::now();
+        }
+    }
+    else if(!open && index > stage.segments.back().next)
+    {
+        /* Lost data: the staged range ends at the gap, the data go on in a
+         * new range of the same epoch */
+        open = true;
+    }
+
+    if(open)
+    {
+        stage.started = true;
+        stage.segments.push_back(Segment());
+        Segment &segment = stage.segments.back();
+        segment.epoch = stage.epoch;
+        segment.start = index;
+        segment.read = 0;
+        memset(&segment.meta, 0, sizeof(segment.meta));
+    }
+
+    /* Aligned items are removed only once they are the larger part, which
+     * keeps the cost linear in the data staged */
+    Segment &segment = stage.segments.back();
+    if(segment.read > 0 && 2 * segment.read >= segment.data.size())
+    {
+        segment.data.erase(segment.data.begin(), segment.data.begin() + segment.read);
+        segment.read = 0;
+    }
+    segment.data.insert(segment.data.end(), data, data + length);
+    segment.next = index + length;
+    if(meta)
+        segment.meta = *meta;
+
+    emit();
+    return DYB_Ok;
+}
+
+
+void MultiChannelAcquisition::emit()
+{
+    if(_stages.empty())
+        return;
+    for(const Stage &stage : _stages)
+        if(!stage.started)
+            return;
+
+    while(true)
+    {
+        /* Oldest epoch still staged */
+        bool any = false;
+        uint64_t oldest = 0;
+        for(const Stage &stage : _stages)
+        {
+            if(!stage.segments.empty() && (!any || stage.segments.front().epoch < oldest))
+            {
+                oldest = stage.segments.front().epoch;
+                any = true;
+            }
+        }
+        if(!any)
+            return;
+
+        bool complete = true;
+        for(const Stage &stage : _stages)
+            complete = complete && !stage.segments.empty() && stage.segments.front().epoch == oldest;
+        if(complete)
+            align(oldest);
+
+        /* The oldest epoch is closed when no channel can deliver more of it */
+        bool moved = true;
+        for(const Stage &stage : _stages)
+            moved = moved && stage.epoch > oldest;
+        const bool expired = _newestEpoch > oldest && Clock::now() - _newestSince >= _epochTimeout;
+        if(!moved && !expired)
+            return;
+
+        for(Stage &stage : _stages)
+        {
+            while(!stage.segments.empty() && stage.segments.front().epoch == oldest)
+            {
+                discard(stage.segments.front());
+                stage.segments.pop_front();
+            }
+        }
+    }
+}
+
+
+/** \brief Emit the records of an epoch that all channels have staged.
+ *
+ * A range that is followed by another one (the channel lost data) and has
+ * nothing left to match is dropped, and the channel continues with its
+ * next range, as long as that belongs to the same epoch.
+ *
+ * \param epoch const uint64_t Epoch of the front range of every channel.
+ * \return void
+ *
+ */
+void MultiChannelAcquisition::align(const uint64_t epoch)
+{
+    bool more = true;
+
+    while(more)
+    {
+        int32_t lo = _stages[0].segments.front().start,
+                hi = _stages[0].segments.front().next;
+        for(const Stage &stage : _stages)
+        {
+            lo = std::max(lo, stage.segments.front().start);
+            hi = std::min(hi, stage.segments.front().next);
+        }
+        if(hi > lo)
+            emitBlock(lo, hi);
+
+        /* Ranges ending at hi can't match anything more */
+        more = false;
+        for(Stage &stage : _stages)
+        {
+            if(stage.segments.size() > 1 && stage.segments.front().next <= hi)
+            {
+                discard(stage.segments.front());
+                stage.segments.pop_front();
+                more = true;
+            }
+        }
+        for(const Stage &stage : _stages)
+            more = more && stage.segments.front().epoch == epoch;
+    }
+}
+
+
+/** \brief Hand the records [lo, hi) to the handler and remove them.
+ *
+ * \param lo const int32_t First index, staged by every channel.
+ * \param hi const int32_t Index following the last record.
+ * \return void
+ *
+ */
+void MultiChannelAcquisition::emitBlock(const int32_t lo, const int32_t hi)
+{
+    const int32_t channels = static_cast<int32_t>(_stages.size()),
+                  count = hi - lo;
+    _values.resize(static_cast<size_t>(count) * channels);
+    _metas.resize(channels);
+
+    for(int32_t c = 0; c < channels; c++)
+    {
+        const Segment &segment = _stages[c].segments.front();
+        const int32_t *src = segment.data.data() + segment.read + (lo - segment.start);
+        int32_t *dst = _values.data() + c;
+
+        _discarded += lo - segment.start;
+        for(int32_t r = 0; r < count; r++, dst += channels)
+            *dst = src[r];
+        _metas[c] = segment.meta;
+    }
+
+    AlignedBlock block;
+    block.channels = channels;
+    block.channelIds = _ids.data();
+    block.metas = _metas.data();
+    block.firstIndex = lo;
+    block.count = count;
+    block.values = _values.data();
+    block.columns = block.lines = block.forward = NULL;
+
+    if(_mode == AlignPixel)
+    {
+        _columns.resize(count);
+        _lines.resize(count);
+        _forward.resize(count);
+        /* Every scan frame is an epoch, so the epoch gives the Y direction */
+        _grids.index2Pixel(&_metas[0], lo, count, _columns.data(), _lines.data(), _forward.data(),
+                           _stages[0].segments.front().epoch % 2 != 0);
+        block.columns = _columns.data();
+        block.lines = _lines.data();
+        block.forward = _forward.data();
+    }
+
+    _handler(block);
+
+    for(Stage &stage : _stages)
+    {
+        Segment &segment = stage.segments.front();
+        segment.read += hi - segment.start;
+        segment.start = hi;
+    }
+}
+
+
+int32_t MultiChannelAcquisition::pollBuffers(FramePool &pool, const int32_t timeout)
+{
+    int32_t buffers = 0;
+
+    if(_eventMask == 0)
+        return 0;
+    if(DYB_waitForEvent(timeout, _eventMask, 0) == 0)
+    {
+        emit();
+        return 0;
+    }
+
+    /* The event names one channel; the others may be ready as well. One
+     * buffer per channel and pass keeps the channels in step */
+    int32_t read = 0;
+    do
+    {
+        read = 0;
+        for(const Stage &stage : _stages)
+        {
+            const int32_t channel = stage.channel;
+            PooledFrame frame(pool, channel);
+            if(!frame || FramePool::fill(frame.get(), 1) != DYB_Ok)
+                continue;
+            feed(channel, frame->index, frame->dataSize, frame->data, &frame->meta);
+            read++;
+        }
+        buffers += read;
+    }
+    while(read > 0);
+    return buffers;
+}
+
+} /* namespace asc500 */
@@ -0,0 +1,190 @@
+/** \file asc500_multichannel.h
+ * \brief Synchronized acquisition of several data channels.
+ *
+ * The engine waits for the combined DYB_EVT_DATA_xx mask of all its channels
+ * and reads the ready channels round-robin, one buffer each per pass, so a
+ * channel that is drained quickly doesn't run ahead of the others. Incoming
+ * data are staged per channel and emitted as aligned blocks: one record per
+ * data index with one value per channel, so e.g. topography, phase and
+ * counter of a scan come out as one dataset.
+ *
+ * Alignment works on the data index. An index that goes backwards (a new
+ * scan frame or an overflow reset) starts a new epoch; data are only aligned
+ * among channels of the same epoch. Data of a newer epoch are kept until the
+ * older epoch is closed, which happens when all channels have reached the
+ * newer one or when the newest epoch is older than the epoch timeout. Only
+ * then the unmatched rest of the old epoch is discarded. An index that
+ * jumps ahead (lost data) closes the staged range of the channel and opens
+ * a new one at the new index: the staged data are still aligned, only the
+ * records in the gap find no partner. In pixel mode every
+ * record additionally carries its column, line and scan direction, looked up
+ * from a cached coordinate grid; the first epoch is taken as the first frame
+ * of the scan for the alternating Y direction.
+ *
+ * The engine can also be fed from the callback based Acquisition layer via
+ * feed() instead of pollBuffers().
+ */
+
+#ifndef __ASC500_MULTICHANNEL_H
+#define __ASC500_MULTICHANNEL_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500.h"
+#include "asc500_framepool.h"
+#include "asc500_gridcache.h"
+
+
+namespace asc500
+{
+
+/** \brief A block of aligned records.
+ *
+ * values holds count records of channels values each (row major).
+ * All pointers are valid during the handler call only.
+ */
+struct AlignedBlock
+{
+    int32_t channels;          /**< Number of channels (values per record)     */
+    const int32_t *channelIds; /**< Data channel of every column               */
+    const DYB_Meta *metas;     /**< Meta data of every column                  */
+    int32_t firstIndex;        /**< Data index of the first record             */
+    int32_t count;             /**< Number of records                          */
+    const int32_t *values;     /**< count * channels raw values                */
+    const int32_t *columns;    /**< Pixel mode: column of every record, else NULL */
+    const int32_t *lines;      /**< Pixel mode: line of every record, else NULL   */
+    const int32_t *forward;    /**< Pixel mode: forward flag of every record, else NULL */
+};
+
+
+class MultiChannelAcquisition
+{
+public:
+    enum AlignMode
+    {
+        AlignIndex,            /**< Records are keyed by data index            */
+        AlignPixel             /**< Records also carry pixel coordinates       */
+    };
+
+    typedef std::function<void(const AlignedBlock &)> BlockHandler;
+
+    /** \brief Create an engine.
+     *
+     * \param handler BlockHandler Receives the aligned blocks.
+     * \param mode const AlignMode Alignment mode.
+     *
+     */
+    MultiChannelAcquisition(BlockHandler handler, const AlignMode mode = AlignIndex);
+
+    /** \brief Add a channel; the order of calls defines the record layout.
+     *
+     * \param channel const int32_t Data channel (0..13).
+     * \return DYB_Rc DYB_OutOfRange if invalid or already added.
+     *
+     */
+    DYB_Rc addChannel(const int32_t channel);
+
+    /** \brief Set how long an epoch waits for lagging channels.
+     *
+     * \param timeout const int32_t Time [ms] after the begin of a newer epoch
+     *                              until the older one is closed; default 1000.
+     * \return void
+     *
+     */
+    void setEpochTimeout(const int32_t timeout);
+
+    /** \brief Combined DYB_EVT_DATA_xx mask of all channels.
+     *
+     * \return int32_t Event mask for DYB_waitForEvent.
+     *
+     */
+    int32_t eventMask() const { return _eventMask; }
+
+    /** \brief Wait for data on any channel and drain all ready channels.
+     *
+     * The channels are read round-robin, one buffer per channel and pass,
+     * until no channel has a buffer left. A timeout still closes expired
+     * epochs. Channels must be configured for buffering
+     * (DYB_configureDataBuffering).
+     *
+     * \param pool FramePool& Pool providing the frame buffers.
+     * \param timeout const int32_t Wait timeout [ms].
+     * \return int32_t Number of buffers read; 0 on timeout.
+     *
+     */
+    int32_t pollBuffers(FramePool &pool, const int32_t timeout);
+
+    /** \brief Stage a packet or buffer of a channel and emit what is aligned.
+     *
+     * \param channel const int32_t Data channel.
+     * \param index const int32_t Index of the first item.
+     * \param length const int32_t Number of items.
+     * \param data const int32_t* The data.
+     * \param meta const DYB_Meta* Meta data of the data.
+     * \return DYB_Rc DYB_OutOfRange if the channel has not been added.
+     *
+     */
+    DYB_Rc feed(const int32_t channel, const int32_t index, const int32_t length,
+                const int32_t *data, const DYB_Meta *meta);
+
+    /** \brief Records discarded because no partner data existed.
+     *
+     * \return uint64_t Discarded values summed over all channels.
+     *
+     */
+    uint64_t discarded() const { return _discarded; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Segment
+    {
+        uint64_t epoch;
+        int32_t start;           /* Index of data[read]                       */
+        int32_t next;            /* Index following the staged data           */
+        size_t read;             /* Aligned items not yet removed from data   */
+        std::vector<int32_t> data;
+        DYB_Meta meta;
+    };
+
+    struct Stage
+    {
+        int32_t channel;
+        uint64_t epoch;          /* Epoch of the newest data                  */
+        bool started;
+        std::deque<Segment> segments;    /* Staged data by ascending epoch    */
+    };
+
+    void emit();
+    void align(const uint64_t epoch);
+    void emitBlock(const int32_t lo, const int32_t hi);
+    void discard(Segment &segment);
+
+    BlockHandler _handler;
+    AlignMode _mode;
+    int32_t _eventMask;
+    uint64_t _discarded;
+    std::chrono::milliseconds _epochTimeout;
+    uint64_t _newestEpoch;
+    Clock::time_point _newestSince;      /* Begin of the newest epoch         */
+    std::vector<Stage> _stages;
+    int _slotOf[ASC500_DATA_CHANNELS];
+
+    /* Output buffers, reused between blocks */
+    std::vector<int32_t> _ids;
+    std::vector<DYB_Meta> _metas;
+    std::vector<int32_t> _values;
+    std::vector<int32_t> _columns;
+    std::vector<int32_t> _lines;
+    std::vector<int32_t> _forward;
+    CoordGridCache _grids;
+};
+
+} /* namespace asc500 */
+
+#endif
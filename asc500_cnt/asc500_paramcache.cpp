@@ -0,0 +1,160 @@
+#include <chrono>
+
+#include "asc500_events.h"
+#include "asc500_paramcache.h"
+
+
+namespace asc500
+{
+
+static int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+static uint64_t keyOf(const DYB_Address address, const int32_t index)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(address)) << 32) | static_cast<uint32_t>(index);
+}
+
+
+ParameterCache::ParameterCache(const size_t capacity)
+    : _mask(0), _token(0), _hits(0), _misses(0)
+{
+    size_t size = 16;
+    while(size < capacity)
+        size <<= 1;
+
+    _slots.reset(new Slot[size]);
+    _mask = size - 1;
+    for(size_t k = 0; k < size; k++)
+    {
+        _slots[k].key.store(Empty, std::memory_order_relaxed);
+        _slots[k].value.store(0, std::memory_order_relaxed);
+        _slots[k].stamp.store(0, std::memory_order_relaxed);
+    }
+
+    _token = EventHub::subscribe([this](const DYB_Address address, const int32_t index, const int32_t value)
+    {
+        store(address, index, value);
+    });
+}
+
+
+ParameterCache::~ParameterCache()
+{
+    EventHub::unsubscribe(_token);
+}
+
+
+ParameterCache::Slot *ParameterCache::find(const uint64_t key, const bool insert) const
+{
+    /* Open addressing with linear probing; slots are never removed */
+    size_t k = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & _mask;
+
+    for(size_t probe = 0; probe <= _mask; probe++, k = (k + 1) & _mask)
+    {
+        Slot &slot = _slots[k];
+        uint64_t current = slot.key.load(std::memory_order_acquire);
+
+        if(current == key)
+            return &slot;
+        if(current == Empty)
+        {
+            if(!insert)
+                return NULL;
+            if(slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel) || current == key)
+                return &slot;
+        }
+    }
+    return NULL;
+}
+
+
+/** \brief Record a value in a slot.
+ *
+ * \param slot Slot& The slot.
+ * \param value const int32_t Value.
+ * \param expected const int64_t Stamp the slot must still have; negative for any.
+ * \return bool False if the slot has been written since expected.
+ *
+ */
+bool ParameterCache::update(Slot &slot, const int32_t value, const int64_t expected)
+{
+    std::lock_guard<std::mutex> lock(_writeLock);
+    const int64_t stamp = slot.stamp.load(std::memory_order_relaxed);
+    if(expected >= 0 && stamp != expected)
+        return false;
+
+    /* A reader that sees the new stamp also sees the new value. The stamp
+     * increases with every write, even within the resolution of the clock */
+    const int64_t now = nowNs();
+    slot.value.store(value, std::memory_order_relaxed);
+    slot.stamp.store(now > stamp ? now : stamp + 1, std::memory_order_release);
+    return true;
+}
+
+
+void ParameterCache::store(const DYB_Address address, const int32_t index, const int32_t value)
+{
+    Slot *slot = find(keyOf(address, index), true);
+    if(slot)
+        update(*slot, value, -1);
+}
+
+
+bool ParameterCache::peek(const DYB_Address address, const int32_t index, int32_t *value,
+                          int64_t *ageUs) const
+{
+    const Slot *slot = find(keyOf(address, index), false);
+    if(!slot)
+        return false;
+
+    const int64_t stamp = slot->stamp.load(std::memory_order_acquire);
+    if(stamp == 0)
+        return false;
+
+    *value = slot->value.load(std::memory_order_relaxed);
+    if(ageUs)
+        *ageUs = (nowNs() - stamp) / 1000;
+    return true;
+}
+
+
+DYB_Rc ParameterCache::get(const DYB_Address address, const int32_t index, int32_t *value,
+                           const int64_t maxAgeUs)
+{
+    int64_t age = 0;
+    if(peek(address, index, value, maxAgeUs >= 0 ? &age : NULL) && (maxAgeUs < 0 || age <= maxAgeUs))
+    {
+        _hits.fetch_add(1, std::memory_order_relaxed);
+        return DYB_Ok;
+    }
+
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    Slot *slot = find(keyOf(address, index), true);
+    const int64_t before = slot ? slot->stamp.load(std::memory_order_acquire) : 0;
+    const DYB_Rc rc = DYB_getParameterSync(address, index, value);
+
+    /* An event during the round trip is newer than the read back; keep and return it */
+    if(rc == DYB_Ok && slot && !update(*slot, *value, before))
+        peek(address, index, value);
+    return rc;
+}
+
+
+DYB_Rc ParameterCache::prefetch(const DYB_Address address, const int32_t index)
+{
+    return DYB_getParameterAsync(address, index);
+}
+
+
+void ParameterCache::invalidate()
+{
+    for(size_t k = 0; k <= _mask; k++)
+        _slots[k].stamp.store(0, std::memory_order_release);
+}
+
+} /* namespace asc500 */
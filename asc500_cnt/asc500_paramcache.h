@@ -0,0 +1,121 @@
+/** \file asc500_paramcache.h
+ * \brief Local shadow copy of the controller parameters.
+ *
+ * Every DYB_getParameterSync is a round trip to the server. The server
+ * however pushes every parameter change (by any client) as an event, so a
+ * local copy can be kept current: ParameterCache subscribes to the EventHub
+ * and records the last value of every (address, index) it sees. Reads are
+ * served from a lock free table; parameters that have not been seen yet are
+ * read synchronously once and cached from then on.
+ *
+ * A read may demand a maximum age; older values are refreshed by a
+ * synchronous read. Values change only by events, so a cached value is as
+ * current as the event stream. An event that arrives while a synchronous
+ * read is under way is newer than the read back and is kept.
+ */
+
+#ifndef __ASC500_PARAMCACHE_H
+#define __ASC500_PARAMCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "daisybase.h"
+
+
+namespace asc500
+{
+
+class ParameterCache
+{
+public:
+    /** \brief Create a cache and subscribe to the event stream.
+     *
+     * \param capacity const size_t Number of (address, index) pairs kept;
+     *                 rounded up to a power of 2.
+     *
+     */
+    explicit ParameterCache(const size_t capacity = 4096);
+    ~ParameterCache();
+
+    ParameterCache(const ParameterCache &) = delete;
+    ParameterCache &operator=(const ParameterCache &) = delete;
+
+    /** \brief Read a parameter.
+     *
+     * Falls back to DYB_getParameterSync if the value is unknown or older
+     * than maxAgeUs; must not be called from a callback in that case.
+     *
+     * \param address const DYB_Address Parameter address.
+     * \param index const int32_t Subaddress, 0 if not applicable.
+     * \param value int32_t* Output: parameter value.
+     * \param maxAgeUs const int64_t Maximum age [us], negative for any age.
+     * \return DYB_Rc Result of DYB_getParameterSync if it was needed.
+     *
+     */
+    DYB_Rc get(const DYB_Address address, const int32_t index, int32_t *value,
+               const int64_t maxAgeUs = -1);
+
+    /** \brief Read a cached value without falling back.
+     *
+     * \param address const DYB_Address Parameter address.
+     * \param index const int32_t Subaddress.
+     * \param value int32_t* Output: parameter value.
+     * \param ageUs int64_t* Output: time since the value arrived [us], may be NULL.
+     * \return bool False if the value is not cached.
+     *
+     */
+    bool peek(const DYB_Address address, const int32_t index, int32_t *value,
+              int64_t *ageUs = NULL) const;
+
+    /** \brief Request a parameter asynchronously; the answer fills the cache.
+     *
+     * \param address const DYB_Address Parameter address.
+     * \param index const int32_t Subaddress.
+     * \return DYB_Rc Result of DYB_getParameterAsync.
+     *
+     */
+    DYB_Rc prefetch(const DYB_Address address, const int32_t index);
+
+    /** \brief Record a value, as done for every event.
+     *
+     * \param address const DYB_Address Parameter address.
+     * \param index const int32_t Subaddress.
+     * \param value const int32_t Value.
+     * \return void
+     *
+     */
+    void store(const DYB_Address address, const int32_t index, const int32_t value);
+
+    /** \brief Forget all values; they are read synchronously again. */
+    void invalidate();
+
+    uint64_t hits() const { return _hits.load(std::memory_order_relaxed); }     /**< Reads served locally */
+    uint64_t misses() const { return _misses.load(std::memory_order_relaxed); } /**< Synchronous reads     */
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> key;     /* Address and index, Empty if unused   */
+        std::atomic<int32_t> value;
+        std::atomic<int64_t> stamp;    /* Arrival [ns], 0 while invalid        */
+    };
+
+    static const uint64_t Empty = ~0ULL;
+
+    Slot *find(const uint64_t key, const bool insert) const;
+    bool update(Slot &slot, const int32_t value, const int64_t expected);
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask;
+    int32_t _token;
+    std::mutex _writeLock;     /* Serializes the writers, readers are lock free */
+    std::atomic<uint64_t> _hits;
+    std::atomic<uint64_t> _misses;
+};
+
+} /* namespace asc500 */
+
+#endif
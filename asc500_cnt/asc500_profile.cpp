@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "asc500_batch.h"
+#include "asc500_profile.h"
+
+
+namespace asc500
+{
+
+static const char CompiledMagic[4] = { 'A', '5', 'P', 'B' };
+static const uint32_t CompiledVersion = 1;
+
+/* Header of a compiled profile, followed by count ProfileEntry */
+struct CompiledHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t entryBytes;
+    uint64_t hash;
+    uint8_t reserved[8];
+};
+
+static_assert(sizeof(CompiledHeader) == 32, "Compiled profile header layout");
+static_assert(sizeof(ProfileEntry) == 12, "Compiled profile entry layout");
+
+
+/** \brief Value of an attribute within a tag.
+ *
+ * \param tag const std::string& Text of the tag.
+ * \param name const char* Attribute name.
+ * \param value int32_t& Output: decimal or 0x prefixed hexadecimal value.
+ * \return bool False if missing or not a number.
+ *
+ */
+static bool attribute(const std::string &tag, const char *name, int32_t &value)
+{
+    const std::string key = std::string(" ") + name + "=\"";
+    const size_t start = tag.find(key);
+    if(start == std::string::npos)
+        return false;
+
+    const char *text = tag.c_str() + start + key.size();
+    const bool hex = text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+    char *end = NULL;
+
+    /* Hex values are bit patterns and may exceed the signed range */
+    value = static_cast<int32_t>(hex ? strtoul(text, &end, 16) : strtol(text, &end, 10));
+    return end != text && *end == '"';
+}
+
+
+DYB_Rc Profile::load(const std::string &fileName)
+{
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    if(!file)
+        return DYB_FileNotFound;
+
+    std::ostringstream text;
+    text << file.rdbuf();
+    return parse(text.str());
+}
+
+
+DYB_Rc Profile::parse(const std::string &text)
+{
+    _entries.clear();
+
+    size_t pos = 0;
+    while((pos = text.find("<Persist ", pos)) != std::string::npos)
+    {
+        const size_t end = text.find('>', pos);
+        if(end == std::string::npos)
+            return DYB_XmlError;
+
+        const std::string tag = text.substr(pos, end - pos);
+        ProfileEntry entry;
+        if(!attribute(tag, "Addr", entry.address) || !attribute(tag, "Index", entry.index) ||
+           !attribute(tag, "Value", entry.value))
+            return DYB_XmlError;
+
+        _entries.push_back(entry);
+        pos = end;
+    }
+    return DYB_Ok;
+}
+
+
+/** \brief Entries sorted by (address, index); of repeated parameters the last one wins.
+ *
+ * Used for sending and compiling alike, so both apply the same state.
+ *
+ * \param entries const std::vector<ProfileEntry>& Entries in file order.
+ * \return std::vector<ProfileEntry> Unique entries.
+ *
+ */
+static std::vector<ProfileEntry> uniqueEntries(const std::vector<ProfileEntry> &entries)
+{
+    std::vector<ProfileEntry> table(entries);
+    std::stable_sort(table.begin(), table.end(), [](const ProfileEntry &a, const ProfileEntry &b)
+    {
+        return a.address != b.address ? a.address < b.address : a.index < b.index;
+    });
+
+    size_t count = 0;
+    for(size_t k = 0; k < table.size(); k++)
+    {
+        if(count > 0 && table[count - 1].address == table[k].address && table[count - 1].index == table[k].index)
+            table[count - 1] = table[k];
+        else
+            table[count++] = table[k];
+    }
+    table.resize(count);
+    return table;
+}
+
+
+static DYB_Rc diffEntries(const ProfileEntry *entries, const size_t count, ParameterCache &cache,
+                          std::vector<ProfileChange> &changes, const int32_t timeout)
+{
+    std::vector<size_t> unknown;
+    int32_t value = 0;
+    DYB_Rc rc = DYB_Ok;
+
+    changes.clear();
+
+    /* Request everything unknown at once, the answers arrive as events */
+    for(size_t k = 0; k < count; k++)
+    {
+        if(!cache.peek(entries[k].address, entries[k].index, &value))
+        {
+            cache.prefetch(entries[k].address, entries[k].index);
+            unknown.push_back(k);
+        }
+    }
+
+    const std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    while(!unknown.empty() && std::chrono::steady_clock::now() < deadline)
+    {
+        const ProfileEntry &last = entries[unknown.back()];
+        if(cache.peek(last.address, last.index, &value))
+            unknown.pop_back();
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for(size_t k = 0; k < count; k++)
+    {
+        const ProfileEntry &entry = entries[k];
+        /* Falls back to a synchronous read for anything still missing */
+        const DYB_Rc got = cache.get(entry.address, entry.index, &value);
+        if(got != DYB_Ok)
+        {
+            if(rc == DYB_Ok)
+                rc = got;
+            continue;
+        }
+        if(value != entry.value)
+        {
+            ProfileChange change;
+            change.address = entry.address;
+            change.index = entry.index;
+            change.oldValue = value;
+            change.newValue = entry.value;
+            change.returned = value;
+            change.acknowledged = false;
+            changes.push_back(change);
+        }
+    }
+    return rc;
+}
+
+
+static DYB_Rc applyEntries(const ProfileEntry *entries, const size_t count, ParameterCache &cache,
+                           std::vector<ProfileChange> &changes, const int32_t timeout)
+{
+    DYB_Rc rc = diffEntries(entries, count, cache, changes, timeout);
+    if(rc != DYB_Ok || changes.empty())
+        return rc;
+
+    std::vector<ParamEntry> batch(changes.size());
+    for(size_t k = 0; k < changes.size(); k++)
+    {
+        batch[k].address = changes[k].address;
+        batch[k].index = changes[k].index;
+        batch[k].value = changes[k].newValue;
+        batch[k].returned = changes[k].oldValue;
+        batch[k].acknowledged = false;
+    }
+
+    rc = setParameterBatch(batch.data(), batch.size(), timeout);
+    for(size_t k = 0; k < changes.size(); k++)
+    {
+        changes[k].returned = batch[k].returned;
+        changes[k].acknowledged = batch[k].acknowledged;
+    }
+    return rc;
+}
+
+
+DYB_Rc diffProfile(const Profile &profile, ParameterCache &cache,
+                   std::vector<ProfileChange> &changes, const int32_t timeout)
+{
+    const std::vector<ProfileEntry> entries = uniqueEntries(profile.entries());
+    return diffEntries(entries.data(), entries.size(), cache, changes, timeout);
+}
+
+
+DYB_Rc diffProfile(const CompiledProfile &profile, ParameterCache &cache,
+                   std::vector<ProfileChange> &changes, const int32_t timeout)
+{
+    return diffEntries(profile.entries(), profile.size(), cache, changes, timeout);
+}
+
+
+DYB_Rc applyProfileDelta(const Profile &profile, ParameterCache &cache,
+                         std::vector<ProfileChange> &changes, const int32_t timeout)
+{
+    const std::vector<ProfileEntry> entries = uniqueEntries(profile.entries());
+    return applyEntries(entries.data(), entries.size(), cache, changes, timeout);
+}
+
+
+DYB_Rc applyProfileDelta(const CompiledProfile &profile, ParameterCache &cache,
+                         std::vector<ProfileChange> &changes, const int32_t timeout)
+{
+    if(profileMatches(profile, cache))
+    {
+        changes.clear();
+        return DYB_Ok;
+    }
+    return applyEntries(profile.entries(), profile.size(), cache, changes, timeout);
+}
+
+
+/* ----------------------------------------------------------------------
+ *  Compiled profiles
+ * ---------------------------------------------------------------------- */
+
+static uint64_t hashStep(uint64_t hash, const uint32_t field)
+{
+    hash ^= field;
+    return hash * 1099511628211ULL;
+}
+
+
+uint64_t profileHash(const ProfileEntry *entries, const size_t count)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(size_t k = 0; k < count; k++)
+    {
+        hash = hashStep(hash, static_cast<uint32_t>(entries[k].address));
+        hash = hashStep(hash, static_cast<uint32_t>(entries[k].index));
+        hash = hashStep(hash, static_cast<uint32_t>(entries[k].value));
+    }
+    return hash;
+}
+
+
+bool profileMatches(const CompiledProfile &profile, const ParameterCache &cache)
+{
+    const ProfileEntry *entries = profile.entries();
+    uint64_t hash = 14695981039346656037ULL;
+    int32_t value = 0;
+
+    for(size_t k = 0; k < profile.size(); k++)
+    {
+        if(!cache.peek(entries[k].address, entries[k].index, &value))
+            return false;
+        hash = hashStep(hash, static_cast<uint32_t>(entries[k].address));
+        hash = hashStep(hash, static_cast<uint32_t>(entries[k].index));
+        hash = hashStep(hash, static_cast<uint32_t>(value));
+    }
+    return profile.size() > 0 && hash == profile.hash();
+}
+
+
+DYB_Rc compileProfile(const Profile &profile, const std::string &fileName)
+{
+    const std::vector<ProfileEntry> table = uniqueEntries(profile.entries());
+    const size_t count = table.size();
+
+    CompiledHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CompiledMagic, sizeof(CompiledMagic));
+    header.version = CompiledVersion;
+    header.count = static_cast<uint32_t>(count);
+    header.entryBytes = sizeof(ProfileEntry);
+    header.hash = profileHash(table.data(), count);
+
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if(!file)
+        return DYB_OpenError;
+
+    const bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                    (count == 0 || fwrite(table.data(), sizeof(ProfileEntry), count, file) == count);
+    return fclose(file) == 0 && ok ? DYB_Ok : DYB_Error;
+}
+
+
+CompiledProfile::CompiledProfile()
+    : _entries(NULL), _count(0), _hash(0)
+{
+}
+
+
+DYB_Rc CompiledProfile::open(const std::string &fileName)
+{
+    close();
+    const DYB_Rc rc = _file.open(fileName);
+    if(rc != DYB_Ok)
+        return rc;
+
+    CompiledHeader header;
+    if(_file.size() < sizeof(header))
+    {
+        close();
+        return DYB_Error;
+    }
+    memcpy(&header, _file.data(), sizeof(header));
+
+    const ProfileEntry *entries = reinterpret_cast<const ProfileEntry *>(_file.data() + sizeof(header));
+    if(memcmp(header.magic, CompiledMagic, sizeof(CompiledMagic)) != 0 ||
+       header.version != CompiledVersion || header.entryBytes != sizeof(ProfileEntry) ||
+       _file.size() != sizeof(header) + static_cast<uint64_t>(header.count) * sizeof(ProfileEntry) ||
+       profileHash(entries, header.count) != header.hash)
+    {
+        close();
+        return DYB_Error;
+    }
+
+    _entries = entries;
+    _count = header.count;
+    _hash = header.hash;
+    return DYB_Ok;
+}
+
+
+void CompiledProfile::close()
+{
+    _file.close();
+    _entries = NULL;
+    _count = 0;
+    _hash = 0;
+}
+
+} /* namespace asc500 */
@@ -0,0 +1,202 @@
+/** \file asc500_profile.h
+ * \brief Applying a profile (.ngp) as a delta to the current state.
+ *
+ * DYB_sendProfile transmits every parameter of a profile, may run several
+ * seconds and causes a change notification for each of them. Usually only
+ * a few of the <Persist Addr Index Value> entries differ from the values in
+ * place. applyProfileDelta reads the current values (from the
+ * ParameterCache; unknown ones are requested all at once), compares them
+ * with the profile and sends only the differing entries as one batch
+ * (see asc500_batch.h).
+ *
+ * Only the Persistence section is applied; panel, settings and aliases of a
+ * profile concern the GUI and are ignored.
+ *
+ * compileProfile stores the entries of a profile as a binary table sorted by
+ * (address, index), 12 bytes per entry, together with an FNV-1a hash of the
+ * table. CompiledProfile maps such a file and hands the table out without
+ * parsing. If a parameter occurs more than once in a profile, the last value
+ * is kept; diffProfile and applyProfileDelta treat a Profile the same way,
+ * so both paths send the same state in the same order. profileMatches
+ * compares the hash with the cached state, so a profile that is already in
+ * place is skipped without sending anything.
+ */
+
+#ifndef __ASC500_PROFILE_H
+#define __ASC500_PROFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500_filereader.h"
+#include "asc500_paramcache.h"
+
+
+namespace asc500
+{
+
+/** \brief A persistent parameter of a profile.
+ */
+struct ProfileEntry
+{
+    DYB_Address address;       /**< Parameter address                          */
+    int32_t index;             /**< Subaddress                                 */
+    int32_t value;             /**< Value in the profile                       */
+};
+
+
+/** \brief A parameter that differs between profile and controller.
+ */
+struct ProfileChange
+{
+    DYB_Address address;       /**< Parameter address                          */
+    int32_t index;             /**< Subaddress                                 */
+    int32_t oldValue;          /**< Value before                               */
+    int32_t newValue;          /**< Value in the profile                       */
+    int32_t returned;          /**< Value acknowledged by the server           */
+    bool acknowledged;         /**< The change has been acknowledged           */
+};
+
+
+class Profile
+{
+public:
+    /** \brief Read the Persist entries of a profile file.
+     *
+     * \param fileName const std::string& Profile (.ngp).
+     * \return DYB_Rc DYB_FileNotFound if not readable, DYB_XmlError if an
+     *         entry can't be parsed.
+     *
+     */
+    DYB_Rc load(const std::string &fileName);
+
+    /** \brief Parse the Persist entries from the text of a profile.
+     *
+     * \param text const std::string& Content of a profile.
+     * \return DYB_Rc DYB_XmlError if an entry can't be parsed.
+     *
+     */
+    DYB_Rc parse(const std::string &text);
+
+    /** \brief The entries in file order.
+     *
+     * \return const std::vector<ProfileEntry>& Entries.
+     *
+     */
+    const std::vector<ProfileEntry> &entries() const { return _entries; }
+
+private:
+    std::vector<ProfileEntry> _entries;
+};
+
+
+class CompiledProfile
+{
+public:
+    CompiledProfile();
+
+    /** \brief Map a compiled profile.
+     *
+     * \param fileName const std::string& File written by compileProfile().
+     * \return DYB_Rc DYB_OpenError if not readable, DYB_Error if the
+     *         format or the hash doesn't match.
+     *
+     */
+    DYB_Rc open(const std::string &fileName);
+
+    /** \brief Unmap the file. */
+    void close();
+
+    const ProfileEntry *entries() const { return _entries; }   /**< Sorted by (address, index) */
+    size_t size() const { return _count; }                     /**< Number of entries          */
+    uint64_t hash() const { return _hash; }                    /**< Hash of the entries        */
+
+private:
+    MappedFile _file;
+    const ProfileEntry *_entries;
+    size_t _count;
+    uint64_t _hash;
+};
+
+
+/** \brief Write a profile as a compiled profile.
+ *
+ * \param profile const Profile& Parsed profile.
+ * \param fileName const std::string& Output file.
+ * \return DYB_Rc DYB_OpenError if the file can't be created, DYB_Error on
+ *         write errors.
+ *
+ */
+DYB_Rc compileProfile(const Profile &profile, const std::string &fileName);
+
+/** \brief Hash of a table of entries (FNV-1a over the 32 bit fields).
+ *
+ * \param entries const ProfileEntry* Entries.
+ * \param count const size_t Number of entries.
+ * \return uint64_t Hash.
+ *
+ */
+uint64_t profileHash(const ProfileEntry *entries, const size_t count);
+
+/** \brief Check from the cache whether a profile is in place.
+ *
+ * Doesn't communicate: returns false as soon as a value is not cached.
+ *
+ * \param profile const CompiledProfile& The profile.
+ * \param cache const ParameterCache& Shadow of the current values.
+ * \return bool True if all cached values hash like the profile.
+ *
+ */
+bool profileMatches(const CompiledProfile &profile, const ParameterCache &cache);
+
+
+/** \brief Compare a profile with the current parameter values.
+ *
+ * Values not in the cache are requested with DYB_getParameterAsync in one
+ * go; those still missing after the timeout are read synchronously.
+ * Must not be called in the context of a callback.
+ *
+ * \param profile const Profile& The profile.
+ * \param cache ParameterCache& Shadow of the current values.
+ * \param changes std::vector<ProfileChange>& Output: differing entries.
+ * \param timeout const int32_t Wait for the answers [ms].
+ * \return DYB_Rc Error of the synchronous reads, if any.
+ *
+ */
+DYB_Rc diffProfile(const Profile &profile, ParameterCache &cache,
+                   std::vector<ProfileChange> &changes, const int32_t timeout = 1000);
+
+/** \brief Compare a compiled profile with the current parameter values.
+ *
+ * As diffProfile() for a Profile.
+ *
+ */
+DYB_Rc diffProfile(const CompiledProfile &profile, ParameterCache &cache,
+                   std::vector<ProfileChange> &changes, const int32_t timeout = 1000);
+
+/** \brief Send only the entries of a profile that differ from the current values.
+ *
+ * \param profile const Profile& The profile.
+ * \param cache ParameterCache& Shadow of the current values.
+ * \param changes std::vector<ProfileChange>& Output: entries that have been sent.
+ * \param timeout const int32_t Wait for the answers and acknowledgements [ms].
+ * \return DYB_Rc Result of diffProfile or setParameterBatch.
+ *
+ */
+DYB_Rc applyProfileDelta(const Profile &profile, ParameterCache &cache,
+                         std::vector<ProfileChange> &changes, const int32_t timeout = 1000);
+
+/** \brief Send the entries of a compiled profile that differ from the current values.
+ *
+ * Returns at once without changes if profileMatches(). Otherwise as
+ * applyProfileDelta() for a Profile.
+ *
+ */
+DYB_Rc applyProfileDelta(const CompiledProfile &profile, ParameterCache &cache,
+                         std::vector<ProfileChange> &changes, const int32_t timeout = 1000);
+
+} /* namespace asc500 */
+
+#endif
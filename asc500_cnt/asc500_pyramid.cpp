@@ -0,0 +1,269 @@
+#include <cstring>
+#include <limits>
+
+#include "asc500_pyramid.h"
+#include "asc500_simd.h"
+
+
+namespace asc500
+{
+
+/* ---------------------------------------------------------------------------
+ *  2x2 reduction kernels: out[j] = NaN ignoring mean of
+ *  a[2j], a[2j+1], b[2j], b[2j+1] for j in [first, last)
+ * ------------------------------------------------------------------------- */
+
+static void reduceScalar(const Flt32 *a, const Flt32 *b, const int32_t first,
+                         const int32_t last, Flt32 *out)
+{
+    for(int32_t j = first; j < last; j++)
+    {
+        const Flt32 v[4] = { a[2 * j], a[2 * j + 1], b[2 * j], b[2 * j + 1] };
+        Flt32 sum = 0.0f,
+              count = 0.0f;
+
+        /* Same order of additions as the vector kernels */
+        for(int k = 0; k < 4; k++)
+        {
+            if(v[k] == v[k])
+            {
+                sum += v[k];
+                count += 1.0f;
+            }
+        }
+        out[j] = sum / count;      /* 0 / 0 = NaN if nothing is valid */
+    }
+}
+
+
+#ifdef ASC500_SSE2
+static void reduceSse2(const Flt32 *a, const Flt32 *b, const int32_t first,
+                       const int32_t last, Flt32 *out)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    int32_t j = first;
+
+    for(; j + 4 <= last; j += 4)
+    {
+        const __m128 a0 = _mm_loadu_ps(a + 2 * j), a1 = _mm_loadu_ps(a + 2 * j + 4),
+                     b0 = _mm_loadu_ps(b + 2 * j), b1 = _mm_loadu_ps(b + 2 * j + 4);
+        const __m128 v[4] = { _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)),
+                              _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)),
+                              _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)),
+                              _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)) };
+        __m128 sum = _mm_setzero_ps(),
+               count = _mm_setzero_ps();
+        for(int k = 0; k < 4; k++)
+        {
+            const __m128 valid = _mm_cmpord_ps(v[k], v[k]);
+            sum = _mm_add_ps(sum, _mm_and_ps(valid, v[k]));
+            count = _mm_add_ps(count, _mm_and_ps(valid, one));
+        }
+        _mm_storeu_ps(out + j, _mm_div_ps(sum, count));
+    }
+    reduceScalar(a, b, j, last, out);
+}
+#endif
+
+
+#ifdef ASC500_AVX2
+ASC500_TARGET_AVX2
+static __m256 evenOdd(const __m256 lo, const __m256 hi, const bool odd)
+{
+    /* Shuffles work per 128 bit lane; restore the element order afterwards */
+    const __m256 mixed = odd ? _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1))
+                             : _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(mixed), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+
+ASC500_TARGET_AVX2
+static void reduceAvx2(const Flt32 *a, const Flt32 *b, const int32_t first,
+                       const int32_t last, Flt32 *out)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    int32_t j = first;
+
+    for(; j + 8 <= last; j += 8)
+    {
+        const __m256 a0 = _mm256_loadu_ps(a + 2 * j), a1 = _mm256_loadu_ps(a + 2 * j + 8),
+                     b0 = _mm256_loadu_ps(b + 2 * j), b1 = _mm256_loadu_ps(b + 2 * j + 8);
+        const __m256 v[4] = { evenOdd(a0, a1, false), evenOdd(a0, a1, true),
+                              evenOdd(b0, b1, false), evenOdd(b0, b1, true) };
+        __m256 sum = _mm256_setzero_ps(),
+               count = _mm256_setzero_ps();
+        for(int k = 0; k < 4; k++)
+        {
+            const __m256 valid = _mm256_cmp_ps(v[k], v[k], _CMP_ORD_Q);
+            sum = _mm256_add_ps(sum, _mm256_and_ps(valid, v[k]));
+            count = _mm256_add_ps(count, _mm256_and_ps(valid, one));
+        }
+        _mm256_storeu_ps(out + j, _mm256_div_ps(sum, count));
+    }
+    reduceScalar(a, b, j, last, out);
+}
+#endif
+
+
+static void reduce(const Flt32 *a, const Flt32 *b, const int32_t first,
+                   const int32_t last, Flt32 *out)
+{
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+        return reduceAvx2(a, b, first, last, out);
+#endif
+#ifdef ASC500_SSE2
+    reduceSse2(a, b, first, last, out);
+#else
+    reduceScalar(a, b, first, last, out);
+#endif
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Pyramid
+ * ------------------------------------------------------------------------- */
+
+ImagePyramid::ImagePyramid(const int32_t minSize)
+    : _minSize(minSize > 0 ? minSize : 1), _version(0)
+{
+}
+
+
+DYB_Rc ImagePyramid::reset(const int32_t columns, const int32_t rows)
+{
+    if(columns <= 0 || rows <= 0)
+        return DYB_OutOfRange;
+
+    std::lock_guard<std::mutex> lock(_lock);
+    build(columns, rows);
+    return DYB_Ok;
+}
+
+
+void ImagePyramid::build(const int32_t columns, const int32_t rows)
+{
+    _levels.clear();
+
+    Level level;
+    level.columns = columns;
+    level.rows = rows;
+    for(;;)
+    {
+        level.data.assign(static_cast<size_t>(level.columns) * level.rows,
+                          std::numeric_limits<Flt32>::quiet_NaN());
+        _levels.push_back(level);
+        if((level.columns <= _minSize && level.rows <= _minSize) || (level.columns == 1 && level.rows == 1))
+            break;
+        level.columns = (level.columns + 1) / 2;
+        level.rows = (level.rows + 1) / 2;
+    }
+    _version.fetch_add(1, std::memory_order_release);
+}
+
+
+DYB_Rc ImagePyramid::update(const Flt32 *image, const int32_t columns, const int32_t rows,
+                            const int32_t row, const int32_t count)
+{
+    return updateRegion(image, columns, rows, 0, row, columns, count);
+}
+
+
+DYB_Rc ImagePyramid::updateRegion(const Flt32 *image, const int32_t columns, const int32_t rows,
+                                  const int32_t x, const int32_t y, const int32_t width, const int32_t height)
+{
+    if(x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > columns || y + height > rows)
+        return DYB_OutOfRange;
+
+    std::lock_guard<std::mutex> lock(_lock);
+    if(_levels.empty() || columns != _levels[0].columns || rows != _levels[0].rows)
+        build(columns, rows);
+
+    Level &base = _levels[0];
+    for(int32_t r = y; r < y + height; r++)
+    {
+        const size_t offset = static_cast<size_t>(r) * columns + x;
+        memcpy(base.data.data() + offset, image + offset, width * sizeof(Flt32));
+    }
+
+    /* The dirty rectangle [x0, x1) x [y0, y1) shrinks by half per level */
+    int32_t x0 = x, x1 = x + width,
+            y0 = y, y1 = y + height;
+    std::vector<Flt32> pad;
+    for(size_t k = 1; k < _levels.size(); k++)
+    {
+        const Level &src = _levels[k - 1];
+        Level &dst = _levels[k];
+        x0 /= 2;
+        y0 /= 2;
+        x1 = (x1 + 1) / 2;
+        y1 = (y1 + 1) / 2;
+
+        /* Full pairs only; a missing last row is padded with NaN, the
+         * missing last column is handled separately */
+        const int32_t pairs = src.columns / 2,
+                      inner = x1 < pairs ? x1 : pairs;
+        pad.assign(2 * static_cast<size_t>(dst.columns), std::numeric_limits<Flt32>::quiet_NaN());
+
+        for(int32_t r = y0; r < y1; r++)
+        {
+            const Flt32 *a = src.data.data() + static_cast<size_t>(2 * r) * src.columns;
+            const Flt32 *b = 2 * r + 1 < src.rows ? a + src.columns : pad.data();
+            Flt32 *out = dst.data.data() + static_cast<size_t>(r) * dst.columns;
+
+            if(x0 < inner)
+                reduce(a, b, x0, inner, out);
+            if(x1 > pairs)
+            {
+                /* Odd width: the last output pixel covers one column */
+                const Flt32 edgeA[2] = { a[src.columns - 1], std::numeric_limits<Flt32>::quiet_NaN() },
+                            edgeB[2] = { b[src.columns - 1], std::numeric_limits<Flt32>::quiet_NaN() };
+                reduceScalar(edgeA, edgeB, 0, 1, out + pairs);
+            }
+        }
+    }
+
+    _version.fetch_add(1, std::memory_order_release);
+    return DYB_Ok;
+}
+
+
+DYB_Rc ImagePyramid::region(const int32_t level, const int32_t x, const int32_t y,
+                            const int32_t width, const int32_t height, Flt32 *out) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    if(level < 0 || level >= static_cast<int32_t>(_levels.size()))
+        return DYB_OutOfRange;
+
+    const Level &src = _levels[level];
+    if(x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > src.columns || y + height > src.rows)
+        return DYB_OutOfRange;
+
+    for(int32_t r = 0; r < height; r++)
+        memcpy(out + static_cast<size_t>(r) * width,
+               src.data.data() + static_cast<size_t>(y + r) * src.columns + x, width * sizeof(Flt32));
+    return DYB_Ok;
+}
+
+
+int32_t ImagePyramid::levels() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return static_cast<int32_t>(_levels.size());
+}
+
+
+int32_t ImagePyramid::columns(const int32_t level) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return level >= 0 && level < static_cast<int32_t>(_levels.size()) ? _levels[level].columns : 0;
+}
+
+
+int32_t ImagePyramid::rows(const int32_t level) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return level >= 0 && level < static_cast<int32_t>(_levels.size()) ? _levels[level].rows : 0;
+}
+
+} /* namespace asc500 */
@@ -0,0 +1,147 @@
+/** \file asc500_pyramid.h
+ * \brief Multi-resolution pyramid of a frame under acquisition.
+ *
+ * Redrawing a large scan from the full resolution frame on every partial
+ * update doesn't keep up with the acquisition. ImagePyramid keeps a copy of
+ * the frame (level 0) and successively 2x downsampled levels down to a
+ * minimum size. An update of a region (typically the line that has just
+ * been completed, see FrameAssembler) only recomputes the pixels of the
+ * coarser levels that cover this region.
+ *
+ * A pixel of level k + 1 is the mean of the up to four pixels of level k it
+ * covers, ignoring NaN (not yet scanned); it is NaN only if all of them are.
+ * Odd sizes round up, the last column / row then covers one pixel less. The
+ * reduction uses SSE2 / AVX2 kernels (see asc500_simd.h) with results
+ * identical to the scalar code.
+ *
+ * update() and region() may be called from different threads; region()
+ * copies under the lock, so a viewer always gets a consistent region.
+ */
+
+#ifndef __ASC500_PYRAMID_H
+#define __ASC500_PYRAMID_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "daisybase.h"
+
+
+namespace asc500
+{
+
+class ImagePyramid
+{
+public:
+    /** \brief Create an empty pyramid.
+     *
+     * \param minSize const int32_t Levels are added while the previous one is wider or higher.
+     *
+     */
+    explicit ImagePyramid(const int32_t minSize = 64);
+
+    ImagePyramid(const ImagePyramid &) = delete;
+    ImagePyramid &operator=(const ImagePyramid &) = delete;
+
+    /** \brief Set the size of level 0; all levels become NaN.
+     *
+     * \param columns const int32_t Width of the frame.
+     * \param rows const int32_t Height of the frame.
+     * \return DYB_Rc DYB_OutOfRange for an empty size.
+     *
+     */
+    DYB_Rc reset(const int32_t columns, const int32_t rows);
+
+    /** \brief Take over complete rows of a frame.
+     *
+     * \param image const Flt32* The frame, rows * columns values.
+     * \param columns const int32_t Width of the frame.
+     * \param rows const int32_t Height of the frame; another size resets the pyramid.
+     * \param row const int32_t First row to take over.
+     * \param count const int32_t Number of rows.
+     * \return DYB_Rc DYB_OutOfRange if the rows are outside of the frame.
+     *
+     */
+    DYB_Rc update(const Flt32 *image, const int32_t columns, const int32_t rows,
+                  const int32_t row, const int32_t count = 1);
+
+    /** \brief Take over a rectangle of a frame.
+     *
+     * \param image const Flt32* The frame, rows * columns values.
+     * \param columns const int32_t Width of the frame.
+     * \param rows const int32_t Height of the frame; another size resets the pyramid.
+     * \param x const int32_t Left column of the rectangle.
+     * \param y const int32_t Top row of the rectangle.
+     * \param width const int32_t Width of the rectangle.
+     * \param height const int32_t Height of the rectangle.
+     * \return DYB_Rc DYB_OutOfRange if the rectangle is outside of the frame.
+     *
+     */
+    DYB_Rc updateRegion(const Flt32 *image, const int32_t columns, const int32_t rows,
+                        const int32_t x, const int32_t y, const int32_t width, const int32_t height);
+
+    /** \brief Copy a rectangle of a level.
+     *
+     * \param level const int32_t Level, 0 = full resolution.
+     * \param x const int32_t Left column.
+     * \param y const int32_t Top row.
+     * \param width const int32_t Width.
+     * \param height const int32_t Height.
+     * \param out Flt32* Output: height * width values, row by row.
+     * \return DYB_Rc DYB_OutOfRange if the rectangle is outside of the level.
+     *
+     */
+    DYB_Rc region(const int32_t level, const int32_t x, const int32_t y,
+                  const int32_t width, const int32_t height, Flt32 *out) const;
+
+    /** \brief Number of levels.
+     *
+     * \return int32_t Levels including level 0; 0 before reset().
+     *
+     */
+    int32_t levels() const;
+
+    /** \brief Width of a level.
+     *
+     * \param level const int32_t Level.
+     * \return int32_t Columns, 0 for an invalid level.
+     *
+     */
+    int32_t columns(const int32_t level) const;
+
+    /** \brief Height of a level.
+     *
+     * \param level const int32_t Level.
+     * \return int32_t Rows, 0 for an invalid level.
+     *
+     */
+    int32_t rows(const int32_t level) const;
+
+    /** \brief Incremented with every update, so viewers can skip unchanged frames.
+     *
+     * \return uint64_t Version.
+     *
+     */
+    uint64_t version() const { return _version.load(std::memory_order_acquire); }
+
+private:
+    void build(const int32_t columns, const int32_t rows);
+
+    struct Level
+    {
+        int32_t columns;
+        int32_t rows;
+        std::vector<Flt32> data;
+    };
+
+    mutable std::mutex _lock;
+    int32_t _minSize;
+    std::vector<Level> _levels;
+    std::atomic<uint64_t> _version;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,244 @@
+#include "asc500.h"
+#include "asc500_events.h"
+#include "asc500_scanner.h"
+
+
+namespace asc500
+{
+
+ScannerControl::ScannerControl(const int32_t pollInterval)
+    : _running(true), _pollInterval(pollInterval > 0 ? pollInterval : 1), _token(0), _command(None),
+      _seenMoving(false), _polled(false), _generation(0), _status(-1), _transitions(0)
+{
+    _token = EventHub::subscribe([this](const DYB_Address, const int32_t, const int32_t value)
+    {
+        onStatus(value);
+    }, ID_SCAN_STATUS);
+    _supervisor = std::thread(&ScannerControl::supervise, this);
+
+    /* Initial state; later states arrive autonomously */
+    DYB_getParameterAsync(ID_SCAN_STATUS, 0);
+}
+
+
+ScannerControl::~ScannerControl()
+{
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _running = false;
+        if(_command != None)
+            finish(DYB_WrongContext);
+    }
+    _wakeup.notify_all();
+    _supervisor.join();
+    EventHub::unsubscribe(_token);
+}
+
+
+std::future<DYB_Rc> ScannerControl::start(const int32_t timeout)
+{
+    return begin(Start, timeout);
+}
+
+
+std::future<DYB_Rc> ScannerControl::stop(const int32_t timeout)
+{
+    return begin(Stop, timeout);
+}
+
+
+std::future<DYB_Rc> ScannerControl::pause(const int32_t timeout)
+{
+    return begin(Pause, timeout);
+}
+
+
+std::future<DYB_Rc> ScannerControl::moveTo(const int32_t x, const int32_t y, const int32_t timeout)
+{
+    return begin(Move, timeout, x, y);
+}
+
+
+std::future<DYB_Rc> ScannerControl::begin(const Command command, const int32_t timeout,
+                                          const int32_t x, const int32_t y)
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    if(_command != None)
+        finish(DYB_WrongContext);
+
+    _promise = std::promise<DYB_Rc>();
+    std::future<DYB_Rc> result = _promise.get_future();
+    const Clock::time_point now = Clock::now();
+    _command = command;
+    _deadline = now + std::chrono::milliseconds(timeout);
+    _nextPoll = now + std::chrono::milliseconds(_pollInterval);
+    _seenMoving = false;
+    _polled = false;
+    const uint64_t generation = ++_generation;
+
+    /* Nothing to do if the scanner is in the target state already */
+    const int32_t state = _status.load(std::memory_order_acquire);
+    if(state >= 0 && command != Move)
+    {
+        const bool done = command == Start ? (state & SCANSTATE_SCAN) != 0 :
+                          command == Stop  ? (state & (SCANSTATE_SCAN | SCANSTATE_MOVING | SCANSTATE_PAUSE)) == 0 :
+                                             (state & SCANSTATE_PAUSE) && !(state & SCANSTATE_MOVING);
+        if(done)
+        {
+            finish(DYB_Ok);
+            return result;
+        }
+    }
+    lock.unlock();
+
+    /* Sent without holding the lock, the events may be dispatched at once */
+    DYB_Rc rc = DYB_Ok;
+    if(command == Move)
+    {
+        rc = DYB_setParameterAsync(ID_POSI_TARGET_X, 0, x);
+        if(rc == DYB_Ok)
+            rc = DYB_setParameterAsync(ID_POSI_TARGET_Y, 0, y);
+    }
+    if(rc == DYB_Ok)
+        rc = transmit(command);
+    if(rc != DYB_Ok)
+        fail(generation, rc);
+
+    _wakeup.notify_all();
+    return result;
+}
+
+
+DYB_Rc ScannerControl::transmit(const Command command)
+{
+    switch(command)
+    {
+    case Start:
+        return DYB_setParameterAsync(ID_SCAN_COMMAND, 0, SCANRUN_ON);
+    case Stop:
+        return DYB_setParameterAsync(ID_SCAN_COMMAND, 0, SCANRUN_OFF);
+    case Pause:
+        return DYB_setParameterAsync(ID_SCAN_COMMAND, 0, SCANRUN_PAUSE);
+    case Move:
+        return DYB_setParameterAsync(ID_POSI_GOTO, 0, 1);
+    default:
+        return DYB_Ok;
+    }
+}
+
+
+bool ScannerControl::evaluate()
+{
+    const int32_t state = _status.load(std::memory_order_acquire);
+    if(_command == None || state < 0)
+        return false;
+
+    const bool moving = (state & SCANSTATE_MOVING) != 0;
+    if(moving)
+        _seenMoving = true;
+
+    switch(_command)
+    {
+    case Start:
+        if(state & SCANSTATE_SCAN)
+        {
+            finish(DYB_Ok);
+        }
+        else if(!moving && (_seenMoving || _polled))
+        {
+            /* At the start position: second step of the handshake */
+            _seenMoving = false;
+            _polled = false;
+            _nextPoll = Clock::now() + std::chrono::milliseconds(_pollInterval);
+            return true;
+        }
+        break;
+    case Stop:
+        if((state & (SCANSTATE_SCAN | SCANSTATE_MOVING | SCANSTATE_PAUSE)) == 0)
+            finish(DYB_Ok);
+        break;
+    case Pause:
+        if((state & SCANSTATE_PAUSE) && !moving)
+            finish(DYB_Ok);
+        break;
+    case Move:
+        if(!moving && (_seenMoving || _polled))
+            finish(DYB_Ok);
+        break;
+    default:
+        break;
+    }
+    return false;
+}
+
+
+void ScannerControl::fail(const uint64_t generation, const DYB_Rc rc)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    if(generation == _generation && _command != None)
+        finish(rc);
+}
+
+
+void ScannerControl::finish(const DYB_Rc rc)
+{
+    _promise.set_value(rc);
+    _command = None;
+}
+
+
+void ScannerControl::onStatus(const int32_t status)
+{
+    if(_status.exchange(status, std::memory_order_acq_rel) != status)
+        _transitions.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t generation = 0;
+    bool resend = false;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        resend = evaluate();
+        generation = _generation;
+    }
+
+    if(resend)
+    {
+        const DYB_Rc rc = transmit(Start);
+        if(rc != DYB_Ok)
+            fail(generation, rc);
+    }
+}
+
+
+void ScannerControl::supervise()
+{
+    std::unique_lock<std::mutex> lock(_lock);
+    while(_running)
+    {
+        if(_command == None)
+        {
+            _wakeup.wait(lock);
+            continue;
+        }
+
+        const Clock::time_point now = Clock::now();
+        if(now >= _deadline)
+        {
+            finish(DYB_Timeout);
+        }
+        else if(now >= _nextPoll)
+        {
+            /* No transition for a while: ask; the answer is evaluated like any event */
+            _polled = true;
+            _nextPoll = now + std::chrono::milliseconds(_pollInterval);
+            lock.unlock();
+            DYB_getParameterAsync(ID_SCAN_STATUS, 0);
+            lock.lock();
+        }
+        else
+        {
+            _wakeup.wait_until(lock, _deadline < _nextPoll ? _deadline : _nextPoll);
+        }
+    }
+}
+
+} /* namespace asc500 */
@@ -0,0 +1,140 @@
+/** \file asc500_scanner.h
+ * \brief Event driven scanner commands.
+ *
+ * Starting the scanner takes two commands: the first SCANRUN_ON moves the
+ * scanner to the start position, the second one runs the scan. Polling
+ * ID_SCAN_STATUS in fixed intervals to find out when to send the second
+ * command (and when the scan runs or a move has finished) costs up to one
+ * interval of dead time per step.
+ *
+ * ScannerControl follows the transitions of ID_SCAN_STATUS (SCANSTATE_ flags)
+ * through the EventHub instead. It sends the second start command as soon as
+ * the scanner has stopped moving, and the future of a command is resolved
+ * by the event of the transition it waits for:
+ *  - start():  SCANSTATE_SCAN is set;
+ *  - stop():   none of SCANSTATE_SCAN, _MOVING, _PAUSE is set;
+ *  - pause():  SCANSTATE_PAUSE is set and the scanner is not moving;
+ *  - moveTo(): the scanner has stopped moving after ID_POSI_GOTO.
+ *
+ * If no transition arrives, the state is requested every pollInterval as a
+ * fallback, e.g. for a move that is too short to be reported. Only one
+ * command is pending at a time; a new command resolves the previous one
+ * with DYB_WrongContext.
+ */
+
+#ifndef __ASC500_SCANNER_H
+#define __ASC500_SCANNER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "daisybase.h"
+
+
+namespace asc500
+{
+
+class ScannerControl
+{
+public:
+    /** \brief Subscribe to the scanner state.
+     *
+     * \param pollInterval const int32_t Fallback request of the state when no transition arrives [ms].
+     *
+     */
+    explicit ScannerControl(const int32_t pollInterval = 200);
+    ~ScannerControl();
+
+    ScannerControl(const ScannerControl &) = delete;
+    ScannerControl &operator=(const ScannerControl &) = delete;
+
+    /** \brief Move to the start position and run the scan.
+     *
+     * \param timeout const int32_t Maximum time until the scan runs [ms].
+     * \return std::future<DYB_Rc> DYB_Ok when scanning, DYB_Timeout, or the
+     *         error of DYB_setParameterAsync.
+     *
+     */
+    std::future<DYB_Rc> start(const int32_t timeout = 30000);
+
+    /** \brief Stop the scanner.
+     *
+     * \param timeout const int32_t Maximum time until the scanner is idle [ms].
+     * \return std::future<DYB_Rc> Result as for start().
+     *
+     */
+    std::future<DYB_Rc> stop(const int32_t timeout = 5000);
+
+    /** \brief Pause the scanner.
+     *
+     * \param timeout const int32_t Maximum time until the scanner pauses [ms].
+     * \return std::future<DYB_Rc> Result as for start().
+     *
+     */
+    std::future<DYB_Rc> pause(const int32_t timeout = 5000);
+
+    /** \brief Move the scanner to an absolute position.
+     *
+     * \param x const int32_t Target X (ID_POSI_TARGET_X) [10pm].
+     * \param y const int32_t Target Y (ID_POSI_TARGET_Y) [10pm].
+     * \param timeout const int32_t Maximum time until the move has finished [ms].
+     * \return std::future<DYB_Rc> Result as for start().
+     *
+     */
+    std::future<DYB_Rc> moveTo(const int32_t x, const int32_t y, const int32_t timeout = 30000);
+
+    /** \brief Latest known scanner state.
+     *
+     * \return int32_t Bitfield of SCANSTATE_.., -1 if not known yet.
+     *
+     */
+    int32_t status() const { return _status.load(std::memory_order_acquire); }
+
+    /** \brief Number of state transitions observed.
+     *
+     * \return uint64_t Transitions.
+     *
+     */
+    uint64_t transitions() const { return _transitions.load(std::memory_order_relaxed); }
+
+private:
+    enum Command { None, Start, Stop, Pause, Move };
+    typedef std::chrono::steady_clock Clock;
+
+    std::future<DYB_Rc> begin(const Command command, const int32_t timeout,
+                              const int32_t x = 0, const int32_t y = 0);
+    static DYB_Rc transmit(const Command command);
+    bool evaluate();
+    void fail(const uint64_t generation, const DYB_Rc rc);
+    void finish(const DYB_Rc rc);
+    void onStatus(const int32_t status);
+    void supervise();
+
+    std::mutex _lock;
+    std::condition_variable _wakeup;
+    std::thread _supervisor;
+    bool _running;
+    int32_t _pollInterval;
+    int32_t _token;
+
+    /* Pending command, guarded by _lock */
+    Command _command;
+    std::promise<DYB_Rc> _promise;
+    Clock::time_point _deadline;
+    Clock::time_point _nextPoll;
+    bool _seenMoving;          /* Scanner has been moving since the last command */
+    bool _polled;              /* State has been requested after the last command */
+    uint64_t _generation;      /* Incremented with every command */
+
+    std::atomic<int32_t> _status;
+    std::atomic<uint64_t> _transitions;
+};
+
+} /* namespace asc500 */
+
+#endif
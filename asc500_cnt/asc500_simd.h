@@ -0,0 +1,70 @@
+/** \file asc500_simd.h
+ * \brief Compiler and CPU feature helpers for the SIMD kernels.
+ *
+ * SSE2 is part of every x86-64 target and is used unconditionally there.
+ * AVX2 kernels are compiled with a function level target attribute (GCC,
+ * Clang) or require /arch:AVX2 (MSVC) and are selected at run time, so the
+ * library still runs on CPUs without AVX2. On other architectures only the
+ * scalar kernels are built.
+ *
+ * The kernels never use fused multiply-add, so their results are identical
+ * to the scalar reference code as long as that isn't contracted either.
+ */
+
+#ifndef __ASC500_SIMD_H
+#define __ASC500_SIMD_H
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define ASC500_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(ASC500_SSE2)
+#include <immintrin.h>
+#define ASC500_AVX2 1
+#define ASC500_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && defined(__AVX2__)
+#include <immintrin.h>
+#define ASC500_AVX2 1
+#define ASC500_TARGET_AVX2
+#else
+#define ASC500_TARGET_AVX2
+#endif
+
+#if defined(_MSC_VER) && defined(ASC500_AVX2)
+#include <intrin.h>
+#endif
+
+
+namespace asc500
+{
+
+/** \brief Check once if the CPU supports the AVX2 kernels.
+ *
+ * \return bool True if AVX2 kernels may be used.
+ *
+ */
+inline bool cpuHasAvx2()
+{
+#if defined(ASC500_AVX2) && defined(__GNUC__)
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#elif defined(ASC500_AVX2) && defined(_MSC_VER)
+    static const bool avx2 = []()
+    {
+        int info[4];
+        __cpuid(info, 0);
+        if(info[0] < 7)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0 && (_xgetbv(0) & 6) == 6;
+    }();
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,409 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "asc500_convert.h"
+#include "asc500_spectrum.h"
+#include "asc500_simd.h"
+
+
+namespace asc500
+{
+
+static const double Pi = 3.14159265358979323846;
+
+
+/* ---------------------------------------------------------------------------
+ *  Radix-2 stage kernels: butterflies of half size m over a complex array
+ *  of count points in split format, twiddles at tw[m + j]
+ * ------------------------------------------------------------------------- */
+
+static void stageScalar(Flt32 *re, Flt32 *im, const int32_t count, const int32_t m,
+                        const Flt32 *twRe, const Flt32 *twIm)
+{
+    for(int32_t s = 0; s < count; s += 2 * m)
+    {
+        for(int32_t j = 0; j < m; j++)
+        {
+            const int32_t a = s + j, b = a + m;
+            const Flt32 wr = twRe[m + j], wi = twIm[m + j],
+                        tr = wr * re[b] - wi * im[b],
+                        ti = wr * im[b] + wi * re[b];
+            re[b] = re[a] - tr;
+            im[b] = im[a] - ti;
+            re[a] = re[a] + tr;
+            im[a] = im[a] + ti;
+        }
+    }
+}
+
+
+#ifdef ASC500_SSE2
+static void stageSse2(Flt32 *re, Flt32 *im, const int32_t count, const int32_t m,
+                      const Flt32 *twRe, const Flt32 *twIm)
+{
+    if(m < 4)
+        return stageScalar(re, im, count, m, twRe, twIm);
+
+    for(int32_t s = 0; s < count; s += 2 * m)
+    {
+        for(int32_t j = 0; j < m; j += 4)
+        {
+            const int32_t a = s + j, b = a + m;
+            const __m128 wr = _mm_loadu_ps(twRe + m + j), wi = _mm_loadu_ps(twIm + m + j),
+                         br = _mm_loadu_ps(re + b), bi = _mm_loadu_ps(im + b),
+                         ar = _mm_loadu_ps(re + a), ai = _mm_loadu_ps(im + a),
+                         tr = _mm_sub_ps(_mm_mul_ps(wr, br), _mm_mul_ps(wi, bi)),
+                         ti = _mm_add_ps(_mm_mul_ps(wr, bi), _mm_mul_ps(wi, br));
+            _mm_storeu_ps(re + b, _mm_sub_ps(ar, tr));
+            _mm_storeu_ps(im + b, _mm_sub_ps(ai, ti));
+            _mm_storeu_ps(re + a, _mm_add_ps(ar, tr));
+            _mm_storeu_ps(im + a, _mm_add_ps(ai, ti));
+        }
+    }
+}
+#endif
+
+
+#ifdef ASC500_AVX2
+ASC500_TARGET_AVX2
+static void stageAvx2(Flt32 *re, Flt32 *im, const int32_t count, const int32_t m,
+                      const Flt32 *twRe, const Flt32 *twIm)
+{
+    if(m < 8)
+        return stageSse2(re, im, count, m, twRe, twIm);
+
+    for(int32_t s = 0; s < count; s += 2 * m)
+    {
+        for(int32_t j = 0; j < m; j += 8)
+        {
+            const int32_t a = s + j, b = a + m;
+            const __m256 wr = _mm256_loadu_ps(twRe + m + j), wi = _mm256_loadu_ps(twIm + m + j),
+                         br = _mm256_loadu_ps(re + b), bi = _mm256_loadu_ps(im + b),
+                         ar = _mm256_loadu_ps(re + a), ai = _mm256_loadu_ps(im + a),
+                         tr = _mm256_sub_ps(_mm256_mul_ps(wr, br), _mm256_mul_ps(wi, bi)),
+                         ti = _mm256_add_ps(_mm256_mul_ps(wr, bi), _mm256_mul_ps(wi, br));
+            _mm256_storeu_ps(re + b, _mm256_sub_ps(ar, tr));
+            _mm256_storeu_ps(im + b, _mm256_sub_ps(ai, ti));
+            _mm256_storeu_ps(re + a, _mm256_add_ps(ar, tr));
+            _mm256_storeu_ps(im + a, _mm256_add_ps(ai, ti));
+        }
+    }
+}
+#endif
+
+
+static void stage(Flt32 *re, Flt32 *im, const int32_t count, const int32_t m,
+                  const Flt32 *twRe, const Flt32 *twIm)
+{
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+        return stageAvx2(re, im, count, m, twRe, twIm);
+#endif
+#ifdef ASC500_SSE2
+    stageSse2(re, im, count, m, twRe, twIm);
+#else
+    stageScalar(re, im, count, m, twRe, twIm);
+#endif
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Plan
+ * ------------------------------------------------------------------------- */
+
+std::shared_ptr<const FftPlan> FftPlan::get(const int32_t size)
+{
+    if(size < MinSize || size > MaxSize || (size & (size - 1)) != 0)
+        return std::shared_ptr<const FftPlan>();
+
+    static std::mutex lock;
+    static std::weak_ptr<const FftPlan> plans[32];
+
+    int32_t order = 0;
+    while((1 << order) < size)
+        order++;
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::shared_ptr<const FftPlan> plan = plans[order].lock();
+    if(!plan)
+    {
+        plan = std::make_shared<const FftPlan>(size);
+        plans[order] = plan;
+    }
+    return plan;
+}
+
+
+FftPlan::FftPlan(const int32_t size)
+    : _size(size)
+{
+    const int32_t half = size / 2;
+
+    int32_t bits = 0;
+    while((1 << bits) < half)
+        bits++;
+    _reverse.resize(half);
+    for(int32_t k = 0; k < half; k++)
+    {
+        int32_t r = 0;
+        for(int32_t b = 0; b < bits; b++)
+            r |= ((k >> b) & 1) << (bits - 1 - b);
+        _reverse[k] = r;
+    }
+
+    /* Twiddles of the stage with half size m at m + j, computed in double */
+    _stageRe.assign(half, 0.0f);
+    _stageIm.assign(half, 0.0f);
+    for(int32_t m = 1; m < half; m *= 2)
+    {
+        for(int32_t j = 0; j < m; j++)
+        {
+            _stageRe[m + j] = static_cast<Flt32>(cos(-Pi * j / m));
+            _stageIm[m + j] = static_cast<Flt32>(sin(-Pi * j / m));
+        }
+    }
+
+    _splitRe.resize(half / 2 + 1);
+    _splitIm.resize(half / 2 + 1);
+    for(int32_t k = 0; k <= half / 2; k++)
+    {
+        _splitRe[k] = static_cast<Flt32>(cos(-2.0 * Pi * k / size));
+        _splitIm[k] = static_cast<Flt32>(sin(-2.0 * Pi * k / size));
+    }
+}
+
+
+void FftPlan::forward(const Flt32 *in, Flt32 *re, Flt32 *im) const
+{
+    const int32_t half = _size / 2;
+
+    /* Pack even / odd samples as one complex signal, in bit reversed order */
+    for(int32_t k = 0; k < half; k++)
+    {
+        re[_reverse[k]] = in[2 * k];
+        im[_reverse[k]] = in[2 * k + 1];
+    }
+
+    /* Radix-4 pass: the first two radix-2 stages at once */
+    for(int32_t s = 0; s < half; s += 4)
+    {
+        const Flt32 r0 = re[s] + re[s + 1], i0 = im[s] + im[s + 1],
+                    r1 = re[s] - re[s + 1], i1 = im[s] - im[s + 1],
+                    r2 = re[s + 2] + re[s + 3], i2 = im[s + 2] + im[s + 3],
+                    r3 = re[s + 2] - re[s + 3], i3 = im[s + 2] - im[s + 3];
+        /* Twiddle -i on the fourth point */
+        re[s] = r0 + r2;
+        im[s] = i0 + i2;
+        re[s + 2] = r0 - r2;
+        im[s + 2] = i0 - i2;
+        re[s + 1] = r1 + i3;
+        im[s + 1] = i1 - r3;
+        re[s + 3] = r1 - i3;
+        im[s + 3] = i1 + r3;
+    }
+
+    for(int32_t m = 4; m < half; m *= 2)
+        stage(re, im, half, m, _stageRe.data(), _stageIm.data());
+
+    /* Split into the spectrum of the real signal:
+     * X[k] = E + W^k O, X[half - k] = conj(E - W^k O) */
+    const Flt32 r0 = re[0], i0 = im[0];
+    re[0] = r0 + i0;
+    im[0] = 0.0f;
+    re[half] = r0 - i0;
+    im[half] = 0.0f;
+    for(int32_t k = 1; k <= half / 2; k++)
+    {
+        const int32_t n = half - k;
+        const Flt32 evenRe = 0.5f * (re[k] + re[n]), evenIm = 0.5f * (im[k] - im[n]),
+                    oddRe = 0.5f * (im[k] + im[n]), oddIm = -0.5f * (re[k] - re[n]),
+                    wr = _splitRe[k], wi = _splitIm[k],
+                    tr = wr * oddRe - wi * oddIm,
+                    ti = wr * oddIm + wi * oddRe;
+        re[k] = evenRe + tr;
+        im[k] = evenIm + ti;
+        re[n] = evenRe - tr;
+        im[n] = ti - evenIm;
+    }
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Analyzer
+ * ------------------------------------------------------------------------- */
+
+SpectrumAnalyzer::SpectrumAnalyzer(const int32_t size, const int32_t overlap,
+                                   const Window window, const int32_t averages)
+    : _size(0), _overlap(0), _averages(0), _windowPower(1.0), _fill(0), _nextIndex(-1),
+      _userRate(0.0), _metaRate(0.0), _segments(0)
+{
+    if(configure(size, overlap, window, averages) != DYB_Ok)
+        configure(4096, -1, window, averages);
+}
+
+
+DYB_Rc SpectrumAnalyzer::configure(const int32_t size, const int32_t overlap,
+                                   const Window window, const int32_t averages)
+{
+    std::shared_ptr<const FftPlan> plan = FftPlan::get(size);
+    const int32_t shared = overlap < 0 ? size / 2 : overlap;
+    if(!plan || shared >= size || averages < 0)
+        return DYB_OutOfRange;
+
+    _plan = plan;
+    _overlap = shared;
+    _averages = averages;
+
+    /* Periodic windows, as usual for spectral estimation */
+    _window.resize(size);
+    _windowPower = 0.0;
+    for(int32_t i = 0; i < size; i++)
+    {
+        const double x = 2.0 * Pi * i / size;
+        double w = 1.0;
+        switch(window)
+        {
+        case Hann:
+            w = 0.5 - 0.5 * cos(x);
+            break;
+        case Hamming:
+            w = 0.54 - 0.46 * cos(x);
+            break;
+        case BlackmanHarris:
+            w = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2.0 * x) - 0.01168 * cos(3.0 * x);
+            break;
+        default:
+            break;
+        }
+        _window[i] = static_cast<Flt32>(w);
+        _windowPower += w * w;
+    }
+
+    _input.assign(size, 0.0f);
+    _work.assign(size, 0.0f);
+    _re.assign(size / 2 + 1, 0.0f);
+    _im.assign(size / 2 + 1, 0.0f);
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _size = size;
+        _average.assign(size / 2 + 1, 0.0);
+    }
+    reset();
+    return DYB_Ok;
+}
+
+
+void SpectrumAnalyzer::setSampleRate(const double rate)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    _userRate = rate > 0.0 ? rate : 0.0;
+}
+
+
+double SpectrumAnalyzer::sampleRate() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _userRate > 0.0 ? _userRate : _metaRate;
+}
+
+
+void SpectrumAnalyzer::reset()
+{
+    _fill = 0;
+    _nextIndex = -1;
+    std::lock_guard<std::mutex> lock(_lock);
+    std::fill(_average.begin(), _average.end(), 0.0);
+    _segments = 0;
+}
+
+
+DYB_Rc SpectrumAnalyzer::push(const Flt32 *samples, const int32_t count)
+{
+    int32_t done = 0;
+    while(done < count)
+    {
+        const int32_t n = count - done < _size - _fill ? count - done : _size - _fill;
+        memcpy(_input.data() + _fill, samples + done, n * sizeof(Flt32));
+        _fill += n;
+        done += n;
+        if(_fill == _size)
+        {
+            segment();
+
+            /* Keep the overlap for the next segment */
+            memmove(_input.data(), _input.data() + _size - _overlap, _overlap * sizeof(Flt32));
+            _fill = _overlap;
+        }
+    }
+    return DYB_Ok;
+}
+
+
+DYB_Rc SpectrumAnalyzer::push(const DataPacket &packet)
+{
+    const double rate = sampleRateOf(&packet.meta);
+    if(rate != _metaRate)
+    {
+        reset();
+        std::lock_guard<std::mutex> lock(_lock);
+        _metaRate = rate;
+    }
+    if(_nextIndex >= 0 && packet.index != _nextIndex)
+        _fill = 0;
+    _nextIndex = static_cast<int64_t>(packet.index) + packet.length;
+
+    Flt32 chunk[256];
+    for(int32_t done = 0; done < packet.length; )
+    {
+        const int32_t n = packet.length - done < 256 ? packet.length - done : 256;
+        convValues2Phys(&packet.meta, packet.data + done, n, chunk);
+        push(chunk, n);
+        done += n;
+    }
+    return DYB_Ok;
+}
+
+
+void SpectrumAnalyzer::segment()
+{
+    /* Remove the mean so that leakage of the DC bin doesn't mask low frequencies */
+    double mean = 0.0;
+    for(int32_t i = 0; i < _size; i++)
+        mean += _input[i];
+    const Flt32 dc = static_cast<Flt32>(mean / _size);
+    for(int32_t i = 0; i < _size; i++)
+        _work[i] = (_input[i] - dc) * _window[i];
+
+    _plan->forward(_work.data(), _re.data(), _im.data());
+
+    std::lock_guard<std::mutex> lock(_lock);
+    _segments++;
+    const double weight = 1.0 / (_averages > 0 && _segments > _averages ? _averages : _segments),
+                 norm = 1.0 / _windowPower;
+    for(int32_t k = 0; k <= _size / 2; k++)
+    {
+        const double power = (static_cast<double>(_re[k]) * _re[k] + static_cast<double>(_im[k]) * _im[k]) * norm;
+        _average[k] += (power - _average[k]) * weight;
+    }
+}
+
+
+int64_t SpectrumAnalyzer::psd(double *out) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    const double rate = _userRate > 0.0 ? _userRate : _metaRate > 0.0 ? _metaRate : 1.0;
+    const int32_t last = _size / 2;
+    for(int32_t k = 0; k <= last; k++)
+        out[k] = _average[k] * (k == 0 || k == last ? 1.0 : 2.0) / rate;
+    return _segments;
+}
+
+
+double SpectrumAnalyzer::frequency(const int32_t bin) const
+{
+    const double rate = sampleRate();
+    return bin * (rate > 0.0 ? rate : 1.0) / _size;
+}
+
+} /* namespace asc500 */
@@ -0,0 +1,203 @@
+/** \file asc500_spectrum.h
+ * \brief Streaming FFT and Welch power spectral density.
+ *
+ * SpectrumAnalyzer consumes the samples of a timer triggered channel
+ * (CHANCONN_PERMANENT) as they arrive, cuts them into overlapping segments,
+ * applies a window and keeps the running Welch average of the one-sided
+ * power spectral density of the segments; the mean of every segment is
+ * removed first. The PSD can be copied at any time from another thread,
+ * all other calls belong to the thread that pushes the data.
+ *
+ * The real FFT of N samples is computed as a complex FFT of N / 2 points
+ * plus a split step. The complex FFT works on separate real and imaginary
+ * arrays: a radix-4 first pass followed by radix-2 stages whose butterflies
+ * are vectorized with SSE2 / AVX2 (see asc500_simd.h). Twiddle factors and
+ * the bit reversal permutation of a size are computed once into an FftPlan,
+ * and plans are shared between analyzers.
+ */
+
+#ifndef __ASC500_SPECTRUM_H
+#define __ASC500_SPECTRUM_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500_spscring.h"
+
+
+namespace asc500
+{
+
+class FftPlan
+{
+public:
+    static const int32_t MinSize = 16;
+    static const int32_t MaxSize = 65536;
+
+    /** \brief Shared plan of a size.
+     *
+     * \param size const int32_t Number of real samples, a power of 2 in MinSize .. MaxSize.
+     * \return std::shared_ptr<const FftPlan> The plan; empty for an invalid size.
+     *
+     */
+    static std::shared_ptr<const FftPlan> get(const int32_t size);
+
+    /** \brief Create a plan; use get() to share plans.
+     *
+     * \param size const int32_t Number of real samples, must be valid.
+     *
+     */
+    explicit FftPlan(const int32_t size);
+
+    /** \brief Forward FFT of real samples.
+     *
+     * Thread safe; the output arrays are used as work space.
+     *
+     * \param in const Flt32* size() samples.
+     * \param re Flt32* Output: real parts of bins 0 .. size() / 2.
+     * \param im Flt32* Output: imaginary parts of bins 0 .. size() / 2.
+     * \return void
+     *
+     */
+    void forward(const Flt32 *in, Flt32 *re, Flt32 *im) const;
+
+    int32_t size() const { return _size; }           /**< Number of real samples           */
+    int32_t bins() const { return _size / 2 + 1; }   /**< Number of output bins            */
+
+private:
+    int32_t _size;
+    std::vector<int32_t> _reverse;     /* Bit reversal of the complex FFT     */
+    std::vector<Flt32> _stageRe;       /* Stage twiddles, m + j for m = 1 .. */
+    std::vector<Flt32> _stageIm;
+    std::vector<Flt32> _splitRe;       /* exp(-2 pi i k / size)               */
+    std::vector<Flt32> _splitIm;
+};
+
+
+class SpectrumAnalyzer
+{
+public:
+    enum Window
+    {
+        Rectangular,           /**< No window                                  */
+        Hann,                  /**< Hann window                                */
+        Hamming,               /**< Hamming window                             */
+        BlackmanHarris         /**< 4 term Blackman-Harris, lowest leakage     */
+    };
+
+    /** \brief Create an analyzer.
+     *
+     * \param size const int32_t Segment length, see configure().
+     * \param overlap const int32_t Samples shared by successive segments; -1 = size / 2.
+     * \param window const Window Window applied to the segments.
+     * \param averages const int32_t 0 = average all segments, otherwise exponential
+     *                               average over about this number of segments.
+     *
+     */
+    explicit SpectrumAnalyzer(const int32_t size = 4096, const int32_t overlap = -1,
+                              const Window window = Hann, const int32_t averages = 0);
+
+    SpectrumAnalyzer(const SpectrumAnalyzer &) = delete;
+    SpectrumAnalyzer &operator=(const SpectrumAnalyzer &) = delete;
+
+    /** \brief Change the parameters; resets the average.
+     *
+     * \param size const int32_t Segment length, a power of 2 in FftPlan::MinSize .. FftPlan::MaxSize.
+     * \param overlap const int32_t Samples shared by successive segments (0 .. size - 1); -1 = size / 2.
+     * \param window const Window Window applied to the segments.
+     * \param averages const int32_t See constructor.
+     * \return DYB_Rc DYB_OutOfRange for invalid parameters, the analyzer is unchanged then.
+     *
+     */
+    DYB_Rc configure(const int32_t size, const int32_t overlap, const Window window, const int32_t averages);
+
+    /** \brief Set the sample rate.
+     *
+     * \param rate const double Samples per second; 0 = take it from the meta data
+     *                          of the packets (time unit of _stepX).
+     * \return void
+     *
+     */
+    void setSampleRate(const double rate);
+
+    /** \brief Append physical samples.
+     *
+     * \param samples const Flt32* Samples.
+     * \param count const int32_t Number of samples.
+     * \return DYB_Rc DYB_Ok
+     *
+     */
+    DYB_Rc push(const Flt32 *samples, const int32_t count);
+
+    /** \brief Append a packet of the acquisition layer.
+     *
+     * The data are converted to physical values. A gap in the data index
+     * discards the incomplete segment; a change of the sample rate also
+     * resets the average.
+     *
+     * \param packet const DataPacket& The packet.
+     * \return DYB_Rc DYB_Ok
+     *
+     */
+    DYB_Rc push(const DataPacket &packet);
+
+    /** \brief Discard the average and the incomplete segment.
+     *
+     * \return void
+     *
+     */
+    void reset();
+
+    /** \brief Copy the averaged PSD.
+     *
+     * One-sided density in unit^2 / Hz of the sample values; per bin if the
+     * sample rate is unknown.
+     *
+     * \param out double* Output: bins() values.
+     * \return int64_t Number of segments averaged; 0 if there is no PSD yet.
+     *
+     */
+    int64_t psd(double *out) const;
+
+    /** \brief Center frequency of a bin.
+     *
+     * \param bin const int32_t Bin 0 .. bins() - 1.
+     * \return double Frequency [Hz], or in units of the sample rate if unknown.
+     *
+     */
+    double frequency(const int32_t bin) const;
+
+    int32_t size() const { return _size; }           /**< Segment length                   */
+    int32_t bins() const { return _size / 2 + 1; }  /**< Number of PSD values             */
+    int32_t overlap() const { return _overlap; }     /**< Samples shared by segments       */
+    double sampleRate() const;                       /**< Samples per second, 0 = unknown  */
+
+private:
+    void segment();
+
+    std::shared_ptr<const FftPlan> _plan;
+    int32_t _size;
+    int32_t _overlap;
+    int32_t _averages;
+    std::vector<Flt32> _window;
+    double _windowPower;       /* Sum of the squared window values            */
+    std::vector<Flt32> _input;
+    int32_t _fill;
+    int64_t _nextIndex;
+    double _userRate;
+    double _metaRate;
+    std::vector<Flt32> _work;
+    std::vector<Flt32> _re;
+    std::vector<Flt32> _im;
+
+    mutable std::mutex _lock;  /* Protects the average and the rate            */
+    std::vector<double> _average;
+    int64_t _segments;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,220 @@
+/** \file asc500_spscring.h
+ * \brief Lock-free single-producer/single-consumer packet ring.
+ *
+ * The ring stores complete data packets (header, meta data and payload) in
+ * one contiguous block of 32 bit words so that the producer (the daisybase
+ * event loop) needs a single copy per packet and the consumer can read the
+ * payload in place. A packet never wraps around the end of the buffer; if it
+ * does not fit, a wrap marker is written and the packet starts at offset 0.
+ *
+ * Exactly one thread may call push() and exactly one thread may call
+ * front()/pop() at the same time.
+ */
+
+#ifndef __ASC500_SPSCRING_H
+#define __ASC500_SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "metadata.h"
+
+
+namespace asc500
+{
+
+/** \brief View of one data packet as delivered by a DYB_DataCallback.
+ *
+ * The payload pointer refers to memory inside the ring and is valid until
+ * the packet is popped.
+ */
+struct DataPacket
+{
+    int32_t channel;       /**< Data channel that has sent the data          */
+    int32_t index;         /**< Number of the first item of the packet       */
+    int32_t length;        /**< Number of Int32 items in the packet          */
+    const int32_t *data;   /**< Payload, valid until SpscRing::pop()         */
+    DYB_Meta meta;         /**< Meta data belonging to the packet            */
+};
+
+
+class SpscRing
+{
+public:
+    /** \brief Create a ring.
+     *
+     * \param words size_t Capacity in 32 bit words, rounded up to a power of two.
+     *
+     */
+    explicit SpscRing(size_t words)
+        : _mask(0), _head(0), _tailCache(0), _tail(0), _headCache(0),
+          _frontWords(0), _dropped(0)
+    {
+        size_t capacity = MinWords;
+        while(capacity < words)
+            capacity <<= 1;
+        _buffer.assign(capacity, 0);
+        _mask = capacity - 1;
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    /** \brief Copy a packet into the ring (producer side, never blocks).
+     *
+     * \param channel const int32_t Data channel.
+     * \param index const int32_t Index of the first item.
+     * \param length const int32_t Number of items.
+     * \param data const int32_t* Payload.
+     * \param meta const DYB_Meta* Meta data of the packet.
+     * \return bool False if the ring was full and the packet has been dropped.
+     *
+     */
+    bool push(const int32_t channel, const int32_t index, const int32_t length,
+              const int32_t *data, const DYB_Meta *meta)
+    {
+        const size_t capacity = _mask + 1,
+                     need = HeaderWords + static_cast<size_t>(length < 0 ? 0 : length);
+        uint64_t head = _head.load(std::memory_order_relaxed);
+        size_t offset = static_cast<size_t>(head & _mask),
+               pad = capacity - offset < need ? capacity - offset : 0;
+
+        if(need > capacity / 2)
+        {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if(head + pad + need - _tailCache > capacity)
+        {
+            _tailCache = _tail.load(std::memory_order_acquire);
+            if(head + pad + need - _tailCache > capacity)
+            {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        if(pad)
+        {
+            _buffer[offset] = WrapMarker;
+            head += pad;
+            offset = 0;
+        }
+
+        int32_t *record = &_buffer[offset];
+        record[0] = static_cast<int32_t>(need);
+        record[1] = channel;
+        record[2] = index;
+        record[3] = length;
+        if(meta)
+            memcpy(record + 4, meta, sizeof(DYB_Meta));
+        else
+            memset(record + 4, 0, sizeof(DYB_Meta));
+        if(length > 0)
+            memcpy(record + HeaderWords, data, length * sizeof(int32_t));
+
+        _head.store(head + need, std::memory_order_release);
+        return true;
+    }
+
+    /** \brief Look at the oldest packet without removing it (consumer side).
+     *
+     * \param packet DataPacket& Output: view of the packet.
+     * \return bool False if the ring is empty.
+     *
+     */
+    bool front(DataPacket &packet)
+    {
+        uint64_t tail = _tail.load(std::memory_order_relaxed);
+
+        if(tail == _headCache)
+        {
+            _headCache = _head.load(std::memory_order_acquire);
+            if(tail == _headCache)
+                return false;
+        }
+
+        size_t offset = static_cast<size_t>(tail & _mask);
+        if(_buffer[offset] == WrapMarker)
+        {
+            tail += _mask + 1 - offset;
+            _tail.store(tail, std::memory_order_release);
+            offset = 0;
+            if(tail == _headCache)
+            {
+                _headCache = _head.load(std::memory_order_acquire);
+                if(tail == _headCache)
+                    return false;
+            }
+        }
+
+        const int32_t *record = &_buffer[offset];
+        _frontWords = static_cast<size_t>(record[0]);
+        packet.channel = record[1];
+        packet.index = record[2];
+        packet.length = record[3];
+        packet.data = record + HeaderWords;
+        memcpy(&packet.meta, record + 4, sizeof(DYB_Meta));
+        return true;
+    }
+
+    /** \brief Release the packet returned by the last successful front().
+     *
+     * \return void
+     *
+     */
+    void pop()
+    {
+        _tail.store(_tail.load(std::memory_order_relaxed) + _frontWords,
+                    std::memory_order_release);
+        _frontWords = 0;
+    }
+
+    /** \brief Number of words currently occupied (approximate from any thread).
+     *
+     * \return size_t Used words.
+     *
+     */
+    size_t used() const
+    {
+        return static_cast<size_t>(_head.load(std::memory_order_acquire) -
+                                   _tail.load(std::memory_order_acquire));
+    }
+
+    size_t capacity() const { return _mask + 1; }
+
+    /** \brief Number of packets dropped because the ring was full.
+     *
+     * \return uint64_t Dropped packets since construction.
+     *
+     */
+    uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+    static const int32_t WrapMarker = -1;
+    static const size_t MetaWords = (sizeof(DYB_Meta) + sizeof(int32_t) - 1) / sizeof(int32_t);
+    static const size_t HeaderWords = 4 + MetaWords;
+    static const size_t MinWords = 1024;
+    static const size_t CacheLine = 64;
+
+    std::vector<int32_t> _buffer;
+    size_t _mask;
+
+    /* Producer and consumer indices are kept on separate cache lines */
+    char _pad0[CacheLine];
+    std::atomic<uint64_t> _head;
+    uint64_t _tailCache;
+    char _pad1[CacheLine];
+    std::atomic<uint64_t> _tail;
+    uint64_t _headCache;
+    size_t _frontWords;
+    char _pad2[CacheLine];
+    std::atomic<uint64_t> _dropped;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -0,0 +1,408 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "asc500_tsstore.h"
+
+
+namespace asc500
+{
+
+static const char FileMagic[4] = { 'A', '5', 'T', 'S' };
+static const char ChunkMagic[4] = { 'C', 'H', 'N', 'K' };
+static const uint32_t FileVersion = 1;
+
+/* On disk layout of the file header */
+struct FileHeader
+{
+    char magic[4];
+    uint32_t version;
+    int32_t channel;
+    int32_t chunkSamples;
+    uint32_t headerBytes;
+    uint32_t chunkHeaderBytes;
+    uint8_t reserved[40];
+};
+
+/* On disk layout of a chunk header */
+struct ChunkHeader
+{
+    char magic[4];
+    int32_t count;
+    int64_t firstIndex;
+    int64_t firstSample;
+    int64_t firstTimeNs;
+    int64_t lastTimeNs;
+    DYB_Meta meta;
+    int32_t rawIndex;
+    uint8_t reserved[32];
+};
+
+static_assert(sizeof(FileHeader) == 64, "File header layout");
+static_assert(sizeof(ChunkHeader) == 128, "Chunk header layout");
+
+
+static int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+
+/* 64 bit file positions, the files easily exceed 2 GB */
+static bool seek64(FILE *file, const int64_t offset, const int whence = SEEK_SET)
+{
+#ifdef _WIN32
+    return _fseeki64(file, offset, whence) == 0;
+#else
+    return fseeko(file, offset, whence) == 0;
+#endif
+}
+
+
+static int64_t tell64(FILE *file)
+{
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return ftello(file);
+#endif
+}
+
+
+static int64_t chunkOffset(const int64_t chunk, const int32_t chunkSamples)
+{
+    return sizeof(FileHeader) + chunk * (sizeof(ChunkHeader) + chunkSamples * sizeof(int32_t));
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Writer
+ * ------------------------------------------------------------------------- */
+
+TimeSeriesWriter::TimeSeriesWriter()
+    : _file(NULL), _chunkSamples(0), _chunk(0), _samples(0), _nextRaw(0), _unwrap(0)
+{
+    memset(&_info, 0, sizeof(_info));
+}
+
+
+TimeSeriesWriter::~TimeSeriesWriter()
+{
+    close();
+}
+
+
+DYB_Rc TimeSeriesWriter::open(const std::string &fileName, const int32_t channel,
+                              const int32_t chunkSamples)
+{
+    if(chunkSamples <= 0)
+        return DYB_OutOfRange;
+
+    close();
+    _file = fopen(fileName.c_str(), "w+b");
+    if(!_file)
+        return DYB_OpenError;
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FileMagic, sizeof(FileMagic));
+    header.version = FileVersion;
+    header.channel = channel;
+    header.chunkSamples = chunkSamples;
+    header.headerBytes = sizeof(FileHeader);
+    header.chunkHeaderBytes = sizeof(ChunkHeader);
+    if(fwrite(&header, sizeof(header), 1, _file) != 1)
+        return DYB_Error;
+
+    _chunkSamples = chunkSamples;
+    _chunk = 0;
+    _samples = 0;
+    _nextRaw = 0;
+    _unwrap = 0;
+    _data.clear();
+    _data.reserve(chunkSamples);
+    memset(&_info, 0, sizeof(_info));
+    return DYB_Ok;
+}
+
+
+DYB_Rc TimeSeriesWriter::writeChunk()
+{
+    ChunkHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ChunkMagic, sizeof(ChunkMagic));
+    header.count = _info.count;
+    header.firstIndex = _info.firstIndex;
+    header.rawIndex = _info.rawIndex;
+    header.firstSample = _info.firstSample;
+    header.firstTimeNs = _info.firstTimeNs;
+    header.lastTimeNs = _info.lastTimeNs;
+    header.meta = _info.meta;
+
+    if(!seek64(_file, chunkOffset(_chunk, _chunkSamples)) ||
+       fwrite(&header, sizeof(header), 1, _file) != 1 ||
+       fwrite(_data.data(), sizeof(int32_t), _data.size(), _file) != _data.size())
+        return DYB_Error;
+    return DYB_Ok;
+}
+
+
+DYB_Rc TimeSeriesWriter::append(const int32_t index, const int32_t length, const int32_t *data,
+                                const DYB_Meta *meta)
+{
+    if(!_file)
+        return DYB_WrongContext;
+    if(length < 0 || (length > 0 && (!data || !meta)))
+        return DYB_OutOfRange;
+
+    const int64_t now = nowNs();
+    int32_t done = 0;
+
+    /* An index reset continues the unwrapped index where the data ended */
+    if(_samples > 0 && index < _nextRaw)
+        _unwrap += _nextRaw - index;
+    if(length > 0)
+        _nextRaw = static_cast<int64_t>(index) + length;
+
+    while(done < length)
+    {
+        /* A gap, an index reset or new meta data start a new chunk */
+        if(_info.count > 0 &&
+           (_info.count == _chunkSamples ||
+            static_cast<int64_t>(index) + done != static_cast<int64_t>(_info.rawIndex) + _info.count ||
+            memcmp(&_info.meta, meta, sizeof(DYB_Meta)) != 0))
+        {
+            const DYB_Rc rc = writeChunk();
+            if(rc != DYB_Ok)
+                return rc;
+            _chunk++;
+            _data.clear();
+            _info.count = 0;
+        }
+        if(_info.count == 0)
+        {
+            _info.firstIndex = _unwrap + index + done;
+            _info.rawIndex = index + done;
+            _info.firstSample = _samples;
+            _info.firstTimeNs = now;
+            _info.meta = *meta;
+        }
+
+        const int32_t n = std::min(length - done, _chunkSamples - _info.count);
+        _data.insert(_data.end(), data + done, data + done + n);
+        _info.count += n;
+        _info.lastTimeNs = now;
+        _samples += n;
+        done += n;
+    }
+    return DYB_Ok;
+}
+
+
+DYB_Rc TimeSeriesWriter::append(const DataPacket &packet)
+{
+    return append(packet.index, packet.length, packet.data, &packet.meta);
+}
+
+
+DYB_Rc TimeSeriesWriter::flush()
+{
+    if(!_file)
+        return DYB_WrongContext;
+    if(_info.count > 0 && writeChunk() != DYB_Ok)
+        return DYB_Error;
+    return fflush(_file) == 0 ? DYB_Ok : DYB_Error;
+}
+
+
+DYB_Rc TimeSeriesWriter::close()
+{
+    if(!_file)
+        return DYB_Ok;
+
+    DYB_Rc rc = flush();
+    if(fclose(_file) != 0)
+        rc = DYB_Error;
+    _file = NULL;
+    return rc;
+}
+
+
+/* ---------------------------------------------------------------------------
+ *  Reader
+ * ------------------------------------------------------------------------- */
+
+TimeSeriesReader::TimeSeriesReader()
+    : _file(NULL), _channel(-1), _chunkSamples(0), _chunks(0)
+{
+}
+
+
+TimeSeriesReader::~TimeSeriesReader()
+{
+    close();
+}
+
+
+DYB_Rc TimeSeriesReader::open(const std::string &fileName)
+{
+    close();
+    _file = fopen(fileName.c_str(), "rb");
+    if(!_file)
+        return DYB_OpenError;
+
+    FileHeader header;
+    if(fread(&header, sizeof(header), 1, _file) != 1 ||
+       memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0 ||
+       header.version != FileVersion || header.chunkSamples <= 0 ||
+       header.headerBytes != sizeof(FileHeader) || header.chunkHeaderBytes != sizeof(ChunkHeader) ||
+       !seek64(_file, 0, SEEK_END))
+    {
+        close();
+        return DYB_Error;
+    }
+
+    /* The last chunk may be shorter than its slot */
+    const int64_t slot = chunkOffset(1, header.chunkSamples) - chunkOffset(0, header.chunkSamples),
+                  body = tell64(_file) - static_cast<int64_t>(sizeof(FileHeader));
+    _channel = header.channel;
+    _chunkSamples = header.chunkSamples;
+    _chunks = body > 0 ? (body + slot - 1) / slot : 0;
+    return DYB_Ok;
+}
+
+
+void TimeSeriesReader::close()
+{
+    if(_file)
+        fclose(_file);
+    _file = NULL;
+    _chunks = 0;
+}
+
+
+DYB_Rc TimeSeriesReader::chunkInfo(const int64_t chunk, ChunkInfo &info)
+{
+    if(!_file || chunk < 0 || chunk >= _chunks)
+        return DYB_OutOfRange;
+
+    ChunkHeader header;
+    if(!seek64(_file, chunkOffset(chunk, _chunkSamples)) ||
+       fread(&header, sizeof(header), 1, _file) != 1 ||
+       memcmp(header.magic, ChunkMagic, sizeof(ChunkMagic)) != 0 ||
+       header.count < 0 || header.count > _chunkSamples)
+        return DYB_Error;
+
+    info.count = header.count;
+    info.firstIndex = header.firstIndex;
+    info.rawIndex = header.rawIndex;
+    info.firstSample = header.firstSample;
+    info.firstTimeNs = header.firstTimeNs;
+    info.lastTimeNs = header.lastTimeNs;
+    info.meta = header.meta;
+    return DYB_Ok;
+}
+
+
+DYB_Rc TimeSeriesReader::readChunk(const int64_t chunk, ChunkInfo &info, std::vector<int32_t> &data)
+{
+    const DYB_Rc rc = chunkInfo(chunk, info);
+    if(rc != DYB_Ok)
+        return rc;
+
+    /* The file position is right behind the chunk header */
+    data.resize(info.count);
+    if(fread(data.data(), sizeof(int32_t), info.count, _file) != static_cast<size_t>(info.count))
+        return DYB_Error;
+    return DYB_Ok;
+}
+
+
+template <typename Key>
+int64_t TimeSeriesReader::search(Key key)
+{
+    int64_t lo = 0,
+            hi = _chunks - 1;
+
+    if(_chunks == 0)
+        return -1;
+
+    /* Last chunk whose key is <= the searched value */
+    while(lo < hi)
+    {
+        const int64_t mid = lo + (hi - lo + 1) / 2;
+        ChunkInfo info;
+        if(chunkInfo(mid, info) != DYB_Ok)
+            return -1;
+        if(key(info))
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+
+int64_t TimeSeriesReader::findTime(const int64_t timeNs)
+{
+    return search([timeNs](const ChunkInfo &info) { return info.firstTimeNs <= timeNs; });
+}
+
+
+int64_t TimeSeriesReader::findIndex(const int64_t index)
+{
+    return search([index](const ChunkInfo &info) { return info.firstIndex <= index; });
+}
+
+
+DYB_Rc TimeSeriesReader::readIndexRange(const int64_t first, const int64_t last, ChunkHandler handler)
+{
+    if(!_file || last < first)
+        return DYB_OutOfRange;
+
+    for(int64_t chunk = findIndex(first); chunk >= 0 && chunk < _chunks; chunk++)
+    {
+        ChunkInfo info;
+        const DYB_Rc rc = readChunk(chunk, info, _data);
+        if(rc != DYB_Ok)
+            return rc;
+        if(info.firstIndex > last)
+            break;
+
+        const int64_t from = std::max(first, info.firstIndex),
+                      to = std::min(last, info.firstIndex + info.count - 1);
+        if(to < from)
+            continue;
+
+        const int32_t *data = _data.data() + (from - info.firstIndex);
+        info.firstSample += from - info.firstIndex;
+        info.rawIndex += static_cast<int32_t>(from - info.firstIndex);
+        info.firstIndex = from;
+        info.count = static_cast<int32_t>(to - from + 1);
+        handler(info, data);
+    }
+    return DYB_Ok;
+}
+
+
+DYB_Rc TimeSeriesReader::readTimeRange(const int64_t fromNs, const int64_t toNs, ChunkHandler handler)
+{
+    if(!_file || toNs < fromNs)
+        return DYB_OutOfRange;
+
+    for(int64_t chunk = findTime(fromNs); chunk >= 0 && chunk < _chunks; chunk++)
+    {
+        ChunkInfo info;
+        const DYB_Rc rc = readChunk(chunk, info, _data);
+        if(rc != DYB_Ok)
+            return rc;
+        if(info.firstTimeNs > toNs)
+            break;
+        if(info.lastTimeNs >= fromNs)
+            handler(info, _data.data());
+    }
+    return DYB_Ok;
+}
+
+} /* namespace asc500 */
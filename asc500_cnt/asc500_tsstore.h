@@ -0,0 +1,231 @@
+/** \file asc500_tsstore.h
+ * \brief Chunked binary store for long time series.
+ *
+ * For data that are not scanner triggered DYB_writeBuffer only writes csv,
+ * which is large and slow to parse for multi-day counter recordings. The
+ * store keeps the raw 32 bit samples of one channel in fixed size chunks:
+ *
+ *     file header (64 bytes)
+ *     chunk 0: chunk header (128 bytes), chunkSamples * int32
+ *     chunk 1: ...
+ *
+ * Every chunk slot has the same size, so chunk k is found at a computed
+ * offset. A chunk header holds the number of valid samples, the data index
+ * of the first sample, the running sample number, the wall clock time
+ * (ns since the epoch) of its first and last sample and the DYB_Meta of the
+ * data. A chunk is closed early if the index is not contiguous or the meta
+ * data change. The reader finds a time or index by binary search over the
+ * chunk headers and never scans the file.
+ *
+ * The library resets the data index from time to time (and every scan
+ * frame starts at 0), so the delivered index isn't ascending. The writer
+ * unwraps it into a continuous 64 bit index: a reset continues where the
+ * previous data ended, gaps are kept. The chunks store the unwrapped index
+ * for the search and the delivered one for reference.
+ *
+ * All numbers are stored in the byte order of the host (little endian on
+ * the supported platforms).
+ */
+
+#ifndef __ASC500_TSSTORE_H
+#define __ASC500_TSSTORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "daisybase.h"
+#include "asc500_spscring.h"
+
+
+namespace asc500
+{
+
+/** \brief Description of a chunk.
+ */
+struct ChunkInfo
+{
+    int32_t count;             /**< Number of valid samples                    */
+    int64_t firstIndex;        /**< Unwrapped data index of the first sample   */
+    int32_t rawIndex;          /**< Data index of the first sample as delivered */
+    int64_t firstSample;       /**< Number of samples stored before the chunk  */
+    int64_t firstTimeNs;       /**< Wall clock of the first sample [ns]        */
+    int64_t lastTimeNs;        /**< Wall clock of the last sample [ns]         */
+    DYB_Meta meta;             /**< Meta data of the samples                   */
+};
+
+
+class TimeSeriesWriter
+{
+public:
+    TimeSeriesWriter();
+    ~TimeSeriesWriter();
+
+    TimeSeriesWriter(const TimeSeriesWriter &) = delete;
+    TimeSeriesWriter &operator=(const TimeSeriesWriter &) = delete;
+
+    /** \brief Create a file; an existing file is overwritten.
+     *
+     * \param fileName const std::string& File name.
+     * \param channel const int32_t Data channel recorded (stored in the header).
+     * \param chunkSamples const int32_t Samples per chunk.
+     * \return DYB_Rc DYB_OpenError if the file can't be created.
+     *
+     */
+    DYB_Rc open(const std::string &fileName, const int32_t channel,
+                const int32_t chunkSamples = 65536);
+
+    /** \brief Append samples.
+     *
+     * \param index const int32_t Data index of the first sample.
+     * \param length const int32_t Number of samples.
+     * \param data const int32_t* Samples.
+     * \param meta const DYB_Meta* Meta data of the samples.
+     * \return DYB_Rc DYB_Error on write errors, DYB_WrongContext if not open.
+     *
+     */
+    DYB_Rc append(const int32_t index, const int32_t length, const int32_t *data,
+                  const DYB_Meta *meta);
+
+    /** \brief Append a packet from an Acquisition ring.
+     *
+     * \param packet const DataPacket& The packet.
+     * \return DYB_Rc See above.
+     *
+     */
+    DYB_Rc append(const DataPacket &packet);
+
+    /** \brief Write the incomplete current chunk; appending continues in it.
+     *
+     * \return DYB_Rc DYB_Error on write errors.
+     *
+     */
+    DYB_Rc flush();
+
+    /** \brief Flush and close the file.
+     *
+     * \return DYB_Rc DYB_Error on write errors.
+     *
+     */
+    DYB_Rc close();
+
+    uint64_t samples() const { return _samples; }  /**< Samples appended      */
+    int64_t chunks() const { return _chunk + (_info.count > 0 ? 1 : 0); } /**< Chunks used */
+
+private:
+    DYB_Rc writeChunk();
+
+    FILE *_file;
+    int32_t _chunkSamples;
+    int64_t _chunk;            /* Slot of the current chunk                   */
+    uint64_t _samples;
+    int64_t _nextRaw;          /* Delivered index expected next               */
+    int64_t _unwrap;           /* Unwrapped minus delivered index             */
+    ChunkInfo _info;           /* Header of the current chunk                 */
+    std::vector<int32_t> _data;
+};
+
+
+class TimeSeriesReader
+{
+public:
+    typedef std::function<void(const ChunkInfo &, const int32_t *)> ChunkHandler;
+
+    TimeSeriesReader();
+    ~TimeSeriesReader();
+
+    TimeSeriesReader(const TimeSeriesReader &) = delete;
+    TimeSeriesReader &operator=(const TimeSeriesReader &) = delete;
+
+    /** \brief Open a file written by TimeSeriesWriter.
+     *
+     * \param fileName const std::string& File name.
+     * \return DYB_Rc DYB_OpenError if it can't be opened, DYB_Error if the
+     *         format is not recognized.
+     *
+     */
+    DYB_Rc open(const std::string &fileName);
+
+    /** \brief Close the file. */
+    void close();
+
+    int32_t channel() const { return _channel; }         /**< Recorded channel */
+    int32_t chunkSamples() const { return _chunkSamples; } /**< Samples per chunk */
+    int64_t chunks() const { return _chunks; }           /**< Chunks in the file */
+
+    /** \brief Read the header of a chunk.
+     *
+     * \param chunk const int64_t Chunk number.
+     * \param info ChunkInfo& Output: chunk header.
+     * \return DYB_Rc DYB_OutOfRange if there is no such chunk.
+     *
+     */
+    DYB_Rc chunkInfo(const int64_t chunk, ChunkInfo &info);
+
+    /** \brief Read a chunk.
+     *
+     * \param chunk const int64_t Chunk number.
+     * \param info ChunkInfo& Output: chunk header.
+     * \param data std::vector<int32_t>& Output: info.count samples.
+     * \return DYB_Rc DYB_OutOfRange if there is no such chunk.
+     *
+     */
+    DYB_Rc readChunk(const int64_t chunk, ChunkInfo &info, std::vector<int32_t> &data);
+
+    /** \brief Chunk holding a wall clock time.
+     *
+     * \param timeNs const int64_t Time [ns since the epoch].
+     * \return int64_t Last chunk starting at or before the time; 0 if the
+     *         time precedes the file, -1 if the file is empty.
+     *
+     */
+    int64_t findTime(const int64_t timeNs);
+
+    /** \brief Chunk holding a data index.
+     *
+     * \param index const int64_t Unwrapped data index.
+     * \return int64_t Last chunk starting at or before the index; 0 if the
+     *         index precedes the file, -1 if the file is empty.
+     *
+     */
+    int64_t findIndex(const int64_t index);
+
+    /** \brief Visit the samples of a data index range.
+     *
+     * The handler is called per chunk with the part inside the range;
+     * info.firstIndex and info.count describe that part.
+     *
+     * \param first const int64_t First unwrapped data index.
+     * \param last const int64_t Last unwrapped data index (inclusive).
+     * \param handler ChunkHandler Receives the data.
+     * \return DYB_Rc DYB_Error on read errors.
+     *
+     */
+    DYB_Rc readIndexRange(const int64_t first, const int64_t last, ChunkHandler handler);
+
+    /** \brief Visit the chunks overlapping a time range.
+     *
+     * \param fromNs const int64_t Start time [ns since the epoch].
+     * \param toNs const int64_t End time [ns since the epoch].
+     * \param handler ChunkHandler Receives the data of whole chunks.
+     * \return DYB_Rc DYB_Error on read errors.
+     *
+     */
+    DYB_Rc readTimeRange(const int64_t fromNs, const int64_t toNs, ChunkHandler handler);
+
+private:
+    template <typename Key>
+    int64_t search(Key key);
+
+    FILE *_file;
+    int32_t _channel;
+    int32_t _chunkSamples;
+    int64_t _chunks;
+    std::vector<int32_t> _data;
+};
+
+} /* namespace asc500 */
+
+#endif
@@ -7,6 +7,10 @@
 #include "daisybase.h"
 #include "daisydata.h"
 #include "asc500.h"
+#include "asc500_batch.h"
+#include "asc500_eventqueue.h"
+#include "asc500_framepool.h"
+#include "asc500_framewriter.h"
 #include <windows.h>
 
 /** \brief Print error code if return is not "Ok".
@@ -47,139 +51,112 @@ static void setParameter(const int32_t id, const int32_t index, const int32_t va
 
 /** \brief Wait for the first full buffer and write it to a file.
  *
+ * \param pool asc500::FramePool& Pool the pump fetches the buffers from.
+ * \param events asc500::EventQueue& Queue whose pump fetches the buffers.
+ * \param since const uint64_t Event sequence before the acquisition started.
  * \param channel_no const int32_t Input channel number.
- * \param framesize const int32_t Size of the data frame.
  * \return DYB_Rc Checks for success or failure.
  *
  */
-static DYB_Rc pollDataFull(const int32_t channel_no, const int32_t framesize)
+static DYB_Rc pollDataFull(asc500::FramePool &pool, asc500::EventQueue &events, const uint64_t since,
+                           const int32_t channel_no)
 {
     DYB_Rc rc = DYB_Ok;
-    int32_t *frame = new int32_t[framesize];
-    int32_t event = 0,
-            index = 0,
-            dataSize = framesize;
-    DYB_Meta meta;
+    int32_t event = 0;
 
-    /* Wait for full buffer and show progress */
+    /* Wait for full buffer; returns at once if it has been full already */
     while(event == 0 /* means timeout */ && rc == DYB_Ok)
-        event = DYB_waitForEvent(500, DYB_EVT_DATA_00, 0 /* not relevant */);
+        event = events.waitSince(since, DYB_EVT_DATA_00, 500);
 
-    /* Read and print data frame */
-    assert(rc == DYB_Ok);
+    /* Take the frame the pump has fetched */
+    asc500::FrameBuffer *frame = events.takeFrame(channel_no);
+    assert(frame != NULL);
 
     fprintf(stdout,
             "Reading frame; buffer size = %d, frame size = %d\n",
-            dataSize,
+            frame->capacity,
             DYB_getFrameSize(channel_no));
 
-    rc = DYB_getDataBuffer(channel_no,
-                           1,
-                           NULL /* ignore */,
-                           &index,
-                           &dataSize,
-                           frame,
-                           &meta);
-    checkRc("DYB_getDataBuffer", rc, __LINE__);
-
-    rc = DYB_writeBuffer("data_output//demo_fwd", "ADC2", 0, 1, index, dataSize, frame, &meta);
+    rc = DYB_writeBuffer("data_output//demo_fwd", "ADC2", 0, 1, frame->index, frame->dataSize, frame->data, &frame->meta);
     checkRc("DYB_writeBuffer", rc, __LINE__);
-    rc = DYB_writeBuffer("data_output//demo_bwd", "ADC2", 0, 0, index, dataSize, frame, &meta);
+    rc = DYB_writeBuffer("data_output//demo_bwd", "ADC2", 0, 0, frame->index, frame->dataSize, frame->data, &frame->meta);
     checkRc("DYB_writeBuffer", rc, __LINE__);
 
-    delete[] frame;
+    pool.release(frame);
     return rc;
 }
 
 
 /** \brief Polls data now without waiting for event.
  *
+ * \param pool asc500::FramePool& Pool providing the data buffer.
  * \param channel_no const int32_t Input channel number.
  * \param buffersize const int32_t Size of the data buffer.
  * \return DYB_Rc Checks for success or failure.
  *
  */
-static DYB_Rc pollDataNow(const int32_t channel_no, const int32_t buffersize)
+static DYB_Rc pollDataNow(asc500::FramePool &pool, const int32_t channel_no, const int32_t buffersize)
 {
-    int32_t framesize = DYB_getFrameSize(channel_no),
-            index = 0;
-    int32_t *buffer = new int32_t[buffersize],
-            dataSize = buffersize;
+    int32_t framesize = DYB_getFrameSize(channel_no);
+    asc500::PooledFrame buffer(pool, channel_no, buffersize);
 
     DYB_Rc rc = DYB_Ok;
-    DYB_Meta meta;
 
     fprintf(stdout,
             "Reading data; buffer size = %d, frame size = %d\n",
-            dataSize, framesize);
+            buffer->capacity, framesize);
 
 
-    rc = DYB_getDataBuffer(channel_no,
-                           1, /* Get data only when buffer is full. */
-                           0, /* Output: number of the frame, ignore. */
-                           &index, /* Output: index of first element in buffer. */
-                           &dataSize, /* In/Output: number of valid data in buffer. */
-                           buffer, /* Allocated buffer. */
-                           &meta);
+    rc = asc500::FramePool::fill(buffer.get(),
+                                 1); /* Get data only when buffer is full. */
     checkRc("DYB_getDataBuffer", rc, __LINE__);
 
     rc = DYB_writeBuffer("data_output//demo_fwd",
                          "Counter", /* Comment */
                          0, /* Ignore */
                          0, /* Fwd/Bwd direction, not relevant. */
-                         index,
-                         dataSize,
-                         buffer,
-                         &meta);
+                         buffer->index,
+                         buffer->dataSize,
+                         buffer->data,
+                         &buffer->meta);
     checkRc("DYB_writeBuffer", rc, __LINE__);
 
-    delete[] buffer;
     return rc;
 }
 
 
 /** \brief Cyclically read incomplete frame and write it to a file.
  *
+ * \param pool asc500::FramePool& Pool providing the frame buffers.
  * \param channel_no const int32_t Input channel number.
  * \param framesize const int32_t Size of the data frame.
  * \return DYB_Rc Checks for success or failure.
  *
  */
-static DYB_Rc pollDataPartial(const int32_t channel_no, const int32_t framesize)
+static DYB_Rc pollDataPartial(asc500::FramePool &pool, const int32_t channel_no, const int32_t framesize)
 {
     DYB_Rc rc = DYB_Ok;
     int loop = 0;
+    /* One file per frame; each loop appends only the lines completed meanwhile */
+    asc500::FrameWriter writer("data_output//demo_fwd", "ADC2", false, true);
 
     while(rc == DYB_Ok && loop < 10)
     {
-        int32_t *frame = new int32_t[framesize];
-        DYB_Meta meta;
-        int32_t index = 0,
-                frameNo = 0,
-                dataSize = framesize;
-        char fn[128];
+        /* Recycled from the previous loop as long as the frame size is unchanged */
+        asc500::PooledFrame frame(pool, channel_no, framesize);
 
         Sleep(200);
         /* Read as much data as available */
-        rc = DYB_getDataBuffer(channel_no,
-                               0,
-                               &frameNo,
-                               &index,
-                               &dataSize,
-                               frame,
-                               &meta);
+        rc = asc500::FramePool::fill(frame.get(), 0);
         checkRc("DYB_getDataBuffer", rc, __LINE__);
-        fprintf(stdout, "Data Read: loop %2d frame %d, index %d, size %d\n", loop, frameNo, index, dataSize);
+        fprintf(stdout, "Data Read: loop %2d frame %d, index %d, size %d\n", loop, frame->frameNo, frame->index, frame->dataSize);
 
-        if(dataSize > 0)
+        if(frame->dataSize > 0)
         {
-            /* Writing empty buffer ends up with error */
-            sprintf(fn, "data_output//demo_fwd_%d", loop);
-            rc = DYB_writeBuffer(fn, "ADC2", 0, 1, index, dataSize, frame, &meta);
-            checkRc("DYB_writeBuffer", rc, __LINE__);
+            rc = writer.update(*frame.get());
+            checkRc("FrameWriter::update", rc, __LINE__);
         }
         loop++;
-        delete[] frame;
     }
 
     return rc;
@@ -201,7 +178,7 @@ int main(int argc, char **argv)
             pixelsize = 1000, /* Width of a column/line [10pm] */
             sampletime = 100, /* Scanner sample time in multiples of 2.5us */
             framesize = columns * lines * 2; /* Amount of data in a frame */
-
+    asc500::FramePool pool;
 
     if(argc > 1)
         variant = atoi(argv[1]); /* Selects data acquisition variant */
@@ -212,6 +189,9 @@ int main(int argc, char **argv)
     ret = DYB_run();
     checkRc("DYB_Run", ret, __LINE__);
 
+    /* Registers the event callback, so only after DYB_init */
+    asc500::EventQueue events;
+
     /* Configure the scanner by sending a profile. */
     ret = DYB_sendProfile(profile_path.c_str());
     checkRc("DYB_sendProfile", ret, __LINE__);
@@ -234,14 +214,29 @@ int main(int argc, char **argv)
     setParameter(ID_SCAN_X_EQ_Y,  0, 0);
     setParameter(ID_SCAN_GEOMODE, 0, 0);
 
-    /* Adjust parameters */
-    setParameter(ID_SCAN_PIXEL, 0, pixelsize);
-    setParameter(ID_SCAN_COLUMNS, 0, columns);
-    setParameter(ID_SCAN_LINES, 0, lines);
-    setParameter(ID_SCAN_OFFSET_X, 0, 150 * pixelsize);
-    setParameter(ID_SCAN_OFFSET_Y, 0, 150 * pixelsize);
-    setParameter(ID_SCAN_MSPPX, 0, sampletime);
-    setParameter(ID_CNT_EXP_TIME, 0, sampletime);
+    /* Adjust parameters; one wait for all acknowledgements */
+    asc500::ParamEntry scan[] = {
+        { ID_SCAN_PIXEL,    0, pixelsize,       0, false },
+        { ID_SCAN_COLUMNS,  0, columns,         0, false },
+        { ID_SCAN_LINES,    0, lines,           0, false },
+        { ID_SCAN_OFFSET_X, 0, 150 * pixelsize, 0, false },
+        { ID_SCAN_OFFSET_Y, 0, 150 * pixelsize, 0, false },
+        { ID_SCAN_MSPPX,    0, sampletime,      0, false },
+        { ID_CNT_EXP_TIME,  0, sampletime,      0, false }
+    };
+    const size_t scanParams = sizeof(scan) / sizeof(scan[0]);
+    const DYB_Rc scanRc = asc500::setParameterBatch(scan, scanParams);
+    checkRc("setParameterBatch", scanRc, __LINE__);
+    if(asc500::countLimited(scan, scanParams) > 0)
+        fprintf(stdout, "Some scan parameters have been limited by the server\n");
+
+    /* Collect full buffers from now on; the other variants read the channel themselves */
+    if(variant == 0)
+    {
+        ret = events.pumpData(pool, DYB_EVT_DATA_00);
+        checkRc("EventQueue::pumpData", ret, __LINE__);
+    }
+    const uint64_t dataSince = events.sequence();
 
     /* Enable Outputs, wait for success (use polling for demonstration). */
     setParameter(ID_OUTPUT_ACTIVATE, 0, 1);
@@ -258,18 +253,20 @@ int main(int argc, char **argv)
     switch(variant)
     {
     case 0:
-        ret = pollDataFull(channel_no, framesize);
+        ret = pollDataFull(pool, events, dataSince, channel_no);
         break;
     case 1:
-        ret = pollDataPartial(channel_no, framesize);
+        ret = pollDataPartial(pool, channel_no, framesize);
         break;
     default:
-        ret = pollDataNow(channel_no, buffer_size);
+        ret = pollDataNow(pool, channel_no, buffer_size);
     }
 
     /* Stop it and exit. This time use wait for event instead of polling */
+    const uint64_t stopSince = events.sequence();
     setParameter(ID_OUTPUT_ACTIVATE, 0, 0);
-    DYB_waitForEvent(1000, DYB_EVT_CUSTOM, ID_OUTPUT_STATUS);
+    events.waitSince(stopSince, DYB_EVT_CUSTOM, 1000, NULL, ID_OUTPUT_STATUS);
+    events.stopPump();
     DYB_getParameterSync(ID_OUTPUT_STATUS, 0, &outActive);
     if(outActive)
         fprintf(stdout, "Outputs are not deactivated!\n");
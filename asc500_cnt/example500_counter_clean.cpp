@@ -7,6 +7,7 @@
 #include "daisybase.h"
 #include "daisydata.h"
 #include "asc500.h"
+#include "asc500_framepool.h"
 #include <windows.h>
 
 /** \brief Print error code if return is not "Ok".
@@ -47,28 +48,23 @@ static void setParameter(const int32_t id, const int32_t index, const int32_t va
 
 /** \brief Polls data now without waiting for event.
  *
+ * \param pool asc500::FramePool& Pool providing the data buffer.
  * \param channel_no const int32_t Input channel number.
  * \param buffersize const int32_t Size of the data buffer.
  * \return DYB_Rc Checks for success or failure.
  *
  */
-static DYB_Rc pollDataNow(const int32_t channel_no, const int32_t buffersize)
+static DYB_Rc pollDataNow(asc500::FramePool &pool, const int32_t channel_no, const int32_t buffersize)
 {
     int32_t framesize = DYB_getFrameSize(channel_no),
-            frameno = 0,
-            event = 0,
-            index = 0;
-    int32_t *buffer = new int32_t[buffersize],
-            dataSize = buffersize;
-
-    memset(buffer, 0xDEAD, sizeof(int32_t));
+            event = 0;
+    asc500::PooledFrame buffer(pool, channel_no, buffersize);
 
     DYB_Rc rc = DYB_Ok;
-    DYB_Meta meta;
 
     fprintf(stdout,
             "Reading data; buffer size = %d, frame size = %d\n",
-            dataSize, framesize);
+            buffer->capacity, framesize);
 
     /* Wait for full buffer and show progress */
     while(event == 0 /* means timeout */)
@@ -76,30 +72,24 @@ static DYB_Rc pollDataNow(const int32_t channel_no, const int32_t buffersize)
                                  DYB_EVT_DATA_00, /* Buffer full */
                                  0 /* custom ID: ignore */);
 
-    rc = DYB_getDataBuffer(channel_no,
-                           0, /* Get data only when buffer is full. */
-                           &frameno, /* Output: number of the frame, ignore. */
-                           &index, /* Output: index of first element in buffer. */
-                           &dataSize, /* In/Output: number of valid data in buffer. */
-                           buffer, /* Allocated buffer. */
-                           &meta);
+    rc = asc500::FramePool::fill(buffer.get(),
+                                 0); /* Also partially filled buffers. */
     checkRc("DYB_getDataBuffer", rc, __LINE__);
 
     fprintf(stdout,
             "Output buffer size = %d\n",
-            dataSize);
+            buffer->dataSize);
 
     rc = DYB_writeBuffer("data_output//demo_fwd",
                          "Counter", /* Comment */
                          0, /* Ignore */
                          0, /* Fwd/Bwd direction, not relevant. */
-                         index,
-                         dataSize,
-                         buffer,
-                         &meta);
+                         buffer->index,
+                         buffer->dataSize,
+                         buffer->data,
+                         &buffer->meta);
     checkRc("DYB_writeBuffer", rc, __LINE__);
 
-    delete[] buffer;
     return rc;
 }
 
@@ -112,6 +102,7 @@ int main(int argc, char **argv)
             channel_no = 0,
             exp_time = 1; /* Scanner sample time in multiples of 2.5 us */
     double sampletime = 1e-3;
+    asc500::FramePool pool;
 
     /* Initialize & start */
     ret = DYB_init(nullptr, bin_path.c_str(), nullptr, ASC500_PORT_NUMBER);
@@ -138,7 +129,7 @@ int main(int argc, char **argv)
     /* Adjust parameters */
     setParameter(ID_CNT_EXP_TIME, 0, exp_time);
 
-    ret = pollDataNow(channel_no, buffer_size);
+    ret = pollDataNow(pool, channel_no, buffer_size);
 
     /* Stop it and exit. This time use wait for event instead of polling */
     int32_t outActive = 0;
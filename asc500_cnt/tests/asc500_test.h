@@ -0,0 +1,63 @@
+/** \file asc500_test.h
+ * \brief Minimal support for self-checking test programs.
+ *
+ * Every test is a console program. A failed CHECK prints the expression
+ * and its location; result() prints a summary and gives the exit code,
+ * 0 if all checks have passed.
+ */
+
+#ifndef __ASC500_TEST_H
+#define __ASC500_TEST_H
+
+#include <cmath>
+#include <cstdio>
+
+
+namespace asc500test
+{
+
+inline int &failures()
+{
+    static int count = 0;
+    return count;
+}
+
+
+inline bool check(const bool ok, const char *expr, const char *file, const int line)
+{
+    if(!ok)
+    {
+        fprintf(stdout, "%s:%d: check failed: %s\n", file, line, expr);
+        failures()++;
+    }
+    return ok;
+}
+
+
+inline bool checkNear(const double value, const double expected, const double tolerance,
+                      const char *expr, const char *file, const int line)
+{
+    const bool ok = std::fabs(value - expected) <= tolerance;
+    if(!ok)
+    {
+        fprintf(stdout, "%s:%d: check failed: %s = %.9g, expected %.9g +- %.3g\n",
+                file, line, expr, value, expected, tolerance);
+        failures()++;
+    }
+    return ok;
+}
+
+
+inline int result(const char *name)
+{
+    fprintf(stdout, "%s: %s (%d failed)\n", name, failures() == 0 ? "passed" : "FAILED", failures());
+    return failures() == 0 ? 0 : 1;
+}
+
+} /* namespace asc500test */
+
+#define CHECK(expr) asc500test::check((expr), #expr, __FILE__, __LINE__)
+#define CHECK_NEAR(value, expected, tolerance) \
+    asc500test::checkNear((value), (expected), (tolerance), #value, __FILE__, __LINE__)
+
+#endif
@@ -0,0 +1,607 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "daisydata.h"
+#include "asc500.h"
+#include "daisybase_stub.h"
+
+
+namespace dybstub
+{
+
+typedef std::pair<DYB_Address, int32_t> Key;
+
+struct Event
+{
+    DYB_Address address;
+    int32_t index;
+    int32_t value;
+};
+
+struct Frame
+{
+    int32_t frameNo;
+    int32_t index;
+    std::vector<int32_t> data;
+    DYB_Meta meta;
+};
+
+static std::mutex s_lock;
+static std::map<Key, int32_t> s_parameters;
+static std::map<DYB_Address, std::pair<int32_t, int32_t> > s_limits;
+static std::multimap<DYB_Address, std::pair<DYB_Address, int32_t> > s_sideEffects;
+static std::map<DYB_Address, DYB_EventCallback> s_callbacks;
+static DYB_EventCallback s_catchAll = NULL;
+static bool s_deferred = false;
+static std::vector<Event> s_held;
+static std::deque<Frame> s_frames[ASC500_DATA_CHANNELS];
+static int32_t s_frameSize[ASC500_DATA_CHANNELS];
+static int32_t s_requests = 0;
+static std::function<void()> s_syncReadHook;
+static std::function<DYB_Rc(const char *, Int32, const Int32 *)> s_writeHook;
+static std::map<int32_t, Flt32> s_value2Phys;
+
+
+void reset()
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_parameters.clear();
+    s_limits.clear();
+    s_sideEffects.clear();
+    s_deferred = false;
+    s_held.clear();
+    for(int32_t channel = 0; channel < ASC500_DATA_CHANNELS; channel++)
+    {
+        s_frames[channel].clear();
+        s_frameSize[channel] = 0;
+    }
+    s_requests = 0;
+    s_syncReadHook = std::function<void()>();
+    s_writeHook = std::function<DYB_Rc(const char *, Int32, const Int32 *)>();
+    s_value2Phys.clear();
+}
+
+
+void setSyncReadHook(std::function<void()> hook)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_syncReadHook = hook;
+}
+
+
+void setWriteHook(std::function<DYB_Rc(const char *, Int32, const Int32 *)> hook)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_writeHook = hook;
+}
+
+
+void setParameter(const DYB_Address address, const int32_t index, const int32_t value)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_parameters[Key(address, index)] = value;
+}
+
+
+int32_t parameter(const DYB_Address address, const int32_t index)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    std::map<Key, int32_t>::const_iterator found = s_parameters.find(Key(address, index));
+    return found == s_parameters.end() ? 0 : found->second;
+}
+
+
+void setLimit(const DYB_Address address, const int32_t min, const int32_t max)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_limits[address] = std::make_pair(min, max);
+}
+
+
+void addSideEffect(const DYB_Address trigger, const DYB_Address target, const int32_t value)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_sideEffects.insert(std::make_pair(trigger, std::make_pair(target, value)));
+}
+
+
+int32_t requests()
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    return s_requests;
+}
+
+
+void queueFrame(const int32_t channel, const int32_t frameNo, const int32_t index,
+                const std::vector<int32_t> &data, const DYB_Meta &meta)
+{
+    Frame frame;
+    frame.frameNo = frameNo;
+    frame.index = index;
+    frame.data = data;
+    frame.meta = meta;
+
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_frames[channel].push_back(frame);
+}
+
+
+void setFrameSize(const int32_t channel, const int32_t size)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_frameSize[channel] = size;
+}
+
+
+void setValue2Phys(const std::map<int32_t, Flt32> &table)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_value2Phys = table;
+}
+
+
+DYB_Meta scanMeta(const DYB_Order order, const int32_t pointsX, const int32_t pointsY)
+{
+    DYB_Meta meta;
+    memset(&meta, 0, sizeof(meta));
+    meta._order = order;
+    meta._pointsX = pointsX;
+    meta._pointsY = pointsY;
+    meta._stepX = 1.0f;
+    meta._stepY = 1.0f;
+    meta._unitXY = DYB_UnitNm;
+    meta._stepVal = 1.0f;
+    meta._stepValNum = 1.0f;
+    meta._unitVal = DYB_UnitLSB;
+    return meta;
+}
+
+
+/* Delivers events outside the lock, as the event loop of daisybase does */
+static void deliver(const std::vector<Event> &events)
+{
+    for(const Event &event : events)
+    {
+        DYB_EventCallback callback = NULL;
+        {
+            std::lock_guard<std::mutex> lock(s_lock);
+            std::map<DYB_Address, DYB_EventCallback>::const_iterator found = s_callbacks.find(event.address);
+            callback = found != s_callbacks.end() ? found->second : s_catchAll;
+        }
+        if(callback)
+            callback(event.address, event.index, event.value);
+    }
+}
+
+
+/* Stores a value as the server does; s_lock must be held */
+static Event store(const DYB_Address address, const int32_t index, int32_t value)
+{
+    std::map<DYB_Address, std::pair<int32_t, int32_t> >::const_iterator limit = s_limits.find(address);
+    if(limit != s_limits.end())
+        value = value < limit->second.first ? limit->second.first :
+                value > limit->second.second ? limit->second.second : value;
+    s_parameters[Key(address, index)] = value;
+
+    Event event;
+    event.address = address;
+    event.index = index;
+    event.value = value;
+    return event;
+}
+
+
+/* Delivers the events of a request, or holds them back */
+static void answer(const std::vector<Event> &events)
+{
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        if(s_deferred)
+        {
+            s_held.insert(s_held.end(), events.begin(), events.end());
+            return;
+        }
+    }
+    deliver(events);
+}
+
+
+void setDeferred(const bool deferred)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_deferred = deferred;
+}
+
+
+int32_t flush()
+{
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        events.swap(s_held);
+    }
+    deliver(events);
+    return static_cast<int32_t>(events.size());
+}
+
+
+void notify(const DYB_Address address, const int32_t index, const int32_t value)
+{
+    std::vector<Event> events(1);
+    events[0].address = address;
+    events[0].index = index;
+    events[0].value = value;
+    deliver(events);
+}
+
+} /* namespace dybstub */
+
+
+using namespace dybstub;
+
+
+/* ----------------------------------------------------------------------
+ *  daisybase.h
+ * ---------------------------------------------------------------------- */
+
+DYB_Rc DYB_init(const char *, const char *, const char *, unsigned short)
+{
+    return DYB_Ok;
+}
+
+
+DYB_Rc DYB_run(void)
+{
+    return DYB_Ok;
+}
+
+
+DYB_Rc DYB_stop(void)
+{
+    return DYB_Ok;
+}
+
+
+DYB_Rc DYB_reset(void)
+{
+    return DYB_Ok;
+}
+
+
+DYB_Rc DYB_setDataCallback(Int32 channel, DYB_DataCallback)
+{
+    return channel >= 0 && channel < ASC500_DATA_CHANNELS ? DYB_Ok : DYB_OutOfRange;
+}
+
+
+DYB_Rc DYB_setEventCallback(DYB_Address address, DYB_EventCallback callback)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    if(address == -1)
+        s_catchAll = callback;
+    else if(callback)
+        s_callbacks[address] = callback;
+    else
+        s_callbacks.erase(address);
+    return DYB_Ok;
+}
+
+
+DYB_Rc DYB_setParameterAsync(DYB_Address address, Int32 index, Int32 value)
+{
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        s_requests++;
+        events.push_back(store(address, index, value));
+
+        typedef std::multimap<DYB_Address, std::pair<DYB_Address, int32_t> >::const_iterator Effect;
+        std::pair<Effect, Effect> effects = s_sideEffects.equal_range(address);
+        for(Effect effect = effects.first; effect != effects.second; ++effect)
+            events.push_back(store(effect->second.first, 0, effect->second.second));
+    }
+    answer(events);
+    return DYB_Ok;
+}
+
+
+DYB_Rc DYB_setParameterSync(DYB_Address address, Int32 index, Int32 value, Int32 *returned)
+{
+    DYB_setParameterAsync(address, index, value);
+    if(returned)
+        *returned = parameter(address, index);
+    return DYB_Ok;
+}
+
+
+DYB_Rc DYB_getParameterAsync(DYB_Address address, Int32 index)
+{
+    std::vector<Event> events(1);
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        s_requests++;
+        events[0].address = address;
+        events[0].index = index;
+        events[0].value = s_parameters[Key(address, index)];
+    }
+    answer(events);
+    return DYB_Ok;
+}
+
+
+DYB_Rc DYB_getParameterSync(DYB_Address address, Int32 index, Int32 *data)
+{
+    *data = parameter(address, index);
+
+    std::function<void()> hook;
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        hook = s_syncReadHook;
+    }
+    if(hook)
+        hook();
+    return DYB_Ok;
+}
+
+
+DYB_Rc DYB_sendProfile(const char *)
+{
+    return DYB_Ok;
+}
+
+
+/* ----------------------------------------------------------------------
+ *  daisydata.h
+ * ---------------------------------------------------------------------- */
+
+const char *DYB_printRc(DYB_Rc rc)
+{
+    static const char *const texts[] = { "Ok", "Error", "Timeout", "NotConnected", "DriverError",
+                                         "FileNotFound", "SrvNotFound", "ServerLost", "OutOfRange",
+                                         "WrongContext", "XmlError", "OpenError" };
+    return rc >= DYB_Ok && rc <= DYB_OpenError ? texts[rc] : "????";
+}
+
+
+const char *DYB_printUnit(DYB_Unit)
+{
+    return "?";
+}
+
+
+DYB_Rc DYB_configureChannel(Int32 number, Int32, Int32, Bln32, double)
+{
+    return number >= 0 && number < ASC500_DATA_CHANNELS ? DYB_Ok : DYB_OutOfRange;
+}
+
+
+DYB_Rc DYB_getChannelConfig(Int32 number, Int32 *trigger, Int32 *source, Bln32 *average, double *smpTime)
+{
+    *trigger = 0;
+    *source = 0;
+    *average = 0;
+    *smpTime = 0.0;
+    return number >= 0 && number < ASC500_DATA_CHANNELS ? DYB_Ok : DYB_OutOfRange;
+}
+
+
+DYB_Rc DYB_configureDataBuffering(Int32 channel, Int32 size)
+{
+    if(channel < 0 || channel >= ASC500_DATA_CHANNELS || size < 0)
+        return DYB_OutOfRange;
+    setFrameSize(channel, size);
+    return DYB_Ok;
+}
+
+
+Int32 DYB_getFrameSize(Int32 channel)
+{
+    if(channel < 0 || channel >= ASC500_DATA_CHANNELS)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(s_lock);
+    return s_frames[channel].empty() ? s_frameSize[channel] :
+           static_cast<Int32>(s_frames[channel].front().data.size());
+}
+
+
+DYB_Rc DYB_getDataBuffer(Int32 channel, Bln32, Int32 *frameNo, Int32 *index, Int32 *dataSize,
+                         Int32 *data, DYB_Meta *meta)
+{
+    if(channel < 0 || channel >= ASC500_DATA_CHANNELS)
+        return DYB_OutOfRange;
+
+    std::lock_guard<std::mutex> lock(s_lock);
+    if(s_frames[channel].empty())
+        return DYB_OutOfRange;
+
+    const Frame &frame = s_frames[channel].front();
+    if(*dataSize < static_cast<Int32>(frame.data.size()))
+        return DYB_OutOfRange;
+
+    *frameNo = frame.frameNo;
+    *index = frame.index;
+    *dataSize = static_cast<Int32>(frame.data.size());
+    if(!frame.data.empty())
+        memcpy(data, frame.data.data(), frame.data.size() * sizeof(Int32));
+    *meta = frame.meta;
+    s_frames[channel].pop_front();
+    return DYB_Ok;
+}
+
+
+DYB_Rc DYB_writeBuffer(const char *fileName, const char *, Bln32, Bln32, Int32, Int32 dataSize,
+                       const Int32 *data, const DYB_Meta *)
+{
+    std::function<DYB_Rc(const char *, Int32, const Int32 *)> hook;
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        hook = s_writeHook;
+    }
+    return hook ? hook(fileName, dataSize, data) : DYB_Ok;
+}
+
+
+Int32 DYB_waitForEvent(Int32 timeout, Int32 eventMask, Int32)
+{
+    Int32 events = 0;
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        for(int32_t channel = 0; channel < ASC500_DATA_CHANNELS; channel++)
+        {
+            if(!s_frames[channel].empty())
+                events |= DYB_EVT_DATA_00 << channel;
+        }
+    }
+    events &= eventMask;
+
+    /* Parameter events are not reported here; the tests use the callbacks */
+    if(events == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout < 5 ? timeout : 5));
+    return events;
+}
+
+
+/* ----------------------------------------------------------------------
+ *  metadata.h: first frame bottom to top, columns by DYB_Order
+ * ---------------------------------------------------------------------- */
+
+static bool isScan(const DYB_Meta *meta)
+{
+    return meta->_order >= DYB_FfScan && meta->_order <= DYB_BfScan &&
+           meta->_pointsX > 0 && meta->_pointsY > 0;
+}
+
+
+DYB_Order DYB_getOrder(const DYB_Meta *meta)
+{
+    return meta->_order;
+}
+
+
+DYB_MRc DYB_getPointsX(const DYB_Meta *meta, Int32 *pointsX)
+{
+    *pointsX = meta->_pointsX;
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc DYB_getPointsY(const DYB_Meta *meta, Int32 *pointsY)
+{
+    if(!isScan(meta))
+        return DYB_MetaNotApp;
+    *pointsY = meta->_pointsY;
+    return DYB_MetaOk;
+}
+
+
+DYB_Unit DYB_getUnitXY(const DYB_Meta *meta)
+{
+    return meta->_unitXY;
+}
+
+
+DYB_Unit DYB_getUnitVal(const DYB_Meta *meta)
+{
+    return meta->_unitVal;
+}
+
+
+DYB_MRc DYB_getRotation(const DYB_Meta *meta, Flt32 *rotation)
+{
+    if(!isScan(meta))
+        return DYB_MetaNotApp;
+    *rotation = meta->_rotation;
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc DYB_getPhysRangeX(const DYB_Meta *meta, Flt32 *rangeX)
+{
+    *rangeX = meta->_stepX * meta->_pointsX;
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc DYB_getPhysRangeY(const DYB_Meta *meta, Flt32 *rangeY)
+{
+    if(!isScan(meta))
+        return DYB_MetaNotApp;
+    *rangeY = meta->_stepY * meta->_pointsY;
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc DYB_convIndex2Direction(const DYB_Meta *meta, Int32 index, Bln32 *forward, Bln32 *upward)
+{
+    if(!isScan(meta))
+        return DYB_MetaNotApp;
+
+    const bool first = index % (2 * meta->_pointsX) < meta->_pointsX;
+    *forward = first ? meta->_order == DYB_FfScan || meta->_order == DYB_FbScan
+                     : meta->_order == DYB_FfScan || meta->_order == DYB_BfScan;
+    *upward = 1;
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc DYB_convIndex2Pixel(const DYB_Meta *meta, Int32 index, Int32 *x, Int32 *y)
+{
+    Bln32 forward = 0, upward = 0;
+    const DYB_MRc rc = DYB_convIndex2Direction(meta, index, &forward, &upward);
+    if(rc != DYB_MetaOk)
+        return rc;
+
+    const int64_t inFrame = index % (2 * static_cast<int64_t>(meta->_pointsX) * meta->_pointsY),
+                  k = inFrame % meta->_pointsX;
+    *x = static_cast<Int32>(forward ? k : meta->_pointsX - 1 - k);
+    *y = static_cast<Int32>(inFrame / (2 * meta->_pointsX));
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc DYB_convIndex2Phys1(const DYB_Meta *meta, Int32 index, Flt32 *x)
+{
+    if(meta->_order > DYB_Cyclic)
+        return DYB_MetaNotApp;
+    const Int32 position = meta->_order == DYB_Cyclic && meta->_pointsX > 0 ? index % meta->_pointsX : index;
+    *x = meta->_originX + position * meta->_stepX;
+    return DYB_MetaOk;
+}
+
+
+DYB_MRc DYB_convIndex2Phys2(const DYB_Meta *meta, Int32 index, Flt32 *x, Flt32 *y)
+{
+    Int32 column = 0, line = 0;
+    const DYB_MRc rc = DYB_convIndex2Pixel(meta, index, &column, &line);
+    if(rc != DYB_MetaOk)
+        return rc;
+
+    const Flt32 u = column * meta->_stepX,
+                v = line * meta->_stepY;
+    *x = meta->_originX + u * std::cos(meta->_rotation) - v * std::sin(meta->_rotation);
+    *y = meta->_originY + u * std::sin(meta->_rotation) + v * std::cos(meta->_rotation);
+    return DYB_MetaOk;
+}
+
+
+Flt32 DYB_convValue2Phys(const DYB_Meta *, Int32 value)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    std::map<int32_t, Flt32>::const_iterator found = s_value2Phys.find(value);
+    return found != s_value2Phys.end() ? found->second : std::numeric_limits<Flt32>::quiet_NaN();
+}
+
+
+Flt32 DYB_convPhys2Print(Flt32 number, DYB_Unit, char *unitStr)
+{
+    strcpy(unitStr, "?");
+    return number;
+}
@@ -0,0 +1,175 @@
+/** \file daisybase_stub.h
+ * \brief In-process replacement of daisybase for the tests.
+ *
+ * daisybase_stub.cpp implements the functions of daisybase.h, daisydata.h
+ * and metadata.h without a server, so the tests run offline. The tests are
+ * built with DYB_NO_DLL and link the stub instead of daisybase.lib.
+ *
+ * The stub keeps a parameter table. DYB_setParameterAsync stores the value,
+ * limited to the range set by setLimit(), applies the side effects set by
+ * addSideEffect() and reports every change as an event through the event
+ * callbacks, like the server does. DYB_getParameterAsync reports the
+ * current value. Events are delivered synchronously in the calling thread,
+ * so an answer arrives before the request returns, unless they are held
+ * back by setDeferred() to be delivered later by flush().
+ *
+ * Full buffers for DYB_getDataBuffer are provided by queueFrame().
+ * DYB_writeBuffer writes nothing; setWriteHook() observes the calls.
+ *
+ * DYB_convValue2Phys doesn't compute anything: it returns the results of
+ * the library set by setValue2Phys(), so the checks against it don't test
+ * the conversion with its own formula.
+ */
+
+#ifndef __DAISYBASE_STUB_H
+#define __DAISYBASE_STUB_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "daisybase.h"
+
+
+namespace dybstub
+{
+
+/** \brief Forget parameters, limits, side effects, hooks and frames; callbacks stay registered. */
+void reset();
+
+/** \brief Hold back the events of requests until flush().
+ *
+ * \param deferred const bool True to hold back, false to deliver at once again.
+ * \return void
+ *
+ */
+void setDeferred(const bool deferred);
+
+/** \brief Deliver the events held back.
+ *
+ * \return int32_t Number of events delivered.
+ *
+ */
+int32_t flush();
+
+/** \brief Deliver an event at once, as a notification caused by another client.
+ *
+ * \param address const DYB_Address Parameter address.
+ * \param index const int32_t Subaddress.
+ * \param value const int32_t Value reported.
+ * \return void
+ *
+ */
+void notify(const DYB_Address address, const int32_t index, const int32_t value);
+
+/** \brief Run an action within DYB_getParameterSync, after the value has been read.
+ *
+ * Simulates an event that arrives during the round trip of a synchronous read.
+ *
+ * \param hook std::function<void()> Action, e.g. notify(); empty for none.
+ * \return void
+ *
+ */
+void setSyncReadHook(std::function<void()> hook);
+
+/** \brief Run an action instead of writing a file in DYB_writeBuffer.
+ *
+ * \param hook std::function<DYB_Rc(const char *, Int32, const Int32 *)> Action
+ *             called with file name, data size and data; its result is
+ *             returned. Empty for none (DYB_Ok).
+ * \return void
+ *
+ */
+void setWriteHook(std::function<DYB_Rc(const char *, Int32, const Int32 *)> hook);
+
+/** \brief Set a parameter without an event.
+ *
+ * \param address const DYB_Address Parameter address.
+ * \param index const int32_t Subaddress.
+ * \param value const int32_t Value.
+ * \return void
+ *
+ */
+void setParameter(const DYB_Address address, const int32_t index, const int32_t value);
+
+/** \brief Current value of a parameter.
+ *
+ * \param address const DYB_Address Parameter address.
+ * \param index const int32_t Subaddress.
+ * \return int32_t Value, 0 if never set.
+ *
+ */
+int32_t parameter(const DYB_Address address, const int32_t index);
+
+/** \brief Limit the values the server accepts for a parameter.
+ *
+ * \param address const DYB_Address Parameter address.
+ * \param min const int32_t Lowest value.
+ * \param max const int32_t Highest value.
+ * \return void
+ *
+ */
+void setLimit(const DYB_Address address, const int32_t min, const int32_t max);
+
+/** \brief Let setting a parameter change another one, with an event.
+ *
+ * \param trigger const DYB_Address Parameter that is set.
+ * \param target const DYB_Address Parameter changed as a side effect (index 0).
+ * \param value const int32_t New value of target.
+ * \return void
+ *
+ */
+void addSideEffect(const DYB_Address trigger, const DYB_Address target, const int32_t value);
+
+/** \brief Number of DYB_setParameterAsync and DYB_getParameterAsync calls.
+ *
+ * \return int32_t Requests since reset().
+ *
+ */
+int32_t requests();
+
+/** \brief Provide a full buffer for DYB_getDataBuffer.
+ *
+ * \param channel const int32_t Data channel.
+ * \param frameNo const int32_t Frame number.
+ * \param index const int32_t Index of the first item.
+ * \param data const std::vector<int32_t>& The data.
+ * \param meta const DYB_Meta& Meta data.
+ * \return void
+ *
+ */
+void queueFrame(const int32_t channel, const int32_t frameNo, const int32_t index,
+                const std::vector<int32_t> &data, const DYB_Meta &meta);
+
+/** \brief Frame size reported by DYB_getFrameSize if no frame is queued.
+ *
+ * \param channel const int32_t Data channel.
+ * \param size const int32_t Size [32 bit items].
+ * \return void
+ *
+ */
+void setFrameSize(const int32_t channel, const int32_t size);
+
+/** \brief Results returned by DYB_convValue2Phys.
+ *
+ * \param table const std::map<int32_t, Flt32>& Physical value per raw value;
+ *              raw values not in the table convert to NaN.
+ * \return void
+ *
+ */
+void setValue2Phys(const std::map<int32_t, Flt32> &table);
+
+/** \brief Meta data of a scan.
+ *
+ * \param order const DYB_Order Scan order.
+ * \param pointsX const int32_t Columns.
+ * \param pointsY const int32_t Lines.
+ * \return DYB_Meta Meta data with unit steps, origin 0 and value scale 1.
+ *
+ */
+DYB_Meta scanMeta(const DYB_Order order, const int32_t pointsX, const int32_t pointsY);
+
+} /* namespace dybstub */
+
+#endif
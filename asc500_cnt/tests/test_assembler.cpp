@@ -0,0 +1,106 @@
+/* Frame assembler over consecutive frames: every frame starts with
+ * index 0, the second one runs top to bottom, the third one has another
+ * value scale.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500_assembler.h"
+
+static const int32_t Columns = 3,
+                     Lines = 4;
+
+
+/* Raw value of an item: line * 100 + position in the line */
+static std::vector<int32_t> frameData()
+{
+    std::vector<int32_t> data(2 * Columns * Lines);
+    for(size_t k = 0; k < data.size(); k++)
+        data[k] = static_cast<int32_t>(k / (2 * Columns) * 100 + k % (2 * Columns));
+    return data;
+}
+
+
+/* Checks both planes, given the display row of each scan line and the
+ * physical value of raw 0 and of one step */
+static void checkPlanes(const asc500::FrameAssembler &assembler, const bool upward,
+                        const Flt32 offset, const Flt32 step)
+{
+    const Flt32 *forward = assembler.forwardPlane(),
+                *backward = assembler.backwardPlane();
+    CHECK(forward != NULL && backward != NULL);
+    if(!forward || !backward)
+        return;
+
+    for(int32_t line = 0; line < Lines; line++)
+    {
+        const int32_t row = upward ? Lines - 1 - line : line;
+        for(int32_t c = 0; c < Columns; c++)
+        {
+            /* FbScan: first pass forward, second pass backward */
+            CHECK_NEAR(forward[row * Columns + c], offset + step * (line * 100 + c), 0.0);
+            CHECK_NEAR(backward[row * Columns + c], offset + step * (line * 100 + Columns + (Columns - 1 - c)), 0.0);
+        }
+    }
+}
+
+
+int main()
+{
+    const DYB_Meta meta = dybstub::scanMeta(DYB_FbScan, Columns, Lines);
+    const std::vector<int32_t> data = frameData();
+    const int32_t split = 2 * Columns + 2;   /* Within the second line */
+    asc500::FrameAssembler assembler;
+    std::vector<int32_t> rows;
+    int32_t frames = 0;
+    Flt32 offset = 0.0f, step = 1.0f;
+
+    assembler.onLine([&](const asc500::FrameAssembler &, const int32_t row) { rows.push_back(row); });
+    assembler.onFrame([&](const asc500::FrameAssembler &done)
+    {
+        checkPlanes(done, frames % 2 == 0, offset, step);
+        frames++;
+    });
+
+    /* First frame in two packets, bottom to top */
+    CHECK(assembler.push(0, split, data.data(), &meta) == DYB_Ok);
+    CHECK(assembler.frame() == 0);
+    CHECK(assembler.linesDone() == 1);
+    CHECK(assembler.push(split, static_cast<int32_t>(data.size()) - split, data.data() + split, &meta) == DYB_Ok);
+    CHECK(frames == 1);
+    CHECK(assembler.linesDone() == Lines);
+
+    /* Second frame, again from index 0: top to bottom */
+    CHECK(assembler.push(0, split, data.data(), &meta) == DYB_Ok);
+    CHECK(assembler.frame() == 1);
+    CHECK(assembler.linesDone() == 1);
+    CHECK(std::isnan(assembler.forwardPlane()[(Lines - 1) * Columns]));
+    CHECK(assembler.push(split, static_cast<int32_t>(data.size()) - split, data.data() + split, &meta) == DYB_Ok);
+    CHECK(frames == 2);
+
+    const int32_t expected[] = { 3, 2, 1, 0, 0, 1, 2, 3 };
+    CHECK(rows.size() == 8);
+    for(size_t k = 0; k < rows.size() && k < 8; k++)
+        CHECK(rows[k] == expected[k]);
+
+    /* Third frame: 1/4 per LSB from -2, exact in binary */
+    DYB_Meta scaled = meta;
+    scaled._stepVal = 1.0f;
+    scaled._stepValNum = 4.0f;
+    scaled._offsetVal = -2.0f;
+    offset = -2.0f;
+    step = 0.25f;
+    CHECK(assembler.push(0, static_cast<int32_t>(data.size()), data.data(), &scaled) == DYB_Ok);
+    CHECK(frames == 3);
+    CHECK(assembler.forwardPlane()[(Lines - 1) * Columns + 2] == -1.5f);
+
+    /* Non scan data are rejected */
+    DYB_Meta linear = meta;
+    linear._order = DYB_Linear;
+    CHECK(assembler.push(0, split, data.data(), &linear) == DYB_OutOfRange);
+
+    return asc500test::result("test_assembler");
+}
@@ -0,0 +1,152 @@
+/* Batch parameter set: the acknowledgement rule, plain and limited values,
+ * notifications caused by other entries while events are delayed, and
+ * batches running in parallel against a slow server.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500_batch.h"
+
+using namespace asc500;
+
+
+static void checkAckState()
+{
+    AckState direct(5);
+    CHECK(direct.onEvent(5) == AckState::Accept);
+
+    /* A differing value asks for one read back and is confirmed after it */
+    AckState limited(5);
+    CHECK(limited.onEvent(3) == AckState::ReadBack);
+    CHECK(limited.onEvent(3) == AckState::Ignore);
+    limited.fence();
+    CHECK(limited.onEvent(4) == AckState::Ignore);
+    CHECK(limited.onEvent(4) == AckState::Accept);
+
+    /* The requested value is taken at any time */
+    AckState late(5);
+    CHECK(late.onEvent(1) == AckState::ReadBack);
+    CHECK(late.onEvent(5) == AckState::Accept);
+}
+
+
+static void checkPlain()
+{
+    dybstub::reset();
+    dybstub::setLimit(0x301, 0, 100);
+    ParamEntry entries[] = { { 0x300, 0, 7, 0, false }, { 0x300, 1, -7, 0, false },
+                             { 0x301, 0, 500, 0, false } };
+
+    CHECK(setParameterBatch(entries, 3, 500) == DYB_Ok);
+    CHECK(entries[0].acknowledged && entries[0].returned == 7);
+    CHECK(entries[1].acknowledged && entries[1].returned == -7);
+    CHECK(entries[2].acknowledged && entries[2].returned == 100);
+    CHECK(countLimited(entries, 3) == 1);
+    CHECK(dybstub::requests() == 4);                   /* One read back */
+    CHECK(setParameterBatch(entries, 0) == DYB_Ok);
+}
+
+
+/* Delayed events: setting 0x311 also changes 0x310, whose own set is
+ * limited. The last value of the server is acknowledged */
+static void checkDelayed()
+{
+    dybstub::reset();
+    dybstub::setLimit(0x310, 0, 2);
+    dybstub::addSideEffect(0x311, 0x310, 1);
+    dybstub::setDeferred(true);
+
+    std::atomic<bool> done(false);
+    std::thread server([&done]()
+    {
+        while(!done.load())
+        {
+            dybstub::flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    ParamEntry entries[] = { { 0x310, 0, 3, 0, false }, { 0x311, 0, 7, 0, false } };
+    CHECK(setParameterBatch(entries, 2, 1000) == DYB_Ok);
+    done = true;
+    server.join();
+    dybstub::setDeferred(false);
+
+    CHECK(entries[0].acknowledged && entries[0].returned == 1);
+    CHECK(entries[1].acknowledged && entries[1].returned == 7);
+    CHECK(dybstub::parameter(0x310, 0) == 1);
+}
+
+
+/* Two batches with repeated addresses share the events of a server that
+ * answers in bursts; neither takes the other's acknowledgements */
+static void checkThreads()
+{
+    dybstub::reset();
+    for(DYB_Address address = 0x400; address < 0x420; address++)
+        dybstub::setLimit(address, -50, 50);
+    dybstub::setDeferred(true);
+
+    std::atomic<bool> done(false);
+    std::thread server([&done]()
+    {
+        while(!done.load())
+        {
+            dybstub::flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    });
+
+    std::vector<ParamEntry> first, second;
+    for(int32_t k = 0; k < 200; k++)
+    {
+        first.push_back({ 0x400 + k % 16, k % 4, k % 120 - 60, 0, false });
+        second.push_back({ 0x410 + k % 16, k % 4, 60 - k % 120, 0, false });
+    }
+    DYB_Rc firstRc = DYB_Error;
+    std::thread other([&]() { firstRc = setParameterBatch(first.data(), first.size(), 5000); });
+    const DYB_Rc secondRc = setParameterBatch(second.data(), second.size(), 5000);
+    other.join();
+    done = true;
+    server.join();
+    dybstub::setDeferred(false);
+
+    CHECK(firstRc == DYB_Ok && secondRc == DYB_Ok);
+    int32_t wrong = 0;
+    for(const std::vector<ParamEntry> *batch : { &first, &second })
+    {
+        for(const ParamEntry &entry : *batch)
+        {
+            const int32_t final = dybstub::parameter(entry.address, entry.index);
+            wrong += entry.acknowledged ? 0 : 1;
+            /* Only the last entry on a parameter must see its final value */
+            wrong += entry.returned < -50 || entry.returned > 50 ? 1 : 0;
+            wrong += &entry - batch->data() >= 184 && entry.returned != final ? 1 : 0;
+        }
+    }
+    CHECK(wrong == 0);
+    CHECK(countLimited(first.data(), first.size()) >= 20);
+
+    /* No answers at all */
+    dybstub::setDeferred(true);
+    ParamEntry silent = { 0x400, 0, 1, 0, false };
+    CHECK(setParameterBatch(&silent, 1, 50) == DYB_Timeout);
+    CHECK(!silent.acknowledged);
+    dybstub::setDeferred(false);
+    dybstub::flush();
+}
+
+
+int main()
+{
+    checkAckState();
+    checkPlain();
+    checkDelayed();
+    checkThreads();
+    return asc500test::result("test_batch");
+}
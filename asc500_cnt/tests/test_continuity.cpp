@@ -0,0 +1,90 @@
+/* Continuity: gaps, resets and early frame restarts, the drop rate after
+ * the packets have stopped, and the channel range of the monitor.
+ */
+
+#include <chrono>
+#include <thread>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500_continuity.h"
+
+using namespace asc500;
+
+
+static void checkClassify()
+{
+    ContinuityTracker tracker;
+    const DYB_Meta linear = DYB_Meta(),
+                   scan = dybstub::scanMeta(DYB_FfScan, 10, 10);      /* 200 items a frame */
+
+    CHECK(tracker.feed(0, 100, &linear) == 0);
+    CHECK(tracker.feed(100, 100, &linear) == 0);
+    CHECK(tracker.feed(250, 50, &linear) == 50);        /* Gap              */
+    CHECK(tracker.feed(0, 10, &linear) == 0);           /* Overflow reset   */
+    CHECK(tracker.feed(10, 100, &scan) == 0);
+    CHECK(tracker.feed(0, 200, &scan) == 90);           /* Frame restarted at 110 of 200 */
+    CHECK(tracker.feed(0, 200, &scan) == 0);            /* Complete frame   */
+    CHECK(tracker.feed(210, 5, &scan) == 10);
+
+    const ContinuityStats stats = tracker.stats();
+    CHECK(stats.packets == 8);
+    CHECK(stats.samples == 765);
+    CHECK(stats.drops == 3);
+    CHECK(stats.lostSamples == 150);
+    CHECK(stats.longestGap == 90);
+    CHECK(stats.resets == 3);
+
+    tracker.reset();
+    CHECK(tracker.stats().packets == 0 && tracker.stats().drops == 0);
+}
+
+
+/* The rate of the last second is read without further packets */
+static void checkRate()
+{
+    ContinuityTracker tracker;
+    const DYB_Meta linear = DYB_Meta();
+    tracker.feed(0, 10, &linear);
+    tracker.feed(20, 10, &linear);
+    tracker.feed(40, 10, &linear);
+    tracker.feed(60, 10, &linear);
+    CHECK(tracker.stats().dropsPerSec == 0.0);          /* Window still open */
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+    ContinuityStats stats = tracker.stats();
+    CHECK(stats.dropsPerSec > 1.5 && stats.dropsPerSec <= 2.5);
+    CHECK(stats.avgDropsPerSec > 1.5 && stats.avgDropsPerSec <= 2.5);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    stats = tracker.stats();
+    CHECK(stats.dropsPerSec == 0.0);
+    CHECK(stats.avgDropsPerSec > 0.0 && stats.avgDropsPerSec < 1.5);
+    CHECK(stats.drops == 3);
+}
+
+
+static void checkMonitor()
+{
+    LossMonitor monitor;
+    ContinuityStats stats;
+    CHECK(monitor.feed(-1, 0, 1, NULL) == -1);
+    CHECK(monitor.feed(ASC500_DATA_CHANNELS, 0, 1, NULL) == -1);
+    CHECK(monitor.stats(ASC500_DATA_CHANNELS, stats) == DYB_OutOfRange);
+
+    monitor.feed(2, 0, 10, NULL);
+    CHECK(monitor.feed(2, 15, 10, NULL) == 5);
+    CHECK(monitor.stats(2, stats) == DYB_Ok && stats.lostSamples == 5);
+    CHECK(monitor.stats(3, stats) == DYB_Ok && stats.packets == 0);
+    monitor.reset(2);
+    CHECK(monitor.stats(2, stats) == DYB_Ok && stats.packets == 0);
+}
+
+
+int main()
+{
+    checkClassify();
+    checkRate();
+    checkMonitor();
+    return asc500test::result("test_continuity");
+}
@@ -0,0 +1,182 @@
+/* Value conversion. The SSE2 and AVX2 kernels are checked for consistency
+ * with the scalar kernel (bit identical results); the values themselves are
+ * checked against results worked out by hand: exact small cases, a ramp
+ * with its statistics, and checkValue2Phys against a table of library
+ * results.
+ */
+
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+
+/* The kernels are static */
+#include "../asc500_convert.cpp"
+
+using namespace asc500;
+
+
+/* Consistency: the SIMD kernels give the results of the scalar kernel */
+static void checkFloatKernels(const std::vector<int32_t> &data, const Flt32 scale, const Flt32 offset)
+{
+    const int32_t count = static_cast<int32_t>(data.size());
+    std::vector<Flt32> reference(count + 1), simd(count + 1);
+    ValueStats referenceStats, simdStats;
+
+    toFloatScalar(data.data(), count, scale, offset, reference.data(), &referenceStats);
+#ifdef ASC500_SSE2
+    toFloatSse2(data.data(), count, scale, offset, simd.data(), &simdStats);
+    CHECK(memcmp(reference.data(), simd.data(), count * sizeof(Flt32)) == 0);
+    CHECK(simdStats.min == referenceStats.min && simdStats.max == referenceStats.max);
+    CHECK_NEAR(simdStats.mean, referenceStats.mean, 1e-9 * (1.0 + fabs(referenceStats.mean)));
+#endif
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+    {
+        toFloatAvx2(data.data(), count, scale, offset, simd.data(), &simdStats);
+        CHECK(memcmp(reference.data(), simd.data(), count * sizeof(Flt32)) == 0);
+        CHECK(simdStats.min == referenceStats.min && simdStats.max == referenceStats.max);
+        CHECK_NEAR(simdStats.mean, referenceStats.mean, 1e-9 * (1.0 + fabs(referenceStats.mean)));
+    }
+#endif
+}
+
+
+static void checkDoubleKernels(const std::vector<int32_t> &data, const double scale, const double offset)
+{
+    const int32_t count = static_cast<int32_t>(data.size());
+    std::vector<double> reference(count + 1), simd(count + 1);
+
+    toDoubleScalar(data.data(), count, scale, offset, reference.data());
+#ifdef ASC500_SSE2
+    toDoubleSse2(data.data(), count, scale, offset, simd.data());
+    CHECK(memcmp(reference.data(), simd.data(), count * sizeof(double)) == 0);
+#endif
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+    {
+        toDoubleAvx2(data.data(), count, scale, offset, simd.data());
+        CHECK(memcmp(reference.data(), simd.data(), count * sizeof(double)) == 0);
+    }
+#endif
+}
+
+
+/* Scale 1/4 and offset 3/2 are exact in binary: every kernel must hit these values */
+static void checkFixed()
+{
+    const int32_t data[] = { 0, 1, -1, 4, 1000, -4096, 3, 8, 9 };
+    const Flt32 expected[] = { 1.5f, 1.75f, 1.25f, 2.5f, 251.5f, -1022.5f, 2.25f, 3.5f, 3.75f };
+    const int32_t count = 9;
+    Flt32 phys[count];
+    double physDouble[count];
+    ValueStats stats;
+
+    toFloatScalar(data, count, 0.25f, 1.5f, phys, &stats);
+    CHECK(memcmp(phys, expected, sizeof(phys)) == 0);
+    CHECK(stats.min == -1022.5f && stats.max == 251.5f);
+    toDoubleScalar(data, count, 0.25, 1.5, physDouble);
+    for(int32_t k = 0; k < count; k++)
+        CHECK(physDouble[k] == expected[k]);
+#ifdef ASC500_SSE2
+    toFloatSse2(data, count, 0.25f, 1.5f, phys, &stats);
+    CHECK(memcmp(phys, expected, sizeof(phys)) == 0);
+    toDoubleSse2(data, count, 0.25, 1.5, physDouble);
+    for(int32_t k = 0; k < count; k++)
+        CHECK(physDouble[k] == expected[k]);
+#endif
+#ifdef ASC500_AVX2
+    if(cpuHasAvx2())
+    {
+        toFloatAvx2(data, count, 0.25f, 1.5f, phys, &stats);
+        CHECK(memcmp(phys, expected, sizeof(phys)) == 0);
+        toDoubleAvx2(data, count, 0.25, 1.5, physDouble);
+        for(int32_t k = 0; k < count; k++)
+            CHECK(physDouble[k] == expected[k]);
+    }
+#endif
+}
+
+
+/* The library results are given by the stub: scale 2.5e-4 / 3, offset -7 */
+static void checkLibrary()
+{
+    DYB_Meta meta = dybstub::scanMeta(DYB_Linear, 0, 0);
+    meta._stepVal = 2.5e-4f;
+    meta._stepValNum = 3.0f;
+    meta._offsetVal = -7.0f;
+    const int32_t data[] = { 0, 12000, -3000, 36000, 1200000 };
+    std::map<int32_t, Flt32> library;
+    library[0] = -7.0f;
+    library[12000] = -6.0f;
+    library[-3000] = -7.25f;
+    library[36000] = -4.0f;
+    library[1200000] = 93.0f;
+
+    dybstub::setValue2Phys(library);
+    CHECK(checkValue2Phys(&meta, data, 5) == 0);
+    CHECK(checkValue2Phys(NULL, data, 5) == -1);
+
+    /* A result off by 1e-3 and a missing one are reported */
+    library[12000] = -6.001f;
+    library.erase(36000);
+    dybstub::setValue2Phys(library);
+    CHECK(checkValue2Phys(&meta, data, 5) == 2);
+    dybstub::reset();
+}
+
+
+int main()
+{
+    std::mt19937 random(500);
+    std::uniform_int_distribution<int32_t> raw(-(1 << 24), 1 << 24);
+
+    /* All tail lengths of the 4 and 8 wide kernels */
+    for(int32_t count = 0; count < 40; count++)
+    {
+        std::vector<int32_t> data(count);
+        for(int32_t &value : data)
+            value = raw(random);
+        checkFloatKernels(data, 3.0517578e-5f, -1.25f);
+        checkDoubleKernels(data, 3.0517578125e-5, -1.25);
+    }
+    std::vector<int32_t> large(100003);
+    for(int32_t &value : large)
+        value = raw(random);
+    checkFloatKernels(large, 1.0e-3f, 0.5f);
+    checkDoubleKernels(large, 1.0e-3, 0.5);
+
+    /* Ramp 0..99, scale 1/2, offset 1: min 1, max 50.5, mean 25.75 */
+    DYB_Meta meta = dybstub::scanMeta(DYB_Linear, 0, 0);
+    meta._stepVal = 1.0f;
+    meta._stepValNum = 2.0f;
+    meta._offsetVal = 1.0f;
+    std::vector<int32_t> ramp(100);
+    for(int32_t k = 0; k < 100; k++)
+        ramp[k] = k;
+
+    ValueStats stats;
+    std::vector<Flt32> phys(100);
+    convValues2PhysStats(&meta, ramp.data(), 100, phys.data(), stats);
+    CHECK(stats.count == 100);
+    CHECK_NEAR(stats.min, 1.0, 0.0);
+    CHECK_NEAR(stats.max, 50.5, 0.0);
+    CHECK_NEAR(stats.mean, 25.75, 1e-12);
+    CHECK_NEAR(phys[37], 19.5, 0.0);
+
+    /* In place gives the same values */
+    std::vector<int32_t> inPlace(ramp);
+    const Flt32 *converted = convValues2PhysInPlace(&meta, inPlace.data(), 100);
+    CHECK(memcmp(converted, phys.data(), 100 * sizeof(Flt32)) == 0);
+
+    std::vector<double> physDouble(100);
+    convValues2Phys(&meta, ramp.data(), 100, physDouble.data());
+    CHECK_NEAR(physDouble[99], 50.5, 0.0);
+
+    checkFixed();
+    checkLibrary();
+    return asc500test::result("test_convert");
+}
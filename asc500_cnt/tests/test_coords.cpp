@@ -0,0 +1,138 @@
+/* Coordinates: the Y direction rule, a small scan and 1D data by hand, and the grid
+ * cache against the bulk and scalar conversion for ranges across frames.
+ */
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500_coords.h"
+#include "asc500_gridcache.h"
+
+using namespace asc500;
+
+
+static void checkScanLine()
+{
+    /* Frames of 3 lines: up, down, up, ... */
+    const int32_t even[] = { 0, 1, 2, 2, 1, 0, 0, 1, 2 },
+                  odd[] = { 2, 1, 0, 0, 1, 2, 2, 1, 0 };
+    for(int32_t l = 0; l < 9; l++)
+    {
+        CHECK(scanLine(l, 3, false) == even[l]);
+        CHECK(scanLine(l, 3, true) == odd[l]);
+    }
+}
+
+
+/* FbScan of 2 x 2 pixels over two frames, written out */
+static void checkByHand()
+{
+    DYB_Meta meta = dybstub::scanMeta(DYB_FbScan, 2, 2);
+    const int32_t columns[] = { 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0 },
+                  lines[] = { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0 },
+                  forward[] = { 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0 };
+    int32_t c[16], l[16], f[16];
+
+    CHECK(convIndex2PixelBulk(&meta, 0, 16, c, l, f) == DYB_MetaOk);
+    CHECK(memcmp(c, columns, sizeof(c)) == 0);
+    CHECK(memcmp(l, lines, sizeof(l)) == 0);
+    CHECK(memcmp(f, forward, sizeof(f)) == 0);
+
+    CoordGridCache cache;
+    CHECK(cache.index2Pixel(&meta, 0, 16, c, l, f, true) == DYB_MetaOk);
+    for(int32_t k = 0; k < 16; k++)
+        CHECK(c[k] == columns[k] && l[k] == 1 - lines[k] && f[k] == forward[k]);
+}
+
+
+/* One variable, linear and across the end of a cycle */
+static void checkPhys1()
+{
+    DYB_Meta meta = DYB_Meta();
+    meta._order = DYB_Linear;
+    meta._originX = 2.0f;
+    meta._stepX = 0.5f;
+    const Flt32 linear[] = { 3.5f, 4.0f, 4.5f, 5.0f, 5.5f, 6.0f, 6.5f },
+                cyclic[] = { 3.0f, 3.5f, 2.0f, 2.5f, 3.0f, 3.5f, 2.0f };
+    Flt32 x[7];
+
+    CHECK(convIndex2Phys1Bulk(&meta, 3, 7, x) == DYB_MetaOk);
+    CHECK(memcmp(x, linear, sizeof(x)) == 0);
+    meta._order = DYB_Cyclic;
+    meta._pointsX = 4;
+    CHECK(convIndex2Phys1Bulk(&meta, 2, 7, x) == DYB_MetaOk);
+    CHECK(memcmp(x, cyclic, sizeof(x)) == 0);
+
+    meta._pointsX = 0;
+    CHECK(convIndex2Phys1Bulk(&meta, 0, 7, x) == DYB_MetaInvalid);
+    meta = dybstub::scanMeta(DYB_FfScan, 2, 2);
+    CHECK(convIndex2Phys1Bulk(&meta, 0, 7, x) == DYB_MetaNotApp);
+}
+
+
+static void checkAgreement(std::mt19937 &random, const DYB_Meta &meta)
+{
+    const int32_t frameSize = 2 * meta._pointsX * meta._pointsY;
+    std::uniform_int_distribution<int32_t> start(0, 2 * frameSize), length(1, 3 * frameSize);
+    CoordGridCache cache;
+
+    for(int32_t round = 0; round < 40; round++)
+    {
+        const int32_t first = start(random),
+                      count = length(random);
+        const bool oddFrame = round % 2 != 0;
+        std::vector<int32_t> gridColumns(count), gridLines(count), gridForward(count),
+                             bulkColumns(count), bulkLines(count), bulkForward(count);
+        std::vector<Flt32> gridX(count), gridY(count), bulkX(count), bulkY(count);
+
+        CHECK(cache.index2Pixel(&meta, first, count, gridColumns.data(), gridLines.data(),
+                                gridForward.data(), oddFrame) == DYB_MetaOk);
+        CHECK(cache.index2Phys2(&meta, first, count, gridX.data(), gridY.data(), oddFrame) == DYB_MetaOk);
+        CHECK(convIndex2PixelBulk(&meta, first, count, bulkColumns.data(), bulkLines.data(),
+                                  bulkForward.data(), oddFrame) == DYB_MetaOk);
+        CHECK(convIndex2Phys2Bulk(&meta, first, count, bulkX.data(), bulkY.data(), oddFrame) == DYB_MetaOk);
+
+        int32_t differ = 0;
+        for(int32_t k = 0; k < count; k++)
+        {
+            int32_t column = 0, line = 0, forward = 0;
+            Flt32 x = 0.0f, y = 0.0f;
+            convIndex2PixelScalar(&meta, first + k, &column, &line, &forward, oddFrame);
+            convIndex2Phys2Scalar(&meta, first + k, &x, &y, oddFrame);
+            differ += gridColumns[k] != bulkColumns[k] || gridLines[k] != bulkLines[k] ||
+                      gridForward[k] != bulkForward[k] || column != bulkColumns[k] ||
+                      line != bulkLines[k] || forward != bulkForward[k] ||
+                      memcmp(&gridX[k], &bulkX[k], sizeof(Flt32)) || memcmp(&gridY[k], &bulkY[k], sizeof(Flt32)) ||
+                      memcmp(&x, &bulkX[k], sizeof(Flt32)) || memcmp(&y, &bulkY[k], sizeof(Flt32)) ? 1 : 0;
+        }
+        CHECK(differ == 0);
+    }
+}
+
+
+int main()
+{
+    checkScanLine();
+    checkByHand();
+    checkPhys1();
+
+    std::mt19937 random(7);
+    const DYB_Order orders[] = { DYB_FfScan, DYB_FbScan, DYB_BbScan, DYB_BfScan };
+    for(const DYB_Order order : orders)
+    {
+        DYB_Meta meta = dybstub::scanMeta(order, 13, 5);
+        checkAgreement(random, meta);
+
+        meta = dybstub::scanMeta(order, 32, 3);
+        meta._originX = -2.5f;
+        meta._originY = 1.25f;
+        meta._stepX = 0.3f;
+        meta._stepY = 0.7f;
+        meta._rotation = 0.4f;
+        checkAgreement(random, meta);
+    }
+    return asc500test::result("test_coords");
+}
@@ -0,0 +1,140 @@
+/* Coroutine client against the stub server: acknowledgements, limited
+ * values, foreign notifications, timeouts and frames. Needs C++20.
+ */
+
+#include <vector>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "daisydata.h"
+#include "asc500_coro.h"
+
+#ifdef ASC500_COROUTINES
+
+static const DYB_Address ParamA = 0x100,
+                         ParamB = 0x101,
+                         ParamLimited = 0x102;
+
+
+static asc500::Task<void> getAndSet(asc500::AsyncClient &asc)
+{
+    dybstub::setParameter(ParamA, 0, 17);
+    asc500::ParamResult got = co_await asc.get(ParamA);
+    CHECK(got.rc == DYB_Ok);
+    CHECK(got.value == 17);
+
+    asc500::ParamResult set = co_await asc.set(ParamA, 0, 42);
+    CHECK(set.rc == DYB_Ok);
+    CHECK(set.value == 42);
+    CHECK(dybstub::parameter(ParamA, 0) == 42);
+}
+
+
+static asc500::Task<void> limited(asc500::AsyncClient &asc)
+{
+    /* The server limits the value; accepted after the read back confirms it */
+    const int32_t before = dybstub::requests();
+    asc500::ParamResult set = co_await asc.set(ParamLimited, 0, 1000);
+    CHECK(set.rc == DYB_Ok);
+    CHECK(set.value == 100);
+    CHECK(dybstub::requests() == before + 2);
+}
+
+
+static asc500::Task<void> setAwaiting(asc500::AsyncClient &asc, asc500::ParamResult &result)
+{
+    result = co_await asc.set(ParamB, 0, 5);
+}
+
+
+static asc500::Task<void> foreignNotification(asc500::AsyncClient &asc)
+{
+    /* Another client reports a value for the parameter before the acknowledgement */
+    co_await asc.sleep(10);
+    dybstub::notify(ParamB, 0, 3);
+    co_await asc.sleep(10);
+    dybstub::flush();
+}
+
+
+static asc500::Task<void> timeout(asc500::AsyncClient &asc)
+{
+    asc500::ParamResult set = co_await asc.set(ParamA, 0, 9, 20);
+    CHECK(set.rc == DYB_Timeout);
+}
+
+
+static asc500::Task<void> frames(asc500::AsyncClient &asc, const DYB_Meta meta)
+{
+    std::vector<int32_t> data(64);
+    for(size_t k = 0; k < data.size(); k++)
+        data[k] = static_cast<int32_t>(k);
+
+    /* Queued before the request and after it */
+    dybstub::queueFrame(1, 0, 0, data, meta);
+    asc500::FrameResult first = co_await asc.nextFrame(1, 1000);
+    CHECK(first.rc == DYB_Ok);
+    CHECK(first.buffer != NULL && first.buffer->frameNo == 0 && first.buffer->dataSize == 64);
+    CHECK(first.buffer != NULL && first.buffer->data[63] == 63);
+    asc.release(first.buffer);
+
+    co_await asc.sleep(20);
+    dybstub::queueFrame(1, 1, 0, data, meta);
+    asc500::FrameResult second = co_await asc.nextFrame(1, 1000);
+    CHECK(second.rc == DYB_Ok);
+    CHECK(second.buffer != NULL && second.buffer->frameNo == 1);
+    asc.release(second.buffer);
+
+    asc500::FrameResult none = co_await asc.nextFrame(1, 50);
+    CHECK(none.rc == DYB_Timeout);
+    CHECK(none.buffer == NULL);
+}
+
+
+int main()
+{
+    dybstub::reset();
+    dybstub::setLimit(ParamLimited, 0, 100);
+    dybstub::setFrameSize(1, 64);
+
+    asc500::FramePool pool;
+    asc500::EventQueue events;
+    asc500::Scheduler scheduler;
+    CHECK(events.pumpData(pool, DYB_EVT_DATA_01) == DYB_Ok);
+    {
+        asc500::AsyncClient asc(scheduler, pool, events);
+
+        scheduler.spawn(getAndSet(asc));
+        CHECK(scheduler.run(2000));
+        scheduler.spawn(limited(asc));
+        CHECK(scheduler.run(2000));
+
+        asc500::ParamResult result = { DYB_Error, 0 };
+        dybstub::setDeferred(true);
+        scheduler.spawn(setAwaiting(asc, result));
+        scheduler.spawn(foreignNotification(asc));
+        CHECK(scheduler.run(2000));
+        CHECK(result.rc == DYB_Ok);
+        CHECK(result.value == 5);
+
+        scheduler.spawn(timeout(asc));
+        CHECK(scheduler.run(2000));
+        dybstub::setDeferred(false);
+        dybstub::flush();
+
+        scheduler.spawn(frames(asc, dybstub::scanMeta(DYB_FfScan, 4, 8)));
+        CHECK(scheduler.run(5000));
+    }
+    events.stopPump();
+    return asc500test::result("test_coro");
+}
+
+#else
+
+int main()
+{
+    CHECK(!"Coroutines not supported, build with C++20");
+    return asc500test::result("test_coro");
+}
+
+#endif
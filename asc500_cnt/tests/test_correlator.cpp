@@ -0,0 +1,157 @@
+/* Multi-tau correlator: lags and product counts of the cascade, g2 of
+ * constant, alternating and Poisson counts, gaps and the curve handler.
+ */
+
+#include <random>
+#include <vector>
+
+#include "asc500_test.h"
+#include "asc500_correlator.h"
+
+using namespace asc500;
+
+static const int32_t Channels = 8;
+
+
+/* Constant counts: g2 = 1 at every lag; level l sees N / 2^l values */
+static void checkConstant()
+{
+    const int32_t length = 1000, levels = 6;
+    std::vector<int32_t> counts(length, 7);
+    MultiTauCorrelator correlator(4, levels, Channels);
+    CHECK(correlator.push(counts.data(), length) == DYB_Ok);
+
+    std::vector<CorrelationPoint> curve;
+    CHECK(correlator.curve(curve) == length);
+    CHECK(curve.size() == static_cast<size_t>(Channels + (levels - 1) * Channels / 2));
+
+    size_t p = 0;
+    for(int32_t l = 0; l < levels && p < curve.size(); l++)
+    {
+        for(int32_t j = l == 0 ? 0 : Channels / 2; j < Channels && p < curve.size(); j++, p++)
+        {
+            CHECK(curve[p].lag == static_cast<int64_t>(j) << l);
+            CHECK(curve[p].products == (length >> l) - j);
+            CHECK_NEAR(curve[p].tau, curve[p].lag * 4 * 2.5e-6, 1e-15);
+            CHECK_NEAR(curve[p].g2, 1.0, 1e-12);
+        }
+    }
+}
+
+
+/* Counts a, b, a, b, ...: closed form at level 0, the pair sums are constant above */
+static void checkAlternating()
+{
+    const int32_t length = 512, a = 9, b = 3;
+    std::vector<int32_t> counts(length);
+    for(int32_t n = 0; n < length; n++)
+        counts[n] = n % 2 ? b : a;
+    MultiTauCorrelator correlator(0, 4, Channels);
+    correlator.push(counts.data(), length);
+
+    std::vector<CorrelationPoint> curve;
+    correlator.curve(curve);
+    for(const CorrelationPoint &point : curve)
+    {
+        CHECK(point.tau == 0.0);
+        const double n = static_cast<double>(length - point.lag);
+        double expected = 1.0;
+        if(point.lag < Channels && point.lag % 2 == 0)
+        {
+            expected = 2.0 * (a * a + b * b) / ((a + b) * (a + b));
+        }
+        else if(point.lag < Channels)
+        {
+            /* n odd: one more product with x[t] = b than with x[t] = a */
+            const double direct = a * (n - 1) / 2 + b * (n + 1) / 2,
+                         delayed = b * (n - 1) / 2 + a * (n + 1) / 2;
+            expected = n * n * a * b / (direct * delayed);
+        }
+        CHECK_NEAR(point.g2, expected, 1e-12);
+    }
+}
+
+
+/* Poisson counts: g2(0) = 1 + 1 / mean, uncorrelated otherwise */
+static void checkPoisson()
+{
+    const double mean = 5.0;
+    const int32_t length = 400000;
+    std::mt19937 random(24);
+    std::poisson_distribution<int32_t> poisson(mean);
+    std::vector<int32_t> counts(length);
+    for(int32_t &c : counts)
+        c = poisson(random);
+
+    MultiTauCorrelator correlator(0, 10, Channels);
+    correlator.push(counts.data(), length);
+    std::vector<CorrelationPoint> curve;
+    correlator.curve(curve);
+    for(const CorrelationPoint &point : curve)
+        CHECK_NEAR(point.g2, point.lag == 0 ? 1.0 + 1.0 / mean : 1.0, 0.01);
+}
+
+
+/* A gap empties the registers: no product spans it, the sums go on */
+static void checkGap()
+{
+    const int32_t length = 100;
+    std::vector<int32_t> counts(length, 2);
+    DataPacket packet;
+    packet.channel = 0;
+    packet.length = length;
+    packet.data = counts.data();
+    packet.meta = DYB_Meta();
+
+    MultiTauCorrelator correlator(0, 1, Channels);
+    packet.index = 0;
+    correlator.push(packet);
+    packet.index = length;
+    correlator.push(packet);
+    packet.index = 3 * length;
+    correlator.push(packet);
+
+    std::vector<CorrelationPoint> curve;
+    CHECK(correlator.curve(curve) == 3 * length);
+    CHECK(curve.size() == Channels);
+    for(const CorrelationPoint &point : curve)
+        CHECK(point.products == (2 * length - point.lag) + (length - point.lag));
+}
+
+
+static void checkHandler()
+{
+    std::vector<int32_t> counts(50, 1);
+    MultiTauCorrelator correlator(0, 2, Channels);
+    int32_t calls = 0;
+    size_t points = 0;
+    correlator.onCurve([&](const std::vector<CorrelationPoint> &curve)
+    {
+        calls++;
+        points = curve.size();
+    }, 100);
+
+    correlator.push(counts.data(), 50);
+    CHECK(calls == 0);
+    correlator.push(counts.data(), 50);
+    CHECK(calls == 1);
+    CHECK(points == Channels + Channels / 2);
+    correlator.push(counts.data(), 50);
+    CHECK(calls == 1);
+
+    correlator.reset();
+    std::vector<CorrelationPoint> curve;
+    CHECK(correlator.curve(curve) == 0);
+    CHECK(curve.empty());
+}
+
+
+int main()
+{
+    checkConstant();
+    checkAlternating();
+    checkPoisson();
+    checkGap();
+    checkHandler();
+    return asc500test::result("test_correlator");
+}
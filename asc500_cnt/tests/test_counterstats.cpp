@@ -0,0 +1,161 @@
+/* Counter statistics: moments, histogram bins and Allan deviations of
+ * count sequences with a closed form, gaps and the exposure time followed
+ * through the events.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500.h"
+#include "asc500_counterstats.h"
+
+using namespace asc500;
+
+static const double ExposureUnit = 2.5e-6;
+
+
+/* Counts a, b, a, b, ...: deviation |a - b| / sqrt(2) at m = 1, 0 at even m */
+static void checkAlternating()
+{
+    const int32_t a = 10, b = 4, length = 1000;
+    std::vector<int32_t> counts(length);
+    for(int32_t n = 0; n < length; n++)
+        counts[n] = n % 2 ? b : a;
+
+    CounterStatistics stats(400, 6);
+    CHECK(stats.push(counts.data(), length) == DYB_Ok);
+
+    const CounterSummary summary = stats.summary();
+    const double variance = (a - b) * (a - b) / 4.0 * length / (length - 1);
+    CHECK(summary.samples == length);
+    CHECK_NEAR(summary.mean, 7.0, 1e-12);
+    CHECK_NEAR(summary.variance, variance, 1e-9);
+    CHECK_NEAR(summary.fano, variance / 7.0, 1e-9);
+    CHECK_NEAR(summary.rate, 7.0 / (400 * ExposureUnit), 1e-6);
+    CHECK(summary.exposure == 400);
+
+    std::vector<AllanPoint> points;
+    stats.allan(points);
+    CHECK(points.size() == 6);
+    for(size_t k = 0; k < points.size(); k++)
+    {
+        const int32_t m = 1 << k;
+        CHECK(points[k].m == m);
+        CHECK(points[k].terms == length - 2 * m + 1);
+        CHECK_NEAR(points[k].tau, m * 400 * ExposureUnit, 1e-15);
+        CHECK_NEAR(points[k].deviation, m == 1 ? (a - b) / sqrt(2.0) / (400 * ExposureUnit) : 0.0, 1e-6);
+    }
+
+    std::vector<HistogramBin> bins;
+    stats.histogram(bins);
+    CHECK(bins.size() == 2);
+    CHECK(bins.size() == 2 && bins[0].lower == b && bins[0].upper == b + 1 && bins[0].samples == length / 2);
+    CHECK(bins.size() == 2 && bins[1].lower == a && bins[1].upper == a + 1 && bins[1].samples == length / 2);
+}
+
+
+/* Counts 0, 1, 2, ...: the means of neighbouring blocks of m differ by m,
+ * deviation m / sqrt(2) in counts per exposure, the exposure being unknown */
+static void checkRamp()
+{
+    const int32_t length = 300;
+    std::vector<int32_t> counts(length);
+    for(int32_t n = 0; n < length; n++)
+        counts[n] = n;
+
+    CounterStatistics stats(0, 8);
+    stats.setExposureTime(0);           /* Unknown, not followed */
+    stats.push(counts.data(), length);
+
+    std::vector<AllanPoint> points;
+    stats.allan(points);
+    CHECK(points.size() == 8);
+    for(const AllanPoint &point : points)
+    {
+        CHECK(point.tau == 0.0);
+        CHECK_NEAR(point.deviation, point.m / sqrt(2.0), 1e-9 * point.m);
+    }
+    CHECK(stats.summary().rate == 0.0);
+
+    /* Log bins: 100 lies in [96, 104), 299 in [288, 320) */
+    std::vector<HistogramBin> bins;
+    stats.histogram(bins);
+    int64_t total = 0;
+    for(const HistogramBin &bin : bins)
+    {
+        total += bin.samples;
+        if(bin.lower <= 100 && 100 < bin.upper)
+            CHECK(bin.lower == 96 && bin.upper == 104 && bin.samples == 8);
+        if(bin.lower <= 299 && 299 < bin.upper)
+            CHECK(bin.lower == 288 && bin.upper == 320 && bin.samples == 12);
+    }
+    CHECK(total == length);
+}
+
+
+/* A gap in the index leaves out the terms spanning it, the sums go on */
+static void checkGap()
+{
+    const int32_t length = 64;
+    std::vector<int32_t> counts(length);
+    for(int32_t n = 0; n < length; n++)
+        counts[n] = n % 2 ? 1 : 5;
+
+    DataPacket packet;
+    packet.channel = 0;
+    packet.length = length;
+    packet.data = counts.data();
+    packet.meta = dybstub::scanMeta(DYB_FfScan, 8, 8);
+
+    CounterStatistics stats(100, 4);
+    packet.index = 0;
+    stats.push(packet);
+    packet.index = length + 10;
+    stats.push(packet);
+
+    std::vector<AllanPoint> points;
+    stats.allan(points);
+    CHECK(points.size() == 4);
+    for(const AllanPoint &point : points)
+        CHECK(point.terms == 2 * (length - 2 * point.m + 1));
+    CHECK_NEAR(points[0].deviation, 4.0 / sqrt(2.0) / (100 * ExposureUnit), 1e-6);
+    CHECK(stats.summary().samples == 2 * length);
+}
+
+
+/* The exposure time is read at construction and followed; a change resets */
+static void checkExposure()
+{
+    dybstub::setParameter(ID_CNT_EXP_TIME, 0, 200);
+    CounterStatistics stats;
+    CHECK(stats.summary().exposure == 200);
+
+    const int32_t counts[] = { 3, 3, 3, 3 };
+    stats.push(counts, 4);
+    CHECK(stats.summary().samples == 4);
+    CHECK_NEAR(stats.summary().rate, 3.0 / (200 * ExposureUnit), 1e-6);
+
+    dybstub::notify(ID_CNT_EXP_TIME, 0, 200);
+    CHECK(stats.summary().samples == 4);
+    dybstub::notify(ID_CNT_EXP_TIME, 0, 800);
+    CHECK(stats.summary().exposure == 800);
+    CHECK(stats.summary().samples == 0);
+
+    /* Fixed: no longer following */
+    stats.setExposureTime(40);
+    dybstub::notify(ID_CNT_EXP_TIME, 0, 1000);
+    CHECK(stats.summary().exposure == 40);
+}
+
+
+int main()
+{
+    dybstub::reset();
+    checkAlternating();
+    checkRamp();
+    checkGap();
+    checkExposure();
+    return asc500test::result("test_counterstats");
+}
@@ -0,0 +1,159 @@
+/* Event queue: events that arrive before the wait, the parameter filter,
+ * overwritten events, a waiter against a posting thread and the data pump.
+ */
+
+#include <chrono>
+#include <thread>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "daisydata.h"
+#include "asc500.h"
+#include "asc500_eventqueue.h"
+
+using namespace asc500;
+
+
+static void checkBeforeWait()
+{
+    dybstub::reset();
+    EventQueue queue;
+    QueuedEvent event;
+
+    /* The answer comes before the wait begins: not lost */
+    uint64_t seq = queue.sequence();
+    DYB_setParameterAsync(0x100, 1, 5);
+    CHECK(queue.waitSince(seq, DYB_EVT_CUSTOM, 0, &event, 0x100) == DYB_EVT_CUSTOM);
+    CHECK(event.seq == seq + 1 && event.address == 0x100 && event.index == 1 && event.value == 5);
+
+    /* Events of other parameters don't count */
+    seq = queue.sequence();
+    dybstub::notify(0x101, 0, 1);
+    CHECK(queue.waitSince(seq, DYB_EVT_CUSTOM, 20, &event, 0x100) == 0);
+    CHECK(queue.waitSince(seq, DYB_EVT_CUSTOM, 0, &event) == DYB_EVT_CUSTOM);
+    CHECK(event.address == 0x101);
+
+    /* The path mode handshake is a custom event as well */
+    seq = queue.sequence();
+    dybstub::notify(ID_SPEC_PATHMANSTAT, 0, 0);
+    CHECK(queue.waitSince(seq, DYB_EVT_HANDSHK, 0) == 0);
+    dybstub::notify(ID_SPEC_PATHMANSTAT, 0, 1);
+    CHECK(queue.waitSince(seq, DYB_EVT_HANDSHK | DYB_EVT_CUSTOM, 0, &event) == DYB_EVT_CUSTOM);
+    CHECK(event.value == 0);
+    CHECK(queue.waitSince(seq, DYB_EVT_HANDSHK, 0, &event) == DYB_EVT_HANDSHK);
+    CHECK(event.value == 1);
+}
+
+
+/* A ring of 4: overwritten matches fall back to the latest one of their kind */
+static void checkOverwritten()
+{
+    EventQueue queue(4);
+    QueuedEvent event;
+    const uint64_t seq = queue.sequence();
+
+    queue.post(DYB_EVT_DATA_02, 2);
+    dybstub::notify(0x300, 0, 1);
+    for(int32_t k = 0; k < 10; k++)
+        dybstub::notify(0x301, 0, k);
+    CHECK(queue.sequence() == seq + 12);
+
+    CHECK(queue.waitSince(seq, DYB_EVT_DATA_02, 0, &event) == DYB_EVT_DATA_02);
+    CHECK(event.seq == seq + 1);
+    CHECK(queue.waitSince(seq, DYB_EVT_CUSTOM, 0, &event, 0x300) == DYB_EVT_CUSTOM);
+    CHECK(event.address == 0x300 && event.value == 1);
+    CHECK(queue.waitSince(seq, DYB_EVT_CUSTOM, 0, &event) == DYB_EVT_CUSTOM);
+    CHECK(event.address == 0x301 && event.value == 6);          /* Oldest one in the ring */
+    CHECK(queue.waitSince(seq + 12, DYB_EVT_CUSTOM, 0) == 0);
+}
+
+
+/* A waiter follows a posting thread without missing the end */
+static void checkThreads()
+{
+    EventQueue queue(64);
+    const int32_t events = 20000;
+    uint64_t seq = queue.sequence();
+    const uint64_t last = seq + events;
+
+    std::thread poster([&queue]()
+    {
+        for(int32_t k = 1; k <= events; k++)
+            queue.post(k % 100 ? DYB_EVT_DATA_01 : DYB_EVT_DATA_01 | DYB_EVT_DATA_03, 1, 0, k);
+    });
+
+    QueuedEvent event;
+    int32_t backwards = 0, seen = 0, timeouts = 0;
+    while(seq < last && timeouts < 10)
+    {
+        if(queue.waitSince(seq, DYB_EVT_DATA_01, 100, &event) == 0)
+        {
+            timeouts++;
+            continue;
+        }
+        backwards += event.seq <= seq || event.value != static_cast<int32_t>(event.seq - (last - events)) ? 1 : 0;
+        seq = event.seq;
+        seen++;
+    }
+    poster.join();
+    CHECK(seq == last);
+    CHECK(backwards == 0);
+    CHECK(seen > 0 && timeouts == 0);
+
+    /* A waiter blocked before the event */
+    seq = queue.sequence();
+    int32_t type = 0;
+    std::thread waiter([&]() { type = queue.waitSince(seq, DYB_EVT_DATA_03, 2000, &event); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.post(DYB_EVT_DATA_03, 3, 0, 42);
+    waiter.join();
+    CHECK(type == DYB_EVT_DATA_03 && event.value == 42);
+}
+
+
+/* The pump fetches all full buffers and keeps the latest one */
+static void checkPump()
+{
+    dybstub::reset();
+    dybstub::setFrameSize(1, 16);
+    const DYB_Meta meta = dybstub::scanMeta(DYB_FfScan, 2, 4);
+    FramePool pool;
+    EventQueue queue;
+    uint64_t seq = queue.sequence();
+
+    for(int32_t frameNo = 0; frameNo < 3; frameNo++)
+        dybstub::queueFrame(1, frameNo, 0, std::vector<int32_t>(16, frameNo), meta);
+    CHECK(queue.pumpData(pool, DYB_EVT_DATA_01) == DYB_Ok);
+    CHECK(queue.pumpData(pool, DYB_EVT_DATA_01) == DYB_WrongContext);
+
+    QueuedEvent event;
+    int32_t fetched = 0;
+    while(fetched < 3 && queue.waitSince(seq, DYB_EVT_DATA_01, 1000, &event) == DYB_EVT_DATA_01)
+    {
+        seq = event.seq;
+        fetched++;
+    }
+    CHECK(fetched == 3);
+    FrameBuffer *buffer = queue.takeFrame(1);
+    CHECK(buffer && buffer->frameNo == 2 && buffer->data[15] == 2);
+    pool.release(buffer);
+    CHECK(queue.takeFrame(1) == NULL);
+    CHECK(queue.takeFrame(-1) == NULL);
+
+    /* A buffer not taken goes back to the pool on stop */
+    dybstub::queueFrame(1, 3, 0, std::vector<int32_t>(16, 3), meta);
+    CHECK(queue.waitSince(seq, DYB_EVT_DATA_01, 1000) == DYB_EVT_DATA_01);
+    queue.stopPump();
+    CHECK(queue.takeFrame(1) == NULL);
+    CHECK(pool.allocations() <= 3);
+}
+
+
+int main()
+{
+    checkBeforeWait();
+    checkOverwritten();
+    checkThreads();
+    checkPump();
+    return asc500test::result("test_eventqueue");
+}
@@ -0,0 +1,219 @@
+/* Exporter: the three policies with a writer held up by the disk, the
+ * buffers returned to the pool, failed writes and submits after stop().
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500_exporter.h"
+
+using namespace asc500;
+
+
+/* A disk that writes only while open; records the first item of every file */
+class Disk
+{
+public:
+    Disk() : _open(true), _busy(false)
+    {
+        dybstub::setWriteHook([this](const char *fileName, const Int32 dataSize, const Int32 *data)
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+            _busy = true;
+            _changed.notify_all();
+            _changed.wait(lock, [this] { return _open; });
+            _busy = false;
+            _written.push_back(dataSize > 0 ? data[0] : -1);
+            return std::string(fileName) == "bad" ? DYB_Error : DYB_Ok;
+        });
+    }
+
+    ~Disk() { dybstub::setWriteHook(NULL); }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _open = false;
+    }
+
+    void open()
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _open = true;
+        _changed.notify_all();
+    }
+
+    /* Waits until the writer is held up */
+    bool waitBusy()
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+        return _changed.wait_for(lock, std::chrono::seconds(2), [this] { return _busy; });
+    }
+
+    std::vector<int32_t> written()
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        return _written;
+    }
+
+private:
+    std::mutex _lock;
+    std::condition_variable _changed;
+    bool _open;
+    bool _busy;
+    std::vector<int32_t> _written;
+};
+
+
+static DYB_Rc submit(Exporter &exporter, FramePool &pool, const int32_t value,
+                     const std::string &fileName = "frame")
+{
+    FrameBuffer *buffer = pool.acquire(1, 8);
+    if(!buffer)
+        return DYB_Error;
+    buffer->dataSize = 8;
+    buffer->data[0] = value;
+    return exporter.submit(pool, buffer, fileName, "", true, true);
+}
+
+
+/* The fourth submit waits for the disk */
+static void checkBlock()
+{
+    dybstub::reset();
+    FramePool pool;
+    Disk disk;
+    Exporter exporter(2, Exporter::Block);
+
+    disk.close();
+    CHECK(submit(exporter, pool, 1) == DYB_Ok);
+    CHECK(disk.waitBusy());
+    CHECK(submit(exporter, pool, 2) == DYB_Ok);
+    CHECK(submit(exporter, pool, 3) == DYB_Ok);
+
+    std::mutex lock;
+    std::condition_variable submitted;
+    DYB_Rc rc = DYB_Error;
+    bool returned = false;
+    std::thread producer([&]()
+    {
+        const DYB_Rc result = submit(exporter, pool, 4);
+        std::lock_guard<std::mutex> guard(lock);
+        rc = result;
+        returned = true;
+        submitted.notify_all();
+    });
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        CHECK(!submitted.wait_for(guard, std::chrono::milliseconds(50), [&] { return returned; }));
+    }
+    CHECK(exporter.metrics().depth == 2);
+    disk.open();
+    producer.join();
+    CHECK(rc == DYB_Ok);
+    exporter.flush();
+
+    const ExportMetrics metrics = exporter.metrics();
+    CHECK(disk.written() == std::vector<int32_t>({ 1, 2, 3, 4 }));
+    CHECK(metrics.submitted == 4 && metrics.written == 4 && metrics.depth == 0 && metrics.maxDepth == 2);
+    CHECK(metrics.blockedUs >= 40000);
+    CHECK(pool.allocations() == 4);
+}
+
+
+static void checkDropOldest()
+{
+    dybstub::reset();
+    FramePool pool;
+    Disk disk;
+    Exporter exporter(2, Exporter::DropOldest);
+
+    disk.close();
+    CHECK(submit(exporter, pool, 1) == DYB_Ok);
+    CHECK(disk.waitBusy());
+    for(int32_t value = 2; value <= 5; value++)
+        CHECK(submit(exporter, pool, value) == DYB_Ok);
+    disk.open();
+    exporter.flush();
+
+    CHECK(disk.written() == std::vector<int32_t>({ 1, 4, 5 }));
+    CHECK(exporter.metrics().dropped == 2);
+
+    /* Every buffer went back */
+    std::vector<FrameBuffer *> buffers;
+    const uint64_t allocations = pool.allocations();
+    for(uint64_t k = 0; k < allocations; k++)
+        buffers.push_back(pool.acquire(1, 8));
+    CHECK(pool.allocations() == allocations);
+    for(FrameBuffer *buffer : buffers)
+        pool.release(buffer);
+}
+
+
+/* Spilled data survive the reuse of their pool buffer */
+static void checkSpill()
+{
+    dybstub::reset();
+    FramePool pool;
+    Disk disk;
+    Exporter exporter(1, Exporter::Spill);
+
+    disk.close();
+    CHECK(submit(exporter, pool, 1) == DYB_Ok);
+    CHECK(disk.waitBusy());
+    CHECK(submit(exporter, pool, 2) == DYB_Ok);
+    CHECK(submit(exporter, pool, 3) == DYB_Ok);
+    CHECK(submit(exporter, pool, 4) == DYB_Ok);
+    const uint64_t allocations = pool.allocations();
+    FrameBuffer *reused = pool.acquire(1, 8);
+    reused->data[0] = -1;
+    pool.release(reused);
+    CHECK(pool.allocations() == allocations);
+    CHECK(exporter.metrics().spilled == 2 && exporter.metrics().depth == 3);
+
+    disk.open();
+    exporter.flush();
+    CHECK(disk.written() == std::vector<int32_t>({ 1, 2, 3, 4 }));
+}
+
+
+static void checkErrors()
+{
+    dybstub::reset();
+    FramePool pool;
+    Disk disk;
+    Exporter exporter;
+
+    CHECK(exporter.submit(pool, NULL, "frame", "", true, true) == DYB_OutOfRange);
+    CHECK(submit(exporter, pool, 1, "bad") == DYB_Ok);
+    CHECK(submit(exporter, pool, 2) == DYB_Ok);
+    exporter.flush();
+    CHECK(exporter.metrics().failed == 1 && exporter.metrics().written == 1);
+    CHECK(exporter.lastError() == DYB_Error);
+
+    /* Queued buffers are written on stop, later ones refused */
+    disk.close();
+    CHECK(submit(exporter, pool, 3) == DYB_Ok);
+    CHECK(disk.waitBusy());
+    CHECK(submit(exporter, pool, 4) == DYB_Ok);
+    disk.open();
+    exporter.stop();
+    CHECK(submit(exporter, pool, 5) == DYB_WrongContext);
+    CHECK(disk.written() == std::vector<int32_t>({ 1, 2, 3, 4 }));
+}
+
+
+int main()
+{
+    checkBlock();
+    checkDropOldest();
+    checkSpill();
+    checkErrors();
+    return asc500test::result("test_exporter");
+}
@@ -0,0 +1,141 @@
+/* File reader: planes of bcrf and bcrstm files, headers that are not
+ * recognized, and the line index of text files with its sidecar.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "asc500_test.h"
+#include "asc500_filereader.h"
+
+using namespace asc500;
+
+
+static void writeFile(const char *name, const std::string &bytes)
+{
+    FILE *file = fopen(name, "wb");
+    CHECK(file != NULL);
+    if(!file)
+        return;
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+
+/* Header padded to 2048 bytes, then the planes */
+static std::string bcrf(const std::string &format, const std::string &values, const void *data,
+                        const size_t bytes)
+{
+    std::string file = "fileformat = " + format + "\nheadersize = 2048\n" + values +
+                       "% comment = not a key\n";
+    file.resize(2048, ' ');
+    file.append(static_cast<const char *>(data), bytes);
+    return file;
+}
+
+
+static void checkBcrf()
+{
+    /* Two planes of 3 x 2 and half a plane */
+    std::vector<Flt32> values(15);
+    for(size_t k = 0; k < values.size(); k++)
+        values[k] = 0.5f * k;
+    writeFile("test_fr.bcrf", bcrf("bcrf", "xpixels = 3\nypixels = 2\r\nxlength  =  12.5\n",
+                                   values.data(), values.size() * sizeof(Flt32)));
+
+    BcrfFile file;
+    CHECK(file.open("test_fr.bcrf") == DYB_Ok);
+    CHECK(file.isFloat() && file.columns() == 3 && file.lines() == 2 && file.planes() == 2);
+    CHECK(file.value("xlength") == "12.5" && file.number("xlength") == 12.5);
+    CHECK(file.value("comment", "none") == "none" && file.number("zlength", -1.0) == -1.0);
+
+    const PlaneView<Flt32> second = file.floatPlane(1);
+    CHECK(second.data != NULL && second.columns == 3 && second.lines == 2);
+    if(second.data)
+        CHECK(second.at(0, 0) == 3.0f && second.at(2, 1) == 5.5f && second.row(1)[0] == 4.5f);
+    CHECK(file.floatPlane(2).data == NULL);
+    CHECK(file.floatPlane(-1).data == NULL);
+    CHECK(file.shortPlane(0).data == NULL);
+    file.close();
+    CHECK(file.planes() == 0 && file.floatPlane(0).data == NULL);
+
+    const int16_t shorts[] = { 1, -2, 3, -4 };
+    writeFile("test_fr.bcrf", bcrf("bcrstm", "xpixels = 2\nypixels = 2\n", shorts, sizeof(shorts)));
+    CHECK(file.open("test_fr.bcrf") == DYB_Ok);
+    CHECK(!file.isFloat() && file.planes() == 1);
+    const PlaneView<int16_t> plane = file.shortPlane(0);
+    CHECK(plane.data != NULL);
+    if(plane.data)
+        CHECK(plane.at(1, 0) == -2 && plane.at(1, 1) == -4);
+    CHECK(file.floatPlane(0).data == NULL);
+
+    /* Not recognized */
+    writeFile("test_fr.bcrf", bcrf("png", "xpixels = 2\nypixels = 2\n", shorts, sizeof(shorts)));
+    CHECK(file.open("test_fr.bcrf") == DYB_Error);
+    writeFile("test_fr.bcrf", bcrf("bcrf", "xpixels = 2\n", shorts, sizeof(shorts)));
+    CHECK(file.open("test_fr.bcrf") == DYB_Error);
+    writeFile("test_fr.bcrf", "fileformat = bcrf\nheadersize = 2048\nxpixels = 2\nypixels = 2\n");
+    CHECK(file.open("test_fr.bcrf") == DYB_Error);
+    CHECK(file.open("test_fr.missing") == DYB_OpenError);
+    remove("test_fr.bcrf");
+}
+
+
+static void checkText()
+{
+    remove("test_fr.asc.idx");
+    writeFile("test_fr.asc", "# x y z\n1 2 3\n\n  4,5;6\r\n# between\n7\t8   9");
+
+    TextFile file;
+    CHECK(file.open("test_fr.asc") == DYB_Ok);
+    CHECK(!file.indexLoaded());
+    CHECK(file.dataLines() == 3 && file.fieldsPerLine() == 3);
+
+    size_t length = 0;
+    const char *line = file.dataLine(1, &length);
+    CHECK(line && std::string(line, length) == "  4,5;6");
+    line = file.dataLine(2, &length);
+    CHECK(line && std::string(line, length) == "7\t8   9");
+    CHECK(file.dataLine(3, &length) == NULL && file.dataLine(-1, &length) == NULL);
+
+    std::vector<double> values;
+    CHECK(file.readValues(1, 8, values) == DYB_Ok);
+    CHECK(values == std::vector<double>({ 2, 3, 4, 5, 6, 7, 8 }));
+    CHECK(file.readValues(4, 4, values) == DYB_Ok && values.empty());
+    CHECK(file.readValues(0, 10, values) == DYB_OutOfRange);
+    CHECK(file.readValues(5, 4, values) == DYB_OutOfRange);
+
+    /* Second open: index from the sidecar, same lines */
+    CHECK(file.open("test_fr.asc") == DYB_Ok);
+    CHECK(file.indexLoaded() && file.dataLines() == 3 && file.fieldsPerLine() == 3);
+    CHECK(file.readValues(6, 9, values) == DYB_Ok && values == std::vector<double>({ 7, 8, 9 }));
+
+    /* The file has changed: the sidecar is stale */
+    writeFile("test_fr.asc", "1.5;2.5\n3.5;4.5\n");
+    CHECK(file.open("test_fr.asc") == DYB_Ok);
+    CHECK(!file.indexLoaded() && file.dataLines() == 2 && file.fieldsPerLine() == 2);
+    CHECK(file.readValues(1, 3, values) == DYB_Ok && values == std::vector<double>({ 2.5, 3.5 }));
+
+    /* A damaged sidecar is rebuilt */
+    writeFile("test_fr.asc.idx", "A5IX");
+    CHECK(file.open("test_fr.asc") == DYB_Ok);
+    CHECK(!file.indexLoaded() && file.dataLines() == 2);
+    CHECK(file.open("test_fr.asc", false) == DYB_Ok && !file.indexLoaded());
+
+    writeFile("test_fr.asc", "");
+    CHECK(file.open("test_fr.asc", false) == DYB_Ok);
+    CHECK(file.dataLines() == 0 && file.readValues(0, 1, values) == DYB_OutOfRange);
+    file.close();
+    remove("test_fr.asc");
+    remove("test_fr.asc.idx");
+}
+
+
+int main()
+{
+    checkBcrf();
+    checkText();
+    return asc500test::result("test_filereader");
+}
@@ -0,0 +1,123 @@
+/* Frame pool: buffers recycled in a polling loop, the limit of kept
+ * buffers, a changing frame size, and threads sharing the pool.
+ */
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500_framepool.h"
+
+using namespace asc500;
+
+
+/* A steady loop allocates once; the data arrive intact and aligned */
+static void checkPolling()
+{
+    dybstub::reset();
+    dybstub::setFrameSize(2, 64);
+    const DYB_Meta meta = dybstub::scanMeta(DYB_FfScan, 4, 8);
+    FramePool pool;
+    int32_t wrong = 0;
+
+    for(int32_t frameNo = 0; frameNo < 100; frameNo++)
+    {
+        std::vector<int32_t> data(64);
+        for(int32_t k = 0; k < 64; k++)
+            data[k] = frameNo * 1000 + k;
+        dybstub::queueFrame(2, frameNo, 0, data, meta);
+
+        PooledFrame frame(pool, 2);
+        CHECK(frame && frame->capacity == 64);
+        if(!frame)
+            continue;
+        wrong += reinterpret_cast<uintptr_t>(frame->data) % 64 != 0 ? 1 : 0;
+        CHECK(FramePool::fill(frame.get(), 1) == DYB_Ok);
+        wrong += frame->frameNo != frameNo || frame->dataSize != 64 || frame->meta._pointsY != 8 ? 1 : 0;
+        for(int32_t k = 0; k < 64; k++)
+            wrong += frame->data[k] != data[k] ? 1 : 0;
+    }
+    CHECK(wrong == 0);
+    CHECK(pool.allocations() == 1);
+
+    /* Nothing queued */
+    PooledFrame empty(pool, 2);
+    CHECK(FramePool::fill(empty.get(), 1) == DYB_OutOfRange);
+    CHECK(FramePool::fill(NULL, 1) == DYB_OutOfRange);
+}
+
+
+static void checkLimits()
+{
+    dybstub::reset();
+    FramePool pool(4);
+    CHECK(pool.acquire(3) == NULL);                     /* Size unknown */
+    CHECK(pool.acquire(-1, 16) == NULL);
+    CHECK(pool.acquire(ASC500_DATA_CHANNELS, 16) == NULL);
+
+    /* Six out at once, four kept on return */
+    std::vector<FrameBuffer *> buffers;
+    for(int32_t k = 0; k < 6; k++)
+        buffers.push_back(pool.acquire(3, 16));
+    for(FrameBuffer *buffer : buffers)
+        pool.release(buffer);
+    buffers.clear();
+    for(int32_t k = 0; k < 6; k++)
+        buffers.push_back(pool.acquire(3, 16));
+    CHECK(pool.allocations() == 8);
+
+    /* A new frame size drops the cached buffers; the old ones aren't kept */
+    FrameBuffer *larger = pool.acquire(3, 32);
+    CHECK(larger && larger->capacity == 32);
+    for(FrameBuffer *buffer : buffers)
+        pool.release(buffer);
+    pool.release(larger);
+    pool.release(NULL);
+    CHECK(pool.allocations() == 9);
+    FrameBuffer *again = pool.acquire(3, 32);
+    CHECK(again == larger);
+    CHECK(pool.allocations() == 9);
+    pool.release(again);
+}
+
+
+/* Buffers handed between threads; never more than one per thread out */
+static void checkThreads()
+{
+    FramePool pool(4);
+    std::vector<std::thread> threads;
+    for(int32_t t = 0; t < 4; t++)
+    {
+        threads.push_back(std::thread([&pool]()
+        {
+            for(int32_t k = 0; k < 10000; k++)
+            {
+                PooledFrame frame(pool, 5, 256);
+                if(frame)
+                    frame->data[k % 256] = k;
+            }
+        }));
+    }
+    for(std::thread &thread : threads)
+        thread.join();
+    CHECK(pool.allocations() <= 4);
+
+    /* Released by another thread than the one that acquired it */
+    PooledFrame frame(pool, 5, 256);
+    FrameBuffer *buffer = frame.detach();
+    CHECK(!frame && buffer != NULL);
+    std::thread receiver([&pool, buffer]() { pool.release(buffer); });
+    receiver.join();
+    CHECK(pool.allocations() <= 4);
+}
+
+
+int main()
+{
+    checkPolling();
+    checkLimits();
+    checkThreads();
+    return asc500test::result("test_framepool");
+}
@@ -0,0 +1,126 @@
+/* Frame writer: headers with long comments, rows of partial frames at
+ * their final position and the Y direction of the following frame.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500_framewriter.h"
+
+using namespace asc500;
+
+static const int32_t PointsX = 3,
+                     PointsY = 2;
+
+
+static std::string readFile(const std::string &name)
+{
+    std::string bytes;
+    FILE *file = fopen(name.c_str(), "rb");
+    if(!file)
+        return bytes;
+    char buffer[256];
+    size_t n = 0;
+    while((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        bytes.append(buffer, n);
+    fclose(file);
+    return bytes;
+}
+
+
+/* Forward and backward half of every line, value = data index */
+static std::vector<int32_t> frameData()
+{
+    std::vector<int32_t> data(2 * PointsX * PointsY);
+    for(size_t k = 0; k < data.size(); k++)
+        data[k] = static_cast<int32_t>(k);
+    return data;
+}
+
+
+static void checkBinary()
+{
+    const DYB_Meta meta = dybstub::scanMeta(DYB_FbScan, PointsX, PointsY);
+    const std::vector<int32_t> data = frameData();
+    FrameWriter writer("test_fw", "z forward", true, true);
+
+    /* First line only: the second row stays NaN */
+    CHECK(writer.update(0, 0, 2 * PointsX, data.data(), &meta) == DYB_Ok);
+    CHECK(writer.isOpen());
+    CHECK(writer.finish() == DYB_Ok);
+    std::string file = readFile("test_fw_0.bcrf");
+    CHECK(file.size() == 2048 + PointsX * PointsY * sizeof(Flt32));
+    CHECK(file.compare(0, 18, "fileformat = bcrf\n") == 0);
+    CHECK(file.find("% z forward\n% frame = 0\n") != std::string::npos);
+    if(file.size() == 2048 + PointsX * PointsY * sizeof(Flt32))
+    {
+        Flt32 rows[PointsX * PointsY];
+        memcpy(rows, file.data() + 2048, sizeof(rows));
+        CHECK(rows[0] == 0.0f && rows[1] == 1.0f && rows[2] == 2.0f);
+        CHECK(std::isnan(rows[3]) && std::isnan(rows[5]));
+    }
+
+    /* Frame 1 runs the other way: data line 0 is row 1 */
+    CHECK(writer.update(1, 0, 8, data.data(), &meta) == DYB_Ok);
+    CHECK(writer.update(1, 6, static_cast<int32_t>(data.size()) - 6, data.data() + 6, &meta) == DYB_Ok);
+    CHECK(!writer.isOpen());
+    file = readFile("test_fw_1.bcrf");
+    if(file.size() == 2048 + PointsX * PointsY * sizeof(Flt32))
+    {
+        Flt32 rows[PointsX * PointsY];
+        memcpy(rows, file.data() + 2048, sizeof(rows));
+        CHECK(rows[0] == 6.0f && rows[1] == 7.0f && rows[2] == 8.0f);
+        CHECK(rows[3] == 0.0f && rows[4] == 1.0f && rows[5] == 2.0f);
+    }
+    else
+        CHECK(false);
+
+    /* A header that does not fit is refused, not cut */
+    FrameWriter large("test_fw_large", std::string(3000, 'c'), true, true);
+    CHECK(large.update(0, 0, static_cast<int32_t>(data.size()), data.data(), &meta) == DYB_OutOfRange);
+    large.finish();
+    remove("test_fw_large_0.bcrf");
+    remove("test_fw_0.bcrf");
+    remove("test_fw_1.bcrf");
+}
+
+
+/* The header holds the complete comment, whatever its length */
+static void checkText()
+{
+    DYB_Meta meta = dybstub::scanMeta(DYB_FbScan, PointsX, PointsY);
+    meta._stepX = 0.5f;
+    meta._originY = -1.25f;
+    const std::vector<int32_t> data = frameData();
+    const std::string comment(400, 'c');
+    FrameWriter writer("test_fw", comment, false, false);
+
+    CHECK(writer.update(0, 0, static_cast<int32_t>(data.size()), data.data(), &meta) == DYB_Ok);
+    CHECK(writer.currentFile() == "test_fw_0.asc");
+    const std::string file = readFile("test_fw_0.asc");
+    const std::string header = "# " + comment + "\n# frame: 0\n# direction: backward\n"
+                               "# x-pixels: 3\n# y-pixels: 2\n# x-length: 1.5 ?\n# y-length: 2 ?\n"
+                               "# x-offset: 0 ?\n# y-offset: -1.25 ?\n# rotation: 0 rad\n# value unit: ?\n";
+    CHECK(file.compare(0, header.size(), header) == 0);
+
+    /* Backward halves, reversed to image order, 16 characters a field */
+    const std::string rows = file.size() > header.size() ? file.substr(header.size()) : std::string();
+    CHECK(rows.size() == 2 * PointsX * 16);
+    CHECK(rows.compare(0, 16, "   5.000000e+00 ") == 0);
+    CHECK(rows.compare(2 * 16, 16, "   3.000000e+00\n") == 0);
+    CHECK(rows.compare(3 * 16, 16, "   1.100000e+01 ") == 0);
+    remove("test_fw_0.asc");
+}
+
+
+int main()
+{
+    checkBinary();
+    checkText();
+    return asc500test::result("test_framewriter");
+}
@@ -0,0 +1,140 @@
+/* Frame leveling: SSE2 and AVX2 kernels against the scalar reference,
+ * and every mode on frames with a known closed form.
+ */
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "asc500_test.h"
+
+/* The kernels are static */
+#include "../asc500_leveling.cpp"
+
+using namespace asc500;
+
+static const Flt32 NaN = std::numeric_limits<Flt32>::quiet_NaN();
+
+
+static void checkKernels(std::mt19937 &random)
+{
+    std::uniform_real_distribution<Flt32> value(-50.0f, 50.0f);
+    std::uniform_int_distribution<int> hole(0, 7);
+    const Flt32 c[4] = { 0.5f, -1.25f, 2.0f, 0.125f };
+
+    for(int32_t count = 1; count < 40; count++)
+    {
+        std::vector<Flt32> z(count), reference(count), simd(count);
+        for(Flt32 &v : z)
+            v = hole(random) == 0 ? NaN : value(random);
+        const double du = step(count);
+        double s0[MomentCount], s1[MomentCount];
+
+        memset(s0, 0, sizeof(s0));
+        momentsScalar(z.data(), 0, count, du, s0);
+        subtractScalar(z.data(), 0, count, static_cast<Flt32>(du), c, reference.data());
+#ifdef ASC500_SSE2
+        memset(s1, 0, sizeof(s1));
+        momentsSse2(z.data(), count, du, s1);
+        for(int k = 0; k < MomentCount; k++)
+            CHECK_NEAR(s1[k], s0[k], 1e-12 * (1.0 + fabs(s0[k])) * count);
+        subtractSse2(z.data(), count, static_cast<Flt32>(du), c, simd.data());
+        CHECK(memcmp(simd.data(), reference.data(), count * sizeof(Flt32)) == 0);
+#endif
+#ifdef ASC500_AVX2
+        if(cpuHasAvx2())
+        {
+            memset(s1, 0, sizeof(s1));
+            momentsAvx2(z.data(), count, du, s1);
+            for(int k = 0; k < MomentCount; k++)
+                CHECK_NEAR(s1[k], s0[k], 1e-12 * (1.0 + fabs(s0[k])) * count);
+            subtractAvx2(z.data(), count, static_cast<Flt32>(du), c, simd.data());
+            CHECK(memcmp(simd.data(), reference.data(), count * sizeof(Flt32)) == 0);
+        }
+#endif
+    }
+}
+
+
+/* Feeds a frame bottom to top and returns the largest |leveled value| */
+static double level(FrameLeveler &leveler, const std::vector<Flt32> &frame, const int32_t columns, const int32_t rows)
+{
+    for(int32_t row = rows - 1; row >= 0; row--)
+        CHECK(leveler.addRow(frame.data() + static_cast<size_t>(row) * columns, columns, rows, row) == DYB_Ok);
+    CHECK(leveler.complete());
+
+    double worst = 0.0;
+    for(int32_t k = 0; k < columns * rows; k++)
+    {
+        if(frame[k] == frame[k])
+            worst = std::max(worst, static_cast<double>(fabs(leveler.frame()[k])));
+        else
+            CHECK(leveler.frame()[k] != leveler.frame()[k]);
+    }
+    return worst;
+}
+
+
+int main()
+{
+    std::mt19937 random(21);
+    checkKernels(random);
+
+    const int32_t columns = 37,
+                  rows = 23;
+    std::vector<Flt32> frame(columns * rows);
+
+    /* Plane: z = 3 + 0.5 x - 0.25 y, with a hole */
+    for(int32_t r = 0; r < rows; r++)
+        for(int32_t c = 0; c < columns; c++)
+            frame[r * columns + c] = 3.0f + 0.5f * c - 0.25f * r;
+    frame[5 * columns + 7] = NaN;
+    {
+        FrameLeveler leveler(FrameLeveler::Plane);
+        CHECK(level(leveler, frame, columns, rows) < 1e-4);
+        const PlaneFit fit = leveler.plane();
+        CHECK_NEAR(fit.offset, 3.0, 1e-6);
+        CHECK_NEAR(fit.slopeX, 0.5, 1e-9);
+        CHECK_NEAR(fit.slopeY, -0.25, 1e-9);
+        CHECK(fit.points == columns * rows - 1);
+    }
+
+    /* Offset: every row has its own offset */
+    for(int32_t r = 0; r < rows; r++)
+        for(int32_t c = 0; c < columns; c++)
+            frame[r * columns + c] = 100.0f * r + (c % 2 == 0 ? 1.0f : -1.0f);
+    {
+        /* Odd count of columns: the row mean is 1 / columns */
+        FrameLeveler leveler(FrameLeveler::Offset);
+        level(leveler, frame, columns, rows);
+        CHECK_NEAR(leveler.frame()[3 * columns], 1.0 - 1.0 / columns, 1e-4);
+        CHECK_NEAR(leveler.frame()[3 * columns + 1], -1.0 - 1.0 / columns, 1e-4);
+    }
+
+    /* Median: an outlier doesn't move the row */
+    for(int32_t r = 0; r < rows; r++)
+        for(int32_t c = 0; c < columns; c++)
+            frame[r * columns + c] = c == 4 ? 1.0e6f : 10.0f * r;
+    {
+        FrameLeveler leveler(FrameLeveler::Median);
+        level(leveler, frame, columns, rows);
+        CHECK_NEAR(leveler.frame()[2 * columns], 0.0, 0.0);
+        CHECK_NEAR(leveler.frame()[2 * columns + 4], 1.0e6 - 20.0, 0.0);
+    }
+
+    /* Polynomial of order 3 in x, different per row */
+    for(int32_t r = 0; r < rows; r++)
+    {
+        for(int32_t c = 0; c < columns; c++)
+        {
+            const double u = -1.0 + 2.0 * c / (columns - 1);
+            frame[r * columns + c] = static_cast<Flt32>(r - 2.0 * u + 0.5 * u * u + 3.0 * u * u * u);
+        }
+    }
+    {
+        FrameLeveler leveler(FrameLeveler::Polynomial, 3);
+        CHECK(level(leveler, frame, columns, rows) < 1e-4);
+    }
+
+    return asc500test::result("test_leveling");
+}
@@ -0,0 +1,168 @@
+/* Lock-in: SSE2 and AVX2 demodulation against the scalar reference, and
+ * the amplitude and phase of a synthetic sum of sines.
+ */
+
+#include <random>
+#include <vector>
+
+#include "asc500_test.h"
+
+/* The kernels are static */
+#include "../asc500_lockin.cpp"
+
+using namespace asc500;
+
+
+struct LaneState
+{
+    std::vector<double> c, s, x, y;
+};
+
+
+static void checkKernels(std::mt19937 &random)
+{
+    std::uniform_real_distribution<double> value(-1.0, 1.0), alpha(0.001, 0.5);
+    const int32_t lanes = 8, stages = 3, count = 300;
+
+    std::vector<Flt32> in(count);
+    for(Flt32 &v : in)
+        v = static_cast<Flt32>(value(random));
+    std::vector<double> rc(lanes), rs(lanes), a(lanes * stages);
+    LaneState start;
+    for(int32_t lane = 0; lane < lanes; lane++)
+    {
+        const double angle = Pi * value(random);
+        rc[lane] = cos(angle);
+        rs[lane] = sin(angle);
+        start.c.push_back(value(random));
+        start.s.push_back(value(random));
+    }
+    for(int32_t k = 0; k < lanes * stages; k++)
+    {
+        a[k] = alpha(random);
+        start.x.push_back(value(random));
+        start.y.push_back(value(random));
+    }
+
+    /* Odd lane ranges exercise the fallback to the narrower kernels */
+    const int32_t ranges[][2] = { { 0, 8 }, { 1, 8 }, { 0, 7 }, { 2, 5 } };
+    for(const int32_t *range : ranges)
+    {
+        LaneState reference = start, simd = start;
+        Lanes l;
+        l.lanes = lanes;
+        l.stages = stages;
+        l.rc = rc.data();
+        l.rs = rs.data();
+        l.alpha = a.data();
+
+        l.c = reference.c.data();
+        l.s = reference.s.data();
+        l.x = reference.x.data();
+        l.y = reference.y.data();
+        demodScalar(in.data(), count, l, range[0], range[1]);
+
+#ifdef ASC500_SSE2
+        l.c = simd.c.data();
+        l.s = simd.s.data();
+        l.x = simd.x.data();
+        l.y = simd.y.data();
+        demodSse2(in.data(), count, l, range[0], range[1]);
+        CHECK(simd.c == reference.c && simd.s == reference.s);
+        CHECK(simd.x == reference.x && simd.y == reference.y);
+#endif
+#ifdef ASC500_AVX2
+        if(cpuHasAvx2())
+        {
+            simd = start;
+            l.c = simd.c.data();
+            l.s = simd.s.data();
+            l.x = simd.x.data();
+            l.y = simd.y.data();
+            demodAvx2(in.data(), count, l, range[0], range[1]);
+            CHECK(simd.c == reference.c && simd.s == reference.s);
+            CHECK(simd.x == reference.x && simd.y == reference.y);
+        }
+#endif
+    }
+}
+
+
+/* Sum of A cos(2 pi f t + phi) and an offset: every reference finds its
+ * own line, X = A cos(phi - p), Y = A sin(phi - p) for reference phase p */
+static void checkSines()
+{
+    const double rate = 100000.0;
+    const double frequency[] = { 1000.0, 3700.0, 12000.0, 25000.0, 41500.0 },
+                 amplitude[] = { 1.0, 0.25, 2.0, 0.5, 0.125 },
+                 phase[] = { 0.0, 45.0, -120.0, 170.0, 10.0 },
+                 refPhase[] = { 0.0, 0.0, 30.0, 0.0, -10.0 };
+    const int32_t refs = 5, length = 100000, decimation = 1000;
+
+    std::vector<Flt32> signal(length);
+    for(int32_t n = 0; n < length; n++)
+    {
+        double v = 0.3;
+        for(int32_t r = 0; r < refs; r++)
+            v += amplitude[r] * cos(2.0 * Pi * frequency[r] * n / rate + phase[r] * Pi / 180.0);
+        signal[n] = static_cast<Flt32>(v);
+    }
+
+    LockIn lockIn(rate, decimation);
+    for(int32_t r = 0; r < refs; r++)
+        CHECK(lockIn.addReference(frequency[r], 0.01, 4, refPhase[r]) == r);
+    CHECK(lockIn.addReference(rate / 2.0, 0.01) == -1);
+    CHECK(lockIn.addReference(1000.0, 0.01, 0) == -1);
+    CHECK(lockIn.addReference(1000.0, 0.0) == -1);
+
+    int32_t outputs = 0;
+    int64_t lastIndex = -1;
+    lockIn.onOutput([&](const int32_t reference, const LockInSample *samples, const int32_t count)
+    {
+        if(reference == 0)
+        {
+            outputs += count;
+            lastIndex = samples[count - 1].index;
+        }
+    });
+
+    /* Uneven pieces across the decimation and block boundaries */
+    for(int32_t done = 0; done < length; )
+    {
+        const int32_t n = length - done < 777 ? length - done : 777;
+        CHECK(lockIn.push(signal.data() + done, n) == DYB_Ok);
+        done += n;
+    }
+    CHECK(outputs == length / decimation);
+    CHECK(lastIndex == length - 1);
+
+    for(int32_t r = 0; r < refs; r++)
+    {
+        LockInSample sample;
+        CHECK(lockIn.latest(r, sample));
+        /* The NCO step is quantized to 2^-32 turns: up to 1e-4 rad phase drift in 1 s */
+        const double theta = (phase[r] - refPhase[r]) * Pi / 180.0;
+        CHECK_NEAR(sample.r, amplitude[r], 1e-5 * amplitude[r]);
+        CHECK_NEAR(sample.theta, phase[r] - refPhase[r], 0.01);
+        CHECK_NEAR(sample.x, amplitude[r] * cos(theta), 2e-4 * amplitude[r]);
+        CHECK_NEAR(sample.y, amplitude[r] * sin(theta), 2e-4 * amplitude[r]);
+    }
+
+    LockInSample none;
+    CHECK(!lockIn.latest(refs, none));
+}
+
+
+int main()
+{
+    std::mt19937 random(25);
+    checkKernels(random);
+    checkSines();
+
+    LockIn unknown;
+    const Flt32 sample = 1.0f;
+    CHECK(unknown.addReference(100.0, 0.1) == 0);
+    CHECK(unknown.push(&sample, 1) == DYB_WrongContext);
+
+    return asc500test::result("test_lockin");
+}
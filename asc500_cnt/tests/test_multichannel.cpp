@@ -0,0 +1,136 @@
+/* Multi-channel acquisition: alignment of uneven packets, lost data in one
+ * channel, epochs of new frames and the pixel coordinates of the records.
+ */
+
+#include <vector>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500_coords.h"
+#include "asc500_multichannel.h"
+
+using namespace asc500;
+
+
+/* Records as handed out, value of channel c at index i is 1000 * c + i */
+struct Records
+{
+    std::vector<int32_t> index, lines;
+    int32_t wrong = 0;
+
+    MultiChannelAcquisition::BlockHandler handler()
+    {
+        return [this](const AlignedBlock &block)
+        {
+            for(int32_t r = 0; r < block.count; r++)
+            {
+                index.push_back(block.firstIndex + r);
+                if(block.lines)
+                    lines.push_back(block.lines[r]);
+                for(int32_t c = 0; c < block.channels; c++)
+                {
+                    const int32_t expected = 1000 * block.channelIds[c] + (block.firstIndex + r) % 1000;
+                    wrong += block.values[r * block.channels + c] != expected ? 1 : 0;
+                }
+            }
+        };
+    }
+};
+
+
+static void feed(MultiChannelAcquisition &engine, const int32_t channel, const int32_t index,
+                 const int32_t length, const DYB_Meta *meta = NULL)
+{
+    std::vector<int32_t> data(length);
+    for(int32_t k = 0; k < length; k++)
+        data[k] = 1000 * channel + (index + k) % 1000;
+    CHECK(engine.feed(channel, index, length, data.data(), meta) == DYB_Ok);
+}
+
+
+/* Small packets against large ones: every index once, in order */
+static void checkUneven()
+{
+    Records records;
+    MultiChannelAcquisition engine(records.handler());
+    CHECK(engine.addChannel(1) == DYB_Ok);
+    CHECK(engine.addChannel(3) == DYB_Ok);
+    CHECK(engine.addChannel(3) == DYB_OutOfRange);
+    CHECK(engine.feed(2, 0, 1, NULL, NULL) == DYB_OutOfRange);
+
+    feed(engine, 1, 0, 900);
+    for(int32_t index = 0; index < 900; index += 7)
+        feed(engine, 3, index, index + 7 <= 900 ? 7 : 900 - index);
+
+    CHECK(records.index.size() == 900);
+    int32_t order = 0;
+    for(size_t k = 0; k < records.index.size(); k++)
+        order += records.index[k] != static_cast<int32_t>(k) ? 1 : 0;
+    CHECK(order == 0);
+    CHECK(records.wrong == 0);
+    CHECK(engine.discarded() == 0);
+}
+
+
+/* Lost data in one channel: the staged part before the gap is still aligned */
+static void checkGap()
+{
+    Records records;
+    MultiChannelAcquisition engine(records.handler());
+    engine.addChannel(0);
+    engine.addChannel(1);
+
+    feed(engine, 1, 0, 40);
+    feed(engine, 1, 60, 40);
+    feed(engine, 0, 0, 100);
+
+    CHECK(records.index.size() == 80);
+    CHECK(records.index.size() == 80 && records.index[39] == 39 && records.index[40] == 60);
+    CHECK(records.wrong == 0);
+    CHECK(engine.discarded() == 20);
+
+    /* Gaps in both channels at different places */
+    feed(engine, 0, 120, 30);
+    feed(engine, 1, 100, 10);
+    feed(engine, 1, 130, 30);
+    feed(engine, 0, 150, 10);
+    CHECK(records.index.size() == 80 + 30);
+    CHECK(records.index.back() == 159);
+    CHECK(records.wrong == 0);
+}
+
+
+/* An index going back starts an epoch; a lagging channel still completes
+ * the old one, and the Y direction follows the epoch */
+static void checkEpochs()
+{
+    Records records;
+    MultiChannelAcquisition engine(records.handler(), MultiChannelAcquisition::AlignPixel);
+    const DYB_Meta meta = dybstub::scanMeta(DYB_FfScan, 4, 3);
+    engine.addChannel(0);
+    engine.addChannel(1);
+
+    feed(engine, 0, 0, 24, &meta);
+    feed(engine, 0, 0, 24, &meta);
+    CHECK(records.index.empty());
+    feed(engine, 1, 0, 24, &meta);
+    CHECK(records.index.size() == 24);
+    feed(engine, 1, 0, 24, &meta);
+    CHECK(records.index.size() == 48);
+    CHECK(records.wrong == 0);
+    CHECK(engine.discarded() == 0);
+
+    int32_t lines = 0;
+    for(size_t k = 0; k < records.lines.size(); k++)
+        lines += records.lines[k] != scanLine(records.index[k] / 8, 3, k >= 24) ? 1 : 0;
+    CHECK(records.lines.size() == 48 && lines == 0);
+}
+
+
+int main()
+{
+    checkUneven();
+    checkGap();
+    checkEpochs();
+    return asc500test::result("test_multichannel");
+}
@@ -0,0 +1,115 @@
+/* Parameter cache: misses, hits, maximum age, events during a synchronous
+ * read and concurrent writers.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500_paramcache.h"
+
+using namespace asc500;
+
+static const DYB_Address ParamA = 0x100,
+                         ParamB = 0x101;
+
+
+static void checkReads()
+{
+    dybstub::reset();
+    dybstub::setParameter(ParamA, 0, 11);
+    ParameterCache cache(16);
+    int32_t value = 0;
+
+    CHECK(!cache.peek(ParamA, 0, &value));
+    CHECK(cache.get(ParamA, 0, &value) == DYB_Ok && value == 11);
+    CHECK(cache.misses() == 1);
+    CHECK(cache.get(ParamA, 0, &value) == DYB_Ok && value == 11);
+    CHECK(cache.hits() == 1);
+
+    /* Values change by events only */
+    dybstub::setParameter(ParamA, 0, 12);
+    CHECK(cache.get(ParamA, 0, &value) == DYB_Ok && value == 11);
+    dybstub::notify(ParamA, 0, 12);
+    CHECK(cache.peek(ParamA, 0, &value) && value == 12);
+
+    /* Too old: read again */
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    dybstub::setParameter(ParamA, 0, 13);
+    CHECK(cache.get(ParamA, 0, &value, 1000000) == DYB_Ok && value == 12);
+    CHECK(cache.get(ParamA, 0, &value, 1000) == DYB_Ok && value == 13);
+    CHECK(cache.misses() == 2);
+
+    cache.invalidate();
+    CHECK(!cache.peek(ParamA, 0, &value));
+    CHECK(cache.prefetch(ParamA, 0) == DYB_Ok);
+    CHECK(cache.peek(ParamA, 0, &value) && value == 13);
+}
+
+
+/* An event during the round trip is newer than the value read back */
+static void checkEventDuringRead()
+{
+    dybstub::reset();
+    dybstub::setParameter(ParamB, 0, 1);
+    ParameterCache cache(16);
+    dybstub::setSyncReadHook([]()
+    {
+        dybstub::setParameter(ParamB, 0, 2);
+        dybstub::notify(ParamB, 0, 2);
+    });
+
+    int32_t value = 0;
+    CHECK(cache.get(ParamB, 0, &value) == DYB_Ok);
+    CHECK(value == 2);
+    CHECK(cache.peek(ParamB, 0, &value) && value == 2);
+
+    /* Without an event the read back is stored */
+    dybstub::setSyncReadHook(std::function<void()>());
+    dybstub::setParameter(ParamB, 1, 7);
+    CHECK(cache.get(ParamB, 1, &value) == DYB_Ok && value == 7);
+    CHECK(cache.peek(ParamB, 1, &value) && value == 7);
+}
+
+
+/* Writers are serialized: a reader never sees a value go back */
+static void checkConcurrent()
+{
+    dybstub::reset();
+    ParameterCache cache(16);
+    cache.store(ParamA, 0, 0);
+    std::atomic<bool> done(false);
+    int32_t backwards = 0;
+
+    std::thread reader([&]()
+    {
+        int32_t last = 0, value = 0;
+        while(!done.load())
+        {
+            if(cache.peek(ParamA, 0, &value))
+            {
+                backwards += value < last ? 1 : 0;
+                last = value;
+            }
+        }
+    });
+    for(int32_t k = 1; k <= 100000; k++)
+        dybstub::notify(ParamA, 0, k);
+    done = true;
+    reader.join();
+
+    int32_t value = 0;
+    CHECK(backwards == 0);
+    CHECK(cache.peek(ParamA, 0, &value) && value == 100000);
+}
+
+
+int main()
+{
+    checkReads();
+    checkEventDuringRead();
+    checkConcurrent();
+    return asc500test::result("test_paramcache");
+}
@@ -0,0 +1,162 @@
+/* Profiles: the hash of known tables, the compiled file round trip with
+ * repeated entries, corrupted files and the delta applied to the stub
+ * server.
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500_profile.h"
+
+using namespace asc500;
+
+static const char *FileName = "test_profile.a5pb";
+
+/* Repeated parameter: the last value wins; hex values are bit patterns */
+static const char *Text =
+    "<Profile>\n"
+    "  <Persistence>\n"
+    "    <Persist Addr=\"0x200\" Index=\"0\" Value=\"7\"/>\n"
+    "    <Persist Addr=\"0x100\" Index=\"1\" Value=\"0xFFFFFFFF\"/>\n"
+    "    <Persist Addr=\"256\" Index=\"0\" Value=\"5\"/>\n"
+    "    <Persist Addr=\"0x200\" Index=\"0\" Value=\"42\"/>\n"
+    "  </Persistence>\n"
+    "</Profile>\n";
+
+
+static std::vector<char> readFile(const char *name)
+{
+    std::vector<char> bytes;
+    FILE *file = fopen(name, "rb");
+    if(!file)
+        return bytes;
+    char buffer[256];
+    size_t n = 0;
+    while((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        bytes.insert(bytes.end(), buffer, buffer + n);
+    fclose(file);
+    return bytes;
+}
+
+
+static void writeFile(const char *name, const std::vector<char> &bytes)
+{
+    FILE *file = fopen(name, "wb");
+    if(!file)
+        return;
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+
+/* FNV-1a over the 32 bit fields, values computed independently */
+static void checkHash()
+{
+    CHECK(profileHash(NULL, 0) == 14695981039346656037ULL);
+
+    const ProfileEntry one[] = { { 1, 2, 3 } };
+    CHECK(profileHash(one, 1) == 15035938162879559083ULL);
+
+    const ProfileEntry table[] = { { 0x100, 0, 5 }, { 0x100, 1, -1 }, { 0x200, 0, 42 } },
+                       swapped[] = { { 0x100, 1, -1 }, { 0x100, 0, 5 }, { 0x200, 0, 42 } };
+    CHECK(profileHash(table, 3) == 7598072344409570754ULL);
+    CHECK(profileHash(swapped, 3) != profileHash(table, 3));
+}
+
+
+static void checkCompiled()
+{
+    Profile profile;
+    CHECK(profile.parse(Text) == DYB_Ok);
+    CHECK(profile.entries().size() == 4);
+    CHECK(profile.parse("<Persist Addr=\"0x100\" Index=\"x\" Value=\"1\"/>") == DYB_XmlError);
+    CHECK(profile.parse(Text) == DYB_Ok);
+
+    CHECK(compileProfile(profile, FileName) == DYB_Ok);
+    CompiledProfile compiled;
+    CHECK(compiled.open(FileName) == DYB_Ok);
+    CHECK(compiled.size() == 3);
+    CHECK(compiled.hash() == 7598072344409570754ULL);
+    if(compiled.size() == 3)
+    {
+        const ProfileEntry *e = compiled.entries();
+        CHECK(e[0].address == 0x100 && e[0].index == 0 && e[0].value == 5);
+        CHECK(e[1].address == 0x100 && e[1].index == 1 && e[1].value == -1);
+        CHECK(e[2].address == 0x200 && e[2].index == 0 && e[2].value == 42);
+    }
+    compiled.close();
+    CHECK(compiled.size() == 0 && compiled.entries() == NULL);
+
+    /* A changed value no longer matches the hash, a cut file the size */
+    const std::vector<char> good = readFile(FileName);
+    CHECK(good.size() == 32 + 3 * sizeof(ProfileEntry));
+    std::vector<char> bad(good);
+    bad[bad.size() - 1] ^= 1;
+    writeFile(FileName, bad);
+    CHECK(compiled.open(FileName) == DYB_Error);
+    bad.assign(good.begin(), good.end() - 4);
+    writeFile(FileName, bad);
+    CHECK(compiled.open(FileName) == DYB_Error);
+    writeFile(FileName, good);
+    CHECK(compiled.open(FileName) == DYB_Ok);
+    compiled.close();
+}
+
+
+/* Only differing entries are sent; a profile in place sends nothing */
+static void checkDelta()
+{
+    dybstub::reset();
+    dybstub::setParameter(0x100, 0, 5);
+    dybstub::setParameter(0x100, 1, 0);
+    dybstub::setParameter(0x200, 0, 7);
+
+    Profile profile;
+    profile.parse(Text);
+    CompiledProfile compiled;
+    CHECK(compiled.open(FileName) == DYB_Ok);
+
+    ParameterCache cache;
+    CHECK(!profileMatches(compiled, cache));
+
+    std::vector<ProfileChange> changes;
+    CHECK(diffProfile(profile, cache, changes, 500) == DYB_Ok);
+    CHECK(changes.size() == 2);
+    CHECK(!profileMatches(compiled, cache));            /* Cached now, but different */
+
+    CHECK(applyProfileDelta(compiled, cache, changes, 500) == DYB_Ok);
+    CHECK(changes.size() == 2);
+    if(changes.size() == 2)
+    {
+        CHECK(changes[0].address == 0x100 && changes[0].index == 1);
+        CHECK(changes[0].oldValue == 0 && changes[0].newValue == -1 && changes[0].acknowledged);
+        CHECK(changes[1].address == 0x200 && changes[1].oldValue == 7 && changes[1].newValue == 42);
+        CHECK(changes[1].acknowledged && changes[1].returned == 42);
+    }
+    CHECK(dybstub::parameter(0x100, 1) == -1);
+    CHECK(dybstub::parameter(0x200, 0) == 42);
+
+    /* In place: decided from the cache alone */
+    CHECK(profileMatches(compiled, cache));
+    const int32_t requests = dybstub::requests();
+    CHECK(applyProfileDelta(compiled, cache, changes, 500) == DYB_Ok);
+    CHECK(changes.empty());
+    CHECK(dybstub::requests() == requests);
+    CHECK(applyProfileDelta(profile, cache, changes, 500) == DYB_Ok);
+    CHECK(changes.empty());
+    CHECK(dybstub::requests() == requests);
+    compiled.close();
+}
+
+
+int main()
+{
+    checkHash();
+    checkCompiled();
+    checkDelta();
+    remove(FileName);
+    return asc500test::result("test_profile");
+}
@@ -0,0 +1,147 @@
+/* Image pyramid: SSE2 and AVX2 reduction against the scalar reference,
+ * and a pyramid updated line by line against a direct computation.
+ */
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "asc500_test.h"
+
+/* The kernels are static */
+#include "../asc500_pyramid.cpp"
+
+using namespace asc500;
+
+static const Flt32 NaN = std::numeric_limits<Flt32>::quiet_NaN();
+
+
+static bool same(const Flt32 a, const Flt32 b)
+{
+    return (a != a && b != b) || memcmp(&a, &b, sizeof(Flt32)) == 0;
+}
+
+
+static void checkKernels(std::mt19937 &random)
+{
+    std::uniform_real_distribution<Flt32> value(-10.0f, 10.0f);
+    std::uniform_int_distribution<int> hole(0, 3);
+
+    for(int32_t last = 0; last < 40; last++)
+    {
+        std::vector<Flt32> a(2 * last + 2), b(2 * last + 2), reference(last + 1), simd(last + 1);
+        for(size_t k = 0; k < a.size(); k++)
+        {
+            a[k] = hole(random) == 0 ? NaN : value(random);
+            b[k] = hole(random) == 0 ? NaN : value(random);
+        }
+        const int32_t first = last > 3 ? 3 : 0;
+
+        reduceScalar(a.data(), b.data(), first, last, reference.data());
+#ifdef ASC500_SSE2
+        reduceSse2(a.data(), b.data(), first, last, simd.data());
+        for(int32_t j = first; j < last; j++)
+            CHECK(same(simd[j], reference[j]));
+#endif
+#ifdef ASC500_AVX2
+        if(cpuHasAvx2())
+        {
+            reduceAvx2(a.data(), b.data(), first, last, simd.data());
+            for(int32_t j = first; j < last; j++)
+                CHECK(same(simd[j], reference[j]));
+        }
+#endif
+    }
+}
+
+
+/* Next level computed pixel by pixel */
+static std::vector<Flt32> halve(const std::vector<Flt32> &src, const int32_t columns, const int32_t rows)
+{
+    const int32_t outColumns = (columns + 1) / 2,
+                  outRows = (rows + 1) / 2;
+    std::vector<Flt32> out(static_cast<size_t>(outColumns) * outRows);
+
+    for(int32_t r = 0; r < outRows; r++)
+    {
+        for(int32_t c = 0; c < outColumns; c++)
+        {
+            Flt32 sum = 0.0f,
+                  count = 0.0f;
+            for(int k = 0; k < 4; k++)
+            {
+                const int32_t x = 2 * c + k % 2,
+                              y = 2 * r + k / 2;
+                const Flt32 v = x < columns && y < rows ? src[static_cast<size_t>(y) * columns + x] : NaN;
+                if(v == v)
+                {
+                    sum += v;
+                    count += 1.0f;
+                }
+            }
+            out[static_cast<size_t>(r) * outColumns + c] = sum / count;
+        }
+    }
+    return out;
+}
+
+
+static void checkPyramid(std::mt19937 &random, const int32_t columns, const int32_t rows)
+{
+    std::uniform_real_distribution<Flt32> value(0.0f, 100.0f);
+    std::uniform_int_distribution<int> hole(0, 9);
+    std::vector<Flt32> image(static_cast<size_t>(columns) * rows);
+    for(Flt32 &v : image)
+        v = hole(random) == 0 ? NaN : value(random);
+
+    /* As during a scan: one line after the other, bottom to top */
+    ImagePyramid pyramid(4);
+    for(int32_t row = rows - 1; row >= 0; row--)
+        CHECK(pyramid.update(image.data(), columns, rows, row) == DYB_Ok);
+
+    std::vector<Flt32> expected(image);
+    int32_t c = columns,
+            r = rows;
+    for(int32_t level = 0; level < pyramid.levels(); level++)
+    {
+        CHECK(pyramid.columns(level) == c && pyramid.rows(level) == r);
+        std::vector<Flt32> got(static_cast<size_t>(c) * r);
+        CHECK(pyramid.region(level, 0, 0, c, r, got.data()) == DYB_Ok);
+
+        int32_t differ = 0;
+        for(size_t k = 0; k < got.size(); k++)
+            differ += same(got[k], expected[k]) ? 0 : 1;
+        CHECK(differ == 0);
+
+        expected = halve(expected, c, r);
+        c = (c + 1) / 2;
+        r = (r + 1) / 2;
+    }
+    CHECK(pyramid.columns(pyramid.levels() - 1) <= 4 && pyramid.rows(pyramid.levels() - 1) <= 4);
+}
+
+
+int main()
+{
+    std::mt19937 random(20);
+    checkKernels(random);
+    checkPyramid(random, 64, 48);
+    checkPyramid(random, 37, 21);
+    checkPyramid(random, 1, 9);
+
+    /* Closed form: 2x2 blocks of a ramp, one hole */
+    const Flt32 ramp[] = { 0, 1, 2, 3,
+                           4, 5, 6, 7,
+                           8, NaN, 10, 11 };
+    ImagePyramid small(1);
+    CHECK(small.update(ramp, 4, 3, 0, 3) == DYB_Ok);
+    Flt32 level1[4];
+    CHECK(small.region(1, 0, 0, 2, 2, level1) == DYB_Ok);
+    CHECK_NEAR(level1[0], 2.5, 0.0);
+    CHECK_NEAR(level1[1], 4.5, 0.0);
+    CHECK_NEAR(level1[2], 8.0, 0.0);
+    CHECK_NEAR(level1[3], 10.5, 0.0);
+    CHECK(small.region(1, 1, 1, 2, 1, level1) == DYB_OutOfRange);
+
+    return asc500test::result("test_pyramid");
+}
@@ -0,0 +1,127 @@
+/* Scanner control: the two step start handshake driven by state events and
+ * by the fallback poll, commands that are done already, timeouts, and a
+ * command replaced by the next one.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "asc500_test.h"
+#include "daisybase_stub.h"
+#include "asc500.h"
+#include "asc500_events.h"
+#include "asc500_scanner.h"
+
+using namespace asc500;
+
+static std::atomic<int32_t> s_starts(0);
+
+
+static bool ready(std::future<DYB_Rc> &result, const int32_t timeout = 0)
+{
+    return result.wait_for(std::chrono::milliseconds(timeout)) == std::future_status::ready;
+}
+
+
+/* Waits for the start commands sent by another thread */
+static bool startsReach(const int32_t starts, const int32_t timeout)
+{
+    const std::chrono::steady_clock::time_point end =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    while(s_starts < starts && std::chrono::steady_clock::now() < end)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return s_starts == starts;
+}
+
+
+/* The second command follows the end of the move at once */
+static void checkEvents()
+{
+    dybstub::reset();
+    dybstub::setParameter(ID_SCAN_STATUS, 0, SCANSTATE_IDLE);
+    s_starts = 0;
+    ScannerControl control(10000);
+    CHECK(control.status() == SCANSTATE_IDLE);
+
+    std::future<DYB_Rc> result = control.start(5000);
+    CHECK(s_starts == 1);
+    dybstub::notify(ID_SCAN_STATUS, 0, SCANSTATE_MOVING);
+    CHECK(s_starts == 1);
+    CHECK(!ready(result));
+    dybstub::notify(ID_SCAN_STATUS, 0, SCANSTATE_IDLE);
+    CHECK(s_starts == 2);
+    CHECK(!ready(result));
+    dybstub::notify(ID_SCAN_STATUS, 0, SCANSTATE_SCAN);
+    CHECK(ready(result) && result.get() == DYB_Ok);
+    CHECK(s_starts == 2);
+    CHECK(control.transitions() == 4);
+
+    /* Scanning already: nothing sent */
+    result = control.start(5000);
+    CHECK(ready(result) && result.get() == DYB_Ok);
+    CHECK(s_starts == 2);
+
+    result = control.stop(5000);
+    CHECK(dybstub::parameter(ID_SCAN_COMMAND, 0) == SCANRUN_OFF);
+    CHECK(!ready(result));
+    dybstub::notify(ID_SCAN_STATUS, 0, SCANSTATE_IDLE);
+    CHECK(ready(result) && result.get() == DYB_Ok);
+}
+
+
+/* A move too short to be reported: the poll finds the scanner at rest */
+static void checkPoll()
+{
+    dybstub::reset();
+    dybstub::setParameter(ID_SCAN_STATUS, 0, SCANSTATE_IDLE);
+    s_starts = 0;
+    ScannerControl control(20);
+
+    std::future<DYB_Rc> result = control.start(5000);
+    CHECK(s_starts == 1);
+    CHECK(startsReach(2, 2000));
+    CHECK(!ready(result));
+    dybstub::notify(ID_SCAN_STATUS, 0, SCANSTATE_SCAN);
+    CHECK(ready(result, 1000) && result.get() == DYB_Ok);
+    CHECK(s_starts == 2);
+}
+
+
+static void checkFailures()
+{
+    dybstub::reset();
+    dybstub::setParameter(ID_SCAN_STATUS, 0, SCANSTATE_MOVING);
+    s_starts = 0;
+    ScannerControl control(10);
+
+    /* Never at rest: no second command */
+    std::future<DYB_Rc> result = control.start(100);
+    CHECK(ready(result, 2000) && result.get() == DYB_Timeout);
+    CHECK(s_starts == 1);
+
+    /* Replaced by the next command */
+    dybstub::setParameter(ID_SCAN_STATUS, 0, SCANSTATE_IDLE);
+    dybstub::notify(ID_SCAN_STATUS, 0, SCANSTATE_IDLE);
+    result = control.start(5000);
+    std::future<DYB_Rc> stopped = control.stop(5000);
+    CHECK(ready(result) && result.get() == DYB_WrongContext);
+    CHECK(ready(stopped) && stopped.get() == DYB_Ok);
+}
+
+
+int main()
+{
+    const int32_t token = EventHub::subscribe([](const DYB_Address, const int32_t, const int32_t value)
+    {
+        if(value == SCANRUN_ON)
+            s_starts++;
+    }, ID_SCAN_COMMAND);
+
+    checkEvents();
+    checkPoll();
+    checkFailures();
+    EventHub::unsubscribe(token);
+    return asc500test::result("test_scanner");
+}
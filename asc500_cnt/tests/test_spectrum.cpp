@@ -0,0 +1,140 @@
+/* Spectrum: SSE2 and AVX2 butterflies against the scalar reference, the
+ * real FFT against a direct DFT, and the PSD of sines of known power.
+ */
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "asc500_test.h"
+
+/* The kernels are static */
+#include "../asc500_spectrum.cpp"
+
+using namespace asc500;
+
+
+static void checkKernels(std::mt19937 &random)
+{
+    std::uniform_real_distribution<Flt32> value(-1.0f, 1.0f);
+    const int32_t count = 256;
+    std::vector<Flt32> twRe(count / 2), twIm(count / 2), re(count), im(count);
+    for(int32_t k = 0; k < count / 2; k++)
+    {
+        twRe[k] = value(random);
+        twIm[k] = value(random);
+    }
+    for(int32_t k = 0; k < count; k++)
+    {
+        re[k] = value(random);
+        im[k] = value(random);
+    }
+
+    /* Same operations in the same order: bit identical */
+    for(int32_t m = 1; m < count; m *= 2)
+    {
+        std::vector<Flt32> refRe(re), refIm(im), simdRe(re), simdIm(im);
+        stageScalar(refRe.data(), refIm.data(), count, m, twRe.data(), twIm.data());
+#ifdef ASC500_SSE2
+        stageSse2(simdRe.data(), simdIm.data(), count, m, twRe.data(), twIm.data());
+        CHECK(memcmp(simdRe.data(), refRe.data(), count * sizeof(Flt32)) == 0);
+        CHECK(memcmp(simdIm.data(), refIm.data(), count * sizeof(Flt32)) == 0);
+#endif
+#ifdef ASC500_AVX2
+        if(cpuHasAvx2())
+        {
+            simdRe = re;
+            simdIm = im;
+            stageAvx2(simdRe.data(), simdIm.data(), count, m, twRe.data(), twIm.data());
+            CHECK(memcmp(simdRe.data(), refRe.data(), count * sizeof(Flt32)) == 0);
+            CHECK(memcmp(simdIm.data(), refIm.data(), count * sizeof(Flt32)) == 0);
+        }
+#endif
+    }
+}
+
+
+static void checkFft(std::mt19937 &random, const int32_t size)
+{
+    std::uniform_real_distribution<Flt32> value(-1.0f, 1.0f);
+    std::vector<Flt32> in(size), re(size / 2 + 1), im(size / 2 + 1);
+    double magnitude = 0.0;
+    for(Flt32 &v : in)
+    {
+        v = value(random);
+        magnitude += fabs(v);
+    }
+
+    std::shared_ptr<const FftPlan> plan = FftPlan::get(size);
+    CHECK(plan && plan->size() == size);
+    if(!plan)
+        return;
+    plan->forward(in.data(), re.data(), im.data());
+
+    /* Rounding of float butterflies grows with log2(size) */
+    double worst = 0.0;
+    for(int32_t k = 0; k <= size / 2; k++)
+    {
+        double dftRe = 0.0,
+               dftIm = 0.0;
+        for(int32_t n = 0; n < size; n++)
+        {
+            const double phase = -2.0 * Pi * ((static_cast<int64_t>(k) * n) % size) / size;
+            dftRe += in[n] * cos(phase);
+            dftIm += in[n] * sin(phase);
+        }
+        worst = std::max(worst, std::max(fabs(re[k] - dftRe), fabs(im[k] - dftIm)));
+    }
+    CHECK(worst <= 1e-6 * magnitude);
+}
+
+
+/* Sine at an exact bin: one sided power A^2/2 in total */
+static void checkPsd(const SpectrumAnalyzer::Window window, const int32_t bin)
+{
+    const int32_t size = 1024;
+    const double rate = 5000.0,
+                 amplitude = 3.0;
+    SpectrumAnalyzer analyzer(size, -1, window);
+    analyzer.setSampleRate(rate);
+
+    std::vector<Flt32> signal(3 * size);
+    for(size_t n = 0; n < signal.size(); n++)
+        signal[n] = static_cast<Flt32>(amplitude * sin(2.0 * Pi * bin * (n % size) / size + 0.3));
+    CHECK(analyzer.push(signal.data(), static_cast<int32_t>(signal.size())) == DYB_Ok);
+
+    /* Half overlap: segments start every size / 2 samples */
+    std::vector<double> psd(analyzer.bins());
+    CHECK(analyzer.psd(psd.data()) == 5);
+
+    double total = 0.0;
+    int32_t peak = 0;
+    for(int32_t k = 0; k < analyzer.bins(); k++)
+    {
+        total += psd[k] * rate / size;
+        peak = psd[k] > psd[peak] ? k : peak;
+    }
+    CHECK(peak == bin);
+    CHECK_NEAR(analyzer.frequency(peak), bin * rate / size, 1e-9);
+    CHECK_NEAR(total, amplitude * amplitude / 2.0, 1e-4 * amplitude * amplitude);
+    if(window == SpectrumAnalyzer::Rectangular)
+        CHECK_NEAR(psd[bin] * rate / size, amplitude * amplitude / 2.0, 1e-4 * amplitude * amplitude);
+}
+
+
+int main()
+{
+    std::mt19937 random(22);
+    checkKernels(random);
+    for(int32_t size = FftPlan::MinSize; size <= 2048; size *= 2)
+        checkFft(random, size);
+    CHECK(!FftPlan::get(FftPlan::MinSize / 2));
+    CHECK(!FftPlan::get(100));
+    CHECK(FftPlan::get(64) == FftPlan::get(64));
+
+    checkPsd(SpectrumAnalyzer::Rectangular, 37);
+    checkPsd(SpectrumAnalyzer::Hann, 100);
+    checkPsd(SpectrumAnalyzer::BlackmanHarris, 200);
+
+    return asc500test::result("test_spectrum");
+}
@@ -0,0 +1,138 @@
+/* SPSC ring: packets across the end of the buffer, a full ring, oversized
+ * packets, and a producer and a consumer thread running against each other.
+ */
+
+#include <thread>
+#include <vector>
+
+#include "asc500_test.h"
+#include "asc500_spscring.h"
+
+using namespace asc500;
+
+
+/* Payload item k of the packet with index i is i + k */
+static bool push(SpscRing &ring, const int32_t index, const int32_t length)
+{
+    std::vector<int32_t> data(length);
+    for(int32_t k = 0; k < length; k++)
+        data[k] = index + k;
+    DYB_Meta meta = DYB_Meta();
+    meta._pointsX = index;
+    return ring.push(3, index, length, data.data(), &meta);
+}
+
+
+static bool intact(const DataPacket &packet, const int32_t index, const int32_t length)
+{
+    bool ok = packet.channel == 3 && packet.index == index && packet.length == length &&
+              packet.meta._pointsX == index;
+    for(int32_t k = 0; ok && k < length; k++)
+        ok = packet.data[k] == index + k;
+    return ok;
+}
+
+
+/* Lengths that don't divide the capacity: the packets wrap at every place */
+static void checkWrap()
+{
+    SpscRing ring(1000);
+    CHECK(ring.capacity() == 1024);
+
+    DataPacket packet;
+    CHECK(!ring.front(packet));
+    int32_t index = 0, wrong = 0;
+    for(int32_t round = 0; round < 500; round++)
+    {
+        const int32_t lengths[] = { 1 + round % 97, 150 + round % 53, 0 };
+        int32_t first = index;
+        for(const int32_t length : lengths)
+        {
+            CHECK(push(ring, index, length));
+            index += length;
+        }
+        for(const int32_t length : lengths)
+        {
+            wrong += ring.front(packet) && intact(packet, first, length) ? 0 : 1;
+            ring.pop();
+            first += length;
+        }
+        wrong += ring.used() == 0 ? 0 : 1;
+    }
+    CHECK(wrong == 0);
+    CHECK(!ring.front(packet));
+    CHECK(ring.dropped() == 0);
+}
+
+
+/* A full ring drops the new packet and keeps the ones stored */
+static void checkFull()
+{
+    SpscRing ring(1024);
+    int32_t stored = 0;
+    while(push(ring, stored * 100, 100))
+        stored++;
+    CHECK(stored > 1);
+    CHECK(ring.dropped() == 1);
+    CHECK(!push(ring, 0, 600));                          /* More than half the ring */
+    CHECK(ring.dropped() == 2);
+
+    DataPacket packet;
+    int32_t wrong = 0;
+    for(int32_t k = 0; k < stored; k++)
+    {
+        wrong += ring.front(packet) && intact(packet, k * 100, 100) ? 0 : 1;
+        ring.pop();
+    }
+    CHECK(wrong == 0);
+    CHECK(!ring.front(packet));
+    CHECK(push(ring, 7, 100));
+}
+
+
+/* The consumer sees every packet once, in order and intact */
+static void checkThreads()
+{
+    SpscRing ring(4096);
+    const int32_t packets = 200000;
+
+    std::thread producer([&ring]()
+    {
+        int32_t index = 0;
+        for(int32_t p = 0; p < packets; p++)
+        {
+            const int32_t length = 1 + p % 61;
+            while(!push(ring, index, length))
+                std::this_thread::yield();
+            index += length;
+        }
+    });
+
+    DataPacket packet;
+    int32_t received = 0, index = 0, wrong = 0;
+    while(received < packets)
+    {
+        if(!ring.front(packet))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        const int32_t length = 1 + received % 61;
+        wrong += intact(packet, index, length) ? 0 : 1;
+        ring.pop();
+        index += length;
+        received++;
+    }
+    producer.join();
+    CHECK(wrong == 0);
+    CHECK(!ring.front(packet));
+}
+
+
+int main()
+{
+    checkWrap();
+    checkFull();
+    checkThreads();
+    return asc500test::result("test_spscring");
+}
@@ -0,0 +1,99 @@
+/* Time series store: chunks across index resets and gaps, the search on
+ * the unwrapped index, and files of another version.
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "asc500_test.h"
+#include "asc500_tsstore.h"
+
+using namespace asc500;
+
+static const char *FileName = "test_tsstore.a5ts";
+
+
+/* Samples hold their unwrapped index */
+static void append(TimeSeriesWriter &writer, const int32_t index, const int32_t length,
+                   const int64_t unwrapped)
+{
+    const DYB_Meta meta = DYB_Meta();
+    std::vector<int32_t> data(length);
+    for(int32_t k = 0; k < length; k++)
+        data[k] = static_cast<int32_t>(unwrapped + k);
+    CHECK(writer.append(index, length, data.data(), &meta) == DYB_Ok);
+}
+
+
+static void checkWrite()
+{
+    TimeSeriesWriter writer;
+    CHECK(writer.open(FileName, 3, 10) == DYB_Ok);
+    append(writer, 0, 25, 0);
+    append(writer, 0, 15, 25);      /* Reset: continues at 25     */
+    append(writer, 20, 10, 45);     /* Gap of 5 after the reset   */
+    CHECK(writer.samples() == 50);
+    CHECK(writer.chunks() == 6);
+    CHECK(writer.close() == DYB_Ok);
+}
+
+
+static void checkRead()
+{
+    TimeSeriesReader reader;
+    CHECK(reader.open(FileName) == DYB_Ok);
+    CHECK(reader.channel() == 3 && reader.chunkSamples() == 10 && reader.chunks() == 6);
+
+    const int64_t first[] = { 0, 10, 20, 25, 35, 45 };
+    const int32_t raw[] = { 0, 10, 20, 0, 10, 20 },
+                  count[] = { 10, 10, 5, 10, 5, 10 };
+    for(int64_t chunk = 0; chunk < 6; chunk++)
+    {
+        ChunkInfo info;
+        CHECK(reader.chunkInfo(chunk, info) == DYB_Ok);
+        CHECK(info.firstIndex == first[chunk] && info.rawIndex == raw[chunk] && info.count == count[chunk]);
+    }
+    CHECK(reader.findIndex(-5) == 0);
+    CHECK(reader.findIndex(37) == 4);
+    CHECK(reader.findIndex(42) == 4);
+    CHECK(reader.findIndex(1000) == 5);
+
+    int32_t samples = 0, wrong = 0;
+    CHECK(reader.readIndexRange(20, 47, [&](const ChunkInfo &info, const int32_t *data)
+    {
+        for(int32_t k = 0; k < info.count; k++)
+            wrong += data[k] != info.firstIndex + k ? 1 : 0;
+        wrong += info.rawIndex != (info.firstIndex < 25 ? info.firstIndex : info.firstIndex - 25) ? 1 : 0;
+        samples += info.count;
+    }) == DYB_Ok);
+    CHECK(samples == 5 + 15 + 3);
+    CHECK(wrong == 0);
+    reader.close();
+}
+
+
+/* Only the current format version is read */
+static void checkVersion()
+{
+    FILE *file = fopen(FileName, "r+b");
+    CHECK(file != NULL);
+    if(!file)
+        return;
+    const unsigned char version[4] = { 2, 0, 0, 0 };
+    fseek(file, 4, SEEK_SET);
+    fwrite(version, 1, sizeof(version), file);
+    fclose(file);
+
+    TimeSeriesReader reader;
+    CHECK(reader.open(FileName) == DYB_Error);
+}
+
+
+int main()
+{
+    checkWrite();
+    checkRead();
+    checkVersion();
+    remove(FileName);
+    return asc500test::result("test_tsstore");
+}
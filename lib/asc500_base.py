@@ -198,6 +198,9 @@ class ASC500Base():
         # Minimum exposure time of counter
         self.minExpTime = 2.5e-6
 
+        # Reusable ctypes buffers of getDataBuffer, keyed by channel
+        self._bufferPool = {}
+
         # Aliases for the functions from the dll. For handling return
         # values: '.errcheck' is an attribute from ctypes.
         # Taken from daisybase.h,v 1.13 2016/10/24 17:55:23
@@ -727,7 +730,7 @@ class ASC500Base():
         out = self._getFrameSize(chn)
         return out
 
-    def getDataBuffer(self, chn, fullOnly, dataSize):
+    def getDataBuffer(self, chn, fullOnly, dataSize, reuse=False):
         """
         Retrieve Data Channel Buffer.
 
@@ -756,6 +759,11 @@ class ASC500Base():
         dataSize : int
             Size of the data buffer provided by the user.
             If insufficient, DYB_OutOfRange will be returned.
+        reuse : bool, optional
+            Recycle the data and meta arrays of the previous call for this
+            channel instead of allocating new ones. They are reallocated only
+            if dataSize changes. The returned arrays are then overwritten by
+            the next call, so copy what must be kept. The default is False.
 
         Returns
         -------
@@ -777,8 +785,15 @@ class ASC500Base():
         frameN = ct.c_int32(0)
         index = ct.c_int32(0)
         dSize = ct.c_int32(dataSize)
-        data = (ct.c_int32 * dataSize)()
-        meta = (ct.c_int32 * 13)()
+        if reuse:
+            pooled = self._bufferPool.get(chn)
+            if pooled is None or len(pooled[0]) != dataSize:
+                pooled = ((ct.c_int32 * dataSize)(), (ct.c_int32 * 13)())
+                self._bufferPool[chn] = pooled
+            data, meta = pooled
+        else:
+            data = (ct.c_int32 * dataSize)()
+            meta = (ct.c_int32 * 13)()
         self._getDataBuffer(ct.c_int32(chn),
                             ct.c_bool(fullOnly),
                             ct.byref(frameN),